@@ -1,6 +1,9 @@
 #ifndef _ADDRESS_H
 #define _ADDRESS_H /* Módulo address */
 
+#include <stdbool.h>
+#include <stddef.h>
+
 /**
  * Retrieves the IP address of the running machine.
  *
@@ -11,5 +14,24 @@
  */
 char* get_ip_address();
 
+/**
+ * Checks whether the given IPv4 address belongs to the running machine.
+ *
+ * @param address The address, in dotted notation (or "localhost").
+ * @return true if a server at this address is co-located with the caller, false otherwise.
+ */
+bool is_local_address(char* address);
+
+/**
+ * Builds the path of the Unix socket of the server listening on the given TCP port
+ * (a node-db-<port>.sock file in the directory named by NODEDB_SOCKET_DIR, /tmp by default).
+ *
+ * @param port The TCP port of the server.
+ * @param path The buffer to store the path.
+ * @param size The size of the buffer.
+ * @return 0 (OK) or -1 if the path does not fit the buffer.
+ */
+int local_socket_path(int port, char* path, size_t size);
+
 
 #endif
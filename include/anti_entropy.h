@@ -0,0 +1,109 @@
+#ifndef _ANTI_ENTROPY_H
+#define _ANTI_ENTROPY_H /* Anti-entropy module */
+
+#include "digest.h"
+#include "message.h"
+#include "snapshot.h"
+
+#include <stdbool.h>
+#include <pthread.h>
+
+struct TableServerDistributedDatabase;
+
+/* Every NODEDB_ANTI_ENTROPY_MS, a server compares its table with the one of the server it gets
+ * its mutations from (its predecessor, or the head in fan-out mode) by digest (see digest.h),
+ * with OP_DIGEST requests: CT_NONE asks for the digests of the groups, CT_RESULT for those of
+ * the buckets of group result, and CT_TABLE for the entries of the buckets listed in digests,
+ * as many as fit in a frame (result is 1 if some were left out).
+ * Mutations still on their way make buckets differ for a moment, so only the buckets found
+ * different by two rounds in a row are repaired: their entries are copied from the
+ * predecessor, and the keys it lacks deleted, the same way as a joining server copies a table
+ * (see ddb_set_syncing()), so that replicated mutations take precedence. Only the keys of the
+ * buckets repaired go over the network.
+ * The value copied from the predecessor may not be committed yet, so a repaired key is dirty
+ * (see dirty_keys.h) until a later round finds the tail holding the same value.
+ */
+
+// Key left dirty by a repair; the key follows the struct
+struct anti_entropy_key_t {
+    struct anti_entropy_key_t* next;
+    char key[];
+};
+
+// Anti-entropy of a server
+struct anti_entropy_t {
+    struct TableServerDistributedDatabase* ddb;
+    int interval_ms;                    // NODEDB_ANTI_ENTROPY_MS, 0 if disabled
+    pthread_t thread;
+    pthread_mutex_t mutex;              // guards source and stop
+    pthread_cond_t cond;
+    char* source;                       // address:port of the predecessor, NULL for the head
+    bool stop;
+    pthread_mutex_t round_mutex;        // held by a round, or while the server rejoins the chain
+    bool suspects[DIGEST_BUCKETS];      // buckets found different by the last round
+    struct anti_entropy_key_t* repaired; // keys left dirty by the repairs (under round_mutex)
+};
+
+/**
+ * @brief Starts comparing the table with the one of the predecessor periodically, on a thread
+ * of its own (unless NODEDB_ANTI_ENTROPY_MS is 0).
+ *
+ * @param ae The anti-entropy.
+ * @param ddb The distributed database.
+ * @return 0 (OK) or -1 on error.
+ */
+int anti_entropy_start(struct anti_entropy_t* ae, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Sets the server the table is compared with.
+ *
+ * @param ae The anti-entropy.
+ * @param source The address:port of the predecessor, or NULL if there is none.
+ */
+void anti_entropy_set_source(struct anti_entropy_t* ae, const char* source);
+
+/**
+ * @brief Waits for the running round, if any, and holds the next ones back until
+ * anti_entropy_resume(), while the server copies its table again.
+ *
+ * @param ae The anti-entropy.
+ */
+void anti_entropy_pause(struct anti_entropy_t* ae);
+
+/**
+ * @brief Lets the rounds held back by anti_entropy_pause() run.
+ *
+ * @param ae The anti-entropy.
+ */
+void anti_entropy_resume(struct anti_entropy_t* ae);
+
+/**
+ * @brief Compares the table with the one of the predecessor, repairing the buckets that
+ * differed in the previous round too.
+ *
+ * @param ae The anti-entropy.
+ * @return The number of keys repaired, or -1 on error.
+ */
+int anti_entropy_round(struct anti_entropy_t* ae);
+
+/**
+ * @brief Stops the rounds and frees the anti-entropy.
+ *
+ * @param ae The anti-entropy.
+ */
+void anti_entropy_stop(struct anti_entropy_t* ae);
+
+#define ANTI_ENTROPY_DEFAULT_MS 1000
+#define ANTI_ENTROPY_MAX_BUCKETS 64     // buckets of a CT_TABLE request
+#define ANTI_ENTROPY_MAX_ENTRIES 512    // entries of a CT_TABLE response
+#define ANTI_ENTROPY_BUDGET (MESSAGE_MAX_FRAME_SIZE - ANTI_ENTROPY_MAX_ENTRIES * SNAPSHOT_ENTRY_OVERHEAD - 64)
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define ANTI_ENTROPY_ENABLED "[ \033[1;35mAnti-Entropy\033[0m ] - Comparing the table with the predecessor every %d ms\n"
+#define ANTI_ENTROPY_REPAIRED "[ \033[1;35mAnti-Entropy\033[0m ] - %d bucket(s) differed from %s: %d key(s) repaired\n"
+#define ANTI_ENTROPY_TRUNCATED "[ \033[1;35mAnti-Entropy\033[0m ] - Bucket %d does not fit in a frame: only its puts are repaired\n"
+
+#endif
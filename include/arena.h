@@ -0,0 +1,74 @@
+#ifndef _ARENA_H
+#define _ARENA_H /* Arena allocator module */
+
+#include <protobuf-c/protobuf-c.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Block allocated once the arena is full, released on the next reset
+struct arena_overflow_t {
+    struct arena_overflow_t* next;
+    size_t size;
+};
+
+/* Bump-pointer allocator holding the messages decoded for one connection.
+ * Allocations are never released individually: arena_reset() recycles the whole
+ * region once the request is answered. Requests that do not fit spill into overflow
+ * blocks, and the next reset grows the region so that the following ones do fit,
+ * leaving no heap calls in steady state.
+ */
+struct arena_t {
+    uint8_t* base;
+    size_t capacity;
+    size_t used;
+    struct arena_overflow_t* overflow;
+    size_t overflow_size;
+    ProtobufCAllocator allocator;   // hands out arena memory to protobuf-c
+};
+
+/**
+ * @brief Creates an arena.
+ *
+ * @param capacity The initial size of the region.
+ * @return The arena, or NULL on failure.
+ */
+struct arena_t* arena_create(size_t capacity);
+
+/**
+ * @brief Frees the arena and every block allocated from it.
+ *
+ * @param arena The arena.
+ */
+void arena_destroy(struct arena_t* arena);
+
+/**
+ * @brief Allocates size bytes (not zeroed) from the arena.
+ *
+ * @param arena The arena.
+ * @param size The number of bytes.
+ * @return The allocated memory, or NULL on failure.
+ */
+void* arena_alloc(struct arena_t* arena, size_t size);
+
+/**
+ * @brief Releases memory handed to protobuf-c. Arena memory is left for arena_reset(),
+ * while blocks from the system allocator (fields the skeleton replaced in a decoded
+ * request) are freed right away.
+ *
+ * @param arena The arena.
+ * @param ptr The memory to release.
+ */
+void arena_free(struct arena_t* arena, void* ptr);
+
+/**
+ * @brief Recycles every allocation of the arena, growing the region if it overflowed.
+ *
+ * @param arena The arena.
+ */
+void arena_reset(struct arena_t* arena);
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_DEFAULT_CAPACITY (1 << 14)
+
+#endif
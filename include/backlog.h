@@ -0,0 +1,146 @@
+#ifndef _BACKLOG_H
+#define _BACKLOG_H /* Replication backlog module */
+
+#include "data.h"
+#include "sdmessage.pb-c.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct snapshot_log_t;
+
+/* The head of the chain numbers every mutation it applies (its chain seq), and the number
+ * travels down the chain with the mutation (chain_seqs of replicated requests), so that a seq
+ * names the same mutation on every server. Each server keeps the last mutations it applied in
+ * a ring indexed by seq, along with the seq up to which it applied every mutation (mutations of
+ * different lanes may be applied out of order). The ring holds up to NODEDB_BACKLOG_SIZE
+ * mutations and NODEDB_BACKLOG_MB of them, the oldest being dropped first to make room. The
+ * copy of a mutation is made before the backlog is locked, and the ones dropped are freed
+ * after it is unlocked, so that only the ring is updated under its lock. A server rejoining the chain presents that seq
+ * to its new predecessor, which streams only the mutations that follow it when its ring still
+ * holds them all, and its whole table otherwise.
+ * A mutation superseded within a replicated batch is not sent, only its seq: it is applied as
+ * a no-op (MESSAGE_T__OPCODE__OP_BAD) downstream, so that no seq goes missing.
+ */
+
+// Mutation kept for rejoining servers; the key and value follow the struct
+struct backlog_mutation_t {
+    uint64_t seq;
+    MessageT__Opcode opcode;
+    char* key;
+    uint8_t* value;
+    size_t value_size;
+    size_t size;                        // of the struct, key and value
+    struct backlog_mutation_t* next;    // once dropped, until freed
+};
+
+// Last mutations applied by a server, by chain seq
+struct backlog_t {
+    pthread_mutex_t mutex;              // held while a mutation is applied and recorded
+    struct backlog_mutation_t** ring;   // the mutation of seq is at seq % capacity, if still held
+    uint64_t capacity;                  // NODEDB_BACKLOG_SIZE
+    size_t max_bytes;                   // NODEDB_BACKLOG_MB
+    size_t bytes;                       // held by the mutations of the ring
+    uint64_t oldest;                    // no mutation of a lower seq is held
+    uint64_t applied;                   // every mutation up to this seq was applied
+    uint64_t last;                      // highest seq applied
+    uint64_t* ahead;                    // bitmap of the seqs of (applied, applied + BACKLOG_WINDOW] applied
+};
+
+/**
+ * @brief Initializes an empty backlog holding up to NODEDB_BACKLOG_SIZE mutations and
+ * NODEDB_BACKLOG_MB of them.
+ *
+ * @param backlog The backlog.
+ * @return 0 (OK) or -1 on error.
+ */
+int backlog_init(struct backlog_t* backlog);
+
+/**
+ * @brief Frees the mutations held by the backlog.
+ *
+ * @param backlog The backlog.
+ */
+void backlog_destroy(struct backlog_t* backlog);
+
+/**
+ * @brief Copies a mutation to be recorded, before the backlog is locked.
+ *
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT, MESSAGE_T__OPCODE__OP_DEL or MESSAGE_T__OPCODE__OP_BAD (no-op).
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @return The copy, or NULL on error (the mutation is then not kept, which only costs a copy of
+ * the table to a server rejoining after it).
+ */
+struct backlog_mutation_t* backlog_mutation_create(MessageT__Opcode opcode, char* key, struct data_t* value);
+
+/**
+ * @brief Locks the backlog before a mutation is applied, so that mutations are recorded in
+ * the order they are applied. Finish with backlog_end().
+ *
+ * @param backlog The backlog.
+ * @param seq The chain seq of the mutation, or 0 for a new mutation (this server is the head).
+ * @return The chain seq of the mutation.
+ */
+uint64_t backlog_begin(struct backlog_t* backlog, uint64_t seq);
+
+/**
+ * @brief Records the mutation begun with backlog_begin(), if applied, and unlocks the backlog.
+ *
+ * @param backlog The backlog.
+ * @param seq The chain seq returned by backlog_begin().
+ * @param mutation The copy of the mutation made by backlog_mutation_create() (taken over), or NULL.
+ * @param applied Whether the mutation was applied (else it is forgotten).
+ */
+void backlog_end(struct backlog_t* backlog, uint64_t seq, struct backlog_mutation_t* mutation, bool applied);
+
+/**
+ * @brief Returns the seq up to which every mutation was applied.
+ *
+ * @param backlog The backlog.
+ * @return The seq, 0 if none.
+ */
+uint64_t backlog_applied(struct backlog_t* backlog);
+
+/**
+ * @brief Takes every mutation up to seq as applied (a copy of a table holding them was).
+ *
+ * @param backlog The backlog.
+ * @param seq The seq.
+ */
+void backlog_advance(struct backlog_t* backlog, uint64_t seq);
+
+/**
+ * @brief Takes the mutations up to seq as applied, and those after it as applied only if
+ * they were since, the table being replaced by a copy holding the former.
+ *
+ * @param backlog The backlog.
+ * @param seq The seq the copy holds every mutation up to.
+ */
+void backlog_reset(struct backlog_t* backlog, uint64_t seq);
+
+/**
+ * @brief Logs, in order, the mutations applied after seq for a rejoining server, provided the
+ * backlog still holds all of them and they fit in the log. No mutation may be applied meanwhile.
+ *
+ * @param backlog The backlog.
+ * @param since The last seq the rejoining server applied every mutation up to.
+ * @param log The log of the rejoining server.
+ * @return 0 (OK) or -1 if the whole table must be copied instead.
+ */
+int backlog_copy_since(struct backlog_t* backlog, uint64_t since, struct snapshot_log_t* log);
+
+#define BACKLOG_DEFAULT_SIZE 65536
+#define BACKLOG_DEFAULT_MB 64
+#define BACKLOG_WINDOW 65536            // seqs tracked beyond the applied one
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define BACKLOG_DELTA "[ \033[1;35mBacklog\033[0m ] - Sending the %lu mutation(s) applied after seq %lu\n"
+#define BACKLOG_NOT_COVERED "[ \033[1;35mBacklog\033[0m ] - Seq %lu is not covered by the backlog (applied up to %lu), copying the whole table\n"
+
+#endif
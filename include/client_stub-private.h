@@ -2,11 +2,19 @@
 #define _CLIENT_STUB_PRIVATE_H
 
 #include "client_stub.h"
+#include "shm_ring.h"
+
+#include <stdint.h>
+#include <stdbool.h>
 
 struct rtable_t {
     char *server_address;
     int server_port;
     int sockfd;
+    struct shm_endpoint_t* shm;     // shared memory channel, if the server is co-located
+    bool compact;                   // connection was upgraded to the compact protocol
+    uint32_t next_request_id;       // request id of the next compact frame
+    uint8_t* buffer;                // COMPACT_MAX_FRAME_SIZE bytes to pack requests and read responses
 };
 
 struct rtable_t* rtable_create(char* address_port);
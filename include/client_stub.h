@@ -3,6 +3,9 @@
 
 #include "data.h"
 #include "entry.h"
+#include "stats.h"
+
+#include <stdbool.h>
 
 /* Remote table, que deve conter as informações necessárias para comunicar
  * com o servidor. A definir pelo grupo em client_stub-private.h
@@ -70,4 +73,18 @@ void rtable_free_entries(struct entry_t **entries);
 /* Obtém as estatísticas do servidor. */
 struct statistics_t* rtable_stats(struct rtable_t *rtable);
 
+/* Obtém as operações lentas do servidor (as mais antigas primeiro), limpando o seu
+ * slow log se reset. Coloca o seu número em n_ops.
+ * Retorna as operações (libertar com stats_destroy_slow_ops()), NULL se não houver
+ * nenhuma, ou NULL com n_ops -1 em caso de erro.
+ */
+struct slow_op_t* rtable_slowlog(struct rtable_t *rtable, bool reset, int* n_ops);
+
+/* Obtém as chaves mais acedidas do servidor, por operações e por bytes, limpando as
+ * suas contagens se reset. Coloca o seu número em n_keys.
+ * Retorna as chaves (libertar com stats_destroy_hot_keys()), NULL se não houver
+ * nenhuma, ou NULL com n_keys -1 em caso de erro.
+ */
+struct hot_key_t* rtable_hotkeys(struct rtable_t *rtable, bool reset, int* n_keys);
+
 #endif
@@ -0,0 +1,101 @@
+#ifndef _COMPACT_PROTOCOL_H
+#define _COMPACT_PROTOCOL_H /* Compact protocol module */
+
+#include "sdmessage.pb-c.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sys/types.h>
+
+/* Once a connection is upgraded (an OP_HELLO request carrying COMPACT_PROTOCOL_VERSION in
+ * its result field, answered with OP_HELLO + 1), every frame in both directions is a
+ * COMPACT_HEADER_SIZE-byte header followed by key_length key bytes and value_length value bytes:
+ *
+ *   | opcode (1) | flags (1) | key_length (2) | value_length (4) | request_id (4) |
+ *
+ * (multi-byte fields in network order). PUT, GET and DEL travel as raw bytes; every other
+ * operation travels as a COMPACT_OP_PROTOBUF frame whose value is a packed MessageT.
+ * Responses echo the opcode and request_id of the request.
+ */
+#define COMPACT_PROTOCOL_VERSION 1
+#define COMPACT_HEADER_SIZE 12
+#define COMPACT_MAX_PAYLOAD USHRT_MAX                                   // key + value bytes
+#define COMPACT_MAX_FRAME_SIZE (COMPACT_HEADER_SIZE + COMPACT_MAX_PAYLOAD)
+
+enum CompactOpcode {
+    COMPACT_OP_PUT = 1,
+    COMPACT_OP_GET = 2,
+    COMPACT_OP_DEL = 3,
+    COMPACT_OP_PROTOBUF = 4
+};
+
+#define COMPACT_FLAG_ERROR 0x01     // response: the operation failed (or the key was not found)
+
+struct compact_header_t {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t key_length;
+    uint32_t value_length;
+    uint32_t request_id;
+};
+
+/**
+ * @brief Serializes a header into the first COMPACT_HEADER_SIZE bytes of buffer.
+ *
+ * @param header The header.
+ * @param buffer The destination buffer.
+ */
+void compact_header_encode(struct compact_header_t* header, uint8_t* buffer);
+
+/**
+ * @brief Deserializes the header at the start of buffer.
+ *
+ * @param buffer The first COMPACT_HEADER_SIZE bytes of a frame.
+ * @param header The header to fill.
+ * @return 0 (OK) or -1 if the header is invalid (unknown opcode or payload too large).
+ */
+int compact_header_decode(const uint8_t* buffer, struct compact_header_t* header);
+
+/**
+ * @brief Returns the number of payload (key + value) bytes following the header.
+ *
+ * @param header The header.
+ * @return The payload size.
+ */
+size_t compact_payload_size(struct compact_header_t* header);
+
+/**
+ * @brief Packs msg into buffer as a complete COMPACT_OP_PROTOBUF frame.
+ *
+ * @param msg The message.
+ * @param request_id The request id of the frame.
+ * @param buffer The destination buffer.
+ * @param capacity The number of bytes available in buffer.
+ * @return The frame size or -1 on error (including a buffer too small).
+ */
+ssize_t compact_pack_message(MessageT* msg, uint32_t request_id, uint8_t* buffer, size_t capacity);
+
+/**
+ * @brief Sends a frame made of header, key and value (either may be NULL when empty)
+ * with a single gathering write.
+ *
+ * @param fd The socket.
+ * @param header The header (key_length and value_length give the sizes of key and value).
+ * @param key The key bytes.
+ * @param value The value bytes.
+ * @return 0 (OK) or -1 on error.
+ */
+int compact_send_frame(int fd, struct compact_header_t* header, const void* key, const void* value);
+
+/**
+ * @brief Reads the next frame, storing its payload in buffer.
+ *
+ * @param fd The socket.
+ * @param header The header to fill.
+ * @param buffer The buffer to store the payload (at least COMPACT_MAX_PAYLOAD bytes).
+ * @return 0 (OK) or -1 on error.
+ */
+int compact_read_frame(int fd, struct compact_header_t* header, uint8_t* buffer);
+
+#endif
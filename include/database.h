@@ -4,19 +4,21 @@
 #include "table.h"
 #include "stats.h"
 #include "client_stub.h"
+#include "digest.h"
 
 #include <pthread.h>
+#include <stdint.h>
 
 struct TableServerDatabase {
     struct table_t* table;
     pthread_mutex_t table_mutex;
+    struct digest_t* digest;            // digests of the buckets of table, under table_mutex
 
-    struct statistics_t* stats;
-    pthread_mutex_t op_counter_mutex;
-    pthread_mutex_t computed_time_mutex;
+    struct statistics_t* stats;         // active_clients; the other counters are kept per thread (see latency.h)
     pthread_mutex_t active_mutex;
 
     pthread_attr_t thread_attr;
+    uint64_t started_ns;                // see latency_now_ns()
 };
 
 /**
@@ -34,15 +36,6 @@ void database_init(struct TableServerDatabase* db, int n_lists);
  */
 void database_destroy(struct TableServerDatabase* db);
 
-/**
- * @brief Migrates the table entries from a remote table to the local database.
- * 
- * @param db The local database.
- * @param migration_table The remote table to migrate from.
- * @return 0 on success, -1 on failure.
- */
-int db_migrate_table(struct TableServerDatabase* db, struct rtable_t* migration_table);
-
 /**
  * @brief Decrements the count of active clients in the database.
  * 
@@ -58,20 +51,29 @@ void db_decrement_active_clients(struct TableServerDatabase* db);
 void db_increment_active_clients(struct TableServerDatabase* db);
 
 /**
- * @brief Increments the operation counter in the database.
+ * @brief Increments the operation counter of the calling thread, without locking.
  * 
  * @param db The database.
  */
 void db_increment_op_counter(struct TableServerDatabase* db);
 
 /**
- * @brief Adds the given time delta to the total computed time in the database.
+ * @brief Adds the given time delta to the computed time of the calling thread, without locking.
  * 
  * @param db The database.
- * @param delta The time delta to add.
+ * @param delta The time delta to add, in nanoseconds.
  */
 void db_add_to_computed_time(struct TableServerDatabase* db, long long delta);
 
+/**
+ * @brief Adds up the operation counter and the total computed time of every thread.
+ * 
+ * @param db The database.
+ * @param op_counter The number of operations.
+ * @param computed_time_micros The total computed time, in micro seconds.
+ */
+void db_read_counters(struct TableServerDatabase* db, long long* op_counter, long long* computed_time_micros);
+
 /**
  * @brief Inserts a key-value pair into the database table.
  * 
@@ -91,6 +93,17 @@ int db_table_put(struct TableServerDatabase* db, char* key, struct data_t* value
  */
 struct data_t* db_table_get(struct TableServerDatabase* db, char* key);
 
+/**
+ * @brief Copies the value associated with the given key into buffer, without allocating.
+ * 
+ * @param db The database.
+ * @param key The key.
+ * @param buffer The destination buffer.
+ * @param capacity The size of buffer.
+ * @return The size of the value, -1 if the key is not found, or -2 if the value does not fit.
+ */
+int db_table_read(struct TableServerDatabase* db, char* key, void* buffer, int capacity);
+
 /**
  * @brief Removes the entry with the given key from the database table.
  * 
@@ -116,10 +129,53 @@ int db_table_size(struct TableServerDatabase* db);
  */
 char** db_table_get_keys(struct TableServerDatabase* db);
 
+/**
+ * @brief Removes every entry of the database table.
+ * 
+ * @param db The database.
+ * @return 0 on success, -1 on failure.
+ */
+int db_table_clear(struct TableServerDatabase* db);
+
+/**
+ * @brief Copies the entries that follow a cursor of the database table (see table_scan).
+ * 
+ * @param db The database.
+ * @param index The list of the cursor, updated with the list of the last entry copied.
+ * @param after The key of the cursor (the last entry copied), or NULL to start with the list.
+ * @param entries The array receiving the copies.
+ * @param max The size of entries.
+ * @param budget The size of keys and values after which no further entry is copied.
+ * @return The number of entries copied (0 at the end of the table), or -1 on failure.
+ */
+int db_table_scan(struct TableServerDatabase* db, int* index, char* after, struct entry_t** entries, int max, size_t budget);
+
+/**
+ * @brief Copies the keys that follow a cursor of the database table and are accepted by a
+ * filter, leaving the other entries and every value alone (see table_scan_keys).
+ * 
+ * @param db The database.
+ * @param index The list of the cursor, updated with the list of the last key copied.
+ * @param after The last key copied, or NULL to start with the list.
+ * @param wanted The filter, called with each key and arg under the table lock.
+ * @param arg The argument of wanted.
+ * @param keys The array receiving the copies, to be freed by the caller.
+ * @param max The size of keys.
+ * @return The number of keys copied (0 at the end of the table), or -1 on failure.
+ */
+int db_table_scan_keys(struct TableServerDatabase* db, int* index, char* after, bool (*wanted)(const char* key, void* arg), void* arg, char** keys, int max);
+
+/**
+ * @brief Copies the digests of the buckets of the database table (see digest.h).
+ * 
+ * @param db The database.
+ * @param buckets The array receiving the DIGEST_BUCKETS digests.
+ * @return 0 on success, -1 on failure.
+ */
+int db_table_digest(struct TableServerDatabase* db, uint32_t* buckets);
+
 // ====================================================================================================
 //                                            MESSAGES
 // ====================================================================================================
 
-#define MIGRATING_KEY_VALUE "[ \033[1;35mMigration\033[0m ] - Migrating %s : "
-
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef _DIGEST_H
+#define _DIGEST_H /* Table digest module (anti-entropy) */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Servers of a chain compare their tables by digest instead of by content. Keys are spread over
+ * DIGEST_BUCKETS buckets by the CRC32C of the key, and the digest of a bucket is the XOR of the
+ * CRC32C of every entry (key and value) it holds, each mixed by the splitmix64 finalizer first
+ * so that the differences of several entries do not cancel out: a put or a delete updates it in place, by
+ * XORing the old entry out and the new one in. Buckets are gathered in DIGEST_GROUPS groups of
+ * DIGEST_GROUP_SIZE, whose digests are the XOR of theirs, making a tree of two levels: comparing
+ * the groups, then the buckets of the groups that differ, tells which buckets to repair.
+ * The CRC32C instruction of SSE 4.2 is used when the processor has it.
+ */
+
+#define DIGEST_GROUPS 64
+#define DIGEST_GROUP_SIZE 64
+#define DIGEST_BUCKETS (DIGEST_GROUPS * DIGEST_GROUP_SIZE)
+
+// Digests of the buckets of a table
+struct digest_t {
+    uint32_t buckets[DIGEST_BUCKETS];
+};
+
+/**
+ * @brief Extends a CRC32C (Castagnoli) with size bytes of data.
+ *
+ * @param crc The CRC of the preceding bytes (0 to start).
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The CRC of the preceding bytes and data.
+ */
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+/**
+ * @brief Finds the bucket of key.
+ *
+ * @param key The key.
+ * @return The bucket, in [0, DIGEST_BUCKETS).
+ */
+int digest_bucket(const char* key);
+
+/**
+ * @brief XORs an entry into (or out of) the digest of its bucket.
+ *
+ * @param digest The digest.
+ * @param key The key of the entry.
+ * @param value The value of the entry.
+ * @param size The size of the value.
+ */
+void digest_toggle(struct digest_t* digest, const char* key, const void* value, size_t size);
+
+/**
+ * @brief Computes the digests of the groups of buckets.
+ *
+ * @param digest The digest.
+ * @param groups The array receiving the DIGEST_GROUPS digests.
+ */
+void digest_groups(const struct digest_t* digest, uint32_t* groups);
+
+#endif
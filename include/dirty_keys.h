@@ -0,0 +1,73 @@
+#ifndef _DIRTY_KEYS_H
+#define _DIRTY_KEYS_H /* Dirty keys module (apportioned reads) */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* Every server of the chain answers reads, not only the tail (CRAQ-style apportioned reads).
+ * A key is dirty on a server while a mutation of it was applied there but not yet acknowledged
+ * by the rest of the chain: the local value may not be committed yet, so a read of a dirty key
+ * is answered with the value of the tail instead. Keys are counted once per pending mutation,
+ * and clean keys are not stored, so the set only holds what is in flight.
+ */
+
+#define DIRTY_KEYS_BUCKETS 4096
+#define DIRTY_KEYS_STRIPES 64           // mutexes, each guarding every DIRTY_KEYS_STRIPES-th bucket
+
+// Key with mutations in flight; the key follows the struct
+struct dirty_key_t {
+    struct dirty_key_t* next;
+    uint32_t hash;
+    int pending;                        // mutations applied but not acknowledged
+    char* key;
+};
+
+// Keys of a server with mutations in flight
+struct dirty_keys_t {
+    pthread_mutex_t mutexes[DIRTY_KEYS_STRIPES];
+    struct dirty_key_t* buckets[DIRTY_KEYS_BUCKETS];
+    uint64_t count;                     // dirty keys, read without locking to skip the lookup
+};
+
+/**
+ * @brief Initializes an empty set.
+ *
+ * @param set The set.
+ */
+void dirty_keys_init(struct dirty_keys_t* set);
+
+/**
+ * @brief Frees the keys of the set.
+ *
+ * @param set The set.
+ */
+void dirty_keys_destroy(struct dirty_keys_t* set);
+
+/**
+ * @brief Counts one more mutation in flight for key. Call before applying it locally.
+ *
+ * @param set The set.
+ * @param key The key.
+ * @return 0 (OK) or -1 on error.
+ */
+int dirty_keys_mark(struct dirty_keys_t* set, const char* key);
+
+/**
+ * @brief Counts one mutation in flight for key less (acknowledged or abandoned).
+ *
+ * @param set The set.
+ * @param key The key.
+ */
+void dirty_keys_clear(struct dirty_keys_t* set, const char* key);
+
+/**
+ * @brief Tells whether key has mutations in flight.
+ *
+ * @param set The set.
+ * @param key The key.
+ * @return true if key is dirty.
+ */
+bool dirty_keys_contains(struct dirty_keys_t* set, const char* key);
+
+#endif
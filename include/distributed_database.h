@@ -3,10 +3,34 @@
 
 #include "database.h"
 #include "client_stub.h"
+#include "replication.h"
+#include "dirty_keys.h"
+#include "snapshot.h"
+#include "backlog.h"
+#include "hash_ring.h"
+
+#include <pthread.h>
 
 struct TableServerDistributedDatabase {
     struct TableServerDatabase* db;
-    struct rtable_t* replica; // remote table to receive forwarded requests
+    struct replication_channel_t* replica; // channel to the next server, receiving forwarded mutations
+    struct replication_channel_t** backups; // fan-out mode: channels to every other server of the chain, at the head
+    int n_backups;
+    int quorum; // backups acknowledging a mutation before it is committed (NODEDB_FANOUT_QUORUM, 0 for all)
+    pthread_rwlock_t replica_lock; // held for writing only while the next server changes
+    struct replication_stats_t replication_stats;
+    struct dirty_keys_t dirty_keys; // keys forwarded but not yet acknowledged by the rest of the chain
+    struct rtable_t* tail; // answers reads of dirty keys; NULL if this server is the tail
+    pthread_mutex_t tail_mutex;
+    struct snapshot_log_t* snapshot_logs; // mutations logged for joining servers, changed under replica_lock
+    pthread_mutex_t capture_mutex; // held while a mutation is applied and logged
+    bool syncing; // this server is copying the table of its predecessor
+    pthread_mutex_t sync_mutex;
+    struct dirty_keys_t synced_keys; // keys mutated through replication while syncing
+    struct backlog_t backlog; // last mutations applied, by chain seq, for rejoining servers
+    bool detached; // this server left the chain: replication streams are neither served nor acknowledged
+    int chain; // chain of this server (see hash_ring.h)
+    struct hash_ring_t* ring; // chains holding the keys, changed under replica_lock; NULL until known (every key is held)
 };
 
 /**
@@ -30,7 +54,7 @@ void ddatabase_destroy(struct TableServerDistributedDatabase* ddb);
  * @param ddb The distributed database.
  * @param key The key.
  * @param value The value.
- * @return 0 on success, -1 on failure.
+ * @return 0 on success, -1 on failure (or if the key belongs to another chain).
  */
 int ddb_table_put(struct TableServerDistributedDatabase* ddb, char* key, struct data_t* value);
 
@@ -39,19 +63,207 @@ int ddb_table_put(struct TableServerDistributedDatabase* ddb, char* key, struct
  * 
  * @param ddb The distributed database.
  * @param key The key to be removed.
- * @return 0 on success, -1 on failure.
+ * @return 0 on success, -1 on failure (or if the key belongs to another chain).
  */
 int ddb_table_remove(struct TableServerDistributedDatabase* ddb, char* key);
 
 /**
- * @brief Retrieves the value associated with the given key from the distributed database.
+ * @brief Applies a client PUT or DEL like ddb_table_put() and ddb_table_remove(), but without
+ * waiting for the rest of the chain, nor for room in the window of its lane: for the event
+ * loops, which serve every client from one thread and answer the write once callback is called.
+ * 
+ * @param ddb The distributed database.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT or MESSAGE_T__OPCODE__OP_DEL.
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @param callback Called (from the thread reading the acknowledgements, or the calling thread)
+ * with the status of the mutation once the rest of the chain acknowledged it, if forwarded.
+ * @param arg Argument of callback.
+ * @return DDB_MUTATION_FORWARDED, DDB_MUTATION_APPLIED (done, nothing to forward) or -1 on
+ * failure (or if the key belongs to another chain).
+ */
+int ddb_table_mutate(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    replication_callback_t callback, void* arg);
+
+/**
+ * @brief Applies a mutation locally and, if there is a next server, forwards it without
+ * waiting for its acknowledgement (only for room in the window of its lane).
+ * 
+ * @param ddb The distributed database.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT or MESSAGE_T__OPCODE__OP_DEL.
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @param chain_seq The chain seq of a replicated mutation, or 0 for a new one (see backlog.h).
+ * @param callback Called once the rest of the chain acknowledged the mutation, if forwarded.
+ * @param arg Argument of callback.
+ * @param tag Tag handed to callback.
+ * @return DDB_MUTATION_FORWARDED, DDB_MUTATION_APPLIED (nothing to forward) or -1 on failure.
+ */
+int ddb_mutate(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag);
+
+/**
+ * @brief Replaces the next server, handing it the mutations the previous one did not acknowledge.
+ * 
+ * @param ddb The distributed database.
+ * @param replica The channel to the new next server, or NULL if this server is now the tail.
+ */
+void ddb_set_replica(struct TableServerDistributedDatabase* ddb, struct replication_channel_t* replica);
+
+/**
+ * @brief Replaces the backups of the head in fan-out mode, which sends every mutation to all of
+ * them at once and commits it once the quorum acknowledged it, instead of forwarding it down the
+ * chain. Streams to the backups still there are kept; the mutations the others did not
+ * acknowledge count as failed there.
+ * 
+ * @param ddb The distributed database.
+ * @param addresses The address:port of each backup.
+ * @param n_addresses The number of backups (0 unless this server is the head in fan-out mode).
+ */
+void ddb_set_backups(struct TableServerDistributedDatabase* ddb, char** addresses, int n_addresses);
+
+/**
+ * @brief Leaves the chain: stops forwarding to the next server (or the backups), failing the mutations it did
+ * not acknowledge, and stops acknowledging the replication streams of the previous server,
+ * which then sends its unacknowledged mutations to the next server instead.
+ * 
+ * @param ddb The distributed database.
+ */
+void ddb_detach(struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Serves replication streams again, this server being about to register in the chain.
+ * 
+ * @param ddb The distributed database.
+ */
+void ddb_attach(struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Starts logging the mutations applied from now on for a joining server. The log
+ * stops when the joining server becomes the next server (see ddb_set_replica), at once if
+ * it is already, or with ddb_capture_stop().
+ * 
+ * A rejoining server gets the mutations it misses logged ahead instead, if the backlog still
+ * holds them. A chain taking over keys (log->chain) gets the mutations of those keys only, until
+ * it joins the ring (see ddb_set_ring).
+ * 
+ * @param ddb The distributed database.
+ * @param log The log.
+ * @param since The chain seq the rejoining server applied every mutation up to, or 0.
+ */
+void ddb_capture_start(struct TableServerDistributedDatabase* ddb, struct snapshot_log_t* log, uint64_t since);
+
+/**
+ * @brief Stops logging mutations for a joining server, if not stopped already.
+ * 
+ * @param ddb The distributed database.
+ * @param log The log.
+ */
+void ddb_capture_stop(struct TableServerDistributedDatabase* ddb, struct snapshot_log_t* log);
+
+/**
+ * @brief Replaces the ring telling which keys the chain of this server holds. Mutations of the
+ * keys of other chains are refused from now on, and the logs of the chains that joined the
+ * ring are closed.
+ * 
+ * @param ddb The distributed database.
+ * @param ring The ring (owned by ddb from now on).
+ */
+void ddb_set_ring(struct TableServerDistributedDatabase* ddb, struct hash_ring_t* ring);
+
+/**
+ * @brief Deletes, down the chain, the entries of the keys that moved to other chains.
+ * 
+ * @param ddb The distributed database.
+ * @return The number of entries deleted, or -1 on failure.
+ */
+int ddb_purge(struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Starts or ends copying the table of the predecessor. While copying, the mutations
+ * replicated to this server take precedence over those replayed with ddb_sync_apply().
+ * 
+ * @param ddb The distributed database.
+ * @param syncing Whether the copy starts (true) or ends (false).
+ */
+void ddb_set_syncing(struct TableServerDistributedDatabase* ddb, bool syncing);
+
+/**
+ * @brief Drops what was copied so far, and which keys were mutated through replication,
+ * before copying the table of another predecessor.
+ * 
+ * @param ddb The distributed database.
+ * @return 0 on success, -1 on failure.
+ */
+int ddb_sync_reset(struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Applies a mutation copied from the predecessor, unless the key was already mutated
+ * through replication since the copy started.
+ * 
+ * @param ddb The distributed database.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT, MESSAGE_T__OPCODE__OP_DEL or MESSAGE_T__OPCODE__OP_BAD (no-op).
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @param chain_seq The chain seq of a logged mutation, or 0 for a copied entry.
+ * @return 0 on success, -1 on failure.
+ */
+int ddb_sync_apply(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, uint64_t chain_seq);
+
+/**
+ * @brief Applies an entry repaired by anti-entropy like ddb_sync_apply(), the key turning
+ * dirty first unless this server is the tail: the value copied from the predecessor may not be
+ * committed yet, so reads of the key go to the tail until ddb_repair_settle() clears it.
+ * 
+ * @param ddb The distributed database.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT or MESSAGE_T__OPCODE__OP_DEL.
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @param dirty Set to whether the key was left dirty.
+ * @return 0 on success, -1 on failure.
+ */
+int ddb_repair(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, bool* dirty);
+
+/**
+ * @brief Clears a key left dirty by ddb_repair() once the tail holds the same value.
+ * 
+ * @param ddb The distributed database.
+ * @param key The key.
+ * @param force Whether to clear it anyway.
+ * @return true if the key was cleared.
+ */
+bool ddb_repair_settle(struct TableServerDistributedDatabase* ddb, char* key, bool force);
+
+/**
+ * @brief Replaces the connection to the tail, which answers the reads of dirty keys.
+ * 
+ * @param ddb The distributed database.
+ * @param tail The remote table of the tail (owned by ddb from now on), or NULL if this server is the tail.
+ */
+void ddb_set_tail(struct TableServerDistributedDatabase* ddb, struct rtable_t* tail);
+
+/**
+ * @brief Retrieves the committed value associated with the given key: the local one, unless a
+ * mutation of the key is still in flight down the chain, in which case it is asked to the tail.
  * 
  * @param ddb The distributed database.
  * @param key The key.
- * @return The associated value, or NULL if the key is not found.
+ * @return The associated value, or NULL if the key is not found (or the tail could not answer).
  */
 struct data_t* ddb_table_get(struct TableServerDistributedDatabase* ddb, char* key);
 
+/**
+ * @brief Copies the committed value associated with the given key into buffer, without allocating
+ * unless the value has to be asked to the tail (see ddb_table_get).
+ * 
+ * @param ddb The distributed database.
+ * @param key The key.
+ * @param buffer The destination buffer.
+ * @param capacity The size of buffer.
+ * @return The size of the value, -1 if the key is not found, or -2 if the value does not fit.
+ */
+int ddb_table_read(struct TableServerDistributedDatabase* ddb, char* key, void* buffer, int capacity);
+
 /**
  * @brief Retrieves the number of entries in the distributed database.
  * 
@@ -68,10 +280,27 @@ int ddb_table_size(struct TableServerDistributedDatabase* ddb);
  */
 char** ddb_table_get_keys(struct TableServerDistributedDatabase* ddb);
 
+#define DDB_MUTATION_FORWARDED 0
+#define DDB_MUTATION_APPLIED 1
+
+/**
+ * @brief Reads the lag of the next server (or of every backup, at the head in fan-out mode).
+ * 
+ * @param ddb The distributed database.
+ * @param lags The array receiving the lag of each one.
+ * @param addresses The array receiving their address:port (to be freed).
+ * @param max The size of lags and addresses.
+ * @return The number of servers, or -1 on error.
+ */
+int ddb_replication_lag(struct TableServerDistributedDatabase* ddb, struct replication_lag_t* lags, char** addresses, int max);
+
 // ====================================================================================================
 //                                            MESSAGES
 // ====================================================================================================
 
+#define DB_READING_FROM_TAIL "[ \033[1;33mDatabase\033[0m ] - Key %s is dirty, reading it from the tail\n"
+#define DB_KEY_MOVED "[ \033[1;33mDatabase\033[0m ] - Key %s belongs to another chain, mutation refused\n"
 #define DB_FORWARDING_OPERATION "[ \033[1;33mDatabase\033[0m ] - Forwarding operation to replica/next server (%s:%d)\n"
+#define DB_FANNING_OUT_OPERATION "[ \033[1;33mDatabase\033[0m ] - Sending operation to %d backup(s), committed after %d\n"
 
 #endif
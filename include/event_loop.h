@@ -0,0 +1,61 @@
+#ifndef _EVENT_LOOP_H
+#define _EVENT_LOOP_H /* Event loop module */
+
+#include "distributed_database.h"
+
+// Network backends available to serve client connections
+enum IOBackend {
+    IO_BACKEND_THREADS,     // one blocking thread per client (network_main_loop)
+    IO_BACKEND_EPOLL,       // single thread, readiness-based (epoll)
+    IO_BACKEND_URING        // single thread, completion-based (io_uring), falls back to epoll
+};
+
+/**
+ * @brief Parses the name of a network backend ("threads", "epoll" or "uring").
+ *
+ * @param name The name of the backend.
+ * @return The backend, or IO_BACKEND_THREADS if the name is unknown.
+ */
+enum IOBackend io_backend_parse(char* name);
+
+/**
+ * @brief Returns the name of the given network backend.
+ *
+ * @param backend The backend.
+ * @return The name of the backend.
+ */
+char* io_backend_name(enum IOBackend backend);
+
+/**
+ * @brief Serves clients connecting to listening_socket using the given backend.
+ * The function does not return unless an error occurs.
+ *
+ * @param listening_socket The listening socket.
+ * @param ddb The distributed database.
+ * @param backend The network backend.
+ * @return -1 on error.
+ */
+int event_loop_run(int listening_socket, struct TableServerDistributedDatabase* ddb, enum IOBackend backend);
+
+/**
+ * @brief Serves every client from a single thread multiplexed with epoll.
+ * The function does not return unless an error occurs.
+ *
+ * @param listening_socket The listening socket.
+ * @param ddb The distributed database.
+ * @return -1 on error.
+ */
+int epoll_main_loop(int listening_socket, struct TableServerDistributedDatabase* ddb);
+
+#define EVENT_LOOP_MAX_EVENTS 64
+#define EVENT_LOOP_HANDED_OFF 1       // the connection left the event loop (replication stream)
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define EVENT_LOOP_STARTED "[ \033[1;32mServer Status\033[0m ] - Serving clients with the %s backend\n"
+#define EVENT_LOOP_URING_FALLBACK "[ \033[1;33mWarning\033[0m ] - io_uring is not supported by this kernel, falling back to epoll\n"
+#define EVENT_LOOP_UNKNOWN_BACKEND "Unknown I/O backend (expected threads, epoll or uring), using threads.\n"
+
+#endif
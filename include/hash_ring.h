@@ -0,0 +1,75 @@
+#ifndef _HASH_RING_H
+#define _HASH_RING_H /* Consistent hashing module (sharding) */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The keyspace is split between several chains, each holding its own keys on every one of its
+ * servers. Keys are mapped to chains by a consistent hash ring: each chain owns
+ * HASH_RING_VNODES points (virtual nodes) of a 64-bit ring, and a key belongs to the chain of
+ * the first point at or after the hash of the key, wrapping around. Adding a chain only moves
+ * the keys hashed right before its points, about 1/n of the keys of every other chain.
+ * Clients and servers build the ring from the same chain numbers, so that they agree on it.
+ */
+
+#define HASH_RING_VNODES 128            // points of each chain
+
+// Point of a chain on the ring
+struct hash_ring_point_t {
+    uint64_t hash;
+    int chain;
+};
+
+// Chains holding the keys, and their points
+struct hash_ring_t {
+    int* chains;                        // sorted
+    int n_chains;
+    struct hash_ring_point_t* points;   // sorted by hash
+    int n_points;
+};
+
+/**
+ * @brief Creates the ring of the given chains.
+ *
+ * @param chains The chain numbers (duplicates are ignored).
+ * @param n_chains The number of chains (may be 0).
+ * @return The ring, or NULL on error.
+ */
+struct hash_ring_t* hash_ring_create(const int* chains, int n_chains);
+
+/**
+ * @brief Creates a ring holding the chains of ring plus chain, the one a chain joining the
+ * ring builds to tell which keys it takes over.
+ *
+ * @param ring The ring (may be NULL, for an empty one).
+ * @param chain The chain added.
+ * @return The new ring, or NULL on error.
+ */
+struct hash_ring_t* hash_ring_with(const struct hash_ring_t* ring, int chain);
+
+/**
+ * @brief Frees the ring.
+ *
+ * @param ring The ring (may be NULL).
+ */
+void hash_ring_destroy(struct hash_ring_t* ring);
+
+/**
+ * @brief Tells whether chain holds keys of the ring.
+ *
+ * @param ring The ring (may be NULL).
+ * @param chain The chain.
+ * @return true if the chain is in the ring.
+ */
+bool hash_ring_contains(const struct hash_ring_t* ring, int chain);
+
+/**
+ * @brief Finds the chain key belongs to.
+ *
+ * @param ring The ring (may be NULL).
+ * @param key The key.
+ * @return The chain, or -1 if the ring is empty.
+ */
+int hash_ring_lookup(const struct hash_ring_t* ring, const char* key);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _HOTKEYS_H
+#define _HOTKEYS_H /* Hot-key detection module (server statistics) */
+
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* GET and PUT served to clients count their key in two count-min sketches, one of operations
+ * and one of bytes (of the value written or read): HOTKEYS_DEPTH rows of HOTKEYS_WIDTH
+ * counters, each row indexed by its own hash of the key, the estimate of a key being the
+ * smallest of its counters (never below its true count; above it by at most
+ * e * total / HOTKEYS_WIDTH with probability 1 - e^-HOTKEYS_DEPTH). Counters are shared by
+ * every thread, with relaxed atomic adds, so with NODEDB_HOTKEYS_SAMPLE=N a thread counts only
+ * one operation in N, picked at random, by N operations and N times its bytes: the sketches
+ * see N times fewer writes, and a key of many operations keeps its estimate.
+ * The HOTKEYS_TOP keys of largest estimates, by operations and by bytes, are kept as heavy
+ * hitters, told apart by the hash and length of the whole key and holding the estimates of
+ * both measures from their last update: a key enters when its estimate passes the smallest of
+ * the list, which is read without locking, and the list is only updated if its lock is free,
+ * so that threads hitting the same hot key do not queue on it (the key is counted in the
+ * sketch anyway, and gets another chance on its next operation).
+ * OP_HOTKEYS fetches the heavy hitters, clearing the sketches if asked to.
+ */
+
+#define HOTKEYS_DEPTH 4
+#define HOTKEYS_WIDTH 4096              // a power of 2
+#define HOTKEYS_TOP 16
+#define HOTKEYS_KEY_SIZE 64             // bytes of the key shown, terminator included
+#define HOTKEYS_DEFAULT_SAMPLE 8
+
+enum HotkeysMeasure {
+    HOTKEYS_OPS,
+    HOTKEYS_BYTES,
+    HOTKEYS_MEASURES
+};
+
+// A heavy hitter
+struct hotkeys_entry_t {
+    uint64_t hash;                      // of the whole key
+    size_t length;                      // of the whole key
+    char key[HOTKEYS_KEY_SIZE];         // its first HOTKEYS_KEY_SIZE - 1 bytes
+    uint64_t estimates[HOTKEYS_MEASURES];
+};
+
+// Heavy hitters by a measure
+struct hotkeys_top_t {
+    struct hotkeys_entry_t entries[HOTKEYS_TOP];
+    int n;
+    uint64_t min;                       // smallest estimate, 0 until full (read without the lock)
+};
+
+/**
+ * @brief Counts an operation on a key.
+ *
+ * @param key The key.
+ * @param bytes The size of the value written or read.
+ */
+void hotkeys_count(const char* key, uint64_t bytes);
+
+/**
+ * @brief Copies the heavy hitters, by operations and by bytes, with the estimates of both.
+ *
+ * @param keys The copies (free with stats_destroy_hot_keys()), or NULL if there are none.
+ * @param reset Whether to clear the sketches and the heavy hitters.
+ * @return The number of keys, or -1 on error.
+ */
+int hotkeys_fetch(struct hot_key_t** keys, bool reset);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _LATENCY_H
+#define _LATENCY_H /* Latency recording module (server statistics) */
+
+#include "stats.h"
+#include "sdmessage.pb-c.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Every thread of the server records the operations it serves, and their latencies, into a
+ * shard of its own: the operation counter, the computation time, and STATS_OPS * STATS_PHASES
+ * histograms (see stats.h). No locks are taken: a shard has a single writer, whose relaxed
+ * stores OP_STATS reads while merging every shard, and shards are aligned to cache lines so
+ * that threads do not write to the same one. The shard of a thread that exits is added to the
+ * retired totals, so its operations are kept.
+ * Latencies are measured with CLOCK_MONOTONIC_RAW, read through the vDSO and not slewed by NTP.
+ * With NODEDB_TIMING_SAMPLE=N, each thread times only one operation in N at every place where
+ * a phase is measured (see latency_sample()); the computation time is scaled up by N, and the
+ * histograms hold the sampled operations.
+ */
+
+// Operations and latencies recorded by a thread
+struct latency_shard_t {
+    long long op_counter;
+    long long computed_time_ns;
+    struct stats_histogram_t histograms[STATS_OPS * STATS_PHASES];
+    struct latency_shard_t* next;
+} __attribute__((aligned(64)));
+
+/**
+ * @brief Reads the clock latencies are measured with.
+ *
+ * @return The time, in nanoseconds.
+ */
+uint64_t latency_now_ns();
+
+/**
+ * @brief Tells whether the calling thread times the operation it is about to measure a phase
+ * of: one in NODEDB_TIMING_SAMPLE, counted for each phase apart.
+ *
+ * @param phase The phase.
+ * @return true if the operation is to be timed.
+ */
+bool latency_sample(enum StatsPhase phase);
+
+/**
+ * @brief Gets NODEDB_TIMING_SAMPLE.
+ *
+ * @return The number of operations of which one is timed (1 if every one is).
+ */
+int latency_sample_rate();
+
+/**
+ * @brief Finds the operation a message opcode counts as.
+ *
+ * @param opcode The opcode of the request.
+ * @return The operation (STATS_OP_OTHER if not one of the table's).
+ */
+enum StatsOp latency_op(MessageT__Opcode opcode);
+
+/**
+ * @brief Records a latency in the shard of the calling thread.
+ *
+ * @param op The operation.
+ * @param phase The phase of the operation.
+ * @param latency_ns The latency, in nanoseconds.
+ */
+void latency_record(enum StatsOp op, enum StatsPhase phase, uint64_t latency_ns);
+
+/**
+ * @brief Counts an operation served by the calling thread.
+ */
+void latency_count_op();
+
+/**
+ * @brief Adds to the computation time of the calling thread.
+ *
+ * @param ns The time, in nanoseconds.
+ */
+void latency_add_computed_time(long long ns);
+
+/**
+ * @brief Adds up the operation counters and computation times of every thread.
+ *
+ * @param op_counter The number of operations served.
+ * @param computed_time_micros The computation time, in microseconds.
+ */
+void latency_counters(long long* op_counter, long long* computed_time_micros);
+
+/**
+ * @brief Adds up the histograms of the shards of every thread.
+ *
+ * @param histograms The STATS_OPS * STATS_PHASES histograms to fill (op * STATS_PHASES + phase).
+ */
+void latency_merge(struct stats_histogram_t* histograms);
+
+#define LATENCY_DEFAULT_SAMPLE 1
+
+#endif
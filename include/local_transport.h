@@ -0,0 +1,54 @@
+#ifndef _LOCAL_TRANSPORT_H
+#define _LOCAL_TRANSPORT_H /* Local transport module */
+
+#include "distributed_database.h"
+
+/* Co-located clients connect to the Unix socket of the server (see local_socket_path())
+ * and open the connection with a 4-byte hello:
+ * - LOCAL_HELLO_SOCKET: requests are then exchanged over the socket with the usual framing;
+ * - LOCAL_HELLO_SHM: the server answers with the memory file of a shared memory channel
+ *   (SCM_RIGHTS) and requests are exchanged through its rings. The socket stays open only
+ *   to tell each side when the other goes away.
+ * The server answers the hello with LOCAL_HELLO_ACCEPTED, or LOCAL_HELLO_REFUSED if it could
+ * not set up the shared memory channel, in which case the socket is used instead.
+ */
+#define LOCAL_HELLO_SIZE 4
+#define LOCAL_HELLO_SOCKET "NDBU"
+#define LOCAL_HELLO_SHM "NDBS"
+#define LOCAL_HELLO_ACCEPTED 'K'
+#define LOCAL_HELLO_REFUSED 'N'
+
+/**
+ * @brief Creates the Unix socket listener of the server listening on the given TCP port.
+ *
+ * @param port The TCP port of the server.
+ * @return The listening socket, or -1 on error.
+ */
+int local_transport_init(int port);
+
+/**
+ * @brief Launches the thread that accepts and serves local clients.
+ *
+ * @param listening_socket The Unix listening socket.
+ * @param ddb The distributed database.
+ * @return 0 (OK) or -1 on error.
+ */
+int local_transport_start(int listening_socket, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Closes the Unix socket listener and removes its path.
+ *
+ * @param listening_socket The Unix listening socket.
+ * @param port The TCP port of the server.
+ */
+void local_transport_close(int listening_socket, int port);
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define LOCAL_TRANSPORT_LISTENING "[ \033[1;32mServer Status\033[0m ] - Accepting local clients on %s\n"
+#define LOCAL_TRANSPORT_IN_USE "\033[0;31m[!] Error:\033[0m Another server accepts local clients on the socket of this port.\n"
+#define LOCAL_TRANSPORT_SHM_CLIENT "[ \033[1;36mInfo\033[0m ] - Local client connection established (shared memory).\n"
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef _LOGGER_H
+#define _LOGGER_H /* Asynchronous logging module (server) */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* Messages of a level above NODEDB_LOG_LEVEL are not even formatted: LOG() compares the level
+ * first, so that the arguments are not evaluated either. The others are formatted by the
+ * thread that logs them into a ring of its own, without locks (the thread is its only writer,
+ * and the logger thread its only reader), and the logger thread writes them to stdout every
+ * LOGGER_DRAIN_MS. A message that does not fit in a full ring is dropped, and counted.
+ * The messages of a thread keep their order; those of different threads may be interleaved
+ * otherwise than they were logged. SIGUSR1 switches between NODEDB_LOG_LEVEL and debug.
+ */
+
+enum LoggerLevel {
+    LOGGER_ERROR,
+    LOGGER_WARN,
+    LOGGER_INFO,        // default
+    LOGGER_DEBUG,       // every request
+    LOGGER_LEVELS
+};
+
+#define LOGGER_RING_RECORDS 256         // a power of 2
+#define LOGGER_RECORD_SIZE 256
+#define LOGGER_DRAIN_MS 5
+
+// Messages logged by a thread
+struct logger_ring_t {
+    char records[LOGGER_RING_RECORDS][LOGGER_RECORD_SIZE];
+    uint64_t head __attribute__((aligned(64)));     // records written, by the owner
+    uint64_t tail __attribute__((aligned(64)));     // records read, by the logger thread
+    uint64_t dropped;                               // by the owner
+    bool writing;                                   // the owner is writing a record
+    uint64_t dropped_reported;                      // by the logger thread
+    bool retired;                                   // the owner exited
+    struct logger_ring_t* next;
+};
+
+// The logger
+struct logger_t {
+    int level;                          // read by LOG()
+    int configured_level;               // NODEDB_LOG_LEVEL
+    bool running;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t mutex;              // guards rings
+    struct logger_ring_t* rings;
+};
+
+extern struct logger_t logger;
+
+#define LOG(lvl, ...) do { \
+        if ((int)(lvl) <= __atomic_load_n(&logger.level, __ATOMIC_RELAXED)) \
+            logger_write(__VA_ARGS__); \
+    } while (0)
+
+#define LOG_ERROR(...) LOG(LOGGER_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG(LOGGER_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG(LOGGER_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG(LOGGER_DEBUG, __VA_ARGS__)
+
+/**
+ * @brief Reads NODEDB_LOG_LEVEL and starts the logger thread. Until then, and after
+ * logger_stop(), messages are printed directly.
+ *
+ * @return 0 (OK) or -1 on error.
+ */
+int logger_start();
+
+/**
+ * @brief Formats a message into the ring of the calling thread (use LOG() instead).
+ *
+ * @param format The printf format of the message.
+ */
+void logger_write(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Sets the level above which messages are discarded.
+ *
+ * @param level The level.
+ */
+void logger_set_level(enum LoggerLevel level);
+
+/**
+ * @brief Parses a level name (error, warn, info or debug).
+ *
+ * @param name The name.
+ * @return The level, or -1 if unknown.
+ */
+int logger_parse_level(const char* name);
+
+/**
+ * @brief Gets the name of a level.
+ *
+ * @param level The level.
+ * @return The name.
+ */
+const char* logger_level_name(enum LoggerLevel level);
+
+/**
+ * @brief Writes out the messages left and stops the logger thread.
+ */
+void logger_stop();
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define LOGGER_DROPPED "[ \033[1;33mLogger\033[0m ] - %llu message(s) dropped, their ring being full\n"
+#define LOGGER_LEVEL "[ \033[1;33mLogger\033[0m ] - Log level: %s\n"
+#define LOGGER_UNKNOWN_LEVEL "[ \033[1;33mLogger\033[0m ] - Unknown NODEDB_LOG_LEVEL %s, using info\n"
+
+#endif
@@ -5,9 +5,22 @@
 #include "data.h"
 #include "stats.h"
 #include "sdmessage.pb-c.h"
+#include "arena.h"
+#include "zerocopy.h"
 
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+
+// every message travels as a 2-byte (network order) size followed by the packed MessageT
+#define MESSAGE_FRAME_HEADER_SIZE sizeof(unsigned short)
+#define MESSAGE_MAX_FRAME_SIZE (MESSAGE_FRAME_HEADER_SIZE + USHRT_MAX)
+
+// the value field of MessageT (5, length-delimited) is sent apart from the other fields
+#define MESSAGE_VALUE_TAG ((5 << 3) | 2)
+#define MESSAGE_VALUE_PREFIX_MAX_SIZE 11    // tag + 64-bit varint length
+#define MESSAGE_INLINE_FIELDS_SIZE 256      // other fields of responses packed on the stack
 
 /**
  * Wrap an ServerStatsT structure with the provided data and return a new ServerStatsT.
@@ -17,7 +30,7 @@
  * @param computed_time - Computed time in micro seconds
  * @return A new ServerStatsT structure.
  */
-ServerStatsT* wrap_stats_with_data(int active_clients, int op_counter, int computed_time);
+ServerStatsT* wrap_stats_with_data(int active_clients, long long op_counter, long long computed_time);
 
 /**
  * Wrap an existing statistics_t structure into a new ServerStatsT structure.
@@ -86,6 +99,19 @@ bool was_operation_unsuccessful(MessageT* received);
  */
 int send_message(int fd, MessageT *msg);
 
+/**
+ * Send a MessageT structure over the specified socket with a single vectored write,
+ * taking its value straight from msg->value instead of packing a copy, and using
+ * zero-copy for large frames (see zerocopy.h). The value of such a frame must be a heap
+ * block: it is taken over, msg->value being cleared, and freed once the kernel is done with it.
+ *
+ * @param fd - The socket to send the message to.
+ * @param msg - The MessageT structure to send.
+ * @param zc - The zero-copy state of the socket, or NULL to always copy.
+ * @return 0 on success or -1 in case of an error.
+ */
+int send_message_zerocopy(int fd, MessageT *msg, struct zerocopy_t* zc);
+
 /**
  * Read a MessageT structure from the specified file descriptor (socket).
  *
@@ -94,6 +120,43 @@ int send_message(int fd, MessageT *msg);
  */
 MessageT* read_message(int fd);
 
+/**
+ * Read a MessageT structure from the specified file descriptor (socket), taking the
+ * receive buffer and every decoded field from arena. Release it with release_message().
+ *
+ * @param fd - The file descriptor to read the message from.
+ * @param arena - The arena of the connection, or NULL to use the system allocator.
+ * @return A pointer to the received MessageT structure or NULL in case of an error.
+ */
+MessageT* read_message_with_arena(int fd, struct arena_t* arena);
+
+/**
+ * Free a MessageT structure decoded with arena (or with the system allocator if arena
+ * is NULL), then recycle the arena for the next message.
+ *
+ * @param msg - The MessageT structure to free (may be NULL).
+ * @param arena - The arena the message was decoded with, or NULL.
+ */
+void release_message(MessageT* msg, struct arena_t* arena);
+
+/**
+ * Compute the size of the frame (size header + packed message) that carries msg.
+ *
+ * @param msg - The MessageT structure.
+ * @return The frame size in bytes or 0 in case of an error.
+ */
+size_t message_frame_size(MessageT* msg);
+
+/**
+ * Pack a MessageT structure into buffer as a complete frame (size header + packed message).
+ *
+ * @param msg - The MessageT structure to pack.
+ * @param buffer - The destination buffer.
+ * @param capacity - The number of bytes available in buffer.
+ * @return The number of bytes written or -1 in case of an error (including a buffer too small).
+ */
+ssize_t pack_message_frame(MessageT* msg, uint8_t* buffer, size_t capacity);
+
 /**
  * Write a specified number of bytes from a buffer to a socket.
  *
@@ -3,13 +3,19 @@
 
 #include "client_stub.h"
 #include "sdmessage.pb-c.h"
+#include "compact_protocol.h"
 
 /* Esta função deve:
- * - Obter o endereço do servidor (struct sockaddr_in) com base na
+ * - Se o servidor estiver na mesma máquina, ligar-se ao seu socket Unix,
+ *   preferindo um canal de memória partilhada (ver local_transport.h);
+ *   a variável de ambiente NODEDB_TRANSPORT (auto, unix ou tcp) restringe a escolha;
+ * - Caso contrário, obter o endereço do servidor (struct sockaddr_in) com base na
  *   informação guardada na estrutura rtable;
  * - Estabelecer a ligação com o servidor;
  * - Guardar toda a informação necessária (e.g., descritor do socket)
  *   na estrutura rtable;
+ * - Nas ligações por socket, negociar o protocolo compacto (ver compact_protocol.h),
+ *   a menos que a variável de ambiente NODEDB_PROTOCOL seja protobuf;
  * - Retornar 0 (OK) ou -1 (erro).
  */
 int network_connect(struct rtable_t *rtable);
@@ -25,6 +31,28 @@ int network_connect(struct rtable_t *rtable);
  */
 MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg);
 
+/* Envia uma operação opcode (PUT, GET ou DEL) do protocolo compacto com a
+ * chave key e o valor value (value_length bytes, podendo value ser NULL) e
+ * espera a resposta, cujo header é guardado em response e cujo valor fica
+ * no buffer da ligação (rtable->buffer) até à próxima operação.
+ * Retorna 0 (OK) ou -1 em caso de erro (incluindo COMPACT_FLAG_ERROR).
+ */
+int network_compact_call(struct rtable_t *rtable, uint8_t opcode, char *key, void *value, uint32_t value_length, struct compact_header_t *response);
+
+/* Envia, sem esperar a resposta, uma operação opcode do protocolo compacto
+ * (como network_compact_call()), guardando o seu request_id em request_id
+ * (se não for NULL). Permite ter vários pedidos pendentes na mesma ligação,
+ * cujas respostas chegam pela ordem dos pedidos.
+ * Retorna 0 (OK) ou -1 (erro).
+ */
+int network_compact_send(struct rtable_t *rtable, uint8_t opcode, char *key, void *value, uint32_t value_length, uint32_t *request_id);
+
+/* Espera a resposta ao pedido pendente mais antigo, cujo header é guardado
+ * em response e cujo valor fica no buffer da ligação (rtable->buffer).
+ * Retorna 0 (OK, mesmo com COMPACT_FLAG_ERROR) ou -1 em caso de erro.
+ */
+int network_compact_receive(struct rtable_t *rtable, struct compact_header_t *response);
+
 /* Fecha a ligação estabelecida por network_connect().
  * Retorna 0 (OK) ou -1 (erro).
  */
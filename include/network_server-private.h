@@ -5,15 +5,24 @@
 #include "distributed_database.h"
 
 /**
- * Process a request received on the given connection socket. This function
- * receives a request, invokes the processing function, sends a response, and
- * then waits for the next request using recursion.
+ * Process the requests received on the given connection socket. For each one, this
+ * function receives the request, invokes the processing function and sends a response,
+ * decoding every request into an arena owned by the connection.
  *
  * @param connection_socket - The socket descriptor for the client connection.
  * @param data - A pointer to the server data.
  */
 void process_request(int connection_socket, struct TableServerDistributedDatabase* ddb);
 
+/**
+ * Serves the requests of a connection upgraded to the compact protocol (see
+ * compact_protocol.h) until the client disconnects or an error occurs.
+ *
+ * @param connection_socket - The socket descriptor for the client connection.
+ * @param ddb - A pointer to the distributed database.
+ */
+void process_compact_requests(int connection_socket, struct TableServerDistributedDatabase* ddb);
+
 // ====================================================================================================
 //                                            MESSAGES
 // ====================================================================================================
@@ -0,0 +1,39 @@
+#ifndef _PROBES_H
+#define _PROBES_H /* Static tracepoints module (server) */
+
+/* USDT probes of the provider nodedb along the path of a request in the server, for perf,
+ * bpftrace or systemtap to attach to (bpftrace -l 'usdt:binary/table-server:nodedb:*'). A
+ * probe is a nop instruction plus a note in the binary telling a tracer where its arguments
+ * are: they are evaluated on every pass, attached or not, so they are kept to values already
+ * at hand (no probe uses an is-enabled semaphore). They are compiled in when the systemtap
+ * header <sys/sdt.h> is available and NODEDB_NO_PROBES is not defined (make PROBES=0), and to
+ * nothing otherwise.
+ *
+ *   request__receive(fd)                   a request was read (fd is -1 for shared memory)
+ *   request__parse(opcode, key)            the request was decoded, before running it
+ *   request__send(fd, opcode)              the response was sent (or queued to be)
+ *   lock__wait(op)                         waiting for the table lock (op is a StatsOp)
+ *   lock__acquire(op)                      the table lock was taken
+ *   table__op(op)                          the operation on the table is done, lock released
+ *   replicate__start(opcode, key)          a mutation was forwarded down the chain
+ *   replicate__done(opcode, key, status)   the tail acknowledged it
+ */
+
+#if defined(__has_include) && !defined(NODEDB_NO_PROBES)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define NODEDB_PROBES 1
+#endif
+#endif
+
+#ifdef NODEDB_PROBES
+#define PROBE1(name, a) DTRACE_PROBE1(nodedb, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(nodedb, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(nodedb, name, a, b, c)
+#else
+#define PROBE1(name, a) do {} while (0)
+#define PROBE2(name, a, b) do {} while (0)
+#define PROBE3(name, a, b, c) do {} while (0)
+#endif
+
+#endif
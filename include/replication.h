@@ -0,0 +1,252 @@
+#ifndef _REPLICATION_H
+#define _REPLICATION_H /* Chain replication module */
+
+#include "data.h"
+#include "stats.h"
+#include "sdmessage.pb-c.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct TableServerDistributedDatabase;
+
+/* Mutations travel down the chain over replication streams: connections to the successor
+ * opened with an OP_REPLICATE request, then carrying OP_PUT and OP_DEL requests numbered by
+ * the seq field. A server applies each mutation, forwards it to its own successor and
+ * acknowledges it upstream (OP_REPLICATE + 1, or OP_ERROR, with the same seq) only once the
+ * successor did, so acknowledgements flow back from the tail.
+ * Up to a window of mutations is outstanding per stream instead of one per round trip, and
+ * a channel spreads keys over several streams (lanes): mutations of a key always take the
+ * same lane, so they stay ordered while different lanes are written concurrently.
+ * Mutations queued while the stream is busy go out together as one OP_BATCH request (puts in
+ * entries, deletes in keys) covering the result mutations from seq, acknowledged at once with
+ * the same seq and result. A mutation superseded by a later one of the same key in the batch
+ * is collapsed into it: every mutation of the batch is acknowledged only once all of them
+ * are applied down the chain, so the intermediate value is never the only one visible.
+ * Every request also carries the chain seqs of its mutations (see backlog.h).
+ * A channel lags once the mutations it holds (unacknowledged) add up to more than
+ * NODEDB_LAG_LIMIT_KB, and catches up below half of it. While it lags, NODEDB_LAG_POLICY
+ * throttle holds the writers back until it catches up, while async acknowledges the mutations
+ * submitted as soon as they are queued, without waiting for the successor nor for room in the
+ * window (up to REPLICATION_ASYNC_FACTOR times the limit).
+ */
+
+// Called once a submitted mutation was acknowledged by the rest of the chain
+typedef void (*replication_callback_t)(void* arg, uint64_t tag, int status);
+
+// Mutation waiting for its acknowledgement; the key and value follow the struct
+struct replication_entry_t {
+    struct replication_entry_t* next;
+    uint64_t seq;
+    uint64_t chain_seq;                 // see backlog.h
+    MessageT__Opcode opcode;
+    char* key;
+    uint32_t key_hash;
+    uint8_t* value;
+    size_t value_size;
+    size_t frame_size;                  // size of the mutation sent alone
+    uint64_t submitted_us;              // monotonic time of the submission
+    replication_callback_t callback;    // NULL once acknowledged ahead of the successor (async)
+    void* arg;
+    uint64_t tag;                       // handed back to callback (e.g. the upstream seq)
+    bool acked;
+    int status;
+};
+
+// Replication stream to the successor, with its sender and acknowledgement receiver
+struct replication_lane_t {
+    struct replication_channel_t* channel;
+    pthread_mutex_t order_mutex;        // held while a mutation is applied locally and submitted
+    int fd;                             // -1 while disconnected
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct replication_entry_t* head;   // oldest unacknowledged mutation
+    struct replication_entry_t* tail;
+    uint64_t next_seq;                  // seq of the next mutation
+    uint64_t sent_seq;                  // mutations before this one were written
+    uint64_t acked_seq;                 // mutations before this one were acknowledged
+    bool broken;                        // the connection failed and must be reopened
+    bool closed;
+    pthread_t sender;
+    bool sender_running;
+    pthread_t receiver;
+    bool receiver_running;
+    uint8_t* tx_buffer;                 // batch being sent, MESSAGE_MAX_FRAME_SIZE bytes
+};
+
+// Replication traffic counters of a server, kept across channels
+struct replication_stats_t {
+    uint64_t batches[STATS_BATCH_BUCKETS];  // requests sent, by mutations covered (1, 2-3, 4-7, ...)
+    uint64_t bytes_saved;                   // versus sending every mutation alone
+    uint64_t coalesced;                     // superseded mutations not sent
+};
+
+// Lag of a successor behind this server
+struct replication_lag_t {
+    uint64_t queued;                    // mutations submitted and not yet sent
+    uint64_t in_flight;                 // mutations sent and not yet acknowledged
+    uint64_t bytes_in_flight;           // frame bytes of the mutations not yet acknowledged
+    uint64_t seq_lag;                   // newest chain seq submitted minus the newest acknowledged
+    uint64_t ack_latency[STATS_LATENCY_BUCKETS]; // acknowledgements, by microseconds since submitted
+    uint64_t throttled;                 // writers held back because the channel lagged
+    uint64_t async_acks;                // mutations acknowledged ahead of the successor
+    bool lagging;
+};
+
+// Replication streams to the successor
+struct replication_channel_t {
+    char* address;
+    int port;
+    int window;                         // mutations in flight per lane before submitters are throttled
+    bool coalesce;                      // superseded mutations of a batch are collapsed
+    struct replication_stats_t* stats;
+    int lag_policy;                     // REPLICATION_LAG_THROTTLE or REPLICATION_LAG_ASYNC (NODEDB_LAG_POLICY)
+    uint64_t lag_limit;                 // bytes held beyond which the channel lags (NODEDB_LAG_LIMIT_KB), 0 for none
+    struct replication_lag_t lag;       // counters (queued and in_flight are computed from the lanes)
+    uint64_t submitted_chain_seq;       // newest chain seq submitted
+    uint64_t acked_chain_seq;           // newest chain seq acknowledged
+    bool stopped;
+    pthread_mutex_t lag_mutex;
+    pthread_cond_t lag_cond;            // signalled as the bytes held drop, for throttled writers
+    int lag_waiters;
+    pthread_mutex_t refs_mutex;
+    int refs;
+    int n_lanes;
+    struct replication_lane_t* lanes;
+};
+
+/**
+ * @brief Creates the channel to the successor at address:port and launches the sender of
+ * each lane (NODEDB_REPLICATION_LANES), which keeps (re)connecting until the channel is stopped.
+ *
+ * @param address_port The address of the successor, as address:port.
+ * @param stats The counters to update (outliving the channel).
+ * @return The channel, or NULL on failure.
+ */
+struct replication_channel_t* replication_channel_create(const char* address_port, struct replication_stats_t* stats);
+
+/**
+ * @brief Takes a reference to the channel, keeping it allocated until released.
+ *
+ * @param channel The channel.
+ */
+void replication_channel_acquire(struct replication_channel_t* channel);
+
+/**
+ * @brief Drops a reference to the channel, freeing it with the last one.
+ *
+ * @param channel The channel.
+ */
+void replication_channel_release(struct replication_channel_t* channel);
+
+/**
+ * @brief Locks the lane of key, so that mutations of the lane are applied locally in the
+ * order they are submitted. Unlock with replication_channel_unlock_lane().
+ *
+ * @param channel The channel.
+ * @param key The key about to be mutated.
+ * @return The lane.
+ */
+int replication_channel_lock_lane(struct replication_channel_t* channel, const char* key);
+
+/**
+ * @brief Unlocks a lane locked by replication_channel_lock_lane().
+ *
+ * @param channel The channel.
+ * @param lane The lane.
+ */
+void replication_channel_unlock_lane(struct replication_channel_t* channel, int lane);
+
+/**
+ * @brief Enqueues a mutation on a lane locked by the caller. Never waits: throttle with
+ * replication_channel_wait_window() once the lane is unlocked.
+ *
+ * @param channel The channel.
+ * @param lane The lane of key.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT, MESSAGE_T__OPCODE__OP_DEL or MESSAGE_T__OPCODE__OP_BAD (superseded, seq only).
+ * @param key The key.
+ * @param value The value (PUT only).
+ * @param chain_seq The chain seq of the mutation.
+ * @param callback Called (from the channel) once the mutation is acknowledged.
+ * @param arg Argument of callback.
+ * @param tag Tag handed to callback.
+ * @return 0 (OK), REPLICATION_SUBMITTED_ASYNC if the channel lags in async mode (callback will
+ * not be called: the caller acknowledges the mutation itself) or -1 on error (callback will not
+ * be called).
+ */
+int replication_channel_submit(struct replication_channel_t* channel, int lane, MessageT__Opcode opcode, char* key,
+    struct data_t* value, uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag);
+
+/**
+ * @brief Waits while the window of a lane is full, or while the channel lags too far behind
+ * (see NODEDB_LAG_POLICY), or until the channel is stopped.
+ *
+ * @param channel The channel.
+ * @param lane The lane.
+ */
+void replication_channel_wait_window(struct replication_channel_t* channel, int lane);
+
+/**
+ * @brief Reads the lag of the successor of the channel.
+ *
+ * @param channel The channel.
+ * @param lag The counters to fill.
+ */
+void replication_channel_lag(struct replication_channel_t* channel, struct replication_lag_t* lag);
+
+/**
+ * @brief Stops the channel and hands the unacknowledged mutations of each lane to the same
+ * lane of successor in order, or acknowledges them if successor is NULL (this server became
+ * the tail). successor must not have been submitted to yet, and no lane of from may be locked.
+ * Releases the reference of the caller to from.
+ *
+ * @param from The channel being replaced.
+ * @param successor The channel to the new successor, or NULL.
+ */
+void replication_channel_replace(struct replication_channel_t* from, struct replication_channel_t* successor);
+
+/**
+ * @brief Stops the channel, failing its unacknowledged mutations, and releases the
+ * reference of the caller.
+ *
+ * @param channel The channel.
+ */
+void replication_channel_destroy(struct replication_channel_t* channel);
+
+/**
+ * @brief Serves, on a thread of its own, the replication stream of the predecessor
+ * whose OP_REPLICATE request was just read from fd.
+ *
+ * @param fd The socket (owned by the stream from now on).
+ * @param buffered Bytes already received after the OP_REPLICATE request.
+ * @param length The number of buffered bytes.
+ * @param ddb The distributed database.
+ * @return 0 (OK) or -1 on error (fd is closed).
+ */
+int replication_stream_start(int fd, const uint8_t* buffered, size_t length, struct TableServerDistributedDatabase* ddb);
+
+#define REPLICATION_DEFAULT_WINDOW 64
+#define REPLICATION_DEFAULT_LANES 4
+#define REPLICATION_MAX_LANES 64
+#define REPLICATION_RETRY_MS 200
+#define REPLICATION_MAX_BATCH 64        // mutations covered by one batch
+#define REPLICATION_BATCH_OVERHEAD 32   // fields of a batch besides its mutations
+#define REPLICATION_SUBMITTED_ASYNC 1
+#define REPLICATION_LAG_THROTTLE 0
+#define REPLICATION_LAG_ASYNC 1
+#define REPLICATION_ASYNC_FACTOR 4      // bytes held in async mode before writers wait, in lag limits
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define REPLICATION_CONNECTED "[ \033[1;35mReplication\033[0m ] - Streaming mutations to %s:%d (lane %d, window %d)\n"
+#define REPLICATION_DISCONNECTED "[ \033[1;35mReplication\033[0m ] - Lost the stream to %s:%d (lane %d), %lu mutation(s) pending\n"
+#define REPLICATION_STREAM_OPENED "[ \033[1;35mReplication\033[0m ] - Receiving the stream of the predecessor\n"
+#define REPLICATION_LAGGING "[ \033[1;35mReplication\033[0m ] - %s:%d lags behind (%lu bytes held): %s\n"
+#define REPLICATION_CAUGHT_UP "[ \033[1;35mReplication\033[0m ] - %s:%d caught up (%lu bytes held)\n"
+#define REPLICATION_STREAM_CLOSED "[ \033[1;35mReplication\033[0m ] - Stream of the predecessor closed\n"
+
+#endif
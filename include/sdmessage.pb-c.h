@@ -15,7 +15,12 @@ PROTOBUF_C__BEGIN_DECLS
 #endif
 
 
+typedef struct _SuccessorStatsT SuccessorStatsT;
+typedef struct _LatencyHistogramT LatencyHistogramT;
+typedef struct _MemoryTagT MemoryTagT;
 typedef struct _ServerStatsT ServerStatsT;
+typedef struct _SlowOpT SlowOpT;
+typedef struct _HotKeyT HotKeyT;
 typedef struct _EntryT EntryT;
 typedef struct _MessageT MessageT;
 
@@ -31,7 +36,15 @@ typedef enum _MessageT__Opcode {
   MESSAGE_T__OPCODE__OP_GETKEYS = 50,
   MESSAGE_T__OPCODE__OP_GETTABLE = 60,
   MESSAGE_T__OPCODE__OP_STATS = 70,
-  MESSAGE_T__OPCODE__OP_ERROR = 99
+  MESSAGE_T__OPCODE__OP_HELLO = 80,
+  MESSAGE_T__OPCODE__OP_REPLICATE = 90,
+  MESSAGE_T__OPCODE__OP_BATCH = 95,
+  MESSAGE_T__OPCODE__OP_ERROR = 99,
+  MESSAGE_T__OPCODE__OP_SNAPSHOT = 100,
+  MESSAGE_T__OPCODE__OP_MIGRATE = 110,
+  MESSAGE_T__OPCODE__OP_DIGEST = 120,
+  MESSAGE_T__OPCODE__OP_SLOWLOG = 130,
+  MESSAGE_T__OPCODE__OP_HOTKEYS = 140
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(MESSAGE_T__OPCODE)
 } MessageT__Opcode;
 typedef enum _MessageT__CType {
@@ -43,19 +56,105 @@ typedef enum _MessageT__CType {
   MESSAGE_T__C_TYPE__CT_KEYS = 50,
   MESSAGE_T__C_TYPE__CT_TABLE = 60,
   MESSAGE_T__C_TYPE__CT_NONE = 70,
-  MESSAGE_T__C_TYPE__CT_STATS = 80
+  MESSAGE_T__C_TYPE__CT_STATS = 80,
+  MESSAGE_T__C_TYPE__CT_SLOW_OPS = 90,
+  MESSAGE_T__C_TYPE__CT_HOT_KEYS = 100
     PROTOBUF_C__FORCE_ENUM_TO_BE_INT_SIZE(MESSAGE_T__C_TYPE)
 } MessageT__CType;
 
 /* --- messages --- */
 
+struct  _SuccessorStatsT
+{
+  ProtobufCMessage base;
+  /*
+   * address:port of the server
+   */
+  char *address;
+  /*
+   * mutations submitted and not yet sent
+   */
+  int64_t queued;
+  /*
+   * mutations sent and not yet acknowledged
+   */
+  int64_t in_flight;
+  /*
+   * frame bytes of the mutations not yet acknowledged
+   */
+  int64_t bytes_in_flight;
+  /*
+   * newest chain seq submitted minus the newest acknowledged
+   */
+  int64_t seq_lag;
+  /*
+   * acknowledgements, by microseconds since submitted (0, 1, 2-3, 4-7, ...)
+   */
+  size_t n_ack_latency;
+  int64_t *ack_latency;
+  /*
+   * writers held back because the server lagged
+   */
+  int64_t throttled;
+  /*
+   * mutations acknowledged ahead of the server (NODEDB_LAG_POLICY=async)
+   */
+  int64_t async_acks;
+  /*
+   * more than NODEDB_LAG_LIMIT_KB are held for the server
+   */
+  protobuf_c_boolean lagging;
+};
+#define SUCCESSOR_STATS_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&successor_stats_t__descriptor) \
+    , (char *)protobuf_c_empty_string, 0, 0, 0, 0, 0,NULL, 0, 0, 0 }
+
+
+struct  _LatencyHistogramT
+{
+  ProtobufCMessage base;
+  int32_t op;
+  int32_t phase;
+  /*
+   * counts of the first buckets, up to the last one used
+   */
+  size_t n_buckets;
+  int64_t *buckets;
+  int64_t sum_ns;
+  int64_t max_ns;
+};
+#define LATENCY_HISTOGRAM_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&latency_histogram_t__descriptor) \
+    , 0, 0, 0,NULL, 0, 0 }
+
+
+struct  _MemoryTagT
+{
+  ProtobufCMessage base;
+  char *tag;
+  /*
+   * memory in use
+   */
+  int64_t bytes;
+  int64_t objects;
+  /*
+   * allocations since the start, and their bytes
+   */
+  int64_t allocations;
+  int64_t allocated_bytes;
+};
+#define MEMORY_TAG_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&memory_tag_t__descriptor) \
+    , (char *)protobuf_c_empty_string, 0, 0, 0, 0 }
+
+
 struct  _ServerStatsT
 {
   ProtobufCMessage base;
   /*
    * counter of operations
    */
-  int32_t op_counter;
+  int64_t op_counter;
   /*
    * number of active clients
    */
@@ -64,10 +163,94 @@ struct  _ServerStatsT
    * time of computations in microseconds
    */
   int64_t computed_time;
+  /*
+   * replication batches sent, by size (1, 2-3, 4-7, ... mutations)
+   */
+  size_t n_replication_batches;
+  int64_t *replication_batches;
+  /*
+   * bytes not sent thanks to batching and coalescing
+   */
+  int64_t replication_bytes_saved;
+  /*
+   * superseded mutations collapsed into later ones
+   */
+  int64_t replication_coalesced;
+  /*
+   * lag of the next server (or of every backup, at the head in fan-out mode)
+   */
+  size_t n_successors;
+  SuccessorStatsT **successors;
+  /*
+   * latencies of every operation and phase that has any
+   */
+  size_t n_latencies;
+  LatencyHistogramT **latencies;
+  /*
+   * one operation in timing_sample is timed
+   */
+  int32_t timing_sample;
+  /*
+   * memory of every subsystem
+   */
+  size_t n_memory;
+  MemoryTagT **memory;
+  /*
+   * time since the server started
+   */
+  int64_t uptime_ms;
 };
 #define SERVER_STATS_T__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&server_stats_t__descriptor) \
-    , 0, 0, 0 }
+    , 0, 0, 0, 0,NULL, 0, 0, 0,NULL, 0,NULL, 0, 0,NULL, 0 }
+
+
+struct  _SlowOpT
+{
+  ProtobufCMessage base;
+  /*
+   * when the operation was received, in milliseconds since the epoch
+   */
+  int64_t time_ms;
+  /*
+   * opcode of the request
+   */
+  int32_t opcode;
+  /*
+   * key of the request (truncated), if any
+   */
+  char *key;
+  /*
+   * size of the value of the request
+   */
+  int32_t value_size;
+  /*
+   * breakdown of the time in the server, in nanoseconds
+   */
+  int64_t lock_wait_ns;
+  int64_t table_ns;
+  int64_t replication_ns;
+  int64_t serialization_ns;
+  int64_t total_ns;
+};
+#define SLOW_OP_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&slow_op_t__descriptor) \
+    , 0, 0, (char *)protobuf_c_empty_string, 0, 0, 0, 0, 0, 0 }
+
+
+struct  _HotKeyT
+{
+  ProtobufCMessage base;
+  char *key;
+  /*
+   * estimated operations on the key and bytes of their values
+   */
+  int64_t ops;
+  int64_t bytes;
+};
+#define HOT_KEY_T__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&hot_key_t__descriptor) \
+    , (char *)protobuf_c_empty_string, 0, 0 }
 
 
 struct  _EntryT
@@ -99,12 +282,90 @@ struct  _MessageT
   size_t n_entries;
   EntryT **entries;
   ServerStatsT *stats;
+  uint64_t seq;
+  /*
+   * sequence number of replicated mutations and their acknowledgements 
+   */
+  size_t n_chain_seqs;
+  uint64_t *chain_seqs;
+  /*
+   * numbers given by the head to the mutations carried (entries, keys, then superseded ones) 
+   */
+  size_t n_digests;
+  uint32_t *digests;
+  /*
+   * digests of the table (see digest.h), or the buckets asked for 
+   */
+  size_t n_slow_ops;
+  SlowOpT **slow_ops;
+  /*
+   * operations of the slow log 
+   */
+  size_t n_hot_keys;
+  HotKeyT **hot_keys;
 };
 #define MESSAGE_T__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&message_t__descriptor) \
-    , MESSAGE_T__OPCODE__OP_BAD, MESSAGE_T__C_TYPE__CT_BAD, NULL, (char *)protobuf_c_empty_string, {0,NULL}, 0, 0,NULL, 0,NULL, NULL }
+    , MESSAGE_T__OPCODE__OP_BAD, MESSAGE_T__C_TYPE__CT_BAD, NULL, (char *)protobuf_c_empty_string, {0,NULL}, 0, 0,NULL, 0,NULL, NULL, 0, 0,NULL, 0,NULL, 0,NULL, 0,NULL }
 
 
+/* SuccessorStatsT methods */
+void   successor_stats_t__init
+                     (SuccessorStatsT         *message);
+size_t successor_stats_t__get_packed_size
+                     (const SuccessorStatsT   *message);
+size_t successor_stats_t__pack
+                     (const SuccessorStatsT   *message,
+                      uint8_t             *out);
+size_t successor_stats_t__pack_to_buffer
+                     (const SuccessorStatsT   *message,
+                      ProtobufCBuffer     *buffer);
+SuccessorStatsT *
+       successor_stats_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   successor_stats_t__free_unpacked
+                     (SuccessorStatsT *message,
+                      ProtobufCAllocator *allocator);
+/* LatencyHistogramT methods */
+void   latency_histogram_t__init
+                     (LatencyHistogramT         *message);
+size_t latency_histogram_t__get_packed_size
+                     (const LatencyHistogramT   *message);
+size_t latency_histogram_t__pack
+                     (const LatencyHistogramT   *message,
+                      uint8_t             *out);
+size_t latency_histogram_t__pack_to_buffer
+                     (const LatencyHistogramT   *message,
+                      ProtobufCBuffer     *buffer);
+LatencyHistogramT *
+       latency_histogram_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   latency_histogram_t__free_unpacked
+                     (LatencyHistogramT *message,
+                      ProtobufCAllocator *allocator);
+/* MemoryTagT methods */
+void   memory_tag_t__init
+                     (MemoryTagT         *message);
+size_t memory_tag_t__get_packed_size
+                     (const MemoryTagT   *message);
+size_t memory_tag_t__pack
+                     (const MemoryTagT   *message,
+                      uint8_t             *out);
+size_t memory_tag_t__pack_to_buffer
+                     (const MemoryTagT   *message,
+                      ProtobufCBuffer     *buffer);
+MemoryTagT *
+       memory_tag_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   memory_tag_t__free_unpacked
+                     (MemoryTagT *message,
+                      ProtobufCAllocator *allocator);
 /* ServerStatsT methods */
 void   server_stats_t__init
                      (ServerStatsT         *message);
@@ -124,6 +385,44 @@ ServerStatsT *
 void   server_stats_t__free_unpacked
                      (ServerStatsT *message,
                       ProtobufCAllocator *allocator);
+/* SlowOpT methods */
+void   slow_op_t__init
+                     (SlowOpT         *message);
+size_t slow_op_t__get_packed_size
+                     (const SlowOpT   *message);
+size_t slow_op_t__pack
+                     (const SlowOpT   *message,
+                      uint8_t             *out);
+size_t slow_op_t__pack_to_buffer
+                     (const SlowOpT   *message,
+                      ProtobufCBuffer     *buffer);
+SlowOpT *
+       slow_op_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   slow_op_t__free_unpacked
+                     (SlowOpT *message,
+                      ProtobufCAllocator *allocator);
+/* HotKeyT methods */
+void   hot_key_t__init
+                     (HotKeyT         *message);
+size_t hot_key_t__get_packed_size
+                     (const HotKeyT   *message);
+size_t hot_key_t__pack
+                     (const HotKeyT   *message,
+                      uint8_t             *out);
+size_t hot_key_t__pack_to_buffer
+                     (const HotKeyT   *message,
+                      ProtobufCBuffer     *buffer);
+HotKeyT *
+       hot_key_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   hot_key_t__free_unpacked
+                     (HotKeyT *message,
+                      ProtobufCAllocator *allocator);
 /* EntryT methods */
 void   entry_t__init
                      (EntryT         *message);
@@ -164,9 +463,24 @@ void   message_t__free_unpacked
                       ProtobufCAllocator *allocator);
 /* --- per-message closures --- */
 
+typedef void (*SuccessorStatsT_Closure)
+                 (const SuccessorStatsT *message,
+                  void *closure_data);
+typedef void (*LatencyHistogramT_Closure)
+                 (const LatencyHistogramT *message,
+                  void *closure_data);
+typedef void (*MemoryTagT_Closure)
+                 (const MemoryTagT *message,
+                  void *closure_data);
 typedef void (*ServerStatsT_Closure)
                  (const ServerStatsT *message,
                   void *closure_data);
+typedef void (*SlowOpT_Closure)
+                 (const SlowOpT *message,
+                  void *closure_data);
+typedef void (*HotKeyT_Closure)
+                 (const HotKeyT *message,
+                  void *closure_data);
 typedef void (*EntryT_Closure)
                  (const EntryT *message,
                   void *closure_data);
@@ -179,7 +493,12 @@ typedef void (*MessageT_Closure)
 
 /* --- descriptors --- */
 
+extern const ProtobufCMessageDescriptor successor_stats_t__descriptor;
+extern const ProtobufCMessageDescriptor latency_histogram_t__descriptor;
+extern const ProtobufCMessageDescriptor memory_tag_t__descriptor;
 extern const ProtobufCMessageDescriptor server_stats_t__descriptor;
+extern const ProtobufCMessageDescriptor slow_op_t__descriptor;
+extern const ProtobufCMessageDescriptor hot_key_t__descriptor;
 extern const ProtobufCMessageDescriptor entry_t__descriptor;
 extern const ProtobufCMessageDescriptor message_t__descriptor;
 extern const ProtobufCEnumDescriptor    message_t__opcode__descriptor;
@@ -0,0 +1,165 @@
+#ifndef _SERVER_CONNECTION_H
+#define _SERVER_CONNECTION_H /* Server connection module */
+
+#include "distributed_database.h"
+#include "table_skel.h"
+#include "arena.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct ServerConnection;
+
+// Connections of an event-driven backend whose pending write the chain acknowledged, handed
+// back to the thread of the backend
+struct server_completions_t {
+    pthread_mutex_t mutex;
+    struct ServerConnection* first;
+    struct ServerConnection* last;
+    int event_fd;               // readable while there are connections to take
+};
+
+// Represents a client connection served by an event-driven backend
+struct ServerConnection {
+    int fd;                     // client socket
+    uint8_t* rx_buffer;         // received bytes not yet processed
+    size_t rx_length;
+    size_t rx_capacity;
+    uint8_t* tx_buffer;         // serialized responses not yet written
+    size_t tx_length;
+    size_t tx_capacity;
+    struct arena_t* arena;      // decoded requests, recycled after each response
+    bool fixed_tx;              // tx_buffer is owned by the backend and cannot grow
+    bool closing;               // connection is being torn down
+    bool compact;               // connection was upgraded to the compact protocol
+    bool replication;           // the predecessor opened its replication stream on the connection
+    char* successor;            // or a joining server (this address:port) asked for a snapshot stream
+    uint64_t since;             // chain seq the joining server holds every mutation up to, if rejoining
+    int chain;                  // chain the keys move to (OP_MIGRATE), or -1
+    struct server_completions_t* completions;   // or NULL: writes are waited for in place
+    struct invoke_pending_t pending;            // a write waits for the chain: no request is processed meanwhile
+    int status;                                 // of the pending write, once acknowledged
+    struct ServerConnection* next_completed;
+};
+
+/**
+ * @brief Creates the state of a client connection.
+ *
+ * @param fd The client socket.
+ * @param tx_buffer Buffer owned by the backend to hold responses, or NULL to use a growable one.
+ * @param tx_capacity The size of tx_buffer (ignored when tx_buffer is NULL).
+ * @param completions Where the writes forwarded down the chain are handed back once
+ * acknowledged, instead of being waited for (see server_connection_complete()), or NULL.
+ * @return The new connection, or NULL on failure.
+ */
+struct ServerConnection* server_connection_create(int fd, uint8_t* tx_buffer, size_t tx_capacity, struct server_completions_t* completions);
+
+/**
+ * @brief Closes the client socket and frees the connection state.
+ *
+ * @param conn The connection.
+ */
+void server_connection_destroy(struct ServerConnection* conn);
+
+/**
+ * @brief Returns free space at the end of the receive buffer, growing it if needed.
+ *
+ * @param conn The connection.
+ * @param available Updated with the number of bytes that can be written at the returned pointer.
+ * @return A pointer to the free space, or NULL on failure.
+ */
+uint8_t* server_connection_rx_space(struct ServerConnection* conn, size_t* available);
+
+/**
+ * @brief Marks n bytes written at server_connection_rx_space() as received.
+ *
+ * @param conn The connection.
+ * @param n The number of bytes received.
+ */
+void server_connection_rx_commit(struct ServerConnection* conn, size_t n);
+
+/**
+ * @brief Appends received bytes to the receive buffer.
+ *
+ * @param conn The connection.
+ * @param data The received bytes.
+ * @param n The number of received bytes.
+ * @return 0 on success, -1 on failure.
+ */
+int server_connection_receive(struct ServerConnection* conn, const uint8_t* data, size_t n);
+
+/**
+ * @brief Processes every complete request frame in the receive buffer, appending the
+ * responses to the transmit buffer. With a fixed transmit buffer, processing stops
+ * while there is no room for a maximum-sized response of either protocol. Processing
+ * also stops at an OP_REPLICATE, OP_SNAPSHOT or OP_MIGRATE request, after which the backend must
+ * hand the connection over with server_connection_start_replication(), and at a write left
+ * pending (conn->pending.pending), until server_connection_complete().
+ *
+ * @param conn The connection.
+ * @param ddb The distributed database.
+ * @return The number of requests processed, or -1 if the connection must be closed.
+ */
+int server_connection_process(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Hands the socket, and the bytes received after its OP_REPLICATE request, over
+ * to a replication stream (see replication.h), or the socket of an OP_SNAPSHOT (OP_MIGRATE) request
+ * to a snapshot stream (see snapshot.h), then frees the connection state. The
+ * socket must no longer be watched by the backend; it is made blocking and any pending
+ * response is written first.
+ *
+ * @param conn The connection.
+ * @param ddb The distributed database.
+ * @return 0 on success, -1 on failure (the socket is closed either way).
+ */
+int server_connection_start_replication(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Drops n bytes (already written to the socket) from the transmit buffer.
+ *
+ * @param conn The connection.
+ * @param n The number of bytes written.
+ */
+void server_connection_tx_consume(struct ServerConnection* conn, size_t n);
+
+/**
+ * @brief Appends the response of the pending write of a connection taken from
+ * server_completions_take(), after which its requests can be processed again. A connection
+ * closing meanwhile must be kept until then.
+ *
+ * @param conn The connection.
+ * @param ddb The distributed database.
+ * @return 0 on success, -1 if the connection must be closed.
+ */
+int server_connection_complete(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Sets up the hand-back of acknowledged writes to the thread of a backend.
+ *
+ * @param completions The completions.
+ * @return 0 on success, -1 on failure.
+ */
+int server_completions_init(struct server_completions_t* completions);
+
+/**
+ * @brief Frees the resources of the completions.
+ *
+ * @param completions The completions.
+ */
+void server_completions_destroy(struct server_completions_t* completions);
+
+/**
+ * @brief Takes the connections whose pending write was acknowledged, once completions->event_fd
+ * is readable.
+ *
+ * @param completions The completions.
+ * @return The connections, linked by next_completed, or NULL.
+ */
+struct ServerConnection* server_completions_take(struct server_completions_t* completions);
+
+#define SERVER_CONNECTION_MIN_READ 4096
+
+#endif
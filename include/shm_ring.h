@@ -0,0 +1,100 @@
+#ifndef _SHM_RING_H
+#define _SHM_RING_H /* Shared memory ring module */
+
+#include "sdmessage.pb-c.h"
+#include "arena.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHM_RING_SIZE (1 << 18)             // must be a power of 2 and hold a maximum-sized frame
+#define SHM_CHANNEL_MAGIC 0x4e444253        // "NDBS"
+
+// Single-producer single-consumer byte ring living in shared memory
+struct shm_ring_t {
+    uint32_t head __attribute__((aligned(64)));     // consumer position
+    uint32_t producer_waiting;
+    uint32_t tail __attribute__((aligned(64)));     // producer position
+    uint32_t consumer_waiting;
+    uint8_t data[SHM_RING_SIZE] __attribute__((aligned(64)));
+};
+
+// Shared memory region of a client: one ring per direction
+struct shm_channel_t {
+    uint32_t magic;
+    uint32_t closed;
+    struct shm_ring_t requests;     // client -> server
+    struct shm_ring_t responses;    // server -> client
+};
+
+// One side of a channel: the rings it writes to and reads from, plus the Unix socket
+// used to hand over the region, kept open to detect the peer going away
+struct shm_endpoint_t {
+    struct shm_channel_t* channel;
+    struct shm_ring_t* tx;
+    struct shm_ring_t* rx;
+    int peer_fd;
+};
+
+/**
+ * @brief Creates a shared memory channel backed by an anonymous memory file.
+ *
+ * @param memfd Updated with the memory file, to be passed to the peer.
+ * @return The mapped channel, or NULL on failure.
+ */
+struct shm_channel_t* shm_channel_create(int* memfd);
+
+/**
+ * @brief Maps the channel received from the peer.
+ *
+ * @param memfd The memory file received from the peer.
+ * @return The mapped channel, or NULL on failure.
+ */
+struct shm_channel_t* shm_channel_map(int memfd);
+
+/**
+ * @brief Unmaps a channel that is not attached to an endpoint.
+ *
+ * @param channel The mapped channel.
+ */
+void shm_channel_destroy(struct shm_channel_t* channel);
+
+/**
+ * @brief Creates an endpoint of the given channel.
+ *
+ * @param channel The mapped channel.
+ * @param peer_fd The Unix socket connected to the peer.
+ * @param is_server Whether the endpoint reads requests and writes responses.
+ * @return The endpoint, or NULL on failure.
+ */
+struct shm_endpoint_t* shm_endpoint_create(struct shm_channel_t* channel, int peer_fd, int is_server);
+
+/**
+ * @brief Marks the channel as closed, wakes the peer, unmaps the channel and closes the peer socket.
+ *
+ * @param endpoint The endpoint.
+ */
+void shm_endpoint_destroy(struct shm_endpoint_t* endpoint);
+
+/**
+ * @brief Writes a message to the endpoint, with the same framing used on sockets.
+ *
+ * @param endpoint The endpoint.
+ * @param msg The message.
+ * @return 0 (OK) or -1 on error.
+ */
+int shm_send_message(struct shm_endpoint_t* endpoint, MessageT* msg);
+
+/**
+ * @brief Reads the next message of the endpoint, waiting for it if needed.
+ *
+ * @param endpoint The endpoint.
+ * @param arena The arena to decode the message into (see release_message()), or NULL.
+ * @return The unpacked message, or NULL if the channel was closed or on error.
+ */
+MessageT* shm_read_message(struct shm_endpoint_t* endpoint, struct arena_t* arena);
+
+#define SHM_SPIN_ITERATIONS 2000
+#define SHM_WAIT_TIMEOUT_MS 500
+
+#endif
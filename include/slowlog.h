@@ -0,0 +1,105 @@
+#ifndef _SLOWLOG_H
+#define _SLOWLOG_H /* Slow operation log module (server) */
+
+#include "stats.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The requests that take NODEDB_SLOW_LOG_MS or longer in the server are kept in a ring of the
+ * last NODEDB_SLOW_LOG_SIZE, with the time spent waiting for the table lock, holding it,
+ * waiting for the chain to replicate a mutation, and packing the response (see
+ * struct slow_op_t). While a thread serves a request (from slowlog_begin() to slowlog_end()),
+ * the places measuring these phases add to its breakdown, timing every request then, sampled
+ * or not (see latency_sample()), which is why the slow log is disabled unless
+ * NODEDB_SLOW_LOG_MS is set. Requests are timed with the monotonic clock of the latencies; the
+ * wall-clock time an operation was received at is only worked out for the slow ones, which
+ * alone take the lock of the ring.
+ * OP_SLOWLOG fetches the ring, clearing it if asked to.
+ */
+
+enum SlowlogPhase {
+    SLOWLOG_LOCK_WAIT,
+    SLOWLOG_TABLE,
+    SLOWLOG_REPLICATION,
+    SLOWLOG_SERIALIZATION,
+    SLOWLOG_PHASES
+};
+
+#define SLOWLOG_KEY_SIZE 64             // bytes of the key kept, terminator included
+#define SLOWLOG_DEFAULT_MS 0                // disabled
+#define SLOWLOG_DEFAULT_SIZE 128
+
+// Request served by a thread
+struct slowlog_request_t {
+    bool active;
+    uint64_t start_ns;
+    uint64_t invoked_ns;                // the response was ready to be packed
+    int opcode;
+    char key[SLOWLOG_KEY_SIZE];
+    int value_size;
+    uint64_t phases[SLOWLOG_PHASES];
+};
+
+/**
+ * @brief Starts timing a request served by the calling thread (nothing if the slow log is
+ * disabled).
+ *
+ * @param opcode The opcode of the request (MessageT__Opcode).
+ * @param key The key of the request, or NULL.
+ * @param value_size The size of the value of the request.
+ */
+void slowlog_begin(int opcode, const char* key, int value_size);
+
+/**
+ * @brief Tells whether the calling thread is timing a request.
+ *
+ * @return true if it is.
+ */
+bool slowlog_active();
+
+/**
+ * @brief Adds to a phase of the request of the calling thread, if any.
+ *
+ * @param phase The phase.
+ * @param ns The time, in nanoseconds.
+ */
+void slowlog_add(enum SlowlogPhase phase, uint64_t ns);
+
+/**
+ * @brief Marks the response to the request of the calling thread ready, the time until
+ * slowlog_end() being that of its serialization.
+ */
+void slowlog_invoked();
+
+/**
+ * @brief Stops timing the request of the calling thread, logging it if slow.
+ */
+void slowlog_end();
+
+/**
+ * @brief Takes the request of the calling thread away from it, for a write answered later,
+ * once the chain acknowledged it (see invoke_complete()), the thread serving other requests
+ * meanwhile.
+ *
+ * @param request Where to keep the request.
+ */
+void slowlog_suspend(struct slowlog_request_t* request);
+
+/**
+ * @brief Makes a request taken by slowlog_suspend() that of the calling thread again.
+ *
+ * @param request The request.
+ */
+void slowlog_resume(struct slowlog_request_t* request);
+
+/**
+ * @brief Copies the operations of the slow log, oldest first.
+ *
+ * @param ops The copies (free with stats_destroy_slow_ops()), or NULL if there are none.
+ * @param reset Whether to clear the slow log.
+ * @return The number of operations, or -1 on error.
+ */
+int slowlog_fetch(struct slow_op_t** ops, bool reset);
+
+#endif
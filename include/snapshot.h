@@ -0,0 +1,184 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H /* State transfer module */
+
+#include "data.h"
+#include "arena.h"
+#include "message.h"
+#include "sdmessage.pb-c.h"
+#include "hash_ring.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct TableServerDistributedDatabase;
+
+/* A server joining the chain copies the table of the current tail (the source) before
+ * registering: it opens a connection with an OP_SNAPSHOT request carrying its own
+ * address:port, over which the source streams its table in chunks (OP_SNAPSHOT + 1 frames
+ * with puts in entries, seq holding the number of mutations logged when the chunk was read),
+ * reading the next chunk only once the previous one was written, so that a slow reader holds
+ * it back. From the request on, the source also logs every mutation it applies and streams the
+ * log between chunks as OP_BATCH frames (one mutation per key each): replayed after the chunks
+ * read before them, they leave the copy equal to the table of the source.
+ * Once the table is sent and the log drained, the source reports SNAPSHOT_CAUGHT_UP and the
+ * joining server registers, becoming the successor of the source: the mutations applied by
+ * the source from then on are replicated, and the log is closed, drained and followed by
+ * SNAPSHOT_END. Until then, the joining server ignores the logged mutations of keys already
+ * mutated through replication, which are more recent.
+ * Should another server register between the source and the joining server meanwhile, the
+ * joining server drops the copy and copies the table of that server instead.
+ * A server rejoining the chain presents in seq the chain seq it applied every mutation up to
+ * (see backlog.h): if the backlog of the source still holds every mutation after it, they are
+ * logged ahead of the rest and no table is copied. The source starts the stream with
+ * SNAPSHOT_DELTA, or SNAPSHOT_FULL and the chain seq its table holds every mutation up to, and
+ * ends it with the chain seq its table held every mutation up to when the log was closed.
+ * The head of a chain joining the ring (see hash_ring.h) takes over its keys the same way, with
+ * an OP_MIGRATE request carrying its chain in result to the head of every chain in the ring:
+ * only the keys moving to its chain are streamed and logged, and the log is closed once that
+ * chain joined the ring, from when the source refuses new mutations of those keys.
+ */
+
+// Mutation applied by the source while the snapshot is streamed; the key and value follow the struct
+struct snapshot_mutation_t {
+    struct snapshot_mutation_t* next;
+    uint64_t seq;
+    uint64_t chain_seq;
+    MessageT__Opcode opcode;
+    char* key;
+    uint8_t* value;
+    size_t value_size;
+};
+
+// Mutations applied by the source and not yet streamed to a joining server
+struct snapshot_log_t {
+    struct snapshot_log_t* next;        // other logs of the source
+    char* successor;                    // address:port of the joining server
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct snapshot_mutation_t* head;
+    struct snapshot_mutation_t* tail;
+    uint64_t next_seq;                  // seq of the next mutation
+    size_t size;                        // bytes held
+    size_t max_size;                    // NODEDB_SNAPSHOT_LOG_MB
+    bool overflowed;                    // the joining server fell too far behind
+    bool spliced;                       // the joining server became the successor: the log is complete
+    bool delta;                         // the mutations the rejoining server misses were logged ahead: no table is copied
+    uint64_t base;                      // chain seq the table of the source held every mutation up to when logging started
+    uint64_t spliced_base;              // chain seq the table of the source held every mutation up to when spliced
+    int chain;                          // chain the keys are moving to (OP_MIGRATE), or -1
+    struct hash_ring_t* ring;           // ring with that chain, telling which keys move
+};
+
+// Joining side of a snapshot stream
+struct snapshot_sync_t {
+    int fd;
+    struct arena_t* arena;
+    uint64_t entries;                   // table entries copied
+    uint64_t mutations;                 // logged mutations replayed
+    bool migration;                     // keys moving to this chain, numbered by another one
+};
+
+/**
+ * @brief Logs a mutation just applied by the source, in the order mutations are applied.
+ *
+ * @param log The log.
+ * @param chain_seq The chain seq of the mutation.
+ * @param opcode MESSAGE_T__OPCODE__OP_PUT, MESSAGE_T__OPCODE__OP_DEL or MESSAGE_T__OPCODE__OP_BAD (no-op).
+ * @param key The key.
+ * @param value The value (PUT only).
+ */
+void snapshot_log_append(struct snapshot_log_t* log, uint64_t chain_seq, MessageT__Opcode opcode, char* key, struct data_t* value);
+
+/**
+ * @brief Closes the log: the joining server became the successor of the source, which
+ * replicates the following mutations.
+ *
+ * @param log The log.
+ * @param applied The chain seq the source applied every mutation up to.
+ */
+void snapshot_log_splice(struct snapshot_log_t* log, uint64_t applied);
+
+/**
+ * @brief Streams, on a thread of its own, the table and the logged mutations of the source
+ * to the joining server whose OP_SNAPSHOT request was just read from fd.
+ *
+ * @param fd The socket (owned by the stream from now on).
+ * @param successor The address:port of the joining server.
+ * @param since The chain seq a rejoining server applied every mutation up to, or 0.
+ * @param chain The chain the keys move to (OP_MIGRATE request), or -1.
+ * @param ddb The distributed database.
+ * @return 0 (OK) or -1 on error (fd is closed).
+ */
+int snapshot_stream_start(int fd, const char* successor, uint64_t since, int chain, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Opens the snapshot stream of the source and replays it until the source reports
+ * SNAPSHOT_CAUGHT_UP, after which the caller may register as its successor.
+ *
+ * @param source The address:port of the source.
+ * @param self The address:port this server registers with.
+ * @param since The chain seq this server applied every mutation up to, if rejoining with its
+ * table (replaced by a copy unless the source still holds the mutations after it), or 0.
+ * @param ddb The distributed database (see ddb_set_syncing()).
+ * @return The stream, or NULL on failure.
+ */
+struct snapshot_sync_t* snapshot_sync_open(const char* source, const char* self, uint64_t since, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Opens the stream of the keys moving from the chain of the source (its head) to the
+ * chain of this server, and replays it until the source reports SNAPSHOT_CAUGHT_UP, after
+ * which the caller may add its chain to the ring.
+ *
+ * @param source The address:port of the source.
+ * @param self The address:port of this server.
+ * @param chain The chain of this server.
+ * @param ddb The distributed database (see ddb_set_syncing()).
+ * @return The stream, or NULL on failure.
+ */
+struct snapshot_sync_t* snapshot_migration_open(const char* source, const char* self, int chain, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Replays the rest of the log, until the source reports SNAPSHOT_END, then closes
+ * and frees the stream.
+ *
+ * @param sync The stream.
+ * @param ddb The distributed database.
+ * @return 0 (OK) or -1 on error.
+ */
+int snapshot_sync_finish(struct snapshot_sync_t* sync, struct TableServerDistributedDatabase* ddb);
+
+/**
+ * @brief Closes and frees the stream without replaying the rest of the log, the source
+ * turning out not to be the previous server of this one.
+ *
+ * @param sync The stream (may be NULL).
+ */
+void snapshot_sync_abort(struct snapshot_sync_t* sync);
+
+#define SNAPSHOT_CHUNK 0                // values of result in OP_SNAPSHOT + 1 frames
+#define SNAPSHOT_CAUGHT_UP 1
+#define SNAPSHOT_END 2
+#define SNAPSHOT_FULL 3
+#define SNAPSHOT_DELTA 4
+
+#define SNAPSHOT_MAX_ENTRIES 256        // entries of a chunk
+#define SNAPSHOT_ENTRY_OVERHEAD 16      // fields of an entry besides its key and value
+#define SNAPSHOT_CHUNK_BUDGET (MESSAGE_MAX_FRAME_SIZE - SNAPSHOT_MAX_ENTRIES * SNAPSHOT_ENTRY_OVERHEAD - 64)
+#define SNAPSHOT_MAX_BATCH 256          // logged mutations of a batch
+#define SNAPSHOT_DEFAULT_LOG_MB 64
+#define SNAPSHOT_WAIT_MS 200
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define SNAPSHOT_SERVING "[ \033[1;35mSnapshot\033[0m ] - Streaming the %s to joining server %s\n"
+#define SNAPSHOT_SERVED "[ \033[1;35mSnapshot\033[0m ] - Joining server %s is now the successor (%lu entries, %lu logged mutations sent)\n"
+#define SNAPSHOT_ABORTED "[ \033[1;35mSnapshot\033[0m ] - Stream to joining server %s aborted%s\n"
+#define SNAPSHOT_CAUGHT_UP_MSG "[ \033[1;35mSnapshot\033[0m ] - Caught up with %s (%lu entries, %lu logged mutations)\n"
+#define SNAPSHOT_COMPLETED "[ \033[1;35mSnapshot\033[0m ] - Spliced after the source (%lu entries, %lu logged mutations)\n"
+#define SNAPSHOT_MIGRATED "[ \033[1;35mSnapshot\033[0m ] - Took over the keys of another chain (%lu entries, %lu logged mutations)\n"
+
+#endif
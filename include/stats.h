@@ -1,12 +1,118 @@
 #ifndef _STATS_H
 #define _STATS_H /* Módulo stats */
 
+/* Lotes de replicação de 1, 2-3, 4-7, ..., 64 mutações */
+#define STATS_BATCH_BUCKETS 7
+
+/* Latências de confirmação de 0, 1, 2-3, 4-7, ... micro segundos */
+#define STATS_LATENCY_BUCKETS 24
+
+/* Servidores seguintes de que um servidor indica o atraso */
+#define STATS_MAX_SUCCESSORS 16
+
+/* Chaves mais acedidas mostradas, por operações e por bytes */
+#define STATS_MAX_HOT_KEYS 16
+
+/* Operações de que o servidor mede as latências */
+enum StatsOp {
+    STATS_OP_PUT,
+    STATS_OP_GET,
+    STATS_OP_DEL,
+    STATS_OP_SIZE,
+    STATS_OP_GETKEYS,
+    STATS_OP_GETTABLE,
+    STATS_OP_OTHER,
+    STATS_OPS
+};
+
+/* Fases de uma operação: na tabela (com o lock), à espera da replicação, no servidor
+ * (do pedido recebido à resposta pronta), e à espera do lock da tabela */
+enum StatsPhase {
+    STATS_PHASE_TABLE,
+    STATS_PHASE_REPLICATION,
+    STATS_PHASE_TOTAL,
+    STATS_PHASE_LOCK_WAIT,
+    STATS_PHASES
+};
+
+/* Histograma de latências (nanosegundos) ao estilo HDR: cada potência de 2 é dividida em
+ * STATS_HISTOGRAM_SUB_BUCKETS buckets lineares (erro relativo de 12.5%), até 2^STATS_HISTOGRAM_MAX_EXPONENT ns */
+#define STATS_HISTOGRAM_SUB_BITS 3
+#define STATS_HISTOGRAM_SUB_BUCKETS (1 << STATS_HISTOGRAM_SUB_BITS)
+#define STATS_HISTOGRAM_MAX_EXPONENT 37
+#define STATS_HISTOGRAM_BUCKETS ((STATS_HISTOGRAM_MAX_EXPONENT - STATS_HISTOGRAM_SUB_BITS + 1) * STATS_HISTOGRAM_SUB_BUCKETS)
+
+struct stats_histogram_t {
+    long long buckets[STATS_HISTOGRAM_BUCKETS];
+    long long sum_ns;
+    long long max_ns;
+};
+
+/* Estrutura que define o atraso de um servidor seguinte (ou backup).
+ */
+struct successor_stats_t {
+    char* address;
+    long long queued;                   /* mutações por enviar */
+    long long in_flight;                /* mutações enviadas por confirmar */
+    long long bytes_in_flight;
+    long long seq_lag;
+    long long ack_latency[STATS_LATENCY_BUCKETS];
+    long long throttled;
+    long long async_acks;
+    int lagging;
+};
+
+/* Estrutura que define uma operação lenta (do slow log de um servidor), com o tempo
+ * passado em cada fase em nanosegundos.
+ */
+struct slow_op_t {
+    long long time_ms;                  /* recebida em (milisegundos desde a epoch) */
+    int opcode;
+    char* key;
+    int value_size;
+    long long lock_wait_ns;
+    long long table_ns;
+    long long replication_ns;
+    long long serialization_ns;
+    long long total_ns;
+};
+
+/* Estrutura que define uma chave muito acedida (heavy hitter) de um servidor, com o
+ * número estimado de operações e de bytes dos seus valores.
+ */
+struct hot_key_t {
+    char* key;
+    long long ops;
+    long long bytes;
+};
+
+/* Estrutura que define a memória de um subsistema do servidor (ver utils.h): em uso, e
+ * reservada desde o arranque.
+ */
+struct memory_stats_t {
+    char* tag;
+    long long bytes;
+    long long objects;
+    long long allocations;
+    long long allocated_bytes;
+};
+
 /* Estrutura que define as estatisticas.
  */
 struct statistics_t {
-    int op_counter;
+    long long op_counter;
     long long computed_time_micros;
     int active_clients;
+    long long replication_batches[STATS_BATCH_BUCKETS]; /* lotes de replicação enviados, por tamanho */
+    long long replication_bytes_saved;
+    long long replication_coalesced;
+    struct successor_stats_t* successors; /* servidores seguintes do servidor que respondeu */
+    int n_successors;
+    struct stats_histogram_t* latencies;  /* STATS_OPS * STATS_PHASES histogramas (op * STATS_PHASES + fase), ou NULL */
+    int timing_sample;                    /* 1 em cada timing_sample operações é medida */
+    struct memory_stats_t* memory;        /* memória de cada subsistema, ou NULL */
+    int n_memory;
+    long long uptime_ms;                  /* tempo desde o arranque do servidor */
 };
 
 /* Função que cria um novo elemento de dados statistics_t e que inicializa 
@@ -14,7 +120,7 @@ struct statistics_t {
  * reservar memória para os dados.	
  * Retorna a nova estrutura ou NULL em caso de erro.
  */
-struct statistics_t* stats_create(int op_counter, long long computed_time_micros, int active_clients); 
+struct statistics_t* stats_create(long long op_counter, long long computed_time_micros, int active_clients); 
 
 /* Função que elimina um bloco de dados, apontado pelo parâmetro data,
  * libertando toda a memória por ele ocupada.
@@ -25,5 +131,57 @@ int stats_destroy(struct statistics_t* stats);
 /* Função que imprime uma representação textual de statistics_t */
 void stats_show(struct statistics_t* stats);
 
-#define STATS_STR "Current total of completed operations: %d\nCurrent amount of clients: %d\nCurrent amount of computation time (micro s): %lld\n"
+/* Função que imprime os percentis das latências de cada operação e fase.
+ */
+void stats_show_latencies(struct statistics_t* stats);
+
+/* Função que imprime a memória de cada subsistema, e a taxa de reservas desde o arranque.
+ */
+void stats_show_memory(struct statistics_t* stats);
+
+/* Função que imprime as n operações lentas ops.
+ */
+void stats_show_slow_ops(struct slow_op_t* ops, int n);
+
+/* Função que liberta as n operações lentas ops.
+ */
+void stats_destroy_slow_ops(struct slow_op_t* ops, int n);
+
+/* Função que imprime as n chaves keys, por operações e por bytes (reordenando keys).
+ */
+void stats_show_hot_keys(struct hot_key_t* keys, int n);
+
+/* Função que liberta as n chaves keys.
+ */
+void stats_destroy_hot_keys(struct hot_key_t* keys, int n);
+
+/* Função que retorna o índice do bucket de uma latência em nanosegundos.
+ */
+int stats_histogram_index(long long latency_ns);
+
+/* Função que retorna o maior valor (nanosegundos) do bucket index.
+ */
+long long stats_histogram_bound(int index);
+
+/* Função que retorna o número de latências do histograma.
+ */
+long long stats_histogram_count(struct stats_histogram_t* histogram);
+
+/* Função que retorna a latência (nanosegundos) abaixo da qual fica a fração
+ * fraction das latências do histograma, ou 0 se este estiver vazio.
+ */
+long long stats_histogram_percentile(struct stats_histogram_t* histogram, double fraction);
+
+#define STATS_STR "Current total of completed operations: %lld\nCurrent amount of clients: %d\nCurrent amount of computation time (micro s): %lld\n"
+#define STATS_SUCCESSOR_STR "Successor %s%s: %lld queued, %lld in flight (%lld bytes), chain seq lag %lld, ack latency p50 < %lld us, p99 < %lld us, %lld writers throttled, %lld mutations acknowledged ahead\n"
+#define STATS_LATENCY_HEADER "%-9s %-12s %10s %10s %10s %10s %10s %10s %10s\n", "op", "phase", "count", "mean us", "p50 us", "p90 us", "p99 us", "p999 us", "max us"
+#define STATS_LATENCY_SAMPLED_STR "(1 in %d operations timed)\n"
+#define STATS_LATENCY_STR "%-9s %-12s %10lld %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n"
+#define STATS_MEMORY_HEADER "%-12s %14s %12s %14s %12s %14s\n", "memory", "bytes", "objects", "allocations", "allocs/s", "alloc bytes/s"
+#define STATS_MEMORY_STR "%-12s %14lld %12lld %14lld %12.1f %14.1f\n"
+#define STATS_SLOW_OPS_HEADER "%-23s %-9s %-24s %8s %10s %10s %12s %10s %10s\n", "time", "op", "key", "bytes", "wait us", "table us", "replicate us", "serial us", "total us"
+#define STATS_SLOW_OP_STR "%-23s %-9s %-24.24s %8d %10.1f %10.1f %12.1f %10.1f %10.1f\n"
+#define STATS_HOT_KEYS_HEADER "%-32s %14s %16s\n", "key", "ops (est.)", "bytes (est.)"
+#define STATS_HOT_KEY_STR "%-32.32s %14lld %16lld\n"
+#define STATS_REPLICATION_STR "Replication batches (1/2-3/4-7/8-15/16-31/32-63/64 mutations): %lld/%lld/%lld/%lld/%lld/%lld/%lld\nReplication bytes saved: %lld (%lld superseded mutations collapsed)\n"
 #endif
\ No newline at end of file
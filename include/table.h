@@ -2,6 +2,10 @@
 #define _TABLE_H /* Módulo table */
 
 #include "data.h"
+#include "entry.h"
+
+#include <stddef.h>
+#include <stdbool.h>
 
 struct table_t; /* definida em table-private.h */
 
@@ -32,6 +36,19 @@ int table_put(struct table_t *table, char *key, struct data_t *value);
  */
 struct data_t *table_get(struct table_t *table, char *key);
 
+/* Função que copia os dados da entry com a chave key para buffer, sem
+ * alocar memória.
+ * Retorna o tamanho dos dados, -1 se não encontrar a entry ou em caso de
+ * erro, ou -2 se os dados não couberem em buffer (capacity bytes).
+ */
+int table_read(struct table_t *table, char *key, void *buffer, int capacity);
+
+/* Função que devolve os dados da entry com a chave key, sem os copiar: só
+ * são válidos até a entry ser alterada ou removida.
+ * Retorna os dados ou NULL se não encontrar a entry ou em caso de erro.
+ */
+struct data_t *table_peek(struct table_t *table, char *key);
+
 /* Função que remove da lista a entry com a chave key, libertando a
  * memória ocupada pela entry.
  * Retorna 0 se encontrou e removeu a entry, 1 se não encontrou a entry,
@@ -39,6 +56,12 @@ struct data_t *table_get(struct table_t *table, char *key);
  */
 int table_remove(struct table_t *table, char *key);
 
+/* Função que remove todas as entries da tabela, libertando a memória
+ * ocupada por elas.
+ * Retorna 0 (ok) ou -1 em caso de erro.
+ */
+int table_clear(struct table_t *table);
+
 /* Função que conta o número de entries na tabela passada como argumento.
  * Retorna o tamanho da tabela ou -1 em caso de erro.
  */
@@ -51,6 +74,24 @@ int table_size(struct table_t *table);
  */
 char **table_get_keys(struct table_t *table);
 
+/* Função que copia para entries, por ordem, as entries da tabela a seguir ao
+ * cursor: lista *index, keys maiores que after (ou desde o início da lista se
+ * after for NULL), seguida das listas seguintes. Copia no máximo max entries,
+ * parando antes de o tamanho das keys e dados copiados exceder budget bytes
+ * (copia sempre pelo menos uma entry). Atualiza *index com a lista da última
+ * entry copiada, que serve de after na chamada seguinte.
+ * Retorna o número de entries copiadas (0 no fim da tabela) ou -1 em caso de
+ * erro.
+ */
+int table_scan(struct table_t *table, int *index, char *after, struct entry_t **entries, int max, size_t budget);
+
+/* Como table_scan(), mas copia para keys apenas as keys aceites por wanted
+ * (chamada com arg), sem os dados: as restantes entries não são copiadas.
+ * Retorna o número de keys copiadas (0 no fim da tabela) ou -1 em caso de
+ * erro.
+ */
+int table_scan_keys(struct table_t *table, int *index, char *after, bool (*wanted)(const char *key, void *arg), void *arg, char **keys, int max);
+
 /* Função que liberta a memória ocupada pelo array de keys obtido pela 
  * função table_get_keys.
  * Retorna 0 (OK) ou -1 em caso de erro.
@@ -0,0 +1,199 @@
+#ifndef _TABLE_BENCH_H
+#define _TABLE_BENCH_H /* YCSB-style load generator */
+
+#include "client_stub.h"
+#include "stats.h"
+#include "workload.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <poll.h>
+
+/* table-bench loads a set of records and then runs a workload of reads (GET) and updates (PUT)
+ * of them, as YCSB does: every thread keeps its own connections, each one with up to depth
+ * requests in flight (compact protocol connections only; see network_compact_send()), and keys
+ * are drawn uniformly or by a zipfian distribution, whose hottest keys are scattered over the
+ * key space. It drives a single server, or every chain found in ZooKeeper, routing keys by the
+ * ring as table-client does, and reports the throughput and latency percentiles of each phase.
+ */
+
+#define BENCH_MAX_TARGETS 64
+#define BENCH_MAX_READERS 16
+#define BENCH_MAX_DEPTH 1024
+#define BENCH_KEY_SIZE 32
+
+enum BenchOp {
+    BENCH_READ,
+    BENCH_UPDATE,
+    BENCH_OPS
+};
+
+// Latencies of the operations of one kind, in the buckets of the server's (see stats.h)
+struct bench_histogram_t {
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t errors;
+    uint64_t max_ns;
+};
+
+// Servers of a chain (or the server given with -s)
+struct bench_target_t {
+    int id;                                     // chain id, -1 for a single server
+    char* write_address;                        // address:port of the head
+    char* read_addresses[BENCH_MAX_READERS];    // address:port of the servers answering reads
+    int n_reads;
+};
+
+// Requests in flight on a connection to a server
+struct bench_endpoint_t {
+    struct rtable_t* rtable;
+    uint64_t* sent_ns;                          // ring of depth send times, oldest at first
+    uint8_t* ops;                               // ring of depth operations
+    int first;
+    int pending;
+};
+
+// A connection of a thread to every server of every target
+struct bench_connection_t {
+    struct bench_endpoint_t writes[BENCH_MAX_TARGETS];
+    struct bench_endpoint_t reads[BENCH_MAX_TARGETS][BENCH_MAX_READERS];
+    unsigned int next_read;
+};
+
+struct TableBenchOptions {
+    char* address;              // ZooKeeper (or server, with -s) address:port
+    bool direct;                // address is a table server
+    int threads;
+    int connections;            // per thread
+    int depth;                  // requests in flight per connection
+    double read_proportion;     // the rest are updates
+    uint64_t records;
+    int value_size;
+    bool uniform;               // uniform instead of zipfian key choice
+    double theta;               // zipfian constant
+    uint64_t operations;
+    int duration;               // seconds, overriding operations if positive
+    bool skip_load;
+    int valid;
+};
+
+// Outcome of a phase (load or run)
+struct bench_result_t {
+    const char* phase;
+    double seconds;
+    struct bench_histogram_t histograms[BENCH_OPS];
+};
+
+// State shared by the threads of a phase
+struct bench_phase_t {
+    bool load;
+    uint64_t operations;        // shared out between the threads, unless stopped by the deadline
+    uint64_t deadline_ns;       // 0 if none
+    struct zipfian_t zipfian;
+};
+
+// A thread of a phase
+struct bench_thread_t {
+    pthread_t thread;
+    int index;
+    struct bench_phase_t* phase;
+    struct bench_connection_t* connections;
+    struct bench_endpoint_t** pipelined;        // for thread_poll(): the endpoints with requests in flight
+    struct pollfd* pollfds;                     // of the pipelined endpoints
+    uint64_t rng;
+    uint8_t* value;
+    struct bench_histogram_t histograms[BENCH_OPS];
+};
+
+void BENCH_INIT();
+void BENCH_EXIT(int status);
+void BENCH_FREE();
+
+// Function to parse argv, updating global TableBenchOptions struct
+void tb_parse_args(int argc, char* argv[]);
+
+// Function to display the information in the given TableBenchOptions struct
+void tb_show_options(struct TableBenchOptions* options);
+
+/**
+ * @brief Records the latency of an operation.
+ *
+ * @param histogram The histogram.
+ * @param latency_ns The latency, in nanoseconds.
+ * @param failed Whether the operation failed.
+ */
+void bench_histogram_record(struct bench_histogram_t* histogram, uint64_t latency_ns, bool failed);
+
+/**
+ * @brief Adds the latencies of from to into.
+ *
+ * @param into The histogram receiving the latencies.
+ * @param from The histogram to add.
+ */
+void bench_histogram_merge(struct bench_histogram_t* into, struct bench_histogram_t* from);
+
+/**
+ * @brief Finds the latency below which a fraction of the operations completed.
+ *
+ * @param histogram The histogram.
+ * @param fraction The fraction, in [0, 1].
+ * @return The upper bound of the bucket holding it, in nanoseconds (0 if empty).
+ */
+uint64_t bench_histogram_percentile(struct bench_histogram_t* histogram, double fraction);
+
+/**
+ * @brief Runs a phase on every thread.
+ *
+ * @param phase The phase.
+ * @param result The result to fill.
+ * @return 0 (OK) or -1 on error.
+ */
+int bench_run(struct bench_phase_t* phase, struct bench_result_t* result);
+
+/**
+ * @brief Prints the throughput and latencies of a phase.
+ *
+ * @param result The result.
+ */
+void bench_report(struct bench_result_t* result);
+
+// ====================================================================================================
+//                                          ERROR HANDLING
+// ====================================================================================================
+#define TB_ERROR_ARGS "\033[0;31m[!] Error:\033[0m Invalid arguments. Execute `table-bench -h` for 'help'.\n"
+
+// Program arguments-related constants
+#define TB_USAGE_STR   "\033[1mUsage:\033[0m \033[33m./table-bench\033[0m [options] \033[32mzk_host:zk_port\033[0m\n"\
+                    "\033[1mOptions:\033[0m\n"\
+                    "  \033[32m-h\033[0m: Print this usage message\n"\
+                    "  \033[32m-s\033[0m: The address is a table server rather than ZooKeeper\n"\
+                    "  \033[32m-w a|b|c\033[0m: YCSB workload: a (50%% reads), b (95%% reads) or c (read only)\n"\
+                    "  \033[32m-r proportion\033[0m: Proportion of reads, the rest being updates (default 0.5)\n"\
+                    "  \033[32m-k records\033[0m: Number of records (default 10000)\n"\
+                    "  \033[32m-v bytes\033[0m: Size of the values (default 100)\n"\
+                    "  \033[32m-u\033[0m: Choose keys uniformly instead of by a zipfian distribution\n"\
+                    "  \033[32m-z theta\033[0m: Zipfian constant (default 0.99)\n"\
+                    "  \033[32m-t threads\033[0m: Number of threads (default 1)\n"\
+                    "  \033[32m-c connections\033[0m: Connections per thread (default 1)\n"\
+                    "  \033[32m-p depth\033[0m: Requests in flight per connection (default 1)\n"\
+                    "  \033[32m-n operations\033[0m: Operations of the run phase (default 100000)\n"\
+                    "  \033[32m-d seconds\033[0m: Duration of the run phase, instead of a number of operations\n"\
+                    "  \033[32m-l\033[0m: Skip the load phase, the records being there already\n"
+
+#define BENCH_DEFAULT_RECORDS 10000
+#define BENCH_DEFAULT_VALUE_SIZE 100
+#define BENCH_DEFAULT_THETA 0.99
+#define BENCH_DEFAULT_OPERATIONS 100000
+#define BENCH_DEFAULT_READ_PROPORTION 0.5
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+#define BENCH_WAITING_FOR_SERVERS "[ \033[1;32mInfo\033[0m ] - Waiting for available servers...\n"
+#define BENCH_TARGET "[ \033[1;33mBench\033[0m ] - Chain %d: writes to %s, reads from %d server(s)\n"
+#define BENCH_NO_PIPELINE "[ \033[1;33mBench\033[0m ] - %s:%d does not use the compact protocol: one request in flight\n"
+#define BENCH_PHASE "[ \033[1;33mBench\033[0m ] - %s: %llu operations in %.2f s (%.0f ops/s)\n"
+#define BENCH_LATENCY "  %-6s %10llu ops %8llu errors   p50 %8.1f us   p99 %8.1f us   p999 %8.1f us   max %8.1f us\n"
+
+#endif
@@ -2,12 +2,31 @@
 #define _TABLE_CLIENT_H
 
 #include "client_stub.h"
+#include "hash_ring.h"
+
+#include <pthread.h>
+#include <stdbool.h>
 
 #define MAX_INPUT_LENGTH 256
+#define TC_MAX_CHAINS 64
 
-struct TableClientData {
+// Servers of a chain, holding the keys the ring maps to it
+struct TableClientChain {
+    int id;
     struct rtable_t* head_table;
     struct rtable_t* tail_table;
+    struct rtable_t** read_tables;  // every server of the chain, taking turns to answer reads (under mutex)
+    int n_read_tables;
+    unsigned int next_read;
+    struct rtable_t** retired_tables;   // of servers that left, which a read may still be using
+    int n_retired_tables;               // (disconnected by the next read, under mutex)
+};
+
+struct TableClientData {
+    struct TableClientChain chains[TC_MAX_CHAINS];
+    int n_chains;
+    struct hash_ring_t* ring;       // chains holding the keys, replaced under mutex
+    pthread_mutex_t mutex;
     int valid;
     int terminate;
 };
@@ -40,6 +59,12 @@ int size();
 int del(char *key);
 int get(char *key);
 int put(char* key, char* value);
+// with detail, the latency percentiles of every operation and the memory of every subsystem too
+int stats(bool detail);
+// the slow operations of the head and of the tail of every chain, cleared with reset
+int slowlog(bool reset);
+// the keys with the most operations, and bytes, of every chain (over all of its servers)
+int hotkeys(bool reset);
 
 // ====================================================================================================
 //                                          ERROR HANDLING
@@ -53,7 +78,9 @@ int put(char* key, char* value);
 #define TC_NUMBER_OF_ARGS 2
 #define TC_USAGE_STR   "\033[1mUsage:\033[0m \033[33m./table-client\033[0m \033[32mserver:port\033[0m\n"\
                     "\033[1mOptions:\033[0m\n"\
-                    "  \033[32m-h\033[0m: Print this usage message\n"
+                    "  \033[32m-h\033[0m: Print this usage message\n"\
+                    "\033[1mEnvironment:\033[0m\n"\
+                    "  \033[32mNODEDB_READS\033[0m: chain (default) to spread reads over every server, or tail\n"
 
 // ====================================================================================================
 //                                            MESSAGES
@@ -2,9 +2,11 @@
 #define _TABLE_SERVER_H
 
 #include "table.h"
+#include "event_loop.h"
 
 struct TableServerConfig {
     int listening_fd;
+    int local_fd;
     int valid;
 };
 
@@ -12,6 +14,8 @@ struct TableServerOptions {
     int listening_port;
     int n_lists;
     char* zk_connection_str;
+    enum IOBackend io_backend;
+    int local_transport;
     int valid;
 };
 
@@ -35,6 +39,29 @@ void ts_show_options(struct TableServerOptions* options);
 #define TS_NUMBER_OF_ARGS 4
 #define TS_USAGE_STR   "\033[1mUsage:\033[0m \033[33m./table-server\033[0m \033[32mport n_list zk_host:zk_port\033[0m\n"\
                     "\033[1mOptions:\033[0m\n"\
-                    "  \033[32m-h\033[0m: Print this usage message\n"
+                    "  \033[32m-h\033[0m: Print this usage message\n"\
+                    "\033[1mEnvironment:\033[0m\n"\
+                    "  \033[32mNODEDB_IO_BACKEND\033[0m: threads (default), epoll or uring\n"\
+                    "  \033[32mNODEDB_LOCAL_TRANSPORT\033[0m: Serve co-located clients over a Unix socket/shared memory (default 1)\n"\
+                    "  \033[32mNODEDB_SOCKET_DIR\033[0m: Directory of the Unix socket (default /tmp)\n"\
+                    "  \033[32mNODEDB_URING_CONNECTIONS\033[0m: Maximum clients of the uring backend (default 128)\n"\
+                    "  \033[32mNODEDB_ZEROCOPY_THRESHOLD\033[0m: Minimum response size sent with MSG_ZEROCOPY by the threads backend, 0 to disable (default 16384)\n"\
+                    "  \033[32mNODEDB_REPLICATION_WINDOW\033[0m: Mutations forwarded to the next server per lane before waiting for acknowledgements (default 64)\n"\
+                    "  \033[32mNODEDB_REPLICATION_LANES\033[0m: Connections to the next server, keys being spread over them (default 4)\n"\
+                    "  \033[32mNODEDB_REPLICATION_COALESCE\033[0m: Collapse mutations superseded within a replication batch (default 1)\n"\
+                    "  \033[32mNODEDB_SNAPSHOT_LOG_MB\033[0m: Mutations logged for a joining server before its snapshot is aborted, in MiB (default 64)\n"\
+                    "  \033[32mNODEDB_BACKLOG_SIZE\033[0m: Mutations kept for servers rejoining the chain after their session expired (default 65536)\n"\
+                    "  \033[32mNODEDB_BACKLOG_MB\033[0m: Bytes of the mutations kept for rejoining servers, in MiB, the oldest being dropped first (default 64)\n"\
+                    "  \033[32mNODEDB_CHAIN\033[0m: Chain this server joins, keys being spread over the chains (default 0)\n"\
+                    "  \033[32mNODEDB_REPLICATION_MODE\033[0m: chain (default) to forward mutations down the chain, or fanout for the head to send them to every server at once\n"\
+                    "  \033[32mNODEDB_FANOUT_QUORUM\033[0m: Servers acknowledging a mutation before the head commits it, in fanout mode (default 0, every one)\n"\
+                    "  \033[32mNODEDB_ANTI_ENTROPY_MS\033[0m: Interval between comparisons of the table with the one of the predecessor, by digest (default 1000, 0 to disable)\n"\
+                    "  \033[32mNODEDB_LAG_LIMIT_KB\033[0m: Bytes of mutations held for a successor, in KiB, past which it is lagging (default 0, no limit)\n"\
+                    "  \033[32mNODEDB_LAG_POLICY\033[0m: throttle (default) to hold writers back while a successor lags, or async to acknowledge them before it does\n"\
+                    "  \033[32mNODEDB_TIMING_SAMPLE\033[0m: Time one operation in N, for the computation time and latency histograms (default 1, every one)\n"\
+                    "  \033[32mNODEDB_HOTKEYS_SAMPLE\033[0m: Count one operation in N, by N, in the sketches of the hot keys (default 8, 1 for every one)\n"\
+                    "  \033[32mNODEDB_LOG_LEVEL\033[0m: error, warn, info (default) or debug, to log every request; SIGUSR1 switches to debug and back\n"\
+                    "  \033[32mNODEDB_SLOW_LOG_MS\033[0m: Time in the server past which a request is kept in the slow log, with its breakdown, every request being timed while enabled (default 0, disabled)\n"\
+                    "  \033[32mNODEDB_SLOW_LOG_SIZE\033[0m: Requests kept in the slow log, the oldest making room for new ones (default 128)\n"
 
 #endif
\ No newline at end of file
@@ -4,19 +4,24 @@
 #include "table_server.h"
 #include "distributed_database.h"
 #include "sdmessage.pb-c.h"
+#include "table_skel.h"
 
 
 // helpers to perform an action over a table
 // verifying if the message is valid
 // performing action and updating msg with regard to its result
 int error(MessageT* msg);
-int put(MessageT* msg, struct TableServerDistributedDatabase* ddb);
+int put(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending);
 int get(MessageT* msg, struct TableServerDistributedDatabase* ddb);
-int del(MessageT* msg, struct TableServerDistributedDatabase* ddb);
+int del(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending);
 int size(MessageT* msg, struct TableServerDistributedDatabase* ddb);
 int getkeys(MessageT* msg, struct TableServerDistributedDatabase* ddb);
 int gettable(MessageT* msg, struct TableServerDistributedDatabase* ddb);
 int stats(MessageT* msg, struct TableServerDistributedDatabase* ddb);
+int hotkeys(MessageT* msg);
+int slowlog(MessageT* msg);
+int hello(MessageT* msg);
+int digest(MessageT* msg, struct TableServerDistributedDatabase* ddb);
 
 // ====================================================================================================
 //                                            MESSAGES
@@ -4,6 +4,30 @@
 #include "table.h"
 #include "sdmessage.pb-c.h"
 #include "distributed_database.h"
+#include "compact_protocol.h"
+#include "slowlog.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Escrita (PUT ou DEL) de um cliente à espera do resto da cadeia, para quem serve vários
+ * clientes numa só thread e não pode bloquear nela (ver ddb_table_mutate()): callback e arg são
+ * definidos por quem executa o pedido, o resto pela sua execução. Quando a callback for chamada,
+ * a resposta é escrita por invoke_complete().
+ */
+struct invoke_pending_t {
+    replication_callback_t callback;    // chamada com o estado da escrita quando a cadeia a confirmar
+    void* arg;
+    bool pending;                       // a resposta espera pela callback
+    MessageT__Opcode opcode;            // MESSAGE_T__OPCODE__OP_PUT ou MESSAGE_T__OPCODE__OP_DEL
+    char* key;
+    uint8_t frame;                      // opcode do frame compacto do pedido, ou 0 (frame protobuf)
+    uint32_t request_id;                // do frame compacto
+    uint64_t start_ns;                  // início do pedido, se amostrado
+    uint64_t forwarded_ns;              // envio para a cadeia, se amostrado ou na slow log
+    bool sampled;                       // o tempo de replicação é amostrado
+    struct slowlog_request_t slowlog;
+};
 
 /* Inicia o skeleton da tabela.
  * O main() do servidor deve chamar esta função antes de poder usar a
@@ -25,4 +49,29 @@ int table_skel_destroy(struct table_t *table);
 */
 int invoke(MessageT *msg, struct TableServerDistributedDatabase* ddb);
 
+/* Como invoke(), mas um PUT ou DEL que tenha de esperar pelo resto da cadeia não espera:
+ * pending->pending fica a true e msg sem resposta, a escrever por invoke_complete().
+ * Retorna 0 (OK) ou -1 em caso de erro.
+*/
+int invoke_async(MessageT *msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending);
+
+/* Executa a operação do frame compacto (header e payload) e escreve o frame
+ * de resposta em response, que deve ter pelo menos COMPACT_MAX_FRAME_SIZE bytes.
+ * Retorna o tamanho do frame de resposta ou -1 em caso de erro.
+*/
+ssize_t compact_invoke(struct compact_header_t* request, uint8_t* payload, struct TableServerDistributedDatabase* ddb, uint8_t* response, size_t capacity);
+
+/* Como compact_invoke(), com pending como em invoke_async().
+ * Retorna o tamanho do frame de resposta, 0 se a resposta ficar à espera, ou -1 em caso de erro.
+*/
+ssize_t compact_invoke_async(struct compact_header_t* request, uint8_t* payload, struct TableServerDistributedDatabase* ddb,
+    uint8_t* response, size_t capacity, struct invoke_pending_t* pending);
+
+/* Escreve em response, no protocolo do pedido, a resposta da escrita pendente em pending, cuja
+ * callback foi chamada com status, terminando o pedido. response deve ter pelo menos
+ * COMPACT_MAX_FRAME_SIZE bytes.
+ * Retorna o tamanho do frame de resposta ou -1 em caso de erro.
+*/
+ssize_t invoke_complete(struct invoke_pending_t* pending, int status, struct TableServerDistributedDatabase* ddb, uint8_t* response, size_t capacity);
+
 #endif
@@ -0,0 +1,86 @@
+#ifndef _URING_PRIVATE_H
+#define _URING_PRIVATE_H
+
+#include "uring.h"
+#include "server_connection.h"
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Submission and completion queues shared with the kernel
+struct uring_t {
+    int ring_fd;
+    void* ring_ptr;             // single mapping holding both queues
+    size_t ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned sq_entries;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sqe_tail;          // sqes handed out, published to the kernel on submit
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+};
+
+// Receive buffers provided to the kernel, picked by multishot receives
+struct uring_buffer_ring {
+    struct io_uring_buf_ring* ring;
+    size_t ring_size;
+    uint8_t* buffers;
+    unsigned short tail;
+};
+
+// State of a connection slot
+struct UringConnection {
+    struct ServerConnection* conn;  // NULL if the slot is free
+    bool recv_armed;                // a multishot receive is pending
+    bool write_inflight;            // a write of the transmit buffer is pending
+    bool cancel_requested;          // the receive is being cancelled to hand the connection over
+};
+
+struct UringServer {
+    struct uring_t ring;
+    struct uring_buffer_ring rx;
+    uint8_t* tx_slots;              // registered buffer, URING_TX_SLOT_SIZE bytes per connection
+    size_t tx_slots_size;
+    bool tx_registered;             // tx_slots is registered with the kernel (fixed writes)
+    struct UringConnection* connections;
+    int max_connections;
+    int listening_socket;
+    struct server_completions_t completions;    // writes acknowledged by the chain, polled by a multishot poll
+    struct TableServerDistributedDatabase* ddb;
+};
+
+// Operation encoded in the low bits of the user_data of each submission
+enum UringOp {
+    URING_OP_ACCEPT = 1,
+    URING_OP_RECV,
+    URING_OP_WRITE,
+    URING_OP_PROBE,
+    URING_OP_CANCEL,
+    URING_OP_COMPLETIONS
+};
+
+#define URING_OP_BITS 8
+#define URING_BUFFER_GROUP 0
+
+// Maps the queues of a new io_uring instance. Returns 0 (OK) or -1 on error.
+int uring_init(struct uring_t* ring, unsigned entries);
+
+// Unmaps the queues and closes the io_uring instance.
+void uring_destroy(struct uring_t* ring);
+
+// Returns a zeroed submission entry, or NULL if the submission queue is full.
+struct io_uring_sqe* uring_get_sqe(struct uring_t* ring);
+
+// Submits pending entries and waits for at least wait_nr completions.
+// Returns the number of submitted entries or -1 on error.
+int uring_submit(struct uring_t* ring, unsigned wait_nr);
+
+#endif
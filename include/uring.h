@@ -0,0 +1,34 @@
+#ifndef _URING_H
+#define _URING_H /* io_uring backend module */
+
+#include "distributed_database.h"
+
+/**
+ * @brief Serves every client from a single thread using io_uring. Connections are
+ * accepted with a multishot accept, requests are received with multishot receives
+ * into a ring of kernel-provided buffers and responses are written from a registered
+ * buffer, so that one io_uring_enter() call submits and reaps the I/O of many clients.
+ * The function does not return unless an error occurs.
+ *
+ * @param listening_socket The listening socket.
+ * @param ddb The distributed database.
+ * @return URING_UNSUPPORTED if the running kernel lacks the required io_uring
+ * features (nothing was served and the caller may use another backend), -1 on error.
+ */
+int uring_main_loop(int listening_socket, struct TableServerDistributedDatabase* ddb);
+
+#define URING_UNSUPPORTED -2
+
+#define URING_QUEUE_DEPTH 256
+#define URING_RX_BUFFERS 256                // must be a power of 2
+#define URING_RX_BUFFER_SIZE 16384
+#define URING_TX_SLOT_SIZE (1 << 17)        // room for at least one maximum-sized response frame
+#define URING_DEFAULT_MAX_CONNECTIONS 128
+
+// ====================================================================================================
+//                                            MESSAGES
+// ====================================================================================================
+
+#define URING_TOO_MANY_CONNECTIONS "[ \033[1;31mError\033[0m ] - Too many connections for the io_uring backend, client rejected\n"
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef _MAIN_PRIVATE_H
 #define _MAIN_PRIVATE_H
 #include <unistd.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 enum CommandType {
     PUT,
@@ -10,6 +13,8 @@ enum CommandType {
     GETKEYS,
     GETTABLE,
     STATS,
+    SLOWLOG,
+    HOTKEYS,
     QUIT,
     INVALID
 };
@@ -75,6 +80,130 @@ Indica na excecao o "snippet_id" associado ao erro.
 */
 int assert_error(int condition, char* snippet_id, char* error_msg);
 
+// ====================================================================================================
+//                                          MEMORY ACCOUNTING
+// ====================================================================================================
+/* Memory is counted by the subsystem it goes to, in counters kept by every thread (no locks, a
+ * single writer each) and added up by memory_read(); the counters of a thread that exits are
+ * kept. Sizes are those malloc reserved (malloc_usable_size()), so that memory allocated
+ * elsewhere (strdup, protobuf-c) can be handed to a tag with memory_account(), and out of it.
+ * Only the boundaries of the subsystems count: create_dynamic_memory() and
+ * destroy_dynamic_memory() do not, staying as cheap as calloc() and free().
+ */
+enum MemoryTag {
+    MEMORY_OTHER,                       // anything else handed to memory_account()
+    MEMORY_KEYS,                        // keys of the entries
+    MEMORY_VALUES,                      // values of the entries
+    MEMORY_NODES,                       // entries and list nodes
+    MEMORY_MESSAGES,                    // protobuf and frame buffers, request arenas
+    MEMORY_CONNECTIONS,                 // connection state and its buffers
+    MEMORY_TAGS
+};
+
+// Memory of a tag, since the start
+struct memory_counters_t {
+    long long allocations;
+    long long frees;
+    long long allocated_bytes;
+    long long freed_bytes;
+};
+
+/**
+ * Allocate zeroed memory for a subsystem.
+ *
+ * @param tag - The subsystem.
+ * @param size - The number of bytes.
+ * @return The memory, or NULL on failure.
+ */
+void* create_tagged_memory(enum MemoryTag tag, int size);
+
+/**
+ * Free memory of a subsystem, if not NULL.
+ *
+ * @param tag - The subsystem it was allocated for (or handed to).
+ * @param ptr - The memory.
+ */
+void destroy_tagged_memory(enum MemoryTag tag, void* ptr);
+
+/**
+ * Copy size bytes from from into new memory of a subsystem.
+ *
+ * @param tag - The subsystem.
+ * @param from - The memory to copy.
+ * @param size - The number of bytes.
+ * @param snippet_id - The caller, for errors.
+ * @return The copy, or NULL on failure.
+ */
+void* duplicate_tagged_memory(enum MemoryTag tag, void* from, int size, char* snippet_id);
+
+/**
+ * Hand memory allocated elsewhere to a subsystem, or take it out of one without freeing it.
+ *
+ * @param tag - The subsystem.
+ * @param ptr - The memory (from malloc), or NULL.
+ * @param allocated - true to hand it to the subsystem, false to take it out.
+ */
+void memory_account(enum MemoryTag tag, void* ptr, bool allocated);
+
+/**
+ * Add the memory counters of every thread up.
+ *
+ * @param counters - MEMORY_TAGS counters, one per tag, filled in.
+ */
+void memory_read(struct memory_counters_t* counters);
+
+/**
+ * Get the name of a tag.
+ *
+ * @param tag - The tag.
+ * @return The name ("unknown" if not a tag).
+ */
+const char* memory_tag_name(enum MemoryTag tag);
+
+// ====================================================================================================
+//                                          CONFIGURATION
+// ====================================================================================================
+
+/**
+ * Read an integer setting from the environment.
+ *
+ * @param name - The name of the environment variable.
+ * @param default_value - The value to use when the variable is unset or invalid.
+ * @return The parsed value or default_value.
+ */
+int get_env_int(char* name, int default_value);
+
+/**
+ * Read a string setting from the environment.
+ *
+ * @param name - The name of the environment variable.
+ * @param default_value - The value to use when the variable is unset or empty.
+ * @return The value of the variable (not a copy) or default_value.
+ */
+char* get_env_string(char* name, char* default_value);
+
+// ====================================================================================================
+//                                          HASHING
+// ====================================================================================================
+
+/**
+ * Mix a 64-bit value with the splitmix64 finalizer, so that close inputs spread
+ * over every bit of the result.
+ *
+ * @param x - The value.
+ * @return The mixed value.
+ */
+uint64_t hash_mix64(uint64_t x);
+
+/**
+ * Hash a string with FNV-1a, mixed by hash_mix64 so that both halves spread.
+ *
+ * @param key - The string.
+ * @param length - Receives the length of the string, unless NULL.
+ * @return The hash.
+ */
+uint64_t hash_string(const char* key, size_t* length);
+
 // ====================================================================================================
 //                                          NETWORK
 // ====================================================================================================
@@ -96,6 +225,23 @@ int get_client(int listening_fd);
  */
 int close_and_return_failure(int fd);
 
+/**
+ * Put the specified file descriptor in non-blocking mode.
+ *
+ * @param fd - The file descriptor.
+ * @return 0 on success, -1 on failure.
+ */
+int set_non_blocking(int fd);
+
+/**
+ * Disable Nagle's algorithm on the specified TCP socket, so that small frames
+ * are not held back waiting for the acknowledgement of previous ones.
+ *
+ * @param fd - The TCP socket.
+ * @return 0 on success, -1 on failure.
+ */
+int set_no_delay(int fd);
+
 // ====================================================================================================
 //                                          ERROR HANDLING
 // ====================================================================================================
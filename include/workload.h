@@ -0,0 +1,62 @@
+#ifndef _WORKLOAD_H
+#define _WORKLOAD_H /* Workload generation module (benchmarks) */
+
+#include <stdint.h>
+
+/* Random numbers and key choices shared by the benchmarks: a xorshift64* generator, and a
+ * zipfian distribution (Gray et al., "Quickly generating billion-record synthetic databases",
+ * as YCSB draws it) whose ranks are scrambled so that the hottest keys are not neighbours.
+ */
+
+// Zipfian distribution over [0, n)
+struct zipfian_t {
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+};
+
+/**
+ * @brief Draws the next number of a xorshift64* generator.
+ *
+ * @param state The state of the generator (never 0).
+ * @return The number.
+ */
+uint64_t random_next(uint64_t* state);
+
+/**
+ * @brief Draws a uniform number in [0, 1).
+ *
+ * @param state The state of the generator (never 0).
+ * @return The number.
+ */
+double random_uniform(uint64_t* state);
+
+/**
+ * @brief Hashes (FNV-1a) a rank, spreading neighbouring ranks over the key space.
+ *
+ * @param rank The rank.
+ * @return The hash.
+ */
+uint64_t workload_scramble(uint64_t rank);
+
+/**
+ * @brief Prepares a zipfian distribution over [0, n), in O(n).
+ *
+ * @param zipfian The distribution.
+ * @param n The number of items.
+ * @param theta The zipfian constant, in (0, 1).
+ */
+void zipfian_init(struct zipfian_t* zipfian, uint64_t n, double theta);
+
+/**
+ * @brief Draws the rank of an item, 0 being the most popular one.
+ *
+ * @param zipfian The distribution.
+ * @param u A uniform number in [0, 1).
+ * @return The rank, in [0, n).
+ */
+uint64_t zipfian_next(struct zipfian_t* zipfian, double u);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef _ZEROCOPY_H
+#define _ZEROCOPY_H /* Zero-copy send module */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define ZEROCOPY_DEFAULT_THRESHOLD 16384
+#define ZEROCOPY_BUFFERS 4
+#define ZEROCOPY_WAIT_TIMEOUT_MS 1000
+
+/* Sends of at least threshold bytes on a TCP socket go out with MSG_ZEROCOPY: the kernel
+ * pins the pages instead of copying them, and reports on the error queue once they are no
+ * longer needed, which only happens after the peer acknowledges them. Zero-copy sends are
+ * therefore made from one of a few tx buffers of the connection (see zerocopy_buffer()),
+ * left untouched until their report arrives; the reports are read, without blocking, before
+ * the next buffer is handed out, and when every buffer is still in flight the frame is built
+ * in the caller's own buffer and copied. The kernel also reports when it had to copy anyway
+ * (e.g. over loopback), in which case zero-copy is turned off for the connection.
+ */
+struct zerocopy_slot_t {
+    uint8_t* buffer;        // tx buffer
+    size_t capacity;
+    void* block;            // heap block sent along with the buffer, freed once reported
+    uint32_t first;         // ids of the zero-copy sends made from the buffer: first..end-1
+    uint32_t end;
+    uint32_t pending;       // those not reported yet (0 when the buffer is free)
+};
+
+struct zerocopy_t {
+    int fd;
+    bool enabled;           // SO_ZEROCOPY was accepted and pays off
+    size_t threshold;       // minimum size of a zero-copy send
+    uint32_t next_id;       // id the kernel gives the next zero-copy send
+    int in_flight;          // buffers waiting for their reports
+    int reserved;           // buffer handed out for the next send, -1 if none
+    struct zerocopy_slot_t slots[ZEROCOPY_BUFFERS];
+};
+
+/**
+ * @brief Enables zero-copy sends on the socket, if it supports them and the threshold
+ * (NODEDB_ZEROCOPY_THRESHOLD bytes, 0 to disable) is set.
+ *
+ * @param zc The state to initialize.
+ * @param fd The socket.
+ */
+void zerocopy_init(struct zerocopy_t* zc, int fd);
+
+/**
+ * @brief Frees the tx buffers, after waiting for the reports of those still in flight for as
+ * long as they keep arriving within ZEROCOPY_WAIT_TIMEOUT_MS.
+ *
+ * @param zc The zero-copy state.
+ */
+void zerocopy_destroy(struct zerocopy_t* zc);
+
+/**
+ * @brief Hands out a tx buffer of at least size bytes for the next send on the socket,
+ * after reading the reports queued so far.
+ *
+ * @param zc The zero-copy state (may be NULL).
+ * @param size The size needed.
+ * @return The buffer, or NULL if zero-copy is off or every buffer is in flight, in which
+ * case the frame is to be built elsewhere and is copied.
+ */
+uint8_t* zerocopy_buffer(struct zerocopy_t* zc, size_t size);
+
+/**
+ * @brief Hands over a heap block (freed with free()) sent along with the buffer of the last
+ * zerocopy_buffer(), released once the kernel no longer needs it.
+ *
+ * @param zc The zero-copy state.
+ * @param block The block.
+ * @return 0 (OK) or -1 if no buffer was handed out, the block then staying the caller's.
+ */
+int zerocopy_attach(struct zerocopy_t* zc, void* block);
+
+/**
+ * @brief Sends every byte described by iov with as few system calls as possible. The send
+ * goes out with zero-copy only if it is large enough and a buffer was handed out by
+ * zerocopy_buffer(), in which case every byte must lie in that buffer or in the attached
+ * block. Either way, the buffer is released by the send.
+ *
+ * @param fd The socket.
+ * @param iov The buffers (updated while partially written).
+ * @param iovcnt The number of buffers.
+ * @param zc The zero-copy state of the socket, or NULL to always copy.
+ * @return The number of bytes sent or -1 on error.
+ */
+ssize_t zerocopy_send_iov(int fd, struct iovec* iov, int iovcnt, struct zerocopy_t* zc);
+
+#endif
@@ -2,14 +2,23 @@
 #define _ZK_CLIENT_H
 
 #include "table_client.h"
+#include "zk_utils.h"
 
 #include <zookeeper/zookeeper.h>
 
+// Represents the nodes of a chain known to a table client
+struct TableClientChainNodes {
+    char path[64];                          // Path of the chain node
+    char* head_node_path;                   // Path of the head node
+    char* tail_node_path;                   // Path of the tail node
+    char** chain_node_paths;                // Paths of the servers in read_tables of the chain
+};
+
 // Represents the replication data for a table client
 struct TableClientReplicationData {
     zhandle_t* zh;                          // ZooKeeper handle
-    char* head_node_path;                   // Path of the head node
-    char* tail_node_path;                   // Path of the tail node
+    struct TableClientChainNodes chains[TC_MAX_CHAINS]; // Nodes of client->chains, by index
+    int apportioned_reads;                  // Flag indicating that reads are spread over the chain
     struct TableClientData* client;         // client data
     int valid;                              // Flag indicating validity
 };
@@ -24,23 +33,44 @@ struct TableClientReplicationData {
 void zk_client_init(struct TableClientReplicationData* replicator, struct TableClientData* client, struct TableClientOptions* options);
 
 /**
- * @brief Handles the change of the head node in replication.
+ * @brief Handles the change of the head node of a chain in replication.
  * 
  * @param replicator The replication data for the table client.
+ * @param chain The index of the chain in client->chains.
  * @param head The path of the new head node.
  */
-void handle_head_change(struct TableClientReplicationData* replicator, char* head);
+void handle_head_change(struct TableClientReplicationData* replicator, int chain, char* head);
 
 /**
- * @brief Handles the change of the tail node in replication.
+ * @brief Handles the change of the tail node of a chain in replication.
  * 
  * @param replicator The replication data for the table client.
+ * @param chain The index of the chain in client->chains.
  * @param tail The path of the new tail node.
  */
-void handle_tail_change(struct TableClientReplicationData* replicator, char* tail);
+void handle_tail_change(struct TableClientReplicationData* replicator, int chain, char* tail);
+
+/**
+ * @brief Handles the change of the servers of a chain, keeping a connection to each one
+ * for reads (unless NODEDB_READS is tail).
+ * 
+ * @param replicator The replication data for the table client.
+ * @param chain The index of the chain in client->chains.
+ * @param children_list The children of the chain node.
+ */
+void handle_chain_change(struct TableClientReplicationData* replicator, int chain, zoo_string* children_list);
+
+/**
+ * @brief Handles the change of the chains, watching the servers of the new ones.
+ * 
+ * @param replicator The replication data for the table client.
+ * @param children_list The children of the chains node.
+ */
+void handle_chains_change(struct TableClientReplicationData* replicator, zoo_string* children_list);
 
 /**
- * @brief Watches the children of the ZooKeeper node and triggers updates on changes.
+ * @brief Watches the children of the ZooKeeper node (the chains, or the servers of a chain) and
+ * triggers updates on changes.
  * 
  * @param wzh The handle to the ZooKeeper connection.
  * @param type The type of event.
@@ -50,11 +80,25 @@ void handle_tail_change(struct TableClientReplicationData* replicator, char* tai
  */
 void client_child_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx);
 
+/**
+ * @brief Watches the chains of the ring, which keys are routed by.
+ * 
+ * @param wzh The handle to the ZooKeeper connection.
+ * @param type The type of event.
+ * @param state The state of the connection.
+ * @param zpath The path of the ZooKeeper node.
+ * @param watcher_ctx The context for the ring watcher.
+ */
+void client_ring_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx);
+
 // ====================================================================================================
 //                                            MESSAGES
 // ====================================================================================================
 
 #define ZK_CLIENT_HEAD_UPDATE "[ \033[1;34mFault Tolerance\033[0m ] - Write server changed: (\033[1;36m%s\033[0m) -> (\033[1;36m%s\033[0m)\n"
+#define ZK_CLIENT_CHAIN_UPDATE "[ \033[1;34mFault Tolerance\033[0m ] - Reads spread over %d server(s)\n"
 #define ZK_CLIENT_TAIL_UPDATE "[ \033[1;34mFault Tolerance\033[0m ] - Read server changed: (\033[1;36m%s\033[0m) -> (\033[1;36m%s\033[0m)\n"
+#define ZK_CLIENT_NEW_CHAIN "[ \033[1;34mSharding\033[0m ] - Chain %d found\n"
+#define ZK_CLIENT_RING_UPDATE "[ \033[1;34mSharding\033[0m ] - Keys spread over %d chain(s)\n"
 
 #endif
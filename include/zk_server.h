@@ -4,16 +4,28 @@
 #include "table_server.h"
 #include "database.h"
 #include "distributed_database.h"
+#include "zk_utils.h"
+#include "anti_entropy.h"
 
 #include <zookeeper/zookeeper.h>
+#include <stdbool.h>
 
 // Represents the replication data for a table server
 struct TableServerReplicationData {
     zhandle_t* zh;                          // ZooKeeper handle
     char* server_node_path;                 // Path of the server node
     char* next_server_node_path;            // Path of the next server node
+    char* tail_node_path;                   // Path of the tail node, answering reads of dirty keys
     struct TableServerDistributedDatabase* ddb; // datatabse
     int valid;                              // Flag indicating validity
+    char* zk_connection_str;                // ZooKeeper to reconnect to once the session expires
+    int listening_port;                     // Port registered for this server
+    bool rejoining;                         // The session expired and this server is joining the chain again
+    int chain;                              // Chain of this server (NODEDB_CHAIN)
+    char chain_path[64];                    // Path of that chain
+    bool purging;                           // The keys moved to other chains are being deleted
+    bool fanout;                            // The head sends mutations to every server (NODEDB_REPLICATION_MODE)
+    struct anti_entropy_t anti_entropy;     // Comparison of the table with the one of the predecessor
 };
 
 /**
@@ -24,6 +36,23 @@ struct TableServerReplicationData {
  */
 void handle_next_server_change(struct TableServerReplicationData* replicator, char* next_node);
 
+/**
+ * @brief Handles the change of the servers of the chain in fan-out mode: the head sends the
+ * mutations to all the others at once.
+ * 
+ * @param replicator The replication data for the table server.
+ * @param children_list The children of the chain node.
+ */
+void handle_backups_change(struct TableServerReplicationData* replicator, zoo_string* children_list);
+
+/**
+ * @brief Handles the change of the tail of the chain, connecting to it unless it is this server.
+ * 
+ * @param replicator The replication data for the table server.
+ * @param tail_node The path of the tail node.
+ */
+void handle_tail_server_change(struct TableServerReplicationData* replicator, char* tail_node);
+
 /**
  * @brief Watches the children of the ZooKeeper node and triggers updates on changes.
  * 
@@ -36,7 +65,23 @@ void handle_next_server_change(struct TableServerReplicationData* replicator, ch
 void zk_server_child_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx);
 
 /**
- * @brief Initializes the ZooKeeper server with replication settings.
+ * @brief Watches the chains of the ring (see hash_ring.h): mutations of the keys of other chains
+ * are refused from now on, and the head of the chain deletes the keys that moved away.
+ * 
+ * @param wzh The handle to the ZooKeeper connection.
+ * @param type The type of event.
+ * @param state The state of the connection.
+ * @param zpath The path of the ZooKeeper node.
+ * @param watcher_ctx The context for the ring watcher.
+ */
+void zk_server_ring_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx);
+
+/**
+ * @brief Initializes the ZooKeeper server with replication settings, joining the chain. Should
+ * the session expire, the server joins the chain again under a new session, getting only the
+ * mutations it missed if its new previous server still holds them (see backlog.h). The first
+ * server of a chain out of the ring takes over its keys from the other chains, then adds the
+ * chain to the ring.
  * 
  * @param replicator The replication data for the table server.
  * @param ddb The distributed database associated with the table server.
@@ -56,10 +101,18 @@ void zk_server_destroy(struct TableServerReplicationData* replicator);
 // ====================================================================================================
 
 #define ZK_SERVER_REPLICA_UPDATE "[ \033[1;34mServer Replication\033[0m ] - Next server change: (\033[1;36m%s\033[0m) -> (\033[1;36m%s\033[0m)\n"
+#define ZK_SERVER_BACKUPS_UPDATE "[ \033[1;34mServer Replication\033[0m ] - Sending mutations to %d backup(s) at once\n"
+#define ZK_SERVER_TAIL_UPDATE "[ \033[1;34mServer Replication\033[0m ] - Tail change: (\033[1;36m%s\033[0m) -> (\033[1;36m%s\033[0m)\n"
 #define ZK_SERVER_SET_REPLICA "[ \033[1;34mServer Sync\033[0m ] Setting up %s as next server of %s\n"
 #define ZK_SERVER_CHECKING_SYNC "[ \033[1;34mServer Sync\033[0m ] - Checking if there is an available server for synchronization...\n"
 #define ZK_SERVER_SET_SYNC "[ \033[1;34mServer Sync\033[0m ] - Setting up synchronization with server \033[1;36m%s\033[0m\n"
-#define ZK_SERVER_SESSION_OK_FOR_SYNC "[ \033[1;34mServer Sync\033[0m ] - Established temporary remote session to \033[1;36m%s\033[0m. Starting synchronization...\n"
+#define ZK_SERVER_RESYNC "[ \033[1;34mServer Sync\033[0m ] - Server \033[1;36m%s\033[0m is not the previous server anymore, synchronizing with \033[1;36m%s\033[0m\n"
+#define ZK_SERVER_REJOINING "[ \033[1;34mServer Sync\033[0m ] - Session expired, joining the chain again (mutations applied up to seq %lu)\n"
+#define ZK_SERVER_TAKING_OVER "[ \033[1;34mServer Sync\033[0m ] - Taking over the keys of chain %d from its head \033[1;36m%s\033[0m\n"
+#define ZK_SERVER_NO_HEAD "[ \033[1;34mServer Sync\033[0m ] - Chain %d has no server, its keys moving to chain %d are lost\n"
+#define ZK_SERVER_JOINED_RING "[ \033[1;34mServer Sync\033[0m ] - Chain %d joined the ring (%d chains)\n"
+#define ZK_SERVER_RING_UPDATE "[ \033[1;34mServer Replication\033[0m ] - Ring change: %d chains\n"
+#define ZK_SERVER_PURGED "[ \033[1;34mServer Replication\033[0m ] - Deleted %d keys moved to other chains\n"
 #define ZK_SERVER_COMPLETED_SYNC "[ \033[1;34mServer Sync\033[0m ] - Completed synchronization with other servers (if any)\n"
 
 #endif
\ No newline at end of file
@@ -1,11 +1,15 @@
 #ifndef _ZK_UTILS_H
 #define _ZK_UTILS_H /* Module for replication support */
 
+#include "hash_ring.h"
+
 #include <zookeeper/zookeeper.h>
 #include <pthread.h>
+#include <stddef.h>
 
-#define CHAIN_PATH "/chain"
-#define NODE_PATH "/chain/node"
+#define CHAINS_PATH "/chains"           // /chains/N: the servers of chain N, in chain order
+#define RING_PATH "/ring"               // /ring/N: chain N holds its keys (see hash_ring.h)
+#define NODE_NAME "node"
 
 // Represents the context for a connection
 struct ConnectionContext {
@@ -34,6 +38,43 @@ zhandle_t* zk_connect(char* zk_connection_str);
  */
 int ensure_chain_exists(zhandle_t* zh, const char* path);
 
+/**
+ * @brief Builds the path of a chain (CHAINS_PATH/chain).
+ * 
+ * @param chain The chain.
+ * @param path The buffer to store the path.
+ * @param size The size of the buffer.
+ */
+void zk_chain_path(int chain, char* path, size_t size);
+
+/**
+ * @brief Reads the chains holding keys (the children of RING_PATH) and sets a watch on them.
+ * 
+ * @param zh The handle to the ZooKeeper connection.
+ * @param watcher The watcher called once the chains change, or NULL.
+ * @param watcher_ctx The context for the watcher.
+ * @return The ring of the chains (empty if there is none yet), or NULL on failure.
+ */
+struct hash_ring_t* zk_ring_get(zhandle_t* zh, watcher_fn watcher, void* watcher_ctx);
+
+/**
+ * @brief Adds a chain to the ring, once it holds its keys.
+ * 
+ * @param zh The handle to the ZooKeeper connection.
+ * @param chain The chain.
+ * @return 0 (OK) or -1 on failure.
+ */
+int zk_ring_join(zhandle_t* zh, int chain);
+
+/**
+ * @brief Retrieves the address (address:port) a server registered under the provided ZooKeeper path.
+ * 
+ * @param zh The handle to the ZooKeeper connection.
+ * @param path The path of the server in ZooKeeper.
+ * @return The address, to be freed by the caller, or NULL on failure.
+ */
+char* zk_node_address(zhandle_t* zh, const char* path);
+
 /**
  * @brief Establishes a connection to a remote table based on the provided ZooKeeper path.
  * 
@@ -47,11 +88,12 @@ struct rtable_t* zk_table_connect(zhandle_t* zh, const char* path);
  * @brief Registers the server in ZooKeeper under the specified path.
  * 
  * @param zh The handle to the ZooKeeper connection.
+ * @param chain_path The path of the chain of the server.
  * @param host_str The host string.
  * @param host_port The host port.
  * @return The path of the registered server in ZooKeeper.
  */
-char* zk_register_server(zhandle_t* zh, char* host_str, int host_port);
+char* zk_register_server(zhandle_t* zh, const char* chain_path, char* host_str, int host_port);
 
 /**
  * @brief Finds the previous node in the children list relative to the specified child.
@@ -43,4 +43,42 @@ char* get_ip_address() {
     // free memory allocated by getifaddrs
     freeifaddrs(ifaddr);
     return ip_address;
-}
\ No newline at end of file
+}
+
+bool is_local_address(char* address) {
+    if (address == NULL)
+        return false;
+    if (strcmp(address, "localhost") == 0 || strncmp(address, "127.", 4) == 0)
+        return true;
+
+    struct ifaddrs *ifaddr, *ifa;
+    if (assert_error(
+        getifaddrs(&ifaddr) == -1,
+        "is_local_address",
+        "Failed to retrieve information about network interfaces\n"
+    )) return false;
+
+    // the address is local if it belongs to one of the interfaces of this machine
+    bool local = false;
+    for (ifa = ifaddr; ifa != NULL && !local; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET)
+            continue;
+
+        char ip[INET_ADDRSTRLEN];
+        struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
+        local = inet_ntop(AF_INET, &sa->sin_addr, ip, sizeof(ip)) != NULL && strcmp(ip, address) == 0;
+    }
+
+    freeifaddrs(ifaddr);
+    return local;
+}
+
+int local_socket_path(int port, char* path, size_t size) {
+    int n = snprintf(path, size, "%s/node-db-%d.sock", get_env_string("NODEDB_SOCKET_DIR", "/tmp"), port);
+    if (assert_error(
+        n < 0 || (size_t)n >= size,
+        "local_socket_path",
+        "Local socket path is too long.\n"
+    )) return -1;
+    return 0;
+}
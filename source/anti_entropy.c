@@ -0,0 +1,325 @@
+#include "anti_entropy.h"
+
+#include "distributed_database.h"
+#include "database.h"
+#include "client_stub.h"
+#include "client_stub-private.h"
+#include "network_client.h"
+#include "entry.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+// sends an OP_DIGEST request, returning the response or NULL on error
+static MessageT* anti_entropy_ask(struct rtable_t* rtable, MessageT__CType c_type, int result, uint32_t* buckets, size_t n_buckets) {
+    MessageT msg = MESSAGE_T__INIT;
+    msg.opcode = MESSAGE_T__OPCODE__OP_DIGEST;
+    msg.c_type = c_type;
+    msg.result = result;
+    msg.digests = buckets;
+    msg.n_digests = n_buckets;
+    MessageT* response = network_send_receive(rtable, &msg);
+    if (response != NULL && response->opcode != MESSAGE_T__OPCODE__OP_DIGEST + 1) {
+        message_t__free_unpacked(response, NULL);
+        return NULL;
+    }
+    return response;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    return strcmp((*(EntryT* const*)a)->key, (*(EntryT* const*)b)->key);
+}
+
+// applies a repair, remembering the key if left dirty. Called with round_mutex held
+static int anti_entropy_apply(struct anti_entropy_t* ae, MessageT__Opcode opcode, char* key, struct data_t* value) {
+    bool dirty = false;
+    int result = ddb_repair(ae->ddb, opcode, key, value, &dirty);
+    if (!dirty)
+        return result;
+
+    size_t key_size = strlen(key) + 1;
+    struct anti_entropy_key_t* repaired = create_dynamic_memory(sizeof(struct anti_entropy_key_t) + key_size);
+    if (repaired == NULL) {
+        // not remembered, so not left dirty either
+        ddb_repair_settle(ae->ddb, key, true);
+        return result;
+    }
+    memcpy(repaired->key, key, key_size);
+    repaired->next = ae->repaired;
+    ae->repaired = repaired;
+    return result;
+}
+
+// clears the keys left dirty by the repairs that the tail now holds (every one if force). Called with round_mutex held
+static void anti_entropy_settle(struct anti_entropy_t* ae, bool force) {
+    struct anti_entropy_key_t** link = &ae->repaired;
+    while (*link != NULL) {
+        struct anti_entropy_key_t* repaired = *link;
+        if (ddb_repair_settle(ae->ddb, repaired->key, force)) {
+            *link = repaired->next;
+            destroy_dynamic_memory(repaired);
+        } else {
+            link = &repaired->next;
+        }
+    }
+}
+
+// tells whether the bucket of key is among those asked for
+static bool anti_entropy_asked(const char* key, void* asked) {
+    return ((bool*)asked)[digest_bucket(key)];
+}
+
+// copies the entries of buckets from the predecessor, deleting the keys it lacks. Returns the
+// number of keys repaired, or -1 on error
+static int anti_entropy_repair(struct anti_entropy_t* ae, struct rtable_t* rtable, uint32_t* buckets, int n_buckets) {
+    MessageT* response = anti_entropy_ask(rtable, MESSAGE_T__C_TYPE__CT_TABLE, 0, buckets, n_buckets);
+    if (response == NULL)
+        return -1;
+
+    bool truncated = response->result != 0;
+    if (truncated && n_buckets > 1) {
+        // too many entries for a frame: ask for half the buckets at a time
+        message_t__free_unpacked(response, NULL);
+        int half = n_buckets / 2;
+        int first = anti_entropy_repair(ae, rtable, buckets, half);
+        int second = first == -1 ? -1 : anti_entropy_repair(ae, rtable, buckets + half, n_buckets - half);
+        return second == -1 ? -1 : first + second;
+    }
+    if (truncated)
+        LOG_WARN(ANTI_ENTROPY_TRUNCATED, (int)buckets[0]);
+
+    struct TableServerDistributedDatabase* ddb = ae->ddb;
+    int repaired = 0;
+    for (size_t i = 0; i < response->n_entries; i++) {
+        EntryT* entry = response->entries[i];
+        struct data_t value = { .datasize = entry->value.len, .data = entry->value.data };
+        struct data_t* local = db_table_get(ddb->db, entry->key);
+        bool same = local != NULL && local->datasize == value.datasize && memcmp(local->data, value.data, value.datasize) == 0;
+        data_destroy(local);
+        if (!same && anti_entropy_apply(ae, MESSAGE_T__OPCODE__OP_PUT, entry->key, &value) == 0)
+            repaired++;
+    }
+
+    // the keys of the buckets missing from the predecessor were deleted there (unless some entries were left out)
+    if (!truncated) {
+        bool asked[DIGEST_BUCKETS] = { false };
+        for (int i = 0; i < n_buckets; i++)
+            asked[buckets[i]] = true;
+        qsort(response->entries, response->n_entries, sizeof(EntryT*), compare_entries);
+
+        int index = 0, scanned;
+        char* after = NULL;
+        char* keys[SNAPSHOT_MAX_ENTRIES];
+        while ((scanned = db_table_scan_keys(ddb->db, &index, after, anti_entropy_asked, asked, keys, SNAPSHOT_MAX_ENTRIES)) > 0) {
+            destroy_dynamic_memory(after);
+            after = strdup(keys[scanned - 1]);
+            for (int i = 0; i < scanned; i++) {
+                EntryT key = { .key = keys[i] };
+                EntryT* key_ptr = &key;
+                if (bsearch(&key_ptr, response->entries, response->n_entries, sizeof(EntryT*), compare_entries) == NULL &&
+                    anti_entropy_apply(ae, MESSAGE_T__OPCODE__OP_DEL, keys[i], NULL) == 0)
+                    repaired++;
+                destroy_dynamic_memory(keys[i]);
+            }
+        }
+        destroy_dynamic_memory(after);
+    }
+    message_t__free_unpacked(response, NULL);
+    return repaired;
+}
+
+// finds the buckets that differ from those of the predecessor. Returns their number, or -1 on error
+static int anti_entropy_compare(struct anti_entropy_t* ae, struct rtable_t* rtable, bool* differs) {
+    struct digest_t* local = create_dynamic_memory(sizeof(struct digest_t));
+    if (assert_error(
+        local == NULL,
+        "anti_entropy_compare",
+        ERROR_MALLOC
+    )) return -1;
+
+    uint32_t groups[DIGEST_GROUPS];
+    MessageT* response = NULL;
+    if (db_table_digest(ae->ddb->db, local->buckets) == -1 ||
+        (response = anti_entropy_ask(rtable, MESSAGE_T__C_TYPE__CT_NONE, 0, NULL, 0)) == NULL ||
+        response->n_digests != DIGEST_GROUPS) {
+        if (response != NULL)
+            message_t__free_unpacked(response, NULL);
+        destroy_dynamic_memory(local);
+        return -1;
+    }
+    digest_groups(local, groups);
+
+    // only the buckets of the groups that differ are compared
+    int n_differ = 0;
+    for (int group = 0; group < DIGEST_GROUPS && n_differ >= 0; group++) {
+        if (groups[group] == response->digests[group])
+            continue;
+        MessageT* buckets = anti_entropy_ask(rtable, MESSAGE_T__C_TYPE__CT_RESULT, group, NULL, 0);
+        if (buckets == NULL || buckets->n_digests != DIGEST_GROUP_SIZE) {
+            n_differ = -1;
+        } else {
+            for (int i = 0; i < DIGEST_GROUP_SIZE; i++) {
+                int bucket = group * DIGEST_GROUP_SIZE + i;
+                differs[bucket] = local->buckets[bucket] != buckets->digests[i];
+                n_differ += differs[bucket];
+            }
+        }
+        if (buckets != NULL)
+            message_t__free_unpacked(buckets, NULL);
+    }
+    message_t__free_unpacked(response, NULL);
+    destroy_dynamic_memory(local);
+    return n_differ;
+}
+
+int anti_entropy_round(struct anti_entropy_t* ae) {
+    if (assert_error(
+        ae == NULL || ae->ddb == NULL,
+        "anti_entropy_round",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pthread_mutex_lock(&ae->round_mutex);
+    anti_entropy_settle(ae, false);
+    pthread_mutex_lock(&ae->mutex);
+    char* source = ae->source != NULL ? strdup(ae->source) : NULL;
+    pthread_mutex_unlock(&ae->mutex);
+    // the address is split by rtable_connect()
+    char address[source != NULL ? strlen(source) + 1 : 1];
+    strcpy(address, source != NULL ? source : "");
+    struct rtable_t* rtable = source != NULL ? rtable_connect(address) : NULL;
+    if (rtable == NULL) {
+        memset(ae->suspects, 0, sizeof(ae->suspects));
+        pthread_mutex_unlock(&ae->round_mutex);
+        destroy_dynamic_memory(source);
+        return source == NULL ? 0 : -1;
+    }
+
+    bool differs[DIGEST_BUCKETS] = { false };
+    int n_differ = anti_entropy_compare(ae, rtable, differs);
+    uint32_t buckets[DIGEST_BUCKETS];
+    int n_buckets = 0;
+    for (int bucket = 0; n_differ > 0 && bucket < DIGEST_BUCKETS; bucket++) {
+        if (differs[bucket] && ae->suspects[bucket])
+            buckets[n_buckets++] = bucket;
+    }
+    if (n_differ >= 0)
+        memcpy(ae->suspects, differs, sizeof(differs));
+
+    int repaired = n_differ < 0 ? -1 : 0;
+    if (n_buckets > 0) {
+        // the mutations replicated meanwhile supersede the copied entries
+        ddb_set_syncing(ae->ddb, true);
+        for (int i = 0; i < n_buckets && repaired >= 0; i += ANTI_ENTROPY_MAX_BUCKETS) {
+            int n = n_buckets - i < ANTI_ENTROPY_MAX_BUCKETS ? n_buckets - i : ANTI_ENTROPY_MAX_BUCKETS;
+            int result = anti_entropy_repair(ae, rtable, buckets + i, n);
+            repaired = result == -1 ? -1 : repaired + result;
+        }
+        ddb_set_syncing(ae->ddb, false);
+        if (repaired >= 0)
+            LOG_INFO(ANTI_ENTROPY_REPAIRED, n_buckets, source, repaired);
+    }
+    rtable_disconnect(rtable);
+    pthread_mutex_unlock(&ae->round_mutex);
+    destroy_dynamic_memory(source);
+    return repaired;
+}
+
+static void* anti_entropy_thread(void* _ae) {
+    struct anti_entropy_t* ae = _ae;
+    pthread_mutex_lock(&ae->mutex);
+    while (!ae->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ae->interval_ms / 1000;
+        deadline.tv_nsec += (long)(ae->interval_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        if (pthread_cond_timedwait(&ae->cond, &ae->mutex, &deadline) != ETIMEDOUT)
+            continue;
+        pthread_mutex_unlock(&ae->mutex);
+        anti_entropy_round(ae);
+        pthread_mutex_lock(&ae->mutex);
+    }
+    pthread_mutex_unlock(&ae->mutex);
+    return NULL;
+}
+
+int anti_entropy_start(struct anti_entropy_t* ae, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        ae == NULL || ddb == NULL,
+        "anti_entropy_start",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    memset(ae, 0, sizeof(struct anti_entropy_t));
+    ae->ddb = ddb;
+    pthread_mutex_init(&ae->mutex, NULL);
+    pthread_mutex_init(&ae->round_mutex, NULL);
+    pthread_cond_init(&ae->cond, NULL);
+    ae->interval_ms = get_env_int("NODEDB_ANTI_ENTROPY_MS", ANTI_ENTROPY_DEFAULT_MS);
+    if (ae->interval_ms <= 0) {
+        ae->interval_ms = 0;
+        return 0;
+    }
+
+    if (assert_error(
+        pthread_create(&ae->thread, NULL, anti_entropy_thread, ae) != 0,
+        "anti_entropy_start",
+        "Failed to create the anti-entropy thread.\n"
+    )) {
+        ae->interval_ms = 0;
+        return -1;
+    }
+    LOG_INFO(ANTI_ENTROPY_ENABLED, ae->interval_ms);
+    return 0;
+}
+
+void anti_entropy_set_source(struct anti_entropy_t* ae, const char* source) {
+    if (ae == NULL || ae->ddb == NULL)
+        return;
+
+    pthread_mutex_lock(&ae->mutex);
+    destroy_dynamic_memory(ae->source);
+    ae->source = source != NULL ? strdup(source) : NULL;
+    pthread_mutex_unlock(&ae->mutex);
+}
+
+void anti_entropy_pause(struct anti_entropy_t* ae) {
+    if (ae != NULL && ae->ddb != NULL)
+        pthread_mutex_lock(&ae->round_mutex);
+}
+
+void anti_entropy_resume(struct anti_entropy_t* ae) {
+    if (ae != NULL && ae->ddb != NULL) {
+        // the buckets found different before were compared with another table
+        memset(ae->suspects, 0, sizeof(ae->suspects));
+        pthread_mutex_unlock(&ae->round_mutex);
+    }
+}
+
+void anti_entropy_stop(struct anti_entropy_t* ae) {
+    if (ae == NULL || ae->ddb == NULL)
+        return;
+
+    if (ae->interval_ms > 0) {
+        pthread_mutex_lock(&ae->mutex);
+        ae->stop = true;
+        pthread_cond_signal(&ae->cond);
+        pthread_mutex_unlock(&ae->mutex);
+        pthread_join(ae->thread, NULL);
+    }
+    anti_entropy_settle(ae, true);
+    destroy_dynamic_memory(ae->source);
+    pthread_mutex_destroy(&ae->mutex);
+    pthread_mutex_destroy(&ae->round_mutex);
+    pthread_cond_destroy(&ae->cond);
+    ae->ddb = NULL;
+}
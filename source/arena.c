@@ -0,0 +1,135 @@
+#include "arena.h"
+
+#include "utils.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+// overflow blocks keep their header in front of the memory handed out
+#define ARENA_OVERFLOW_HEADER_SIZE \
+    ((sizeof(struct arena_overflow_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static void* arena_protobuf_alloc(void* allocator_data, size_t size) {
+    return arena_alloc((struct arena_t*)allocator_data, size);
+}
+
+static void arena_protobuf_free(void* allocator_data, void* pointer) {
+    arena_free((struct arena_t*)allocator_data, pointer);
+}
+
+struct arena_t* arena_create(size_t capacity) {
+    struct arena_t* arena = create_tagged_memory(MEMORY_MESSAGES, sizeof(struct arena_t));
+    if (assert_error(
+        arena == NULL,
+        "arena_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    if (capacity == 0)
+        capacity = ARENA_DEFAULT_CAPACITY;
+    arena->base = create_tagged_memory(MEMORY_MESSAGES, capacity);
+    if (assert_error(
+        arena->base == NULL,
+        "arena_create",
+        ERROR_MALLOC
+    )) {
+        destroy_tagged_memory(MEMORY_MESSAGES, arena);
+        return NULL;
+    }
+
+    arena->capacity = capacity;
+    arena->allocator.alloc = arena_protobuf_alloc;
+    arena->allocator.free = arena_protobuf_free;
+    arena->allocator.allocator_data = arena;
+    return arena;
+}
+
+static void arena_release_overflow(struct arena_t* arena) {
+    struct arena_overflow_t* block = arena->overflow;
+    while (block != NULL) {
+        struct arena_overflow_t* next = block->next;
+        destroy_tagged_memory(MEMORY_MESSAGES, block);
+        block = next;
+    }
+    arena->overflow = NULL;
+    arena->overflow_size = 0;
+}
+
+void arena_destroy(struct arena_t* arena) {
+    if (arena == NULL)
+        return;
+
+    arena_release_overflow(arena);
+    destroy_tagged_memory(MEMORY_MESSAGES, arena->base);
+    destroy_tagged_memory(MEMORY_MESSAGES, arena);
+}
+
+void* arena_alloc(struct arena_t* arena, size_t size) {
+    if (assert_error(
+        arena == NULL,
+        "arena_alloc",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    size_t aligned_size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (arena->capacity - arena->used >= aligned_size) {
+        void* ptr = arena->base + arena->used;
+        arena->used += aligned_size;
+        return ptr;
+    }
+
+    // full: fall back to a block of its own until the next reset
+    struct arena_overflow_t* block = create_tagged_memory(MEMORY_MESSAGES, ARENA_OVERFLOW_HEADER_SIZE + aligned_size);
+    if (assert_error(
+        block == NULL,
+        "arena_alloc",
+        ERROR_MALLOC
+    )) return NULL;
+
+    block->size = aligned_size;
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflow_size += aligned_size;
+    return (uint8_t*)block + ARENA_OVERFLOW_HEADER_SIZE;
+}
+
+static bool arena_owns(struct arena_t* arena, void* ptr) {
+    uint8_t* p = ptr;
+    if (p >= arena->base && p < arena->base + arena->capacity)
+        return true;
+
+    for (struct arena_overflow_t* block = arena->overflow; block != NULL; block = block->next) {
+        if (p == (uint8_t*)block + ARENA_OVERFLOW_HEADER_SIZE)
+            return true;
+    }
+    return false;
+}
+
+void arena_free(struct arena_t* arena, void* ptr) {
+    if (arena == NULL || ptr == NULL)
+        return;
+
+    if (!arena_owns(arena, ptr))
+        free(ptr);
+}
+
+void arena_reset(struct arena_t* arena) {
+    if (arena == NULL)
+        return;
+
+    // size the region after the largest request seen so far
+    if (arena->overflow != NULL) {
+        size_t new_capacity = arena->capacity;
+        while (new_capacity < arena->used + arena->overflow_size)
+            new_capacity *= 2;
+        arena_release_overflow(arena);
+
+        uint8_t* new_base = create_tagged_memory(MEMORY_MESSAGES, new_capacity);
+        if (new_base != NULL) {
+            destroy_tagged_memory(MEMORY_MESSAGES, arena->base);
+            arena->base = new_base;
+            arena->capacity = new_capacity;
+        }
+    }
+    arena->used = 0;
+}
@@ -0,0 +1,244 @@
+#include "backlog.h"
+
+#include "snapshot.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint64_t* backlog_ahead_word(struct backlog_t* backlog, uint64_t seq) {
+    return &backlog->ahead[(seq % BACKLOG_WINDOW) / 64];
+}
+
+static uint64_t backlog_ahead_bit(uint64_t seq) {
+    return (uint64_t)1 << (seq % 64);
+}
+
+// moves the applied seq over the seqs applied ahead of it. Called with the mutex held
+static void backlog_drain(struct backlog_t* backlog) {
+    while (*backlog_ahead_word(backlog, backlog->applied + 1) & backlog_ahead_bit(backlog->applied + 1)) {
+        backlog->applied++;
+        *backlog_ahead_word(backlog, backlog->applied) &= ~backlog_ahead_bit(backlog->applied);
+    }
+}
+
+// forgets the seqs of (from, to] applied ahead. Called with the mutex held
+static void backlog_clear_ahead(struct backlog_t* backlog, uint64_t from, uint64_t to) {
+    if (to - from >= BACKLOG_WINDOW) {
+        memset(backlog->ahead, 0, BACKLOG_WINDOW / 8);
+        return;
+    }
+    for (uint64_t seq = from + 1; seq <= to; seq++)
+        *backlog_ahead_word(backlog, seq) &= ~backlog_ahead_bit(seq);
+}
+
+// counts seq as applied. Called with the mutex held
+static void backlog_mark(struct backlog_t* backlog, uint64_t seq) {
+    if (seq > backlog->last)
+        backlog->last = seq;
+    if (seq <= backlog->applied)
+        return;
+    // too far ahead to be tracked: the applied seq stops there (rejoining then copies the table)
+    if (seq - backlog->applied > BACKLOG_WINDOW)
+        return;
+
+    *backlog_ahead_word(backlog, seq) |= backlog_ahead_bit(seq);
+    backlog_drain(backlog);
+}
+
+int backlog_init(struct backlog_t* backlog) {
+    if (assert_error(
+        backlog == NULL,
+        "backlog_init",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    int capacity = get_env_int("NODEDB_BACKLOG_SIZE", BACKLOG_DEFAULT_SIZE);
+    backlog->capacity = capacity > 0 ? (uint64_t)capacity : BACKLOG_DEFAULT_SIZE;
+    int mb = get_env_int("NODEDB_BACKLOG_MB", BACKLOG_DEFAULT_MB);
+    backlog->max_bytes = (size_t)(mb > 0 ? mb : BACKLOG_DEFAULT_MB) << 20;
+    backlog->bytes = 0;
+    backlog->oldest = 1;
+    backlog->ring = create_dynamic_memory(backlog->capacity * sizeof(struct backlog_mutation_t*));
+    backlog->ahead = create_dynamic_memory(BACKLOG_WINDOW / 8);
+    if (assert_error(
+        backlog->ring == NULL || backlog->ahead == NULL,
+        "backlog_init",
+        ERROR_MALLOC
+    )) {
+        destroy_dynamic_memory(backlog->ring);
+        destroy_dynamic_memory(backlog->ahead);
+        backlog->ring = NULL;
+        backlog->ahead = NULL;
+        return -1;
+    }
+    backlog->applied = 0;
+    backlog->last = 0;
+    pthread_mutex_init(&backlog->mutex, NULL);
+    return 0;
+}
+
+void backlog_destroy(struct backlog_t* backlog) {
+    if (backlog == NULL || backlog->ring == NULL)
+        return;
+
+    for (uint64_t i = 0; i < backlog->capacity; i++)
+        destroy_dynamic_memory(backlog->ring[i]);
+    destroy_dynamic_memory(backlog->ring);
+    destroy_dynamic_memory(backlog->ahead);
+    backlog->ring = NULL;
+    backlog->ahead = NULL;
+    pthread_mutex_destroy(&backlog->mutex);
+}
+
+struct backlog_mutation_t* backlog_mutation_create(MessageT__Opcode opcode, char* key, struct data_t* value) {
+    if (key == NULL)
+        return NULL;
+
+    size_t key_size = strlen(key) + 1;
+    size_t value_size = opcode == MESSAGE_T__OPCODE__OP_PUT && value != NULL ? (size_t)value->datasize : 0;
+    size_t size = sizeof(struct backlog_mutation_t) + key_size + value_size;
+    struct backlog_mutation_t* mutation = create_dynamic_memory(size);
+    if (mutation == NULL)
+        return NULL;
+
+    mutation->opcode = opcode;
+    mutation->key = (char*)(mutation + 1);
+    memcpy(mutation->key, key, key_size);
+    mutation->value = (uint8_t*)mutation->key + key_size;
+    mutation->value_size = value_size;
+    if (value_size > 0)
+        memcpy(mutation->value, value->data, value_size);
+    mutation->size = size;
+    return mutation;
+}
+
+// takes the mutation of the slot out of the ring, onto the dropped ones. Called with the mutex held
+static void backlog_drop(struct backlog_t* backlog, struct backlog_mutation_t** slot, struct backlog_mutation_t** dropped) {
+    if (*slot == NULL)
+        return;
+    backlog->bytes -= (*slot)->size;
+    (*slot)->next = *dropped;
+    *dropped = *slot;
+    *slot = NULL;
+}
+
+uint64_t backlog_begin(struct backlog_t* backlog, uint64_t seq) {
+    pthread_mutex_lock(&backlog->mutex);
+    // the head numbers the mutations it applies
+    return seq != 0 ? seq : backlog->last + 1;
+}
+
+void backlog_end(struct backlog_t* backlog, uint64_t seq, struct backlog_mutation_t* mutation, bool applied) {
+    struct backlog_mutation_t* dropped = NULL;
+    if (applied) {
+        // a mutation that could not be kept only costs a copy of the table to a rejoining server
+        if (mutation != NULL) {
+            mutation->seq = seq;
+            struct backlog_mutation_t** slot = &backlog->ring[seq % backlog->capacity];
+            backlog_drop(backlog, slot, &dropped);
+            *slot = mutation;
+            backlog->bytes += mutation->size;
+            mutation = NULL;
+
+            // the oldest mutations make room for it
+            if (backlog->oldest + backlog->capacity <= seq)
+                backlog->oldest = seq - backlog->capacity + 1;
+            while (backlog->bytes > backlog->max_bytes && backlog->oldest < seq) {
+                slot = &backlog->ring[backlog->oldest % backlog->capacity];
+                if (*slot != NULL && (*slot)->seq == backlog->oldest)
+                    backlog_drop(backlog, slot, &dropped);
+                backlog->oldest++;
+            }
+        }
+        backlog_mark(backlog, seq);
+    }
+    pthread_mutex_unlock(&backlog->mutex);
+
+    destroy_dynamic_memory(mutation);
+    while (dropped != NULL) {
+        struct backlog_mutation_t* next = dropped->next;
+        destroy_dynamic_memory(dropped);
+        dropped = next;
+    }
+}
+
+uint64_t backlog_applied(struct backlog_t* backlog) {
+    if (backlog == NULL)
+        return 0;
+
+    pthread_mutex_lock(&backlog->mutex);
+    uint64_t applied = backlog->applied;
+    pthread_mutex_unlock(&backlog->mutex);
+    return applied;
+}
+
+void backlog_advance(struct backlog_t* backlog, uint64_t seq) {
+    if (backlog == NULL)
+        return;
+
+    pthread_mutex_lock(&backlog->mutex);
+    if (seq > backlog->applied) {
+        backlog_clear_ahead(backlog, backlog->applied, seq);
+        backlog->applied = seq;
+        if (seq > backlog->last)
+            backlog->last = seq;
+        backlog_drain(backlog);
+    }
+    pthread_mutex_unlock(&backlog->mutex);
+}
+
+void backlog_reset(struct backlog_t* backlog, uint64_t seq) {
+    if (backlog == NULL)
+        return;
+
+    pthread_mutex_lock(&backlog->mutex);
+    if (seq < backlog->applied) {
+        // what was applied here after seq may be missing from the copy
+        backlog_clear_ahead(backlog, seq, backlog->applied);
+        backlog->applied = seq;
+        backlog_drain(backlog);
+    }
+    pthread_mutex_unlock(&backlog->mutex);
+    backlog_advance(backlog, seq);
+}
+
+int backlog_copy_since(struct backlog_t* backlog, uint64_t since, struct snapshot_log_t* log) {
+    if (assert_error(
+        backlog == NULL || log == NULL,
+        "backlog_copy_since",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pthread_mutex_lock(&backlog->mutex);
+    // every mutation up to the applied seq must still be held: those after it come with the log
+    bool covered = since <= backlog->applied && backlog->applied - since <= backlog->capacity;
+    uint64_t count = 0;
+    size_t size = 0;
+    for (uint64_t seq = since + 1; covered && seq <= backlog->last; seq++) {
+        struct backlog_mutation_t* mutation = backlog->ring[seq % backlog->capacity];
+        if (mutation != NULL && mutation->seq == seq) {
+            count++;
+            size += sizeof(struct snapshot_mutation_t) + strlen(mutation->key) + 1 + mutation->value_size;
+        } else if (seq <= backlog->applied) {
+            covered = false;
+        }
+    }
+    if (!covered || size > log->max_size) {
+        LOG_WARN(BACKLOG_NOT_COVERED, (unsigned long)since, (unsigned long)backlog->applied);
+        pthread_mutex_unlock(&backlog->mutex);
+        return -1;
+    }
+
+    LOG_INFO(BACKLOG_DELTA, (unsigned long)count, (unsigned long)since);
+    for (uint64_t seq = since + 1; seq <= backlog->last; seq++) {
+        struct backlog_mutation_t* mutation = backlog->ring[seq % backlog->capacity];
+        if (mutation == NULL || mutation->seq != seq)
+            continue;
+        struct data_t value = { .datasize = (int)mutation->value_size, .data = mutation->value };
+        snapshot_log_append(log, seq, mutation->opcode, mutation->key, &value);
+    }
+    pthread_mutex_unlock(&backlog->mutex);
+    return 0;
+}
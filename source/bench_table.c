@@ -0,0 +1,314 @@
+#include "table.h"
+#include "table-private.h"
+#include "list.h"
+#include "data.h"
+#include "entry.h"
+#include "utils.h"
+#include "workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Micro-benchmarks of the data structures of libtable, run by `make bench`. Every benchmark is
+ * repeated BENCH_REPETITIONS times, and the fastest repetition (the least disturbed one) is
+ * reported, as a JSON array of results on stdout, so that runs of different releases can be
+ * compared. The distributions give the order keys are accessed in: sequential (in order of
+ * creation), uniform, or zipfian (0.99, the hottest keys being scattered).
+ */
+
+#define BENCH_REPETITIONS 5
+#define BENCH_KEY_SIZE 32
+#define BENCH_VALUE_SIZE 64
+#define BENCH_ZIPFIAN_THETA 0.99
+#define BENCH_MAX_WORK 50000000LL       // keys times the longest chain, beyond which a case is skipped
+
+static const int key_counts[] = { 1000, 10000, 100000 };
+static const int bucket_counts[] = { 1, 64, 1024 };
+static const int value_sizes[] = { 16, 256, 4096, 65536 };
+static const char* distributions[] = { "sequential", "uniform", "zipfian" };
+
+#define N_ELEMENTS(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+// Keys of a case, and the order they are accessed in
+struct bench_case_t {
+    int n_keys;
+    int n_buckets;
+    const char* distribution;
+    char** keys;
+    int* order;                         // n_keys indices into keys
+    int* shuffled;                      // every index into keys once, shuffled
+};
+
+static int n_results = 0;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char* name, struct bench_case_t* bench, int value_size, long long ops, uint64_t best_ns, const char* extra) {
+    double ns_per_op = ops > 0 ? (double)best_ns / ops : 0;
+    printf("%s\n  {\"benchmark\": \"%s\", \"keys\": %d, \"buckets\": %d, \"distribution\": \"%s\", \"value_size\": %d, "
+        "\"ops\": %lld, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f%s}",
+        n_results++ > 0 ? "," : "", name, bench != NULL ? bench->n_keys : 0, bench != NULL ? bench->n_buckets : 0,
+        bench != NULL ? bench->distribution : "none", value_size, ops, ns_per_op,
+        ns_per_op > 0 ? 1e9 / ns_per_op : 0, extra != NULL ? extra : "");
+    fprintf(stderr, "%-16s keys %-7d buckets %-5d %-10s value %-6d %10.1f ns/op\n", name, bench != NULL ? bench->n_keys : 0,
+        bench != NULL ? bench->n_buckets : 0, bench != NULL ? bench->distribution : "none", value_size, ns_per_op);
+}
+
+static int case_create(struct bench_case_t* bench, int n_keys, int n_buckets, const char* distribution) {
+    bench->n_keys = n_keys;
+    bench->n_buckets = n_buckets;
+    bench->distribution = distribution;
+    bench->keys = create_dynamic_memory(n_keys * sizeof(char*));
+    bench->order = create_dynamic_memory(n_keys * sizeof(int));
+    bench->shuffled = create_dynamic_memory(n_keys * sizeof(int));
+    if (bench->keys == NULL || bench->order == NULL || bench->shuffled == NULL)
+        return -1;
+
+    for (int i = 0; i < n_keys; i++) {
+        bench->keys[i] = create_dynamic_memory(BENCH_KEY_SIZE);
+        if (bench->keys[i] == NULL)
+            return -1;
+        snprintf(bench->keys[i], BENCH_KEY_SIZE, "user%012d", i);
+    }
+
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    struct zipfian_t zipfian;
+    if (strcmp(distribution, "zipfian") == 0)
+        zipfian_init(&zipfian, n_keys, BENCH_ZIPFIAN_THETA);
+    for (int i = 0; i < n_keys; i++) {
+        if (strcmp(distribution, "sequential") == 0)
+            bench->order[i] = i;
+        else if (strcmp(distribution, "uniform") == 0)
+            bench->order[i] = random_next(&rng) % n_keys;
+        else
+            bench->order[i] = workload_scramble(zipfian_next(&zipfian, random_uniform(&rng))) % n_keys;
+    }
+
+    // Fisher-Yates
+    for (int i = 0; i < n_keys; i++)
+        bench->shuffled[i] = i;
+    for (int i = n_keys - 1; i > 0; i--) {
+        int j = random_next(&rng) % (i + 1);
+        int swap = bench->shuffled[i];
+        bench->shuffled[i] = bench->shuffled[j];
+        bench->shuffled[j] = swap;
+    }
+    return 0;
+}
+
+static void case_destroy(struct bench_case_t* bench) {
+    for (int i = 0; bench->keys != NULL && i < bench->n_keys; i++)
+        destroy_dynamic_memory(bench->keys[i]);
+    destroy_dynamic_memory(bench->keys);
+    destroy_dynamic_memory(bench->order);
+    destroy_dynamic_memory(bench->shuffled);
+}
+
+static struct table_t* filled_table(struct bench_case_t* bench, struct data_t* value) {
+    struct table_t* table = table_create(bench->n_buckets);
+    for (int i = 0; table != NULL && i < bench->n_keys; i++)
+        table_put(table, bench->keys[i], value);
+    return table;
+}
+
+#ifndef BENCH_HASH
+// ====================================================================================================
+//                                              hash_code
+// ====================================================================================================
+// returns the length of the longest chain
+static int bench_hash_code(struct bench_case_t* bench) {
+    uint64_t best = UINT64_MAX;
+    volatile int sink = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        uint64_t start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            sink += hash_code(bench->keys[bench->order[i]], bench->n_buckets);
+        uint64_t elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    // how evenly the keys are spread, which the other benchmarks depend on
+    int* chains = create_dynamic_memory(bench->n_buckets * sizeof(int));
+    int used = 0, longest = 0;
+    for (int i = 0; chains != NULL && i < bench->n_keys; i++) {
+        int bucket = hash_code(bench->keys[i], bench->n_buckets);
+        used += chains[bucket]++ == 0;
+        longest = chains[bucket] > longest ? chains[bucket] : longest;
+    }
+    destroy_dynamic_memory(chains);
+    char extra[64];
+    snprintf(extra, sizeof(extra), ", \"buckets_used\": %d, \"longest_chain\": %d", used, longest);
+    report("hash_code", bench, 0, bench->n_keys, best, extra);
+    return longest;
+}
+
+#endif
+
+#ifndef BENCH_LIST
+// ====================================================================================================
+//                                              list
+// ====================================================================================================
+static void bench_list(struct bench_case_t* bench) {
+    struct data_t value = { .datasize = BENCH_VALUE_SIZE, .data = (char[BENCH_VALUE_SIZE]){ 0 } };
+    struct entry_t** entries = create_dynamic_memory(bench->n_keys * sizeof(struct entry_t*));
+    if (entries == NULL)
+        return;
+
+    uint64_t best_add = UINT64_MAX, best_get = UINT64_MAX;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        struct list_t* list = list_create();
+        for (int i = 0; i < bench->n_keys; i++)
+            entries[i] = entry_create(strdup(bench->keys[bench->order[i]]), data_dup(&value));
+
+        // list_add() takes the entries, freeing those replaced
+        uint64_t start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            list_add(list, entries[i]);
+        uint64_t elapsed = now_ns() - start;
+        best_add = elapsed < best_add ? elapsed : best_add;
+
+        volatile int found = 0;
+        start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            found += list_get(list, bench->keys[bench->order[i]]) != NULL;
+        elapsed = now_ns() - start;
+        best_get = elapsed < best_get ? elapsed : best_get;
+        list_destroy(list);
+    }
+    destroy_dynamic_memory(entries);
+    report("list_add", bench, BENCH_VALUE_SIZE, bench->n_keys, best_add, NULL);
+    report("list_get", bench, BENCH_VALUE_SIZE, bench->n_keys, best_get, NULL);
+}
+
+#endif
+
+#ifndef BENCH_TABLE
+// ====================================================================================================
+//                                              table
+// ====================================================================================================
+static void bench_table(struct bench_case_t* bench) {
+    struct data_t value = { .datasize = BENCH_VALUE_SIZE, .data = (char[BENCH_VALUE_SIZE]){ 0 } };
+    uint64_t best_put = UINT64_MAX, best_get = UINT64_MAX, best_remove = UINT64_MAX;
+    int removed = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        struct table_t* table = table_create(bench->n_buckets);
+        if (table == NULL)
+            return;
+
+        uint64_t start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            table_put(table, bench->keys[bench->order[i]], &value);
+        uint64_t elapsed = now_ns() - start;
+        best_put = elapsed < best_put ? elapsed : best_put;
+        table_destroy(table);
+
+        // the other operations find every key there
+        table = filled_table(bench, &value);
+        if (table == NULL)
+            return;
+        start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            data_destroy(table_get(table, bench->keys[bench->order[i]]));
+        elapsed = now_ns() - start;
+        best_get = elapsed < best_get ? elapsed : best_get;
+
+        // every key is removed once, in an order of its own: drawing them from the distribution
+        // would remove keys already gone, and in sequence always the head of a list
+        removed = 0;
+        start = now_ns();
+        for (int i = 0; i < bench->n_keys; i++)
+            removed += table_remove(table, bench->keys[bench->shuffled[i]]) == 0;
+        elapsed = now_ns() - start;
+        best_remove = elapsed < best_remove ? elapsed : best_remove;
+        table_destroy(table);
+    }
+    report("table_put", bench, BENCH_VALUE_SIZE, bench->n_keys, best_put, NULL);
+    report("table_get", bench, BENCH_VALUE_SIZE, bench->n_keys, best_get, NULL);
+    report("table_remove", bench, BENCH_VALUE_SIZE, removed, best_remove, ", \"order\": \"shuffled\"");
+}
+
+static void bench_table_get_keys(struct bench_case_t* bench) {
+    struct data_t value = { .datasize = BENCH_VALUE_SIZE, .data = (char[BENCH_VALUE_SIZE]){ 0 } };
+    struct table_t* table = filled_table(bench, &value);
+    if (table == NULL)
+        return;
+
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        uint64_t start = now_ns();
+        table_free_keys(table_get_keys(table));
+        uint64_t elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    table_destroy(table);
+    // ns_per_op is per key listed
+    report("table_get_keys", bench, BENCH_VALUE_SIZE, bench->n_keys, best, NULL);
+}
+
+#endif
+
+#ifndef BENCH_DATA
+// ====================================================================================================
+//                                              data
+// ====================================================================================================
+static void bench_data_dup(int value_size) {
+    struct data_t* value = data_create(value_size, create_dynamic_memory(value_size));
+    if (value == NULL)
+        return;
+
+    const int n_copies = 10000;
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        uint64_t start = now_ns();
+        for (int i = 0; i < n_copies; i++)
+            data_destroy(data_dup(value));
+        uint64_t elapsed = now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    data_destroy(value);
+    report("data_dup", NULL, value_size, n_copies, best, NULL);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        fprintf(stderr, "Usage: %s > results.json\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("[");
+    for (int k = 0; k < N_ELEMENTS(key_counts); k++) {
+        for (int b = 0; b < N_ELEMENTS(bucket_counts); b++) {
+            for (int d = 0; d < N_ELEMENTS(distributions); d++) {
+                struct bench_case_t bench = { 0 };
+                if (case_create(&bench, key_counts[k], bucket_counts[b], distributions[d]) == 0) {
+                    // sorted lists make the cost quadratic in the keys per bucket
+                    int longest = bench_hash_code(&bench);
+                    if ((long long)bench.n_keys * longest > BENCH_MAX_WORK) {
+                        fprintf(stderr, "%-16s keys %-7d buckets %-5d %-10s skipped (longest chain %d)\n", "table_*",
+                            bench.n_keys, bench.n_buckets, bench.distribution, longest);
+                        case_destroy(&bench);
+                        continue;
+                    }
+                    if (b == 0)
+                        bench_list(&bench);
+                    bench_table(&bench);
+                    if (d == 0)
+                        bench_table_get_keys(&bench);
+                }
+                case_destroy(&bench);
+            }
+        }
+    }
+    for (int v = 0; v < N_ELEMENTS(value_sizes); v++)
+        bench_data_dup(value_sizes[v]);
+    printf("\n]\n");
+    return EXIT_SUCCESS;
+}
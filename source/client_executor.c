@@ -4,6 +4,7 @@
 #include "distributed_database.h"
 #include "network_server-private.h"
 #include "utils.h"
+#include "logger.h"
 
 #include <stdio.h>
 
@@ -28,9 +29,9 @@ void* thread_process_request(void* _args) {
     destroy_dynamic_memory(args);
 
     db_increment_active_clients(ddb->db);
-    printf(CLIENT_CONNECTION_OK);
+    LOG_INFO(CLIENT_CONNECTION_OK);
     process_request(client_socket, ddb);
-    printf(CLIENT_CONNECTION_CLOSED);
+    LOG_INFO(CLIENT_CONNECTION_CLOSED);
     db_decrement_active_clients(ddb->db);
     close(client_socket);
     pthread_exit(NULL);
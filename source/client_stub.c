@@ -15,8 +15,9 @@
 
 struct rtable_t* rtable_create(char* address_port) {
     // split 
-    char *ip_str = strtok(address_port, ":");
-    char *port_str = strtok(NULL, ":");
+    char *saveptr = NULL;
+    char *ip_str = strtok_r(address_port, ":", &saveptr);
+    char *port_str = strtok_r(NULL, ":", &saveptr);
     if (assert_error(
         ip_str == NULL || port_str == NULL,
         "rtable_create",
@@ -44,7 +45,7 @@ int rtable_destroy(struct rtable_t *rtable) {
         ERROR_NULL_POINTER_REFERENCE
     )) return M_ERROR;
 
-    close(rtable->sockfd);
+    network_close(rtable);
     safe_free(rtable);
     return M_OK;
 }
@@ -106,6 +107,12 @@ int rtable_put_common(struct rtable_t* rtable, EntryT* entry_wrapper) {
     return 0;
 }
 
+// point operations of connections upgraded to the compact protocol skip protobuf altogether
+static int rtable_put_compact(struct rtable_t* rtable, char* key, struct data_t* data) {
+    struct compact_header_t response;
+    return network_compact_call(rtable, COMPACT_OP_PUT, key, data->data, data->datasize, &response);
+}
+
 int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
     if (assert_error(
         rtable == NULL || entry == NULL,
@@ -113,6 +120,9 @@ int rtable_put(struct rtable_t *rtable, struct entry_t *entry) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
+    if (rtable->compact)
+        return rtable_put_compact(rtable, entry->key, entry->value);
+
     // create entry
     EntryT* entry_wrapper = wrap_entry(entry);
     return rtable_put_common(rtable, entry_wrapper);
@@ -125,6 +135,9 @@ int rtable_put_with_data(struct rtable_t *rtable, char* key, struct data_t* data
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
+    if (rtable->compact)
+        return rtable_put_compact(rtable, key, data);
+
     // create entry
     EntryT* entry_wrapper = wrap_entry_with_data(key, data);
     return rtable_put_common(rtable, entry_wrapper);
@@ -137,6 +150,20 @@ struct data_t *rtable_get(struct rtable_t *rtable, char *key) {
         ERROR_NULL_POINTER_REFERENCE
     )) return NULL;
 
+    if (rtable->compact) {
+        struct compact_header_t response;
+        if (network_compact_call(rtable, COMPACT_OP_GET, key, NULL, 0, &response) == -1)
+            return NULL;
+
+        void* value = duplicate_memory(rtable->buffer + response.key_length, response.value_length, "rtable_get");
+        if (value == NULL)
+            return NULL;
+        struct data_t* data = data_create(response.value_length, value);
+        if (data == NULL)
+            destroy_dynamic_memory(value);
+        return data;
+    }
+
     MessageT* msg_wrapper = wrap_message(MESSAGE_T__OPCODE__OP_GET, MESSAGE_T__C_TYPE__CT_KEY);
     if (msg_wrapper == NULL)
         return NULL;
@@ -165,6 +192,11 @@ int rtable_del(struct rtable_t *rtable, char *key) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
+    if (rtable->compact) {
+        struct compact_header_t response;
+        return network_compact_call(rtable, COMPACT_OP_DEL, key, NULL, 0, &response);
+    }
+
     MessageT* msg_wrapper = wrap_message(MESSAGE_T__OPCODE__OP_DEL, MESSAGE_T__C_TYPE__CT_KEY);
     if (msg_wrapper == NULL)
         return -1;
@@ -390,7 +422,136 @@ struct statistics_t* rtable_stats(struct rtable_t* rtable) {
         return NULL;
     }
     struct statistics_t* stats = stats_create(received->stats->op_counter, received->stats->computed_time, received->stats->active_clients);
+    if (stats != NULL) {
+        for (size_t i = 0; i < received->stats->n_replication_batches && i < STATS_BATCH_BUCKETS; i++)
+            stats->replication_batches[i] = received->stats->replication_batches[i];
+        stats->replication_bytes_saved = received->stats->replication_bytes_saved;
+        stats->replication_coalesced = received->stats->replication_coalesced;
+        size_t n_successors = received->stats->n_successors;
+        stats->successors = n_successors > 0 ? create_dynamic_memory(n_successors * sizeof(struct successor_stats_t)) : NULL;
+        for (size_t i = 0; stats->successors != NULL && i < n_successors; i++) {
+            SuccessorStatsT* from = received->stats->successors[i];
+            struct successor_stats_t* to = &stats->successors[stats->n_successors++];
+            to->address = strdup(from->address != NULL ? from->address : "");
+            to->queued = from->queued;
+            to->in_flight = from->in_flight;
+            to->bytes_in_flight = from->bytes_in_flight;
+            to->seq_lag = from->seq_lag;
+            for (size_t j = 0; j < from->n_ack_latency && j < STATS_LATENCY_BUCKETS; j++)
+                to->ack_latency[j] = from->ack_latency[j];
+            to->throttled = from->throttled;
+            to->async_acks = from->async_acks;
+            to->lagging = from->lagging;
+        }
+        stats->latencies = received->stats->n_latencies > 0 ? create_dynamic_memory(STATS_OPS * STATS_PHASES * sizeof(struct stats_histogram_t)) : NULL;
+        for (size_t i = 0; stats->latencies != NULL && i < received->stats->n_latencies; i++) {
+            LatencyHistogramT* from = received->stats->latencies[i];
+            if (from->op < 0 || from->op >= STATS_OPS || from->phase < 0 || from->phase >= STATS_PHASES)
+                continue;
+            struct stats_histogram_t* to = &stats->latencies[from->op * STATS_PHASES + from->phase];
+            for (size_t j = 0; j < from->n_buckets && j < STATS_HISTOGRAM_BUCKETS; j++)
+                to->buckets[j] = from->buckets[j];
+            to->sum_ns = from->sum_ns;
+            to->max_ns = from->max_ns;
+        }
+        stats->timing_sample = received->stats->timing_sample;
+        size_t n_memory = received->stats->n_memory;
+        stats->memory = n_memory > 0 ? create_dynamic_memory(n_memory * sizeof(struct memory_stats_t)) : NULL;
+        for (size_t i = 0; stats->memory != NULL && i < n_memory; i++) {
+            MemoryTagT* from = received->stats->memory[i];
+            struct memory_stats_t* to = &stats->memory[stats->n_memory++];
+            to->tag = strdup(from->tag != NULL ? from->tag : "");
+            to->bytes = from->bytes;
+            to->objects = from->objects;
+            to->allocations = from->allocations;
+            to->allocated_bytes = from->allocated_bytes;
+        }
+        stats->uptime_ms = received->stats->uptime_ms;
+    }
     message_t__free_unpacked(received, NULL);
 
     return stats;
-}
\ No newline at end of file
+}
+struct slow_op_t* rtable_slowlog(struct rtable_t* rtable, bool reset, int* n_ops) {
+    if (assert_error(
+        rtable == NULL || n_ops == NULL,
+        "rtable_slowlog",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    *n_ops = -1;
+    MessageT* msg_wrapper = wrap_message(MESSAGE_T__OPCODE__OP_SLOWLOG, MESSAGE_T__C_TYPE__CT_NONE);
+    if (msg_wrapper == NULL)
+        return NULL;
+    msg_wrapper->result = reset ? 1 : 0;
+
+    // send a wait for response...
+    MessageT* received = network_send_receive(rtable, msg_wrapper);
+    message_t__free_unpacked(msg_wrapper, NULL);
+    if (was_operation_unsuccessful(received)) {
+        if (received != NULL)
+            message_t__free_unpacked(received, NULL);
+        return NULL;
+    }
+
+    size_t n = received->n_slow_ops;
+    struct slow_op_t* ops = n > 0 ? create_dynamic_memory(n * sizeof(struct slow_op_t)) : NULL;
+    if (n > 0 && ops == NULL) {
+        message_t__free_unpacked(received, NULL);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        SlowOpT* from = received->slow_ops[i];
+        ops[i].time_ms = from->time_ms;
+        ops[i].opcode = from->opcode;
+        ops[i].key = strdup(from->key != NULL ? from->key : "");
+        ops[i].value_size = from->value_size;
+        ops[i].lock_wait_ns = from->lock_wait_ns;
+        ops[i].table_ns = from->table_ns;
+        ops[i].replication_ns = from->replication_ns;
+        ops[i].serialization_ns = from->serialization_ns;
+        ops[i].total_ns = from->total_ns;
+    }
+    message_t__free_unpacked(received, NULL);
+    *n_ops = n;
+    return ops;
+}
+
+struct hot_key_t* rtable_hotkeys(struct rtable_t* rtable, bool reset, int* n_keys) {
+    if (assert_error(
+        rtable == NULL || n_keys == NULL,
+        "rtable_hotkeys",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    *n_keys = -1;
+    MessageT* msg_wrapper = wrap_message(MESSAGE_T__OPCODE__OP_HOTKEYS, MESSAGE_T__C_TYPE__CT_NONE);
+    if (msg_wrapper == NULL)
+        return NULL;
+    msg_wrapper->result = reset ? 1 : 0;
+
+    // send a wait for response...
+    MessageT* received = network_send_receive(rtable, msg_wrapper);
+    message_t__free_unpacked(msg_wrapper, NULL);
+    if (was_operation_unsuccessful(received)) {
+        if (received != NULL)
+            message_t__free_unpacked(received, NULL);
+        return NULL;
+    }
+
+    size_t n = received->n_hot_keys;
+    struct hot_key_t* keys = n > 0 ? create_dynamic_memory(n * sizeof(struct hot_key_t)) : NULL;
+    if (n > 0 && keys == NULL) {
+        message_t__free_unpacked(received, NULL);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        HotKeyT* from = received->hot_keys[i];
+        keys[i].key = strdup(from->key != NULL ? from->key : "");
+        keys[i].ops = from->ops;
+        keys[i].bytes = from->bytes;
+    }
+    message_t__free_unpacked(received, NULL);
+    *n_keys = n;
+    return keys;
+}
@@ -0,0 +1,101 @@
+#include "compact_protocol.h"
+
+#include "message.h"
+#include "utils.h"
+#include "zerocopy.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
+
+void compact_header_encode(struct compact_header_t* header, uint8_t* buffer) {
+    uint16_t key_length = htons(header->key_length);
+    uint32_t value_length = htonl(header->value_length);
+    uint32_t request_id = htonl(header->request_id);
+
+    buffer[0] = header->opcode;
+    buffer[1] = header->flags;
+    memcpy(buffer + 2, &key_length, sizeof(key_length));
+    memcpy(buffer + 4, &value_length, sizeof(value_length));
+    memcpy(buffer + 8, &request_id, sizeof(request_id));
+}
+
+int compact_header_decode(const uint8_t* buffer, struct compact_header_t* header) {
+    uint16_t key_length;
+    uint32_t value_length, request_id;
+    memcpy(&key_length, buffer + 2, sizeof(key_length));
+    memcpy(&value_length, buffer + 4, sizeof(value_length));
+    memcpy(&request_id, buffer + 8, sizeof(request_id));
+
+    header->opcode = buffer[0];
+    header->flags = buffer[1];
+    header->key_length = ntohs(key_length);
+    header->value_length = ntohl(value_length);
+    header->request_id = ntohl(request_id);
+
+    if (assert_error(
+        header->opcode < COMPACT_OP_PUT || header->opcode > COMPACT_OP_PROTOBUF,
+        "compact_header_decode",
+        "Unknown compact opcode.\n"
+    )) return -1;
+
+    if (assert_error(
+        compact_payload_size(header) > COMPACT_MAX_PAYLOAD,
+        "compact_header_decode",
+        "Compact frame too large.\n"
+    )) return -1;
+    return 0;
+}
+
+size_t compact_payload_size(struct compact_header_t* header) {
+    return (size_t)header->key_length + header->value_length;
+}
+
+ssize_t compact_pack_message(MessageT* msg, uint32_t request_id, uint8_t* buffer, size_t capacity) {
+    if (assert_error(
+        msg == NULL || buffer == NULL,
+        "compact_pack_message",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    size_t msg_size = message_t__get_packed_size(msg);
+    if (assert_error(
+        msg_size > COMPACT_MAX_PAYLOAD || COMPACT_HEADER_SIZE + msg_size > capacity,
+        "compact_pack_message",
+        "Message does not fit a compact frame.\n"
+    )) return -1;
+
+    struct compact_header_t header = {
+        .opcode = COMPACT_OP_PROTOBUF,
+        .value_length = msg_size,
+        .request_id = request_id
+    };
+    compact_header_encode(&header, buffer);
+    message_t__pack(msg, buffer + COMPACT_HEADER_SIZE);
+    return COMPACT_HEADER_SIZE + msg_size;
+}
+
+int compact_send_frame(int fd, struct compact_header_t* header, const void* key, const void* value) {
+    uint8_t encoded[COMPACT_HEADER_SIZE];
+    compact_header_encode(header, encoded);
+
+    struct iovec iov[3] = {
+        { .iov_base = encoded, .iov_len = COMPACT_HEADER_SIZE },
+        { .iov_base = (void*)key, .iov_len = key != NULL ? header->key_length : 0 },
+        { .iov_base = (void*)value, .iov_len = value != NULL ? header->value_length : 0 }
+    };
+    return zerocopy_send_iov(fd, iov, 3, NULL) == -1 ? -1 : 0;
+}
+
+int compact_read_frame(int fd, struct compact_header_t* header, uint8_t* buffer) {
+    uint8_t encoded[COMPACT_HEADER_SIZE];
+    if (read_all(fd, encoded, COMPACT_HEADER_SIZE) != COMPACT_HEADER_SIZE)
+        return -1;
+    if (compact_header_decode(encoded, header) == -1)
+        return -1;
+
+    size_t payload_size = compact_payload_size(header);
+    if (payload_size > 0 && read_all(fd, buffer, payload_size) != (ssize_t)payload_size)
+        return -1;
+    return 0;
+}
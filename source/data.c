@@ -26,7 +26,8 @@ struct data_t *data_create(int size, void *data) {
         ERROR_MALLOC
     )) return NULL;
 
-    // update struct fields with given pointers
+    // update struct fields with given pointers, the value being counted from now on
+    memory_account(MEMORY_VALUES, data, true);
     block->data = data;
     block->datasize = size;
     return block;
@@ -40,7 +41,7 @@ enum MemoryOperationStatus data_cleanup(struct data_t *data) {
     )) return M_ERROR;
 
     // destroy memory allocated by data->data and set to NULL
-    destroy_dynamic_memory(data->data);
+    destroy_tagged_memory(MEMORY_VALUES, data->data);
     data->data = NULL;  
     return M_OK;
 }
@@ -89,6 +90,7 @@ int data_replace(struct data_t *data, int new_size, void *new_data) {
         return M_ERROR;
 
     // update struct fields with given pointer and size
+    memory_account(MEMORY_VALUES, new_data, true);
     data->data = new_data;
     data->datasize = new_size;
     return M_OK;
@@ -3,13 +3,15 @@
 #include "table_skel.h"
 #include "client_stub.h"
 #include "utils.h"
-#include "aptime.h"
+#include "latency.h"
+#include "slowlog.h"
 #include "stats.h"
 #include "entry.h"
+#include "probes.h"
 
 #include <pthread.h>
 #include <stdio.h>
-#include <sys/time.h>
+#include <string.h>
 
 void database_init(struct TableServerDatabase* db, int n_lists) {
     if (assert_error(
@@ -25,11 +27,11 @@ void database_init(struct TableServerDatabase* db, int n_lists) {
     )) return;
 
     db->table = table_skel_init(n_lists);
+    db->digest = create_dynamic_memory(sizeof(struct digest_t));
     db->stats = stats_create(0, 0, 0);
+    db->started_ns = latency_now_ns();
     pthread_mutex_init(&db->active_mutex, NULL);
     pthread_mutex_init(&db->table_mutex, NULL);
-    pthread_mutex_init(&db->op_counter_mutex, NULL);
-    pthread_mutex_init(&db->computed_time_mutex, NULL);
     pthread_attr_init(&db->thread_attr);
     // set the thread attribute to detached mode
     if (assert_error(
@@ -58,10 +60,9 @@ void database_destroy(struct TableServerDatabase* db) {
         "database_destroy",
         "Failed to free server stats."
     );
+    destroy_dynamic_memory(db->digest);
     pthread_mutex_destroy(&db->active_mutex);
     pthread_mutex_destroy(&db->table_mutex);
-    pthread_mutex_destroy(&db->op_counter_mutex);
-    pthread_mutex_destroy(&db->computed_time_mutex);
     pthread_attr_destroy(&db->thread_attr);
 }
 
@@ -96,9 +97,7 @@ void db_increment_op_counter(struct TableServerDatabase* db) {
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
-    pthread_mutex_lock(&db->op_counter_mutex);
-    db->stats->op_counter++;
-    pthread_mutex_unlock(&db->op_counter_mutex);
+    latency_count_op();
 }
 
 void db_add_to_computed_time(struct TableServerDatabase* db, long long delta) {
@@ -108,9 +107,58 @@ void db_add_to_computed_time(struct TableServerDatabase* db, long long delta) {
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
-    pthread_mutex_lock(&db->computed_time_mutex);
-    db->stats->computed_time_micros += delta;
-    pthread_mutex_unlock(&db->computed_time_mutex);
+    latency_add_computed_time(delta);
+}
+
+void db_read_counters(struct TableServerDatabase* db, long long* op_counter, long long* computed_time_micros) {
+    if (assert_error(
+        db == NULL,
+        "db_read_counters",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    latency_counters(op_counter, computed_time_micros);
+}
+
+// times of an operation on the table (requested_ns is 0 if not timed)
+struct db_timing_t {
+    enum StatsOp op;
+    bool sampled;
+    uint64_t requested_ns;
+    uint64_t acquired_ns;
+};
+
+// takes table_mutex, reading the clock before and after if the operation is sampled, or the
+// request is timed for the slow log
+static void db_lock(struct TableServerDatabase* db, struct db_timing_t* timing, enum StatsOp op) {
+    timing->op = op;
+    timing->sampled = latency_sample(STATS_PHASE_TABLE);
+    timing->requested_ns = timing->sampled || slowlog_active() ? latency_now_ns() : 0;
+    PROBE1(lock__wait, op);
+    pthread_mutex_lock(&db->table_mutex);
+    PROBE1(lock__acquire, op);
+    if (timing->requested_ns != 0)
+        timing->acquired_ns = latency_now_ns();
+}
+
+// releases table_mutex, then counts the time spent waiting for it and holding it
+static void db_unlock(struct TableServerDatabase* db, struct db_timing_t* timing) {
+    pthread_mutex_unlock(&db->table_mutex);
+    PROBE1(table__op, timing->op);
+    if (timing->requested_ns == 0)
+        return;
+
+    uint64_t released_ns = latency_now_ns();
+    uint64_t wait_ns = timing->acquired_ns - timing->requested_ns;
+    uint64_t hold_ns = released_ns - timing->acquired_ns;
+    slowlog_add(SLOWLOG_LOCK_WAIT, wait_ns);
+    slowlog_add(SLOWLOG_TABLE, hold_ns);
+    if (!timing->sampled)
+        return;
+
+    db_add_to_computed_time(db, (long long)hold_ns * latency_sample_rate());
+    latency_record(timing->op, STATS_PHASE_LOCK_WAIT, wait_ns);
+    latency_record(timing->op, STATS_PHASE_TABLE, hold_ns);
 }
 
 int db_table_put(struct TableServerDatabase* db, char *key, struct data_t *value) {
@@ -120,16 +168,18 @@ int db_table_put(struct TableServerDatabase* db, char *key, struct data_t *value
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
-    struct timeval start_time, end_time;
-    pthread_mutex_lock(&db->table_mutex);
-    gettimeofday(&start_time, NULL);
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_PUT);
+    // the entry replaced leaves the digest of its bucket
+    struct data_t* previous = table_peek(db->table, key);
+    if (previous != NULL)
+        digest_toggle(db->digest, key, previous->data, previous->datasize);
     int result = table_put(db->table, key, value);
-    gettimeofday(&end_time, NULL);
-    pthread_mutex_unlock(&db->table_mutex);
-
-    // compute time
-    long long delta = delta_microsec(&start_time, &end_time);
-    db_add_to_computed_time(db, delta);
+    if (result == 0)
+        digest_toggle(db->digest, key, value->data, value->datasize);
+    else if (previous != NULL)
+        digest_toggle(db->digest, key, previous->data, previous->datasize);
+    db_unlock(db, &timing);
     return result;
 }
 
@@ -140,19 +190,26 @@ struct data_t* db_table_get(struct TableServerDatabase* db, char *key) {
         ERROR_NULL_POINTER_REFERENCE
     )) return NULL;
 
-    struct timeval start_time, end_time;
-    pthread_mutex_lock(&db->table_mutex);
-    gettimeofday(&start_time, NULL);
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_GET);
     struct data_t* result = table_get(db->table, key);
-    gettimeofday(&end_time, NULL);
-    pthread_mutex_unlock(&db->table_mutex);
-
-    // compute time
-    long long delta = delta_microsec(&start_time, &end_time);
-    db_add_to_computed_time(db, delta);
+    db_unlock(db, &timing);
     return result;
 }
 
+int db_table_read(struct TableServerDatabase* db, char* key, void* buffer, int capacity) {
+    if (assert_error(
+        db == NULL,
+        "db_table_read",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_GET);
+    int result = table_read(db->table, key, buffer, capacity);
+    db_unlock(db, &timing);
+    return result;
+}
 
 int db_table_remove(struct TableServerDatabase* db, char* key) {
     if (assert_error(
@@ -161,16 +218,15 @@ int db_table_remove(struct TableServerDatabase* db, char* key) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
-    struct timeval start_time, end_time;
-    pthread_mutex_lock(&db->table_mutex);
-    gettimeofday(&start_time, NULL);
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_DEL);
+    struct data_t* previous = table_peek(db->table, key);
+    if (previous != NULL)
+        digest_toggle(db->digest, key, previous->data, previous->datasize);
     int result = table_remove(db->table, key);
-    gettimeofday(&end_time, NULL);
-    pthread_mutex_unlock(&db->table_mutex);
-
-    // compute time
-    long long delta = delta_microsec(&start_time, &end_time);
-    db_add_to_computed_time(db, delta);
+    if (result != 0 && previous != NULL)
+        digest_toggle(db->digest, key, previous->data, previous->datasize);
+    db_unlock(db, &timing);
     return result;
 }
 
@@ -181,16 +237,10 @@ int db_table_size(struct TableServerDatabase* db) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
-    struct timeval start_time, end_time;
-    pthread_mutex_lock(&db->table_mutex);
-    gettimeofday(&start_time, NULL);
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_SIZE);
     int result = table_size(db->table);
-    gettimeofday(&end_time, NULL);
-    pthread_mutex_unlock(&db->table_mutex);
-
-    // compute time
-    long long delta = delta_microsec(&start_time, &end_time);
-    db_add_to_computed_time(db, delta);
+    db_unlock(db, &timing);
     return result;
 }
 
@@ -201,43 +251,63 @@ char** db_table_get_keys(struct TableServerDatabase* db) {
         ERROR_NULL_POINTER_REFERENCE
     )) return NULL;
 
-    struct timeval start_time, end_time;
-    pthread_mutex_lock(&db->table_mutex);
-    gettimeofday(&start_time, NULL);
+    struct db_timing_t timing;
+    db_lock(db, &timing, STATS_OP_GETKEYS);
     char** result = table_get_keys(db->table);
-    gettimeofday(&end_time, NULL);
-    pthread_mutex_unlock(&db->table_mutex);
+    db_unlock(db, &timing);
+    return result;
+}
+
+int db_table_clear(struct TableServerDatabase* db) {
+    if (assert_error(
+        db == NULL,
+        "db_table_clear",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
 
-    // compute time
-    long long delta = delta_microsec(&start_time, &end_time);
-    db_add_to_computed_time(db, delta);
+    pthread_mutex_lock(&db->table_mutex);
+    int result = table_clear(db->table);
+    if (result == 0 && db->digest != NULL)
+        memset(db->digest, 0, sizeof(struct digest_t));
+    pthread_mutex_unlock(&db->table_mutex);
     return result;
 }
 
-int db_migrate_table(struct TableServerDatabase* db, struct rtable_t* migration_table) {
+int db_table_scan(struct TableServerDatabase* db, int* index, char* after, struct entry_t** entries, int max, size_t budget) {
     if (assert_error(
-        db == NULL || db->table == NULL || migration_table == NULL,
-        "db_migrate_table",
+        db == NULL,
+        "db_table_scan",
         ERROR_NULL_POINTER_REFERENCE
-    )) return 0;
+    )) return -1;
+
+    pthread_mutex_lock(&db->table_mutex);
+    int result = table_scan(db->table, index, after, entries, max, budget);
+    pthread_mutex_unlock(&db->table_mutex);
+    return result;
+}
 
-    struct entry_t** entries = rtable_get_table(migration_table);
+int db_table_scan_keys(struct TableServerDatabase* db, int* index, char* after, bool (*wanted)(const char* key, void* arg), void* arg, char** keys, int max) {
     if (assert_error(
-        entries == NULL,
-        "gettable",
-        "Failed to retrieve remote table.\n"
-    )) return 0;
+        db == NULL,
+        "db_table_scan_keys",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pthread_mutex_lock(&db->table_mutex);
+    int result = table_scan_keys(db->table, index, after, wanted, arg, keys, max);
+    pthread_mutex_unlock(&db->table_mutex);
+    return result;
+}
 
-    // starting with index 0, iterate over entries, updating this server database
-    int index = 0;
-    struct entry_t* entry;
-    while ((entry = entries[index])) {
-        printf(MIGRATING_KEY_VALUE, entry->key);
-        print_data(entry->value->data, entry->value->datasize);
-        db_table_put(db, entry->key, entry->value);
-        index++;
-    }
+int db_table_digest(struct TableServerDatabase* db, uint32_t* buckets) {
+    if (assert_error(
+        db == NULL || db->digest == NULL || buckets == NULL,
+        "db_table_digest",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
 
-    rtable_free_entries(entries);
+    pthread_mutex_lock(&db->table_mutex);
+    memcpy(buckets, db->digest->buckets, sizeof(db->digest->buckets));
+    pthread_mutex_unlock(&db->table_mutex);
     return 0;
-}
\ No newline at end of file
+}
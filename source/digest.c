@@ -0,0 +1,96 @@
+#include "digest.h"
+
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLYNOMIAL 0x82F63B78    // reflected
+
+static uint32_t crc32c_table[256];
+static bool crc32c_hardware = false;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        crc32c_table[i] = crc;
+    }
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    crc32c_hardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t crc32c_software(uint32_t crc, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        crc = crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__)
+// 8 bytes per instruction, then the tail byte by byte
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* data, size_t size) {
+    uint64_t crc64 = crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; size > 0; size--, data++)
+        crc = _mm_crc32_u8(crc, *data);
+    return crc;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+    pthread_once(&crc32c_once, crc32c_init);
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (crc32c_hardware)
+        return ~crc32c_sse42(crc, data, size);
+#endif
+    return ~crc32c_software(crc, data, size);
+}
+
+// CRCs are linear, so that the differences of several entries of a bucket could cancel out in
+// the XOR of theirs unless mixed first
+static uint32_t digest_mix(uint32_t crc) {
+    uint64_t x = hash_mix64(crc);
+    return (uint32_t)(x ^ (x >> 32));
+}
+
+int digest_bucket(const char* key) {
+    return crc32c(0, key, strlen(key)) % DIGEST_BUCKETS;
+}
+
+void digest_toggle(struct digest_t* digest, const char* key, const void* value, size_t size) {
+    if (digest == NULL || key == NULL)
+        return;
+
+    size_t key_size = strlen(key);
+    // the CRC of the key picks the bucket, and is extended with the terminator, which keeps
+    // ("ab", "c") and ("a", "bc") apart, and the value
+    uint32_t key_crc = crc32c(0, key, key_size);
+    uint32_t crc = crc32c(key_crc, key + key_size, 1);
+    crc = crc32c(crc, value, size);
+    digest->buckets[key_crc % DIGEST_BUCKETS] ^= digest_mix(crc);
+}
+
+void digest_groups(const struct digest_t* digest, uint32_t* groups) {
+    for (int group = 0; group < DIGEST_GROUPS; group++) {
+        uint32_t crc = 0;
+        for (int i = 0; i < DIGEST_GROUP_SIZE; i++)
+            crc ^= digest->buckets[group * DIGEST_GROUP_SIZE + i];
+        groups[group] = crc;
+    }
+}
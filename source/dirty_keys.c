@@ -0,0 +1,122 @@
+#include "dirty_keys.h"
+
+#include "utils.h"
+
+#include <string.h>
+
+static uint32_t dirty_key_hash(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)key; *c != '\0'; c++)
+        hash = (hash ^ *c) * 16777619u;
+    return hash;
+}
+
+static pthread_mutex_t* dirty_keys_mutex(struct dirty_keys_t* set, uint32_t hash) {
+    return &set->mutexes[(hash % DIRTY_KEYS_BUCKETS) % DIRTY_KEYS_STRIPES];
+}
+
+// the link to key in its bucket, pointing to NULL if key is clean. The stripe of hash must be locked
+static struct dirty_key_t** dirty_keys_find(struct dirty_keys_t* set, const char* key, uint32_t hash) {
+    struct dirty_key_t** link = &set->buckets[hash % DIRTY_KEYS_BUCKETS];
+    while (*link != NULL && ((*link)->hash != hash || strcmp((*link)->key, key) != 0))
+        link = &(*link)->next;
+    return link;
+}
+
+void dirty_keys_init(struct dirty_keys_t* set) {
+    if (assert_error(
+        set == NULL,
+        "dirty_keys_init",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    memset(set->buckets, 0, sizeof(set->buckets));
+    set->count = 0;
+    for (int i = 0; i < DIRTY_KEYS_STRIPES; i++)
+        pthread_mutex_init(&set->mutexes[i], NULL);
+}
+
+void dirty_keys_destroy(struct dirty_keys_t* set) {
+    if (set == NULL)
+        return;
+
+    for (int i = 0; i < DIRTY_KEYS_BUCKETS; i++) {
+        struct dirty_key_t* dirty = set->buckets[i];
+        while (dirty != NULL) {
+            struct dirty_key_t* next = dirty->next;
+            destroy_dynamic_memory(dirty);
+            dirty = next;
+        }
+        set->buckets[i] = NULL;
+    }
+    for (int i = 0; i < DIRTY_KEYS_STRIPES; i++)
+        pthread_mutex_destroy(&set->mutexes[i]);
+    set->count = 0;
+}
+
+int dirty_keys_mark(struct dirty_keys_t* set, const char* key) {
+    if (assert_error(
+        set == NULL || key == NULL,
+        "dirty_keys_mark",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    uint32_t hash = dirty_key_hash(key);
+    pthread_mutex_t* mutex = dirty_keys_mutex(set, hash);
+    pthread_mutex_lock(mutex);
+    struct dirty_key_t** link = dirty_keys_find(set, key, hash);
+    if (*link == NULL) {
+        size_t key_size = strlen(key) + 1;
+        struct dirty_key_t* dirty = create_dynamic_memory(sizeof(struct dirty_key_t) + key_size);
+        if (assert_error(
+            dirty == NULL,
+            "dirty_keys_mark",
+            ERROR_MALLOC
+        )) {
+            pthread_mutex_unlock(mutex);
+            return -1;
+        }
+        dirty->hash = hash;
+        dirty->key = (char*)(dirty + 1);
+        memcpy(dirty->key, key, key_size);
+        *link = dirty;
+        __atomic_add_fetch(&set->count, 1, __ATOMIC_RELEASE);
+    }
+    (*link)->pending++;
+    pthread_mutex_unlock(mutex);
+    return 0;
+}
+
+void dirty_keys_clear(struct dirty_keys_t* set, const char* key) {
+    if (set == NULL || key == NULL)
+        return;
+
+    uint32_t hash = dirty_key_hash(key);
+    pthread_mutex_t* mutex = dirty_keys_mutex(set, hash);
+    pthread_mutex_lock(mutex);
+    struct dirty_key_t** link = dirty_keys_find(set, key, hash);
+    struct dirty_key_t* dirty = *link;
+    if (dirty != NULL && --dirty->pending == 0) {
+        // clean again: forget it
+        *link = dirty->next;
+        destroy_dynamic_memory(dirty);
+        __atomic_sub_fetch(&set->count, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(mutex);
+}
+
+bool dirty_keys_contains(struct dirty_keys_t* set, const char* key) {
+    if (set == NULL || key == NULL)
+        return false;
+
+    // nothing in flight (the common case of a read-mostly workload): no lookup
+    if (__atomic_load_n(&set->count, __ATOMIC_ACQUIRE) == 0)
+        return false;
+
+    uint32_t hash = dirty_key_hash(key);
+    pthread_mutex_t* mutex = dirty_keys_mutex(set, hash);
+    pthread_mutex_lock(mutex);
+    bool dirty = *dirty_keys_find(set, key, hash) != NULL;
+    pthread_mutex_unlock(mutex);
+    return dirty;
+}
@@ -4,9 +4,31 @@
 #include "client_stub.h"
 #include "client_stub-private.h"
 #include "utils.h"
+#include "latency.h"
+#include "slowlog.h"
+#include "logger.h"
+#include "probes.h"
 
 
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// client request waiting for the rest of the chain
+struct ddb_waiter_t {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool done;
+    int status;
+};
+
+// forwarded mutation, keeping its key dirty until the rest of the chain acknowledges it
+struct ddb_commit_t {
+    struct TableServerDistributedDatabase* ddb;
+    replication_callback_t callback;
+    void* arg;
+    char key[];
+};
 
 
 void ddatabase_init(struct TableServerDistributedDatabase* ddb, int n_lists) {
@@ -18,6 +40,24 @@ void ddatabase_init(struct TableServerDistributedDatabase* ddb, int n_lists) {
 
     ddb->db = (struct TableServerDatabase*)create_dynamic_memory(sizeof(struct TableServerDatabase));
     database_init(ddb->db, n_lists);
+    ddb->replica = NULL;
+    memset(&ddb->replication_stats, 0, sizeof(ddb->replication_stats));
+    pthread_rwlock_init(&ddb->replica_lock, NULL);
+    dirty_keys_init(&ddb->dirty_keys);
+    ddb->tail = NULL;
+    pthread_mutex_init(&ddb->tail_mutex, NULL);
+    ddb->snapshot_logs = NULL;
+    pthread_mutex_init(&ddb->capture_mutex, NULL);
+    ddb->syncing = false;
+    pthread_mutex_init(&ddb->sync_mutex, NULL);
+    dirty_keys_init(&ddb->synced_keys);
+    backlog_init(&ddb->backlog);
+    ddb->detached = false;
+    ddb->chain = 0;
+    ddb->ring = NULL;
+    ddb->backups = NULL;
+    ddb->n_backups = 0;
+    ddb->quorum = get_env_int("NODEDB_FANOUT_QUORUM", 0);
 }
 
 void ddatabase_destroy(struct TableServerDistributedDatabase* ddb) {
@@ -27,10 +67,648 @@ void ddatabase_destroy(struct TableServerDistributedDatabase* ddb) {
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
+    replication_channel_destroy(ddb->replica);
+    ddb->replica = NULL;
+    for (int i = 0; i < ddb->n_backups; i++)
+        replication_channel_destroy(ddb->backups[i]);
+    destroy_dynamic_memory(ddb->backups);
+    ddb->backups = NULL;
+    ddb->n_backups = 0;
+    memset(&ddb->replication_stats, 0, sizeof(ddb->replication_stats));
+    pthread_rwlock_destroy(&ddb->replica_lock);
+    ddb_set_tail(ddb, NULL);
+    pthread_mutex_destroy(&ddb->tail_mutex);
+    dirty_keys_destroy(&ddb->dirty_keys);
+    pthread_mutex_destroy(&ddb->capture_mutex);
+    pthread_mutex_destroy(&ddb->sync_mutex);
+    dirty_keys_destroy(&ddb->synced_keys);
+    backlog_destroy(&ddb->backlog);
+    hash_ring_destroy(ddb->ring);
+    ddb->ring = NULL;
     database_destroy(ddb->db);
     destroy_dynamic_memory(ddb->db);
-    if (ddb->replica != NULL)
-        rtable_disconnect(ddb->replica);
+}
+
+static void ddb_on_committed(void* arg, uint64_t tag, int status) {
+    struct ddb_commit_t* commit = arg;
+    dirty_keys_clear(&commit->ddb->dirty_keys, commit->key);
+    commit->callback(commit->arg, tag, status);
+    destroy_dynamic_memory(commit);
+}
+
+static struct ddb_commit_t* ddb_commit_create(struct TableServerDistributedDatabase* ddb, char* key,
+    replication_callback_t callback, void* arg) {
+    size_t key_size = strlen(key) + 1;
+    struct ddb_commit_t* commit = create_dynamic_memory(sizeof(struct ddb_commit_t) + key_size);
+    if (assert_error(
+        commit == NULL,
+        "ddb_commit_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    commit->ddb = ddb;
+    commit->callback = callback;
+    commit->arg = arg;
+    memcpy(commit->key, key, key_size);
+    if (dirty_keys_mark(&ddb->dirty_keys, key) == -1) {
+        destroy_dynamic_memory(commit);
+        return NULL;
+    }
+    return commit;
+}
+
+static void ddb_commit_abandon(struct ddb_commit_t* commit) {
+    dirty_keys_clear(&commit->ddb->dirty_keys, commit->key);
+    destroy_dynamic_memory(commit);
+}
+
+// mutation sent to every backup, committed once the quorum acknowledged it and kept dirty until all answered
+struct ddb_fanout_t {
+    struct TableServerDistributedDatabase* ddb;
+    replication_callback_t callback;
+    void* arg;
+    pthread_mutex_t mutex;
+    int pending;                        // backups yet to answer
+    int acked;
+    int quorum;
+    bool committed;                     // callback called
+    char key[];
+};
+
+static struct ddb_fanout_t* ddb_fanout_create(struct TableServerDistributedDatabase* ddb, char* key,
+    replication_callback_t callback, void* arg, int n_backups) {
+    size_t key_size = strlen(key) + 1;
+    struct ddb_fanout_t* fanout = create_dynamic_memory(sizeof(struct ddb_fanout_t) + key_size);
+    if (assert_error(
+        fanout == NULL,
+        "ddb_fanout_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    fanout->ddb = ddb;
+    fanout->callback = callback;
+    fanout->arg = arg;
+    fanout->pending = n_backups;
+    fanout->quorum = ddb->quorum > 0 && ddb->quorum < n_backups ? ddb->quorum : n_backups;
+    memcpy(fanout->key, key, key_size);
+    if (dirty_keys_mark(&ddb->dirty_keys, key) == -1) {
+        destroy_dynamic_memory(fanout);
+        return NULL;
+    }
+    pthread_mutex_init(&fanout->mutex, NULL);
+    return fanout;
+}
+
+static void ddb_fanout_destroy(struct ddb_fanout_t* fanout) {
+    dirty_keys_clear(&fanout->ddb->dirty_keys, fanout->key);
+    pthread_mutex_destroy(&fanout->mutex);
+    destroy_dynamic_memory(fanout);
+}
+
+static void ddb_on_fanned_out(void* arg, uint64_t tag, int status) {
+    struct ddb_fanout_t* fanout = arg;
+    pthread_mutex_lock(&fanout->mutex);
+    fanout->pending--;
+    if (status != -1)
+        fanout->acked++;
+    // committed as soon as the quorum is reached, or failed as soon as it cannot be
+    bool commit = !fanout->committed && (fanout->acked >= fanout->quorum || fanout->acked + fanout->pending < fanout->quorum);
+    if (commit)
+        fanout->committed = true;
+    bool last = fanout->pending == 0;
+    pthread_mutex_unlock(&fanout->mutex);
+
+    if (commit)
+        fanout->callback(fanout->arg, tag, fanout->acked >= fanout->quorum ? 0 : -1);
+    if (last)
+        ddb_fanout_destroy(fanout);
+}
+
+// applies a mutation locally, numbering it if new (chain_seq 0) and logging it for the joining
+// and rejoining servers. Called with replica_lock held
+static int ddb_apply(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, uint64_t* chain_seq) {
+    // copied for the backlog before it is locked
+    struct backlog_mutation_t* mutation = backlog_mutation_create(opcode, key, value);
+    // a joining server gets the mutations in the order they are applied
+    bool capture = ddb->snapshot_logs != NULL;
+    // while copying the table of the predecessor, replicated mutations supersede the copied ones
+    bool syncing = __atomic_load_n(&ddb->syncing, __ATOMIC_ACQUIRE);
+    if (capture)
+        pthread_mutex_lock(&ddb->capture_mutex);
+    if (syncing) {
+        pthread_mutex_lock(&ddb->sync_mutex);
+        dirty_keys_mark(&ddb->synced_keys, key);
+    }
+
+    bool replicated = *chain_seq != 0;
+    *chain_seq = backlog_begin(&ddb->backlog, *chain_seq);
+    int result = 0;
+    if (opcode == MESSAGE_T__OPCODE__OP_PUT)
+        result = db_table_put(ddb->db, key, value);
+    else if (opcode == MESSAGE_T__OPCODE__OP_DEL)
+        result = db_table_remove(ddb->db, key);
+    // a replicated mutation keeps its seq even if it changed nothing here, so that none goes missing
+    bool recorded = result == 0 || replicated;
+    backlog_end(&ddb->backlog, *chain_seq, mutation, recorded);
+    // and goes on down the chain: a server missing the key (see anti_entropy.h) does not hold the delete back
+    if (replicated && result == NOT_FOUND)
+        result = 0;
+    if (capture && recorded) {
+        for (struct snapshot_log_t* log = ddb->snapshot_logs; log != NULL; log = log->next) {
+            if (log->chain < 0)
+                snapshot_log_append(log, *chain_seq, opcode, key, value);
+            // another chain numbers the keys it takes over itself
+            else if (opcode != MESSAGE_T__OPCODE__OP_BAD && hash_ring_lookup(log->ring, key) == log->chain)
+                snapshot_log_append(log, 0, opcode, key, value);
+        }
+    }
+
+    if (syncing)
+        pthread_mutex_unlock(&ddb->sync_mutex);
+    if (capture)
+        pthread_mutex_unlock(&ddb->capture_mutex);
+    return result;
+}
+
+// tells whether key belongs to the chain of this server. Called with replica_lock held
+static bool ddb_holds(struct TableServerDistributedDatabase* ddb, char* key) {
+    return ddb->ring == NULL || ddb->ring->n_chains == 0 || hash_ring_lookup(ddb->ring, key) == ddb->chain;
+}
+
+// applies a mutation locally and sends it to every backup at once (fan-out mode). Called with
+// replica_lock held for reading, which it releases
+static int ddb_fan_out(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag, bool throttle) {
+    int n_backups = ddb->n_backups;
+    struct replication_channel_t* backups[n_backups];
+    int lanes[n_backups];
+    // the mutations of a key take the same lane of every backup, locked in the same order by every writer
+    for (int i = 0; i < n_backups; i++) {
+        backups[i] = ddb->backups[i];
+        lanes[i] = replication_channel_lock_lane(backups[i], key);
+    }
+    struct ddb_fanout_t* fanout = ddb_fanout_create(ddb, key, callback, arg, n_backups);
+    int result = fanout != NULL ? ddb_apply(ddb, opcode, key, value, &chain_seq) : -1;
+    if (result == 0)
+        LOG_DEBUG(DB_FANNING_OUT_OPERATION, n_backups, fanout->quorum);
+    bool ahead[n_backups];
+    for (int i = 0; i < n_backups; i++) {
+        int submit = result == 0 ? replication_channel_submit(backups[i], lanes[i], opcode, key, value, chain_seq, ddb_on_fanned_out, fanout, tag) : -1;
+        bool submitted = submit != -1;
+        ahead[i] = submit == REPLICATION_SUBMITTED_ASYNC;
+        replication_channel_unlock_lane(backups[i], lanes[i]);
+        if (submitted)
+            replication_channel_acquire(backups[i]);
+        else
+            backups[i] = NULL;
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+
+    if (result != 0) {
+        if (fanout != NULL)
+            ddb_fanout_destroy(fanout);
+        return -1;
+    }
+    // a backup not reached counts as a failed one, and a lagging one in async mode as an acknowledging one
+    for (int i = 0; i < n_backups; i++) {
+        if (backups[i] == NULL || ahead[i])
+            ddb_on_fanned_out(fanout, tag, backups[i] == NULL ? -1 : 0);
+    }
+    // the windows are waited on outside the locks so that a full window never stalls acknowledgements
+    for (int i = 0; i < n_backups; i++) {
+        if (backups[i] != NULL) {
+            if (throttle)
+                replication_channel_wait_window(backups[i], lanes[i]);
+            replication_channel_release(backups[i]);
+        }
+    }
+    return DDB_MUTATION_FORWARDED;
+}
+
+// see ddb_mutate; a new mutation of a key of another chain is refused unless any_key, and the
+// windows of the lanes are only waited on if throttle
+static int ddb_mutate_key(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag, bool any_key, bool throttle) {
+    // writers of different lanes proceed concurrently; only a change of next server excludes them
+    pthread_rwlock_rdlock(&ddb->replica_lock);
+    if (!any_key && !ddb_holds(ddb, key)) {
+        pthread_rwlock_unlock(&ddb->replica_lock);
+        LOG_INFO(DB_KEY_MOVED, key);
+        return -1;
+    }
+    if (ddb->n_backups > 0)
+        return ddb_fan_out(ddb, opcode, key, value, chain_seq, callback, arg, tag, throttle);
+    struct replication_channel_t* replica = ddb->replica;
+    int lane = replica != NULL ? replication_channel_lock_lane(replica, key) : -1;
+    // the key turns dirty before the new value is visible, so that no read takes it as committed
+    struct ddb_commit_t* commit = replica != NULL ? ddb_commit_create(ddb, key, callback, arg) : NULL;
+    int result = -1;
+    bool ahead = false;
+    if (replica == NULL || commit != NULL)
+        result = ddb_apply(ddb, opcode, key, value, &chain_seq);
+    if (replica != NULL) {
+        if (result == 0) {
+            // success. forward to the next server
+            LOG_DEBUG(DB_FORWARDING_OPERATION, replica->address, replica->port);
+            result = replication_channel_submit(replica, lane, opcode, key, value, chain_seq, ddb_on_committed, commit, tag);
+            // the next server lags in async mode: committed here without waiting for it
+            ahead = result == REPLICATION_SUBMITTED_ASYNC;
+            if (ahead)
+                result = 0;
+        }
+        if (result != 0 && commit != NULL)
+            ddb_commit_abandon(commit);
+        replication_channel_unlock_lane(replica, lane);
+        if (result == 0)
+            replication_channel_acquire(replica);
+        else
+            replica = NULL;
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+
+    if (replica != NULL) {
+        // the window is waited on outside the locks so that a full window never stalls acknowledgements
+        if (throttle)
+            replication_channel_wait_window(replica, lane);
+        replication_channel_release(replica);
+        if (ahead)
+            ddb_on_committed(commit, tag, 0);
+        return DDB_MUTATION_FORWARDED;
+    }
+    return result == -1 ? -1 : DDB_MUTATION_APPLIED;
+}
+
+int ddb_mutate(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag) {
+    if (assert_error(
+        ddb == NULL || ddb->db == NULL,
+        "ddb_mutate",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the head already checked the keys replicated down the chain
+    return ddb_mutate_key(ddb, opcode, key, value, chain_seq, callback, arg, tag, true, true);
+}
+
+// tells whether channel streams to the server at address_port
+static bool ddb_channel_is(struct replication_channel_t* channel, const char* address_port) {
+    if (channel == NULL)
+        return false;
+
+    char channel_address_port[256];
+    snprintf(channel_address_port, sizeof(channel_address_port), "%s:%d", channel->address, channel->port);
+    return strcmp(channel_address_port, address_port) == 0;
+}
+
+// tells whether the next server (or a backup) is the one at address_port. Called with replica_lock held
+static bool ddb_is_replica(struct TableServerDistributedDatabase* ddb, const char* address_port) {
+    for (int i = 0; i < ddb->n_backups; i++) {
+        if (ddb_channel_is(ddb->backups[i], address_port))
+            return true;
+    }
+    return ddb_channel_is(ddb->replica, address_port);
+}
+
+// closes the logs of the joining servers mutations are now replicated to. Called with replica_lock held for writing
+static void ddb_splice_logs(struct TableServerDistributedDatabase* ddb) {
+    struct snapshot_log_t** link = &ddb->snapshot_logs;
+    while (*link != NULL) {
+        struct snapshot_log_t* log = *link;
+        if (log->chain < 0 && ddb_is_replica(ddb, log->successor)) {
+            *link = log->next;
+            snapshot_log_splice(log, backlog_applied(&ddb->backlog));
+        } else {
+            link = &log->next;
+        }
+    }
+}
+
+void ddb_set_replica(struct TableServerDistributedDatabase* ddb, struct replication_channel_t* replica) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_set_replica",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    replication_channel_replace(ddb->replica, replica);
+    ddb->replica = replica;
+    // a joining server that became the next server gets the following mutations replicated
+    ddb_splice_logs(ddb);
+    pthread_rwlock_unlock(&ddb->replica_lock);
+}
+
+void ddb_set_backups(struct TableServerDistributedDatabase* ddb, char** addresses, int n_addresses) {
+    if (assert_error(
+        ddb == NULL || (addresses == NULL && n_addresses > 0),
+        "ddb_set_backups",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    struct replication_channel_t** backups = n_addresses > 0 ? create_dynamic_memory(n_addresses * sizeof(struct replication_channel_t*)) : NULL;
+    if (assert_error(
+        n_addresses > 0 && backups == NULL,
+        "ddb_set_backups",
+        ERROR_MALLOC
+    )) return;
+
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    // the streams to the backups still in the chain are kept
+    int n_backups = 0;
+    for (int i = 0; i < n_addresses; i++) {
+        struct replication_channel_t* channel = NULL;
+        for (int j = 0; j < ddb->n_backups && channel == NULL; j++) {
+            if (ddb_channel_is(ddb->backups[j], addresses[i])) {
+                channel = ddb->backups[j];
+                ddb->backups[j] = NULL;
+            }
+        }
+        if (channel == NULL)
+            channel = replication_channel_create(addresses[i], &ddb->replication_stats);
+        if (channel != NULL)
+            backups[n_backups++] = channel;
+    }
+    struct replication_channel_t** previous = ddb->backups;
+    int n_previous = ddb->n_backups;
+    ddb->backups = backups;
+    ddb->n_backups = n_backups;
+    // a joining server that became a backup gets the following mutations replicated
+    ddb_splice_logs(ddb);
+    pthread_rwlock_unlock(&ddb->replica_lock);
+
+    // the mutations a backup that left did not acknowledge count as failed there
+    for (int j = 0; j < n_previous; j++) {
+        if (previous[j] != NULL)
+            replication_channel_destroy(previous[j]);
+    }
+    destroy_dynamic_memory(previous);
+}
+
+void ddb_detach(struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_detach",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    // acknowledgements stop before the replica goes: no mutation is taken for applied by the tail
+    __atomic_store_n(&ddb->detached, true, __ATOMIC_RELEASE);
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    struct replication_channel_t* replica = ddb->replica;
+    ddb->replica = NULL;
+    pthread_rwlock_unlock(&ddb->replica_lock);
+    if (replica != NULL)
+        replication_channel_destroy(replica);
+    ddb_set_backups(ddb, NULL, 0);
+}
+
+void ddb_attach(struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_attach",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    __atomic_store_n(&ddb->detached, false, __ATOMIC_RELEASE);
+}
+
+void ddb_capture_start(struct TableServerDistributedDatabase* ddb, struct snapshot_log_t* log, uint64_t since) {
+    if (assert_error(
+        ddb == NULL || log == NULL,
+        "ddb_capture_start",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    // no mutation is being applied while the log is linked
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    log->base = backlog_applied(&ddb->backlog);
+    if (log->chain >= 0) {
+        // the keys moving are those of the chain in the ring with it
+        log->ring = hash_ring_with(ddb->ring, log->chain);
+        if (log->ring == NULL)
+            log->overflowed = true;
+    } else {
+        log->delta = since > 0 && backlog_copy_since(&ddb->backlog, since, log) == 0;
+    }
+    bool spliced = log->chain >= 0 ? hash_ring_contains(ddb->ring, log->chain) : ddb_is_replica(ddb, log->successor);
+    if (spliced) {
+        snapshot_log_splice(log, log->base);
+    } else {
+        log->next = ddb->snapshot_logs;
+        ddb->snapshot_logs = log;
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+}
+
+void ddb_capture_stop(struct TableServerDistributedDatabase* ddb, struct snapshot_log_t* log) {
+    if (assert_error(
+        ddb == NULL || log == NULL,
+        "ddb_capture_stop",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    for (struct snapshot_log_t** link = &ddb->snapshot_logs; *link != NULL; link = &(*link)->next) {
+        if (*link == log) {
+            *link = log->next;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+}
+
+void ddb_set_ring(struct TableServerDistributedDatabase* ddb, struct hash_ring_t* ring) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_set_ring",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    pthread_rwlock_wrlock(&ddb->replica_lock);
+    struct hash_ring_t* previous = ddb->ring;
+    ddb->ring = ring;
+
+    // a chain that joined the ring holds the keys it took over from now on
+    struct snapshot_log_t** link = &ddb->snapshot_logs;
+    while (*link != NULL) {
+        struct snapshot_log_t* log = *link;
+        if (log->chain >= 0 && hash_ring_contains(ring, log->chain)) {
+            *link = log->next;
+            snapshot_log_splice(log, 0);
+        } else {
+            link = &log->next;
+        }
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+    hash_ring_destroy(previous);
+}
+
+void ddb_set_syncing(struct TableServerDistributedDatabase* ddb, bool syncing) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_set_syncing",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    pthread_mutex_lock(&ddb->sync_mutex);
+    __atomic_store_n(&ddb->syncing, syncing, __ATOMIC_RELEASE);
+    if (!syncing) {
+        // forget the keys mutated meanwhile
+        dirty_keys_destroy(&ddb->synced_keys);
+        dirty_keys_init(&ddb->synced_keys);
+    }
+    pthread_mutex_unlock(&ddb->sync_mutex);
+}
+
+int ddb_sync_reset(struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_sync_reset",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // replicated mutations are copied again with the table of the predecessor
+    pthread_mutex_lock(&ddb->sync_mutex);
+    int result = db_table_clear(ddb->db);
+    dirty_keys_destroy(&ddb->synced_keys);
+    dirty_keys_init(&ddb->synced_keys);
+    pthread_mutex_unlock(&ddb->sync_mutex);
+    return result;
+}
+
+int ddb_sync_apply(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, uint64_t chain_seq) {
+    if (assert_error(
+        ddb == NULL || key == NULL,
+        "ddb_sync_apply",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct backlog_mutation_t* mutation = chain_seq != 0 ? backlog_mutation_create(opcode, key, value) : NULL;
+    pthread_mutex_lock(&ddb->sync_mutex);
+    if (chain_seq != 0)
+        backlog_begin(&ddb->backlog, chain_seq);
+    int result = 0;
+    if (opcode != MESSAGE_T__OPCODE__OP_BAD && !dirty_keys_contains(&ddb->synced_keys, key)) {
+        result = opcode == MESSAGE_T__OPCODE__OP_PUT ? db_table_put(ddb->db, key, value) : db_table_remove(ddb->db, key);
+        // a copied delete of a key absent here is not an error
+        result = result == -1 ? -1 : 0;
+    }
+    // superseded by a replicated mutation or not, the logged one was applied in its turn
+    if (chain_seq != 0)
+        backlog_end(&ddb->backlog, chain_seq, mutation, result == 0);
+    pthread_mutex_unlock(&ddb->sync_mutex);
+    return result;
+}
+
+void ddb_set_tail(struct TableServerDistributedDatabase* ddb, struct rtable_t* tail) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_set_tail",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    pthread_mutex_lock(&ddb->tail_mutex);
+    struct rtable_t* previous = ddb->tail;
+    ddb->tail = tail;
+    pthread_mutex_unlock(&ddb->tail_mutex);
+    if (previous != NULL)
+        rtable_disconnect(previous);
+}
+
+// committed value of a dirty key, asked to the tail
+static struct data_t* ddb_tail_get(struct TableServerDistributedDatabase* ddb, char* key) {
+    LOG_DEBUG(DB_READING_FROM_TAIL, key);
+    pthread_mutex_lock(&ddb->tail_mutex);
+    struct data_t* data = ddb->tail != NULL ? rtable_get(ddb->tail, key) : NULL;
+    pthread_mutex_unlock(&ddb->tail_mutex);
+    return data;
+}
+
+int ddb_repair(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, bool* dirty) {
+    if (assert_error(
+        ddb == NULL || key == NULL || dirty == NULL,
+        "ddb_repair",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the key turns dirty before the repaired value is visible, as a forwarded mutation's does
+    pthread_mutex_lock(&ddb->tail_mutex);
+    *dirty = ddb->tail != NULL && dirty_keys_mark(&ddb->dirty_keys, key) == 0;
+    pthread_mutex_unlock(&ddb->tail_mutex);
+    int result = ddb_sync_apply(ddb, opcode, key, value, 0);
+    if (result != 0 && *dirty) {
+        dirty_keys_clear(&ddb->dirty_keys, key);
+        *dirty = false;
+    }
+    return result;
+}
+
+bool ddb_repair_settle(struct TableServerDistributedDatabase* ddb, char* key, bool force) {
+    if (assert_error(
+        ddb == NULL || key == NULL,
+        "ddb_repair_settle",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return false;
+
+    bool committed = force;
+    if (!committed) {
+        pthread_mutex_lock(&ddb->tail_mutex);
+        bool tail = ddb->tail == NULL;
+        pthread_mutex_unlock(&ddb->tail_mutex);
+        struct data_t* local = db_table_get(ddb->db, key);
+        struct data_t* committed_value = tail ? NULL : ddb_tail_get(ddb, key);
+        // this server became the tail, or the tail holds the repaired value
+        committed = tail || (local == NULL && committed_value == NULL) ||
+            (local != NULL && committed_value != NULL && local->datasize == committed_value->datasize &&
+            memcmp(local->data, committed_value->data, local->datasize) == 0);
+        if (local != NULL)
+            data_destroy(local);
+        if (committed_value != NULL)
+            data_destroy(committed_value);
+    }
+    if (committed)
+        dirty_keys_clear(&ddb->dirty_keys, key);
+    return committed;
+}
+
+static void ddb_on_replicated(void* arg, uint64_t tag, int status) {
+    (void)tag;
+    struct ddb_waiter_t* waiter = arg;
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->done = true;
+    waiter->status = status;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+// applies a client mutation, returning once the whole chain applied it
+static int ddb_mutate_and_wait(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value, bool any_key) {
+    struct ddb_waiter_t waiter = { .done = false, .status = -1 };
+    pthread_mutex_init(&waiter.mutex, NULL);
+    pthread_cond_init(&waiter.cond, NULL);
+
+    int result = ddb_mutate_key(ddb, opcode, key, value, 0, ddb_on_replicated, &waiter, 0, any_key, true);
+    if (result == DDB_MUTATION_FORWARDED) {
+        PROBE2(replicate__start, opcode, key);
+        bool sampled = latency_sample(STATS_PHASE_REPLICATION);
+        uint64_t start_ns = sampled || slowlog_active() ? latency_now_ns() : 0;
+        pthread_mutex_lock(&waiter.mutex);
+        while (!waiter.done)
+            pthread_cond_wait(&waiter.cond, &waiter.mutex);
+        pthread_mutex_unlock(&waiter.mutex);
+        if (start_ns != 0) {
+            uint64_t wait_ns = latency_now_ns() - start_ns;
+            slowlog_add(SLOWLOG_REPLICATION, wait_ns);
+            if (sampled)
+                latency_record(latency_op(opcode), STATS_PHASE_REPLICATION, wait_ns);
+        }
+        result = waiter.status;
+        PROBE3(replicate__done, opcode, key, result);
+    }
+
+    pthread_mutex_destroy(&waiter.mutex);
+    pthread_cond_destroy(&waiter.cond);
+    return result == -1 ? -1 : 0;
 }
 
 int ddb_table_put(struct TableServerDistributedDatabase* ddb, char *key, struct data_t *value) {
@@ -40,12 +718,7 @@ int ddb_table_put(struct TableServerDistributedDatabase* ddb, char *key, struct
         ERROR_NULL_POINTER_REFERENCE
     )) return -1; 
 
-    if (db_table_put(ddb->db, key, value) == 0 && ddb->replica != NULL) {
-        // success. forward to remote table
-        printf(DB_FORWARDING_OPERATION, ddb->replica->server_address, ddb->replica->server_port);
-        return rtable_put_with_data(ddb->replica, key, value);
-    }
-    return 0;
+    return ddb_mutate_and_wait(ddb, MESSAGE_T__OPCODE__OP_PUT, key, value, false);
 }
 
 int ddb_table_remove(struct TableServerDistributedDatabase* ddb, char* key) {
@@ -55,12 +728,22 @@ int ddb_table_remove(struct TableServerDistributedDatabase* ddb, char* key) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1; 
 
-    if (db_table_remove(ddb->db, key) == 0 && ddb->replica != NULL) {
-        // success. forward to remote table
-        printf(DB_FORWARDING_OPERATION, ddb->replica->server_address, ddb->replica->server_port);
-        return rtable_del(ddb->replica, key);
-    }
-    return 0; 
+    return ddb_mutate_and_wait(ddb, MESSAGE_T__OPCODE__OP_DEL, key, NULL, false);
+}
+
+int ddb_table_mutate(struct TableServerDistributedDatabase* ddb, MessageT__Opcode opcode, char* key, struct data_t* value,
+    replication_callback_t callback, void* arg) {
+    if (assert_error(
+        ddb == NULL || ddb->db == NULL || key == NULL || callback == NULL,
+        "ddb_table_mutate",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // every mutation in flight holds up a client until acknowledged, which bounds them as the windows would
+    int result = ddb_mutate_key(ddb, opcode, key, value, 0, callback, arg, 0, false, false);
+    if (result == DDB_MUTATION_FORWARDED)
+        PROBE2(replicate__start, opcode, key);
+    return result;
 }
 
 struct data_t* ddb_table_get(struct TableServerDistributedDatabase* ddb, char *key) {
@@ -70,7 +753,35 @@ struct data_t* ddb_table_get(struct TableServerDistributedDatabase* ddb, char *k
         ERROR_NULL_POINTER_REFERENCE
     )) return NULL; 
 
-    return db_table_get(ddb->db, key);
+    // the key is checked after the local read: clean then, the value read was committed
+    struct data_t* data = db_table_get(ddb->db, key);
+    if (dirty_keys_contains(&ddb->dirty_keys, key)) {
+        if (data != NULL)
+            data_destroy(data);
+        data = ddb_tail_get(ddb, key);
+    }
+    return data;
+}
+
+int ddb_table_read(struct TableServerDistributedDatabase* ddb, char* key, void* buffer, int capacity) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_table_read",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1; 
+
+    int size = db_table_read(ddb->db, key, buffer, capacity);
+    if (!dirty_keys_contains(&ddb->dirty_keys, key))
+        return size;
+
+    struct data_t* data = ddb_tail_get(ddb, key);
+    if (data == NULL)
+        return -1;
+    size = data->datasize <= capacity ? data->datasize : -2;
+    if (size >= 0)
+        memcpy(buffer, data->data, size);
+    data_destroy(data);
+    return size;
 }
 
 int ddb_table_size(struct TableServerDistributedDatabase* ddb) {
@@ -91,4 +802,51 @@ char** ddb_table_get_keys(struct TableServerDistributedDatabase* ddb) {
     )) return NULL;
 
     return db_table_get_keys(ddb->db);
-}
\ No newline at end of file
+}
+
+int ddb_purge(struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        ddb == NULL,
+        "ddb_purge",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    char** keys = db_table_get_keys(ddb->db);
+    if (keys == NULL)
+        return -1;
+
+    int purged = 0;
+    for (int i = 0; keys[i] != NULL; i++) {
+        pthread_rwlock_rdlock(&ddb->replica_lock);
+        bool held = ddb_holds(ddb, keys[i]);
+        pthread_rwlock_unlock(&ddb->replica_lock);
+        // deleted down the chain too, like a client would
+        if (!held && ddb_mutate_and_wait(ddb, MESSAGE_T__OPCODE__OP_DEL, keys[i], NULL, true) == 0)
+            purged++;
+    }
+    table_free_keys(keys);
+    return purged;
+}
+
+int ddb_replication_lag(struct TableServerDistributedDatabase* ddb, struct replication_lag_t* lags, char** addresses, int max) {
+    if (assert_error(
+        ddb == NULL || lags == NULL || addresses == NULL,
+        "ddb_replication_lag",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pthread_rwlock_rdlock(&ddb->replica_lock);
+    int n = 0;
+    for (int i = -1; i < ddb->n_backups && n < max; i++) {
+        struct replication_channel_t* channel = i < 0 ? ddb->replica : ddb->backups[i];
+        if (channel == NULL)
+            continue;
+        char address_port[256];
+        snprintf(address_port, sizeof(address_port), "%s:%d", channel->address, channel->port);
+        addresses[n] = strdup(address_port);
+        replication_channel_lag(channel, &lags[n]);
+        n++;
+    }
+    pthread_rwlock_unlock(&ddb->replica_lock);
+    return n;
+}
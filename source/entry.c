@@ -13,14 +13,15 @@ struct entry_t *entry_create(char *key, struct data_t *data) {
     )) return NULL;
 
     // allocate memory for entry
-    struct entry_t* entry = create_dynamic_memory(sizeof(struct entry_t));
+    struct entry_t* entry = create_tagged_memory(MEMORY_NODES, sizeof(struct entry_t));
     if (assert_error(
         entry == NULL,
         "entry_create",
         ERROR_MALLOC
     )) return NULL;
 
-    // update struct with given pointers
+    // update struct with given pointers, the key being counted from now on
+    memory_account(MEMORY_KEYS, key, true);
     entry->key = key;
     entry->value = data;
     return entry;
@@ -67,7 +68,7 @@ enum MemoryOperationStatus entry_cleanup(struct entry_t* entry) {
     )) return M_ERROR;
 
     // destroy key
-    destroy_dynamic_memory(entry->key);
+    destroy_tagged_memory(MEMORY_KEYS, entry->key);
     // destroy data
     if (assert_error(
         data_destroy(entry->value) == M_ERROR,
@@ -87,7 +88,7 @@ int entry_destroy(struct entry_t *entry) {
         return M_ERROR;
 
     // destroy memory of the struct itself and return M_OK
-    destroy_dynamic_memory(entry);
+    destroy_tagged_memory(MEMORY_NODES, entry);
     return M_OK;
 }
 
@@ -138,6 +139,7 @@ int entry_replace(struct entry_t *entry, char *new_key, struct data_t *new_value
         return M_ERROR;
 
     // update key and value with given new key-value
+    memory_account(MEMORY_KEYS, new_key, true);
     entry->key = new_key;
     entry->value = new_value;
     return M_OK;
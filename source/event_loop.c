@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+
+#include "event_loop.h"
+
+#include "server_connection.h"
+#include "network_server.h"
+#include "network_server-private.h"
+#include "client_executor.h"
+#include "database.h"
+#include "uring.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+enum IOBackend io_backend_parse(char* name) {
+    if (name != NULL && strcmp(name, "threads") == 0)
+        return IO_BACKEND_THREADS;
+    if (name != NULL && strcmp(name, "epoll") == 0)
+        return IO_BACKEND_EPOLL;
+    if (name != NULL && strcmp(name, "uring") == 0)
+        return IO_BACKEND_URING;
+
+    assert_error(
+        true,
+        "io_backend_parse",
+        EVENT_LOOP_UNKNOWN_BACKEND
+    );
+    return IO_BACKEND_THREADS;
+}
+
+char* io_backend_name(enum IOBackend backend) {
+    switch (backend) {
+        case IO_BACKEND_EPOLL:
+            return "epoll";
+        case IO_BACKEND_URING:
+            return "uring";
+        default:
+            return "threads";
+    }
+}
+
+int event_loop_run(int listening_socket, struct TableServerDistributedDatabase* ddb, enum IOBackend backend) {
+    if (backend == IO_BACKEND_THREADS)
+        return network_main_loop(listening_socket, ddb);
+
+    signal(SIGPIPE, SIG_IGN);
+    if (backend == IO_BACKEND_URING) {
+        if (uring_main_loop(listening_socket, ddb) != URING_UNSUPPORTED)
+            return -1;
+        LOG_WARN(EVENT_LOOP_URING_FALLBACK);
+    }
+    return epoll_main_loop(listening_socket, ddb);
+}
+
+#ifndef EPOLL_BACKEND
+// ====================================================================================================
+//                                          Epoll Backend
+// ====================================================================================================
+
+static void epoll_close_client(int epoll_fd, struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb) {
+    // a connection whose write is pending is kept until the chain acknowledges it
+    if (conn->pending.pending) {
+        if (!conn->closing)
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+        conn->closing = true;
+        return;
+    }
+    // closing the socket also removes it from the epoll interest list
+    server_connection_destroy(conn);
+    LOG_INFO(CLIENT_CONNECTION_CLOSED);
+    db_decrement_active_clients(ddb->db);
+}
+
+// the replication stream of the predecessor is served by a thread of its own
+static void epoll_hand_off_client(int epoll_fd, struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    server_connection_start_replication(conn, ddb);
+    db_decrement_active_clients(ddb->db);
+}
+
+static void epoll_accept_clients(int epoll_fd, int listening_socket, struct server_completions_t* completions,
+    struct TableServerDistributedDatabase* ddb) {
+    while (true) {
+        int client_socket = accept4(listening_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_ERROR(SERVER_FAILED_CONNECTION);
+            return;
+        }
+
+        set_no_delay(client_socket);
+        struct ServerConnection* conn = server_connection_create(client_socket, NULL, 0, completions);
+        if (conn == NULL) {
+            close(client_socket);
+            continue;
+        }
+
+        // edge-triggered: both directions are drained until EAGAIN on every notification
+        struct epoll_event event = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = conn };
+        if (assert_error(
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &event) < 0,
+            "epoll_accept_clients",
+            "Failed to register client socket.\n"
+        )) {
+            server_connection_destroy(conn);
+            continue;
+        }
+
+        db_increment_active_clients(ddb->db);
+        LOG_INFO(CLIENT_CONNECTION_OK);
+    }
+}
+
+// returns -1 if the connection must be closed
+static int epoll_flush_client(struct ServerConnection* conn) {
+    while (conn->tx_length > 0) {
+        ssize_t n = send(conn->fd, conn->tx_buffer, conn->tx_length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        server_connection_tx_consume(conn, n);
+    }
+    return 0;
+}
+
+// returns -1 if the connection must be closed, or EVENT_LOOP_HANDED_OFF if it must be handed over
+static int epoll_handle_client(struct ServerConnection* conn, uint32_t events, struct TableServerDistributedDatabase* ddb) {
+    if (events & EPOLLERR)
+        return -1;
+
+    bool peer_closed = false;
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        while (true) {
+            size_t available;
+            uint8_t* space = server_connection_rx_space(conn, &available);
+            if (space == NULL)
+                return -1;
+
+            ssize_t n = recv(conn->fd, space, available, 0);
+            if (n > 0) {
+                server_connection_rx_commit(conn, n);
+                continue;
+            }
+            if (n == 0) {
+                peer_closed = true;
+                break;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+
+        // every request read in this wake-up is answered with a single flush
+        if (server_connection_process(conn, ddb) == -1)
+            return -1;
+        if (conn->replication)
+            return EVENT_LOOP_HANDED_OFF;
+    }
+
+    if (epoll_flush_client(conn) == -1)
+        return -1;
+    return peer_closed ? -1 : 0;
+}
+
+static void epoll_dispatch_client(int epoll_fd, struct ServerConnection* conn, int result, struct TableServerDistributedDatabase* ddb) {
+    if (result == -1)
+        epoll_close_client(epoll_fd, conn, ddb);
+    else if (result == EVENT_LOOP_HANDED_OFF)
+        epoll_hand_off_client(epoll_fd, conn, ddb);
+}
+
+// answers the writes the chain acknowledged, then the requests received in the meantime
+static void epoll_complete_clients(int epoll_fd, struct server_completions_t* completions, struct TableServerDistributedDatabase* ddb) {
+    struct ServerConnection* conn = server_completions_take(completions);
+    while (conn != NULL) {
+        struct ServerConnection* next = conn->next_completed;
+        int result = server_connection_complete(conn, ddb);
+        if (conn->closing) {
+            result = -1;
+        } else if (result == 0) {
+            result = server_connection_process(conn, ddb) == -1 ? -1
+                : conn->replication ? EVENT_LOOP_HANDED_OFF
+                : epoll_flush_client(conn);
+        }
+        epoll_dispatch_client(epoll_fd, conn, result, ddb);
+        conn = next;
+    }
+}
+
+int epoll_main_loop(int listening_socket, struct TableServerDistributedDatabase* ddb) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (assert_error(
+        epoll_fd < 0,
+        "epoll_main_loop",
+        "Failed to create epoll instance.\n"
+    )) return -1;
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (assert_error(
+        set_non_blocking(listening_socket) == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listening_socket, &event) < 0,
+        "epoll_main_loop",
+        "Failed to register listening socket.\n"
+    )) return close_and_return_failure(epoll_fd);
+
+    // the writes waiting for the chain are answered from this thread too, once acknowledged
+    struct server_completions_t completions;
+    if (server_completions_init(&completions) == -1)
+        return close_and_return_failure(epoll_fd);
+    struct epoll_event completion_event = { .events = EPOLLIN, .data.ptr = &completions };
+    if (assert_error(
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, completions.event_fd, &completion_event) < 0,
+        "epoll_main_loop",
+        "Failed to register the completion eventfd.\n"
+    )) {
+        server_completions_destroy(&completions);
+        return close_and_return_failure(epoll_fd);
+    }
+
+    LOG_INFO(EVENT_LOOP_STARTED, io_backend_name(IO_BACKEND_EPOLL));
+    LOG_INFO(SERVER_WAITING_FOR_CONNECTIONS);
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    while (true) {
+        int n_events = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, -1);
+        if (n_events < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        bool completed = false;
+        for (int i = 0; i < n_events; i++) {
+            struct ServerConnection* conn = events[i].data.ptr;
+            if (conn == NULL) {
+                epoll_accept_clients(epoll_fd, listening_socket, &completions, ddb);
+                continue;
+            }
+            if (events[i].data.ptr == &completions) {
+                completed = true;
+                continue;
+            }
+
+            epoll_dispatch_client(epoll_fd, conn, epoll_handle_client(conn, events[i].events, ddb), ddb);
+        }
+        // after the events, which may refer to the connections closed by completing their writes
+        if (completed)
+            epoll_complete_clients(epoll_fd, &completions, ddb);
+    }
+    server_completions_destroy(&completions);
+    return close_and_return_failure(epoll_fd);
+}
+
+#endif
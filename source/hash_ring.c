@@ -0,0 +1,120 @@
+#include "hash_ring.h"
+
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// splitmix64 spreads close vnode numbers over the whole ring
+static uint64_t hash_point(int chain, int vnode) {
+    return hash_mix64(((uint64_t)(uint32_t)chain << 32 | (uint32_t)vnode) + 1);
+}
+
+static int compare_chains(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_points(const void* a, const void* b) {
+    const struct hash_ring_point_t* x = a;
+    const struct hash_ring_point_t* y = b;
+    if (x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+    // equal hashes (unlikely) still order the same way everywhere
+    return compare_chains(&x->chain, &y->chain);
+}
+
+struct hash_ring_t* hash_ring_create(const int* chains, int n_chains) {
+    if (assert_error(
+        chains == NULL && n_chains > 0,
+        "hash_ring_create",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    struct hash_ring_t* ring = create_dynamic_memory(sizeof(struct hash_ring_t));
+    if (assert_error(
+        ring == NULL,
+        "hash_ring_create",
+        ERROR_MALLOC
+    )) return NULL;
+    if (n_chains <= 0)
+        return ring;
+
+    ring->chains = create_dynamic_memory(n_chains * sizeof(int));
+    ring->points = create_dynamic_memory(n_chains * HASH_RING_VNODES * sizeof(struct hash_ring_point_t));
+    if (assert_error(
+        ring->chains == NULL || ring->points == NULL,
+        "hash_ring_create",
+        ERROR_MALLOC
+    )) {
+        hash_ring_destroy(ring);
+        return NULL;
+    }
+
+    memcpy(ring->chains, chains, n_chains * sizeof(int));
+    qsort(ring->chains, n_chains, sizeof(int), compare_chains);
+    for (int i = 0; i < n_chains; i++) {
+        if (ring->n_chains > 0 && ring->chains[ring->n_chains - 1] == ring->chains[i])
+            continue;
+        ring->chains[ring->n_chains++] = ring->chains[i];
+    }
+
+    for (int i = 0; i < ring->n_chains; i++) {
+        for (int vnode = 0; vnode < HASH_RING_VNODES; vnode++) {
+            ring->points[ring->n_points].hash = hash_point(ring->chains[i], vnode);
+            ring->points[ring->n_points].chain = ring->chains[i];
+            ring->n_points++;
+        }
+    }
+    qsort(ring->points, ring->n_points, sizeof(struct hash_ring_point_t), compare_points);
+    return ring;
+}
+
+struct hash_ring_t* hash_ring_with(const struct hash_ring_t* ring, int chain) {
+    int n_chains = ring != NULL ? ring->n_chains : 0;
+    int* chains = create_dynamic_memory((n_chains + 1) * sizeof(int));
+    if (assert_error(
+        chains == NULL,
+        "hash_ring_with",
+        ERROR_MALLOC
+    )) return NULL;
+
+    if (n_chains > 0)
+        memcpy(chains, ring->chains, n_chains * sizeof(int));
+    chains[n_chains] = chain;
+    struct hash_ring_t* with = hash_ring_create(chains, n_chains + 1);
+    destroy_dynamic_memory(chains);
+    return with;
+}
+
+void hash_ring_destroy(struct hash_ring_t* ring) {
+    if (ring == NULL)
+        return;
+
+    destroy_dynamic_memory(ring->chains);
+    destroy_dynamic_memory(ring->points);
+    destroy_dynamic_memory(ring);
+}
+
+bool hash_ring_contains(const struct hash_ring_t* ring, int chain) {
+    if (ring == NULL || ring->n_chains == 0)
+        return false;
+    return bsearch(&chain, ring->chains, ring->n_chains, sizeof(int), compare_chains) != NULL;
+}
+
+int hash_ring_lookup(const struct hash_ring_t* ring, const char* key) {
+    if (ring == NULL || ring->n_points == 0 || key == NULL)
+        return -1;
+
+    // first point at or after the hash of the key
+    uint64_t hash = hash_string(key, NULL);
+    int low = 0, high = ring->n_points;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (ring->points[middle].hash < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return ring->points[low == ring->n_points ? 0 : low].chain;
+}
@@ -0,0 +1,165 @@
+#include "hotkeys.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t sketches[HOTKEYS_MEASURES][HOTKEYS_DEPTH][HOTKEYS_WIDTH];
+static struct hotkeys_top_t tops[HOTKEYS_MEASURES];
+static pthread_mutex_t tops_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int sample_rate = HOTKEYS_DEFAULT_SAMPLE;
+static pthread_once_t sample_once = PTHREAD_ONCE_INIT;
+static __thread uint32_t local_random = 0;      // xorshift state of the thread, 0 until seeded
+
+static void sample_rate_init(void) {
+    int rate = get_env_int("NODEDB_HOTKEYS_SAMPLE", HOTKEYS_DEFAULT_SAMPLE);
+    sample_rate = rate > 1 ? rate : 1;
+}
+
+// whether the calling thread counts this operation: one in rate, at random
+static bool hotkeys_sample(int rate) {
+    if (rate == 1)
+        return true;
+    if (local_random == 0)
+        local_random = (uint32_t)(uintptr_t)&local_random | 1;
+    local_random ^= local_random << 13;
+    local_random ^= local_random >> 17;
+    local_random ^= local_random << 5;
+    return local_random % rate == 0;
+}
+
+// counters of a key of that hash in every row (double hashing of the two halves of the hash)
+static void hotkeys_columns(uint64_t hash, uint32_t* columns) {
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    for (int row = 0; row < HOTKEYS_DEPTH; row++)
+        columns[row] = (h1 + row * h2) & (HOTKEYS_WIDTH - 1);
+}
+
+// adds to the counters of the key, returning its new estimate
+static uint64_t sketch_add(enum HotkeysMeasure measure, uint32_t* columns, uint64_t amount) {
+    uint64_t estimate = UINT64_MAX;
+    for (int row = 0; row < HOTKEYS_DEPTH; row++) {
+        uint64_t count = __atomic_add_fetch(&sketches[measure][row][columns[row]], amount, __ATOMIC_RELAXED);
+        if (count < estimate)
+            estimate = count;
+    }
+    return estimate;
+}
+
+static uint64_t sketch_estimate(enum HotkeysMeasure measure, uint32_t* columns) {
+    uint64_t estimate = UINT64_MAX;
+    for (int row = 0; row < HOTKEYS_DEPTH; row++) {
+        uint64_t count = __atomic_load_n(&sketches[measure][row][columns[row]], __ATOMIC_RELAXED);
+        if (count < estimate)
+            estimate = count;
+    }
+    return estimate;
+}
+
+// updates the estimates of the key in the heavy hitters by a measure, under tops_mutex
+static void top_update(struct hotkeys_top_t* top, enum HotkeysMeasure measure, const char* key,
+    uint64_t hash, size_t length, uint64_t* estimates) {
+    int smallest = 0;
+    for (int i = 0; i < top->n; i++) {
+        if (top->entries[i].hash == hash && top->entries[i].length == length) {
+            memcpy(top->entries[i].estimates, estimates, sizeof(top->entries[i].estimates));
+            smallest = -1;
+            break;
+        }
+        if (top->entries[i].estimates[measure] < top->entries[smallest].estimates[measure])
+            smallest = i;
+    }
+
+    if (smallest != -1) {
+        // a new key: appended, or in place of the smallest if it has a larger estimate
+        int slot = top->n < HOTKEYS_TOP ? top->n++
+            : estimates[measure] > top->entries[smallest].estimates[measure] ? smallest : -1;
+        if (slot == -1)
+            return;
+        struct hotkeys_entry_t* entry = &top->entries[slot];
+        entry->hash = hash;
+        entry->length = length;
+        strncpy(entry->key, key, HOTKEYS_KEY_SIZE - 1);
+        entry->key[HOTKEYS_KEY_SIZE - 1] = '\0';
+        memcpy(entry->estimates, estimates, sizeof(entry->estimates));
+    }
+
+    uint64_t min = UINT64_MAX;
+    for (int i = 0; top->n == HOTKEYS_TOP && i < top->n; i++) {
+        if (top->entries[i].estimates[measure] < min)
+            min = top->entries[i].estimates[measure];
+    }
+    __atomic_store_n(&top->min, top->n == HOTKEYS_TOP ? min : 0, __ATOMIC_RELAXED);
+}
+
+void hotkeys_count(const char* key, uint64_t bytes) {
+    pthread_once(&sample_once, sample_rate_init);
+    if (key == NULL || !hotkeys_sample(sample_rate))
+        return;
+
+    size_t length;
+    uint64_t hash = hash_string(key, &length);
+    uint32_t columns[HOTKEYS_DEPTH];
+    hotkeys_columns(hash, columns);
+    uint64_t estimates[HOTKEYS_MEASURES] = {
+        sketch_add(HOTKEYS_OPS, columns, sample_rate),
+        bytes > 0 ? sketch_add(HOTKEYS_BYTES, columns, bytes * sample_rate) : sketch_estimate(HOTKEYS_BYTES, columns)
+    };
+
+    bool candidate = false;
+    for (int m = 0; m < HOTKEYS_MEASURES; m++)
+        candidate |= estimates[m] > __atomic_load_n(&tops[m].min, __ATOMIC_RELAXED);
+    if (!candidate || pthread_mutex_trylock(&tops_mutex) != 0)
+        return;
+    for (int m = 0; m < HOTKEYS_MEASURES; m++) {
+        if (estimates[m] > tops[m].min)
+            top_update(&tops[m], m, key, hash, length, estimates);
+    }
+    pthread_mutex_unlock(&tops_mutex);
+}
+
+int hotkeys_fetch(struct hot_key_t** keys, bool reset) {
+    if (assert_error(
+        keys == NULL,
+        "hotkeys_fetch",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the keys of both lists, once each, with the latest of their estimates
+    struct hotkeys_entry_t entries[HOTKEYS_MEASURES * HOTKEYS_TOP];
+    int n = 0;
+    pthread_mutex_lock(&tops_mutex);
+    for (int m = 0; m < HOTKEYS_MEASURES; m++) {
+        for (int i = 0; i < tops[m].n; i++) {
+            struct hotkeys_entry_t* entry = &tops[m].entries[i];
+            int j = 0;
+            while (j < n && (entries[j].hash != entry->hash || entries[j].length != entry->length))
+                j++;
+            if (j == n)
+                entries[n++] = *entry;
+            for (int k = 0; k < HOTKEYS_MEASURES; k++) {
+                if (entry->estimates[k] > entries[j].estimates[k])
+                    entries[j].estimates[k] = entry->estimates[k];
+            }
+        }
+    }
+
+    if (reset) {
+        memset(tops, 0, sizeof(tops));
+        for (int m = 0; m < HOTKEYS_MEASURES; m++)
+            for (int row = 0; row < HOTKEYS_DEPTH; row++)
+                for (int column = 0; column < HOTKEYS_WIDTH; column++)
+                    __atomic_store_n(&sketches[m][row][column], 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&tops_mutex);
+
+    *keys = n > 0 ? create_dynamic_memory(n * sizeof(struct hot_key_t)) : NULL;
+    for (int i = 0; *keys != NULL && i < n; i++) {
+        (*keys)[i].key = strdup(entries[i].key);
+        (*keys)[i].ops = entries[i].estimates[HOTKEYS_OPS];
+        (*keys)[i].bytes = entries[i].estimates[HOTKEYS_BYTES];
+    }
+    return n > 0 && *keys == NULL ? -1 : n;
+}
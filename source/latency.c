@@ -0,0 +1,168 @@
+#include "latency.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static pthread_mutex_t shards_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct latency_shard_t* shards = NULL;    // of the running threads
+static struct latency_shard_t retired;           // of the threads that exited
+static pthread_key_t shard_key;
+static pthread_once_t shard_once = PTHREAD_ONCE_INIT;
+static __thread struct latency_shard_t* local_shard = NULL;
+static int sample_rate = LATENCY_DEFAULT_SAMPLE;
+static pthread_once_t sample_once = PTHREAD_ONCE_INIT;
+static __thread int local_countdown[STATS_PHASES];  // operations left before the next one timed
+
+// adds the counters of the shard up; the owner may still be recording
+static void shard_add_counters(long long* op_counter, long long* computed_time_ns, struct latency_shard_t* shard) {
+    *op_counter += __atomic_load_n(&shard->op_counter, __ATOMIC_RELAXED);
+    *computed_time_ns += __atomic_load_n(&shard->computed_time_ns, __ATOMIC_RELAXED);
+}
+
+// adds the shard up into histograms; the owner may still be recording
+static void shard_add(struct stats_histogram_t* histograms, struct latency_shard_t* shard) {
+    for (int h = 0; h < STATS_OPS * STATS_PHASES; h++) {
+        struct stats_histogram_t* from = &shard->histograms[h];
+        struct stats_histogram_t* into = &histograms[h];
+        for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+            into->buckets[i] += __atomic_load_n(&from->buckets[i], __ATOMIC_RELAXED);
+        into->sum_ns += __atomic_load_n(&from->sum_ns, __ATOMIC_RELAXED);
+        long long max_ns = __atomic_load_n(&from->max_ns, __ATOMIC_RELAXED);
+        if (max_ns > into->max_ns)
+            into->max_ns = max_ns;
+    }
+}
+
+static void shard_retire(void* _shard) {
+    struct latency_shard_t* shard = _shard;
+    pthread_mutex_lock(&shards_mutex);
+    struct latency_shard_t** link = &shards;
+    while (*link != NULL && *link != shard)
+        link = &(*link)->next;
+    if (*link != NULL)
+        *link = shard->next;
+    shard_add_counters(&retired.op_counter, &retired.computed_time_ns, shard);
+    shard_add(retired.histograms, shard);
+    pthread_mutex_unlock(&shards_mutex);
+    free(shard);
+}
+
+static void shard_key_create(void) {
+    pthread_key_create(&shard_key, shard_retire);
+}
+
+static struct latency_shard_t* shard_of_thread() {
+    if (local_shard != NULL)
+        return local_shard;
+
+    pthread_once(&shard_once, shard_key_create);
+    struct latency_shard_t* shard = NULL;
+    if (assert_error(
+        posix_memalign((void**)&shard, 64, sizeof(struct latency_shard_t)) != 0,
+        "shard_of_thread",
+        ERROR_MALLOC
+    )) return NULL;
+
+    memset(shard, 0, sizeof(struct latency_shard_t));
+    pthread_mutex_lock(&shards_mutex);
+    shard->next = shards;
+    shards = shard;
+    pthread_mutex_unlock(&shards_mutex);
+    pthread_setspecific(shard_key, shard);
+    local_shard = shard;
+    return shard;
+}
+
+static void sample_rate_init(void) {
+    int rate = get_env_int("NODEDB_TIMING_SAMPLE", LATENCY_DEFAULT_SAMPLE);
+    sample_rate = rate > 1 ? rate : 1;
+}
+
+int latency_sample_rate() {
+    pthread_once(&sample_once, sample_rate_init);
+    return sample_rate;
+}
+
+bool latency_sample(enum StatsPhase phase) {
+    int rate = latency_sample_rate();
+    if (rate == 1 || phase < 0 || phase >= STATS_PHASES)
+        return true;
+    if (local_countdown[phase] > 0) {
+        local_countdown[phase]--;
+        return false;
+    }
+    local_countdown[phase] = rate - 1;
+    return true;
+}
+
+uint64_t latency_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+enum StatsOp latency_op(MessageT__Opcode opcode) {
+    switch (opcode) {
+        case MESSAGE_T__OPCODE__OP_PUT: return STATS_OP_PUT;
+        case MESSAGE_T__OPCODE__OP_GET: return STATS_OP_GET;
+        case MESSAGE_T__OPCODE__OP_DEL: return STATS_OP_DEL;
+        case MESSAGE_T__OPCODE__OP_SIZE: return STATS_OP_SIZE;
+        case MESSAGE_T__OPCODE__OP_GETKEYS: return STATS_OP_GETKEYS;
+        case MESSAGE_T__OPCODE__OP_GETTABLE: return STATS_OP_GETTABLE;
+        default: return STATS_OP_OTHER;
+    }
+}
+
+void latency_record(enum StatsOp op, enum StatsPhase phase, uint64_t latency_ns) {
+    struct latency_shard_t* shard = shard_of_thread();
+    if (shard == NULL || op < 0 || op >= STATS_OPS || phase < 0 || phase >= STATS_PHASES)
+        return;
+
+    // the only writer: plain increments, stored atomically for latency_merge()
+    struct stats_histogram_t* histogram = &shard->histograms[op * STATS_PHASES + phase];
+    long long* bucket = &histogram->buckets[stats_histogram_index(latency_ns)];
+    __atomic_store_n(bucket, *bucket + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->sum_ns, histogram->sum_ns + (long long)latency_ns, __ATOMIC_RELAXED);
+    if ((long long)latency_ns > histogram->max_ns)
+        __atomic_store_n(&histogram->max_ns, (long long)latency_ns, __ATOMIC_RELAXED);
+}
+
+void latency_count_op() {
+    struct latency_shard_t* shard = shard_of_thread();
+    if (shard != NULL)
+        __atomic_store_n(&shard->op_counter, shard->op_counter + 1, __ATOMIC_RELAXED);
+}
+
+void latency_add_computed_time(long long ns) {
+    struct latency_shard_t* shard = shard_of_thread();
+    if (shard != NULL)
+        __atomic_store_n(&shard->computed_time_ns, shard->computed_time_ns + ns, __ATOMIC_RELAXED);
+}
+
+void latency_counters(long long* op_counter, long long* computed_time_micros) {
+    long long ops = 0, ns = 0;
+    pthread_mutex_lock(&shards_mutex);
+    shard_add_counters(&ops, &ns, &retired);
+    for (struct latency_shard_t* shard = shards; shard != NULL; shard = shard->next)
+        shard_add_counters(&ops, &ns, shard);
+    pthread_mutex_unlock(&shards_mutex);
+    if (op_counter != NULL)
+        *op_counter = ops;
+    if (computed_time_micros != NULL)
+        *computed_time_micros = ns / 1000;
+}
+
+void latency_merge(struct stats_histogram_t* histograms) {
+    if (histograms == NULL)
+        return;
+
+    memset(histograms, 0, STATS_OPS * STATS_PHASES * sizeof(struct stats_histogram_t));
+    pthread_mutex_lock(&shards_mutex);
+    shard_add(histograms, &retired);
+    for (struct latency_shard_t* shard = shards; shard != NULL; shard = shard->next)
+        shard_add(histograms, shard);
+    pthread_mutex_unlock(&shards_mutex);
+}
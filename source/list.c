@@ -13,7 +13,7 @@ struct node_t* node_create(struct entry_t *entry, struct node_t *next) {
     )) return NULL;
 
     // allocate memory for node
-    struct node_t* node = create_dynamic_memory(sizeof(struct node_t));
+    struct node_t* node = create_tagged_memory(MEMORY_NODES, sizeof(struct node_t));
     if (assert_error(
         node == NULL,
         "node_create",
@@ -38,7 +38,7 @@ enum MemoryOperationStatus node_destroy(struct node_t *node) {
         return M_ERROR;
 
     // destroy node struct
-    destroy_dynamic_memory(node);
+    destroy_tagged_memory(MEMORY_NODES, node);
     
     return M_OK;
 }
@@ -156,7 +156,7 @@ int list_add(struct list_t *list, struct entry_t *entry) {
             return ADD_ERROR;
         case REPLACED:
             // if the entry was replaced during insertion, destroy new_node struct and return REPLACED
-            destroy_dynamic_memory(new_node);
+            destroy_tagged_memory(MEMORY_NODES, new_node);
             return REPLACED;
         case ADDED:
             // if the entry was successfully added, return ADDED
@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+
+#include "local_transport.h"
+
+#include "client_executor.h"
+#include "network_server-private.h"
+#include "table_skel.h"
+#include "database.h"
+#include "shm_ring.h"
+#include "address.h"
+#include "message.h"
+#include "utils.h"
+#include "logger.h"
+#include "slowlog.h"
+#include "probes.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// tells whether a server accepts connections on path (a path left behind is refused, or absent)
+static bool local_socket_in_use(struct sockaddr_un* addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    bool in_use = connect(fd, (struct sockaddr*)addr, sizeof(*addr)) == 0 || (errno != ECONNREFUSED && errno != ENOENT);
+    close(fd);
+    return in_use;
+}
+
+int local_transport_init(int port) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (local_socket_path(port, addr.sun_path, sizeof(addr.sun_path)) == -1)
+        return -1;
+
+    // the path may be left behind by a previous server on the same port, but not taken from a
+    // running one
+    if (assert_error(
+        local_socket_in_use(&addr),
+        "local_transport_init",
+        LOCAL_TRANSPORT_IN_USE
+    )) return -1;
+    unlink(addr.sun_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (assert_error(
+        fd < 0,
+        "local_transport_init",
+        "Failed to create unix socket.\n"
+    )) return -1;
+    if (assert_error(
+        bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0,
+        "local_transport_init",
+        "Failed to bind unix socket.\n"
+    )) return close_and_return_failure(fd);
+
+    if (assert_error(
+        listen(fd, SOMAXCONN) < 0,
+        "local_transport_init",
+        "Failed to listen to unix socket.\n"
+    )) {
+        unlink(addr.sun_path);
+        return close_and_return_failure(fd);
+    }
+
+    LOG_INFO(LOCAL_TRANSPORT_LISTENING, addr.sun_path);
+    return fd;
+}
+
+void local_transport_close(int listening_socket, int port) {
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    close(listening_socket);
+    if (local_socket_path(port, path, sizeof(path)) == 0)
+        unlink(path);
+}
+
+// answers the hello, passing memfd along when it is not negative
+static int local_send_reply(int fd, char reply, int memfd) {
+    struct iovec iov = { .iov_base = &reply, .iov_len = 1 };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    if (memfd >= 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    }
+    return sendmsg(fd, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+static void local_serve_shm(struct shm_endpoint_t* endpoint, struct TableServerDistributedDatabase* ddb) {
+    struct arena_t* arena = arena_create(ARENA_DEFAULT_CAPACITY);
+    if (arena == NULL) {
+        shm_endpoint_destroy(endpoint);
+        return;
+    }
+
+    db_increment_active_clients(ddb->db);
+    LOG_INFO(LOCAL_TRANSPORT_SHM_CLIENT);
+    while (true) {
+        MessageT* request = shm_read_message(endpoint, arena);
+        if (request == NULL)
+            break;
+
+        PROBE1(request__receive, -1);
+        LOG_DEBUG(SERVER_RECEIVED_REQUEST);
+        bool failed = invoke(request, ddb) == -1 || shm_send_message(endpoint, request) == -1;
+        slowlog_end();
+        if (!failed)
+            PROBE2(request__send, -1, request->opcode);
+        release_message(request, arena);
+        if (failed)
+            break;
+        LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    }
+    LOG_INFO(CLIENT_CONNECTION_CLOSED);
+    db_decrement_active_clients(ddb->db);
+    arena_destroy(arena);
+    shm_endpoint_destroy(endpoint);
+}
+
+// sets up a shared memory channel for the client. Returns the endpoint, or NULL on failure.
+static struct shm_endpoint_t* local_setup_shm(int client_socket) {
+    int memfd = -1;
+    struct shm_channel_t* channel = shm_channel_create(&memfd);
+    if (channel == NULL)
+        return NULL;
+
+    struct shm_endpoint_t* endpoint = shm_endpoint_create(channel, client_socket, true);
+    if (endpoint == NULL || local_send_reply(client_socket, LOCAL_HELLO_ACCEPTED, memfd) == -1) {
+        // the client socket stays open: it may still be answered with LOCAL_HELLO_REFUSED
+        destroy_dynamic_memory(endpoint);
+        shm_channel_destroy(channel);
+        close(memfd);
+        return NULL;
+    }
+
+    // the client holds its own reference to the memory file now
+    close(memfd);
+    return endpoint;
+}
+
+static void* local_client_executor(void* _args) {
+    struct ClientExecutorArgs* args = (struct ClientExecutorArgs*)_args;
+    int client_socket = args->client_socket;
+
+    char hello[LOCAL_HELLO_SIZE];
+    if (read_all(client_socket, hello, LOCAL_HELLO_SIZE) != LOCAL_HELLO_SIZE) {
+        close(client_socket);
+        destroy_dynamic_memory(args);
+        return NULL;
+    }
+
+    bool accepted = false;
+    if (memcmp(hello, LOCAL_HELLO_SHM, LOCAL_HELLO_SIZE) == 0) {
+        struct shm_endpoint_t* endpoint = local_setup_shm(client_socket);
+        if (endpoint != NULL) {
+            struct TableServerDistributedDatabase* ddb = args->ddb;
+            destroy_dynamic_memory(args);
+            local_serve_shm(endpoint, ddb);
+            return NULL;
+        }
+        // serve the client over the socket instead
+        accepted = local_send_reply(client_socket, LOCAL_HELLO_REFUSED, -1) == 0;
+    } else if (memcmp(hello, LOCAL_HELLO_SOCKET, LOCAL_HELLO_SIZE) == 0) {
+        accepted = local_send_reply(client_socket, LOCAL_HELLO_ACCEPTED, -1) == 0;
+    }
+
+    if (!accepted) {
+        close(client_socket);
+        destroy_dynamic_memory(args);
+        return NULL;
+    }
+    return thread_process_request(args);
+}
+
+static void* local_transport_acceptor(void* _args) {
+    struct ClientExecutorArgs* args = (struct ClientExecutorArgs*)_args;
+    int listening_socket = args->client_socket;
+    struct TableServerDistributedDatabase* ddb = args->ddb;
+    destroy_dynamic_memory(args);
+
+    while (true) {
+        int client_socket = accept4(listening_socket, NULL, NULL, SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EBADF || errno == EINVAL)
+                break; // listener closed
+            if (errno != EINTR)
+                LOG_ERROR(SERVER_FAILED_CONNECTION);
+            continue;
+        }
+
+        struct ClientExecutorArgs* client_args = client_executor_args_create(client_socket, ddb);
+        pthread_t thread;
+        if (client_args == NULL || pthread_create(&thread, &ddb->db->thread_attr, local_client_executor, client_args) != 0) {
+            destroy_dynamic_memory(client_args);
+            close(client_socket);
+        }
+    }
+    return NULL;
+}
+
+int local_transport_start(int listening_socket, struct TableServerDistributedDatabase* ddb) {
+    signal(SIGPIPE, SIG_IGN);
+    struct ClientExecutorArgs* args = client_executor_args_create(listening_socket, ddb);
+    if (args == NULL)
+        return -1;
+
+    pthread_t thread;
+    if (assert_error(
+        pthread_create(&thread, &ddb->db->thread_attr, local_transport_acceptor, args) != 0,
+        "local_transport_start",
+        "Failed to launch the local transport thread.\n"
+    )) {
+        destroy_dynamic_memory(args);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "logger.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+#include <sched.h>
+
+struct logger_t logger = {
+    .level = LOGGER_INFO,
+    .configured_level = LOGGER_INFO,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+static const char* level_names[LOGGER_LEVELS] = { "error", "warn", "info", "debug" };
+static pthread_key_t ring_key;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static __thread struct logger_ring_t* local_ring = NULL;
+
+// the logger thread frees the ring once it wrote its messages out
+static void ring_retire(void* _ring) {
+    struct logger_ring_t* ring = _ring;
+    local_ring = NULL;
+    __atomic_store_n(&ring->retired, true, __ATOMIC_RELEASE);
+}
+
+static void ring_key_create(void) {
+    pthread_key_create(&ring_key, ring_retire);
+}
+
+static struct logger_ring_t* ring_of_thread() {
+    if (local_ring != NULL)
+        return local_ring;
+
+    pthread_once(&ring_once, ring_key_create);
+    struct logger_ring_t* ring = NULL;
+    if (assert_error(
+        posix_memalign((void**)&ring, 64, sizeof(struct logger_ring_t)) != 0,
+        "ring_of_thread",
+        ERROR_MALLOC
+    )) return NULL;
+
+    memset(ring, 0, sizeof(struct logger_ring_t));
+    pthread_mutex_lock(&logger.mutex);
+    ring->next = logger.rings;
+    logger.rings = ring;
+    pthread_mutex_unlock(&logger.mutex);
+    pthread_setspecific(ring_key, ring);
+    local_ring = ring;
+    return ring;
+}
+
+// writes the messages of every ring out, freeing the rings of the threads that exited. Returns
+// the number of messages written
+static int logger_drain() {
+    int written = 0;
+    pthread_mutex_lock(&logger.mutex);
+    struct logger_ring_t** link = &logger.rings;
+    while (*link != NULL) {
+        struct logger_ring_t* ring = *link;
+        // read before head, so that no message of a retired ring is left behind
+        bool retired = __atomic_load_n(&ring->retired, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (uint64_t tail = ring->tail; tail < head; tail++, written++)
+            fputs(ring->records[tail & (LOGGER_RING_RECORDS - 1)], stdout);
+        __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped > ring->dropped_reported) {
+            printf(LOGGER_DROPPED, (unsigned long long)(dropped - ring->dropped_reported));
+            ring->dropped_reported = dropped;
+        }
+
+        if (retired) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&logger.mutex);
+    if (written > 0)
+        fflush(stdout);
+    return written;
+}
+
+static void* logger_thread(void* arg) {
+    (void)arg;
+    struct timespec interval = { .tv_sec = 0, .tv_nsec = LOGGER_DRAIN_MS * 1000000L };
+    while (!__atomic_load_n(&logger.stop, __ATOMIC_ACQUIRE)) {
+        // back to back while messages keep coming
+        if (logger_drain() == 0)
+            nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+// SIGUSR1: switches between NODEDB_LOG_LEVEL and debug
+static void logger_toggle_handler(int signum) {
+    (void)signum;
+    int level = __atomic_load_n(&logger.level, __ATOMIC_RELAXED);
+    __atomic_store_n(&logger.level, level == LOGGER_DEBUG ? logger.configured_level : LOGGER_DEBUG, __ATOMIC_RELAXED);
+}
+
+int logger_parse_level(const char* name) {
+    for (int level = 0; name != NULL && level < LOGGER_LEVELS; level++) {
+        if (strcasecmp(name, level_names[level]) == 0)
+            return level;
+    }
+    return -1;
+}
+
+const char* logger_level_name(enum LoggerLevel level) {
+    return level >= 0 && level < LOGGER_LEVELS ? level_names[level] : "unknown";
+}
+
+void logger_set_level(enum LoggerLevel level) {
+    if (level < 0 || level >= LOGGER_LEVELS)
+        return;
+    __atomic_store_n(&logger.level, level, __ATOMIC_RELAXED);
+}
+
+int logger_start() {
+    char* name = get_env_string("NODEDB_LOG_LEVEL", "info");
+    int level = logger_parse_level(name);
+    if (level == -1) {
+        printf(LOGGER_UNKNOWN_LEVEL, name);
+        level = LOGGER_INFO;
+    }
+    logger.configured_level = level;
+    logger_set_level(level);
+    signal(SIGUSR1, logger_toggle_handler);
+
+    if (assert_error(
+        pthread_create(&logger.thread, NULL, logger_thread, NULL) != 0,
+        "logger_start",
+        "Failed to create the logger thread.\n"
+    )) return -1;
+    __atomic_store_n(&logger.running, true, __ATOMIC_RELEASE);
+    printf(LOGGER_LEVEL, logger_level_name(level));
+    return 0;
+}
+
+void logger_write(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    struct logger_ring_t* ring = __atomic_load_n(&logger.running, __ATOMIC_ACQUIRE) ? ring_of_thread() : NULL;
+    if (ring != NULL) {
+        // logger_stop() waits for the writers that saw it running before draining the last time
+        __atomic_store_n(&ring->writing, true, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&logger.running, __ATOMIC_SEQ_CST)) {
+            __atomic_store_n(&ring->writing, false, __ATOMIC_RELEASE);
+            ring = NULL;
+        }
+    }
+    if (ring == NULL) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    // the only writer: the logger thread moves tail forward only
+    uint64_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOGGER_RING_RECORDS) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+    } else {
+        char* record = ring->records[head & (LOGGER_RING_RECORDS - 1)];
+        int length = vsnprintf(record, LOGGER_RECORD_SIZE, format, args);
+        // a truncated message still ends its line
+        if (length >= LOGGER_RECORD_SIZE)
+            record[LOGGER_RECORD_SIZE - 2] = '\n';
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ring->writing, false, __ATOMIC_RELEASE);
+    va_end(args);
+}
+
+void logger_stop() {
+    if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE))
+        return;
+
+    // from now on messages are printed directly, once the writers already in a ring are done
+    __atomic_store_n(&logger.running, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&logger.mutex);
+    for (struct logger_ring_t* ring = logger.rings; ring != NULL; ring = ring->next) {
+        while (__atomic_load_n(&ring->writing, __ATOMIC_ACQUIRE))
+            sched_yield();
+    }
+    pthread_mutex_unlock(&logger.mutex);
+
+    __atomic_store_n(&logger.stop, true, __ATOMIC_RELEASE);
+    pthread_join(logger.thread, NULL);
+    // what was written between the last pass of the logger thread and its exit
+    logger_drain();
+}
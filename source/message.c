@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 #include <arpa/inet.h>
 
 ServerStatsT* wrap_stats(struct statistics_t* stats) {
@@ -20,7 +21,7 @@ ServerStatsT* wrap_stats(struct statistics_t* stats) {
     return wrap_stats_with_data(stats->active_clients, stats->op_counter, stats->computed_time_micros);
 }
 
-ServerStatsT* wrap_stats_with_data(int active_clients, int op_counter, int computed_time) {
+ServerStatsT* wrap_stats_with_data(int active_clients, long long op_counter, long long computed_time) {
     ServerStatsT* stats_wrapper = create_dynamic_memory(sizeof(ServerStatsT));
     if (assert_error(
         stats_wrapper == NULL,
@@ -139,6 +140,10 @@ bool was_operation_unsuccessful(MessageT* received) {
 }
 
 MessageT* read_message(int fd) {
+    return read_message_with_arena(fd, NULL);
+}
+
+MessageT* read_message_with_arena(int fd, struct arena_t* arena) {
     // get request message size
     unsigned short msg_size_be;
     if (assert_error(
@@ -149,10 +154,10 @@ MessageT* read_message(int fd) {
 
     size_t msg_size = ntohs(msg_size_be);
 
-    // allocate memory to receive message
-    void* buffer = (uint8_t*)create_dynamic_memory(msg_size * sizeof(uint8_t*));
+    // allocate memory to receive message (recycled with the arena, if any)
+    void* buffer = arena != NULL ? arena_alloc(arena, msg_size) : create_tagged_memory(MEMORY_MESSAGES, msg_size);
     if (assert_error(
-        buffer == NULL,
+        buffer == NULL && msg_size > 0,
         "network_receive",
         ERROR_MALLOC
     )) return NULL;
@@ -163,59 +168,144 @@ MessageT* read_message(int fd) {
         "network_receive",
         "Failed to read client request.\n"
     )) {
-        destroy_dynamic_memory(buffer);
+        if (arena == NULL)
+            destroy_tagged_memory(MEMORY_MESSAGES, buffer);
         return NULL;
     }
 
     // unpack message
-    MessageT *msg_request = message_t__unpack(NULL, msg_size, buffer);
-    destroy_dynamic_memory(buffer);
+    MessageT *msg_request = message_t__unpack(arena != NULL ? &arena->allocator : NULL, msg_size, buffer);
+    if (arena == NULL)
+        destroy_tagged_memory(MEMORY_MESSAGES, buffer);
 
     return msg_request;
 }
 
+void release_message(MessageT* msg, struct arena_t* arena) {
+    if (msg != NULL)
+        message_t__free_unpacked(msg, arena != NULL ? &arena->allocator : NULL);
+    arena_reset(arena);
+}
+
 int send_message(int fd, MessageT *msg) {
+    return send_message_zerocopy(fd, msg, NULL);
+}
+
+// encode value as a protobuf varint, returning the number of bytes used
+static size_t encode_varint(uint64_t value, uint8_t* buffer) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        buffer[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[n++] = (uint8_t)value;
+    return n;
+}
+
+int send_message_zerocopy(int fd, MessageT *msg, struct zerocopy_t* zc) {
     if (assert_error(
         msg == NULL,
         "network_send_message",
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
-    size_t msg_size = message_t__get_packed_size(msg);
-    unsigned short msg_size_be = htons(msg_size); // reorder bytes to be
-
-    // allocate buffer with message size
-    uint8_t* buffer = (uint8_t*)create_dynamic_memory(msg_size * sizeof(uint8_t*));
-    if (assert_error(
-        buffer == NULL,
-        "network_send",
-        ERROR_MALLOC
-    )) return -1;
-
-    message_t__pack(msg, buffer);
+    // pack every field but the value, which is sent from where it already is
+    // (protobuf allows fields in any order, so it can go last)
+    ProtobufCBinaryData value = msg->value;
+    msg->value.len = 0;
+    msg->value.data = NULL;
+    size_t fields_size = message_t__get_packed_size(msg);
+
+    uint8_t value_prefix[MESSAGE_VALUE_PREFIX_MAX_SIZE];
+    size_t prefix_size = 0;
+    if (value.len > 0) {
+        value_prefix[prefix_size++] = MESSAGE_VALUE_TAG;
+        prefix_size += encode_varint(value.len, value_prefix + prefix_size);
+    }
 
-    // send size
+    size_t msg_size = fields_size + prefix_size + value.len;
     if (assert_error(
-        write_all(fd, &msg_size_be, sizeof(msg_size_be)) != sizeof(msg_size_be),
+        msg_size > USHRT_MAX,
         "network_send_message",
-        "Failed to send size of message.\n"
+        "Message is too large to be framed.\n"
     )) {
-        destroy_dynamic_memory(buffer);
+        msg->value = value;
         return -1;
     }
 
-    // send msg buffer
+    // large frames are assembled in a zero-copy buffer, left alone until the kernel is done
+    // with it, and small ones on the stack
+    uint8_t inline_buffer[MESSAGE_FRAME_HEADER_SIZE + MESSAGE_INLINE_FIELDS_SIZE + MESSAGE_VALUE_PREFIX_MAX_SIZE];
+    size_t head_size = MESSAGE_FRAME_HEADER_SIZE + fields_size + prefix_size;
+    uint8_t* zerocopy_head = zc != NULL && MESSAGE_FRAME_HEADER_SIZE + msg_size >= zc->threshold ? zerocopy_buffer(zc, head_size) : NULL;
+    uint8_t* buffer = zerocopy_head != NULL ? zerocopy_head
+        : head_size <= sizeof(inline_buffer) ? inline_buffer : create_tagged_memory(MEMORY_MESSAGES, head_size);
     if (assert_error(
-        write_all(fd, (void*)buffer, msg_size) != msg_size,
-        "network_send_message",
-        "Failed to send message buffer.\n"
+        buffer == NULL,
+        "network_send",
+        ERROR_MALLOC
     )) {
-        destroy_dynamic_memory(buffer);
+        msg->value = value;
         return -1;
     }
 
-    destroy_dynamic_memory(buffer);
-    return 0;
+    unsigned short msg_size_be = htons(msg_size); // reorder bytes to be
+    memcpy(buffer, &msg_size_be, MESSAGE_FRAME_HEADER_SIZE);
+    message_t__pack(msg, buffer + MESSAGE_FRAME_HEADER_SIZE);
+    memcpy(buffer + MESSAGE_FRAME_HEADER_SIZE + fields_size, value_prefix, prefix_size);
+    msg->value = value;
+
+    // size, fields and value leave with a single system call
+    struct iovec iov[2] = {
+        { .iov_base = buffer, .iov_len = head_size },
+        { .iov_base = value.data, .iov_len = value.len }
+    };
+    // so is the value, which the zero-copy state frees once sent
+    if (zerocopy_head != NULL && value.len > 0 && zerocopy_attach(zc, value.data) == 0) {
+        msg->value.data = NULL;
+        msg->value.len = 0;
+    }
+    ssize_t sent = zerocopy_send_iov(fd, iov, value.len > 0 ? 2 : 1, zc);
+    if (buffer != inline_buffer && buffer != zerocopy_head)
+        destroy_tagged_memory(MEMORY_MESSAGES, buffer);
+
+    return sent < 0 ? -1 : 0;
+}
+
+size_t message_frame_size(MessageT* msg) {
+    if (assert_error(
+        msg == NULL,
+        "message_frame_size",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return 0;
+
+    size_t msg_size = message_t__get_packed_size(msg);
+    if (assert_error(
+        msg_size > USHRT_MAX,
+        "message_frame_size",
+        "Message is too large to be framed.\n"
+    )) return 0;
+    return MESSAGE_FRAME_HEADER_SIZE + msg_size;
+}
+
+ssize_t pack_message_frame(MessageT* msg, uint8_t* buffer, size_t capacity) {
+    if (assert_error(
+        msg == NULL || buffer == NULL,
+        "pack_message_frame",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    size_t frame_size = message_frame_size(msg);
+    if (assert_error(
+        frame_size == 0 || frame_size > capacity,
+        "pack_message_frame",
+        "Not enough space to pack message frame.\n"
+    )) return -1;
+
+    unsigned short msg_size_be = htons(frame_size - MESSAGE_FRAME_HEADER_SIZE);
+    memcpy(buffer, &msg_size_be, MESSAGE_FRAME_HEADER_SIZE);
+    message_t__pack(msg, buffer + MESSAGE_FRAME_HEADER_SIZE);
+    return frame_size;
 }
 
 ssize_t write_all(int sock, const void *buf, size_t n) {
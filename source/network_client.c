@@ -4,6 +4,10 @@
 #include "client_stub-private.h"
 #include "sdmessage.pb-c.h"
 #include "message.h"
+#include "address.h"
+#include "local_transport.h"
+#include "shm_ring.h"
+#include "compact_protocol.h"
 
 
 #include <arpa/inet.h>
@@ -12,10 +16,122 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <signal.h>
+#include <string.h>
+
+// sends the hello of the local transport and receives the reply (and memory file, if any)
+static int network_local_hello(int fd, char* hello, char* reply, int* memfd) {
+    if (write_all(fd, hello, LOCAL_HELLO_SIZE) != LOCAL_HELLO_SIZE)
+        return -1;
+
+    struct iovec iov = { .iov_base = reply, .iov_len = 1 };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != 1)
+        return -1;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(memfd, CMSG_DATA(cmsg), sizeof(int));
+    return 0;
+}
+
+// connects to the Unix socket of a co-located server, asking for a shared memory channel if use_shm
+static int network_connect_local(struct rtable_t *rtable, bool use_shm) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (local_socket_path(rtable->server_port, addr.sun_path, sizeof(addr.sun_path)) == -1)
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    // servers without a local transport are reached over TCP
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        return close_and_return_failure(fd);
+
+    char reply;
+    int memfd = -1;
+    if (network_local_hello(fd, use_shm ? LOCAL_HELLO_SHM : LOCAL_HELLO_SOCKET, &reply, &memfd) == -1) {
+        if (memfd >= 0)
+            close(memfd);
+        return close_and_return_failure(fd);
+    }
+
+    if (use_shm && reply == LOCAL_HELLO_ACCEPTED) {
+        struct shm_channel_t* channel = memfd >= 0 ? shm_channel_map(memfd) : NULL;
+        if (memfd >= 0)
+            close(memfd);
+        rtable->shm = shm_endpoint_create(channel, fd, false);
+        if (rtable->shm == NULL) {
+            shm_channel_destroy(channel);
+            return close_and_return_failure(fd);
+        }
+    } else if (reply != LOCAL_HELLO_ACCEPTED && reply != LOCAL_HELLO_REFUSED) {
+        return close_and_return_failure(fd);
+    }
+
+    rtable->sockfd = fd;
+    return 0;
+}
+
+// asks the server to upgrade the connection to the compact protocol. Servers that do not
+// know OP_HELLO answer with OP_ERROR and the connection keeps using protobuf frames
+static int network_negotiate(struct rtable_t *rtable) {
+    if (strcmp(get_env_string("NODEDB_PROTOCOL", "compact"), "protobuf") == 0)
+        return 0;
+
+    MessageT* msg = wrap_message(MESSAGE_T__OPCODE__OP_HELLO, MESSAGE_T__C_TYPE__CT_RESULT);
+    if (msg == NULL)
+        return -1;
+    msg->result = COMPACT_PROTOCOL_VERSION;
+
+    MessageT* received = network_send_receive(rtable, msg);
+    message_t__free_unpacked(msg, NULL);
+    if (received == NULL)
+        return -1;
+
+    bool upgraded = received->opcode == MESSAGE_T__OPCODE__OP_HELLO + 1 && received->result == COMPACT_PROTOCOL_VERSION;
+    message_t__free_unpacked(received, NULL);
+    if (!upgraded)
+        return 0;
+
+    rtable->buffer = create_dynamic_memory(COMPACT_MAX_FRAME_SIZE);
+    if (assert_error(
+        rtable->buffer == NULL,
+        "network_negotiate",
+        ERROR_MALLOC
+    )) return -1;
+    rtable->compact = true;
+    return 0;
+}
 
 int network_connect(struct rtable_t *rtable) {
     signal(SIGPIPE, SIG_IGN);
+
+    // co-located servers are reached through shared memory, then the Unix socket, then TCP
+    char* transport = get_env_string("NODEDB_TRANSPORT", "auto");
+    if (strcmp(transport, "tcp") != 0 && is_local_address(rtable->server_address)) {
+        if (strcmp(transport, "unix") != 0 && network_connect_local(rtable, true) == 0) {
+            // shared memory channels keep protobuf frames
+            if (rtable->shm != NULL)
+                return 0;
+            return network_negotiate(rtable);
+        }
+        if (network_connect_local(rtable, false) == 0)
+            return network_negotiate(rtable);
+    }
+
     struct sockaddr_in server_addr;
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(rtable->server_port);
@@ -41,8 +157,28 @@ int network_connect(struct rtable_t *rtable) {
         return -1;
     }
 
+    set_no_delay(fd);
     rtable->sockfd = fd;
-    return 0;
+    return network_negotiate(rtable);
+}
+
+// sends msg inside a COMPACT_OP_PROTOBUF frame and reads the MessageT of the response
+static MessageT *network_compact_send_receive(struct rtable_t *rtable, MessageT *msg) {
+    uint32_t request_id = rtable->next_request_id++;
+    ssize_t frame_size = compact_pack_message(msg, request_id, rtable->buffer, COMPACT_MAX_FRAME_SIZE);
+    if (frame_size < 0 || write_all(rtable->sockfd, rtable->buffer, frame_size) != frame_size)
+        return NULL;
+
+    struct compact_header_t response;
+    if (compact_read_frame(rtable->sockfd, &response, rtable->buffer) == -1)
+        return NULL;
+    if (assert_error(
+        response.opcode != COMPACT_OP_PROTOBUF || response.request_id != request_id,
+        "network_send_receive",
+        "Unexpected response from server.\n"
+    )) return NULL;
+
+    return message_t__unpack(NULL, response.value_length, rtable->buffer + response.key_length);
 }
 
 MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg) {
@@ -58,12 +194,90 @@ MessageT *network_send_receive(struct rtable_t *rtable, MessageT *msg) {
         "Connection to remote server is down.\n"
     )) return NULL;
 
+    if (rtable->shm != NULL) {
+        if (shm_send_message(rtable->shm, msg) < 0)
+            return NULL;
+        return shm_read_message(rtable->shm, NULL);
+    }
+
+    if (rtable->compact)
+        return network_compact_send_receive(rtable, msg);
+
     if (send_message(rtable->sockfd, msg) < 0)
         return NULL;
 
     return read_message(rtable->sockfd);
 }
 
+int network_compact_send(struct rtable_t *rtable, uint8_t opcode, char *key, void *value, uint32_t value_length, uint32_t *request_id) {
+    if (assert_error(
+        rtable == NULL || key == NULL || (value == NULL && value_length > 0),
+        "network_compact_send",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (assert_error(
+        !rtable->compact || rtable->sockfd < 0,
+        "network_compact_send",
+        "Connection does not use the compact protocol.\n"
+    )) return -1;
+
+    size_t key_length = strlen(key);
+    if (assert_error(
+        key_length > COMPACT_MAX_PAYLOAD || key_length + value_length > COMPACT_MAX_PAYLOAD,
+        "network_compact_send",
+        ERROR_SIZE
+    )) return -1;
+
+    struct compact_header_t request = {
+        .opcode = opcode,
+        .key_length = key_length,
+        .value_length = value_length,
+        .request_id = rtable->next_request_id++
+    };
+    if (request_id != NULL)
+        *request_id = request.request_id;
+    return compact_send_frame(rtable->sockfd, &request, key, value);
+}
+
+int network_compact_receive(struct rtable_t *rtable, struct compact_header_t *response) {
+    if (assert_error(
+        rtable == NULL || response == NULL,
+        "network_compact_receive",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (assert_error(
+        !rtable->compact || rtable->sockfd < 0,
+        "network_compact_receive",
+        "Connection does not use the compact protocol.\n"
+    )) return -1;
+
+    return compact_read_frame(rtable->sockfd, response, rtable->buffer);
+}
+
+int network_compact_call(struct rtable_t *rtable, uint8_t opcode, char *key, void *value, uint32_t value_length, struct compact_header_t *response) {
+    if (assert_error(
+        rtable == NULL || key == NULL || response == NULL,
+        "network_compact_call",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    uint32_t request_id;
+    if (network_compact_send(rtable, opcode, key, value, value_length, &request_id) == -1)
+        return -1;
+
+    if (network_compact_receive(rtable, response) == -1)
+        return -1;
+    if (assert_error(
+        response->opcode != opcode || response->request_id != request_id,
+        "network_compact_call",
+        "Unexpected response from server.\n"
+    )) return -1;
+
+    return (response->flags & COMPACT_FLAG_ERROR) ? -1 : 0;
+}
+
 
 int network_close(struct rtable_t *rtable) {
     if (assert_error(
@@ -72,8 +286,17 @@ int network_close(struct rtable_t *rtable) {
         ERROR_NULL_POINTER_REFERENCE
     )) return -1;
 
-    close(rtable->sockfd);
+    // the shared memory endpoint owns the Unix socket
+    if (rtable->shm != NULL) {
+        shm_endpoint_destroy(rtable->shm);
+        rtable->shm = NULL;
+    } else {
+        close(rtable->sockfd);
+    }
     rtable->sockfd = -1;
+    rtable->compact = false;
+    destroy_dynamic_memory(rtable->buffer);
+    rtable->buffer = NULL;
     return 0;
 }
 
@@ -7,6 +7,11 @@
 #include "database.h"
 #include "distributed_database.h"
 #include "client_executor.h"
+#include "replication.h"
+#include "snapshot.h"
+#include "logger.h"
+#include "slowlog.h"
+#include "probes.h"
 
 #include <stdio.h>
 #include <unistd.h>
@@ -45,7 +50,7 @@ int network_server_init(short port) {
     }
 
     if (assert_error(
-        listen(fd, 0) < 0,
+        listen(fd, SOMAXCONN) < 0,
         "network_server_init",
         "Failed to listen to socket."
     )) {
@@ -57,14 +62,15 @@ int network_server_init(short port) {
 
 int network_main_loop(int listening_socket, struct TableServerDistributedDatabase* ddb) {
     signal(SIGPIPE, SIG_IGN);
-    printf(SERVER_WAITING_FOR_CONNECTIONS);
+    LOG_INFO(SERVER_WAITING_FOR_CONNECTIONS);
     while (true) {
         int client_socket = get_client(listening_socket);
         if (client_socket == -1) {
-            printf(SERVER_FAILED_CONNECTION);
+            LOG_ERROR(SERVER_FAILED_CONNECTION);
             continue;
         }
 
+        set_no_delay(client_socket);
         launch_client_executor(client_socket, ddb);
     }
     return -1;   
@@ -83,22 +89,94 @@ int network_server_close(int socket) {
 }
 
 void process_request(int connection_socket, struct TableServerDistributedDatabase* ddb) {
-    MessageT *request = network_receive(connection_socket);
-
-    if (request != NULL) {
-        printf(SERVER_RECEIVED_REQUEST);
-        // invoke process...
-        if (invoke(request, ddb) == -1) {
-            message_t__free_unpacked(request, NULL);
-        } else {
-            // send response...
-            if (network_send(connection_socket, request) == -1) {
-                message_t__free_unpacked(request, NULL);
-            } else {
-                printf(SERVER_SENT_MSG_TO_CLIENT);
-                message_t__free_unpacked(request, NULL);
-                process_request(connection_socket, ddb);  // use recursion to process next request...
-            }
+    // requests of this connection are decoded into the same arena, recycled after each response
+    struct arena_t* arena = arena_create(ARENA_DEFAULT_CAPACITY);
+    if (arena == NULL)
+        return;
+
+    struct zerocopy_t zc;
+    zerocopy_init(&zc, connection_socket);
+
+    bool upgraded = false;
+    bool replication = false;
+    char* successor = NULL;
+    uint64_t since = 0;
+    int chain = -1;
+    while (!upgraded && !replication && successor == NULL) {
+        MessageT *request = read_message_with_arena(connection_socket, arena);
+        if (request == NULL)
+            break;
+
+        // the predecessor opens its replication stream, or a joining server (or chain) its
+        // snapshot stream, served from now on by a thread of its own
+        replication = request->opcode == MESSAGE_T__OPCODE__OP_REPLICATE;
+        if ((request->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT || request->opcode == MESSAGE_T__OPCODE__OP_MIGRATE) && request->key != NULL) {
+            successor = strdup(request->key);
+            since = request->seq;
+            chain = request->opcode == MESSAGE_T__OPCODE__OP_MIGRATE ? request->result : -1;
+        }
+        if (replication || successor != NULL) {
+            release_message(request, arena);
+            break;
         }
+
+        PROBE1(request__receive, connection_socket);
+        LOG_DEBUG(SERVER_RECEIVED_REQUEST);
+        // invoke process and send response...
+        bool failed = invoke(request, ddb) == -1 || send_message_zerocopy(connection_socket, request, &zc) == -1;
+        slowlog_end();
+        upgraded = !failed && request->opcode == MESSAGE_T__OPCODE__OP_HELLO + 1;
+        if (!failed)
+            PROBE2(request__send, connection_socket, request->opcode);
+        release_message(request, arena);
+        if (failed)
+            break;
+        LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    }
+    zerocopy_destroy(&zc);
+    arena_destroy(arena);
+
+    if (upgraded)
+        process_compact_requests(connection_socket, ddb);
+    else if (replication)
+        replication_stream_start(dup(connection_socket), NULL, 0, ddb);
+    else if (successor != NULL)
+        snapshot_stream_start(dup(connection_socket), successor, since, chain, ddb);
+    destroy_dynamic_memory(successor);
+}
+
+void process_compact_requests(int connection_socket, struct TableServerDistributedDatabase* ddb) {
+    uint8_t* payload = create_tagged_memory(MEMORY_MESSAGES, COMPACT_MAX_PAYLOAD);
+    uint8_t* response = create_tagged_memory(MEMORY_MESSAGES, COMPACT_MAX_FRAME_SIZE);
+    if (payload == NULL || response == NULL) {
+        destroy_tagged_memory(MEMORY_MESSAGES, payload);
+        destroy_tagged_memory(MEMORY_MESSAGES, response);
+        return;
     }
+
+    struct zerocopy_t zc;
+    zerocopy_init(&zc, connection_socket);
+
+    struct compact_header_t header;
+    while (compact_read_frame(connection_socket, &header, payload) == 0) {
+        PROBE1(request__receive, connection_socket);
+        LOG_DEBUG(SERVER_RECEIVED_REQUEST);
+        // the response is built where a zero-copy send can leave it until the kernel is done
+        uint8_t* buffer = zerocopy_buffer(&zc, COMPACT_MAX_FRAME_SIZE);
+        if (buffer == NULL)
+            buffer = response;
+        ssize_t response_size = compact_invoke(&header, payload, ddb, buffer, COMPACT_MAX_FRAME_SIZE);
+        if (response_size == -1)
+            break;
+
+        struct iovec iov = { .iov_base = buffer, .iov_len = response_size };
+        if (zerocopy_send_iov(connection_socket, &iov, 1, &zc) != response_size)
+            break;
+        PROBE2(request__send, connection_socket, header.opcode);
+        LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    }
+
+    zerocopy_destroy(&zc);
+    destroy_tagged_memory(MEMORY_MESSAGES, payload);
+    destroy_tagged_memory(MEMORY_MESSAGES, response);
 }
\ No newline at end of file
@@ -0,0 +1,942 @@
+#include "replication.h"
+
+#include "distributed_database.h"
+#include "message.h"
+#include "zerocopy.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef CHANNEL
+// ====================================================================================================
+//                                              Channel
+// ====================================================================================================
+
+// FNV-1a: lanes only need a stable, well spread choice per key
+static uint32_t key_hash(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)key; *c != '\0'; c++)
+        hash = (hash ^ *c) * 16777619u;
+    return hash;
+}
+
+static int lane_of(struct replication_channel_t* channel, const char* key) {
+    return (int)(key_hash(key) % (uint32_t)channel->n_lanes);
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void atomic_max(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (current < value && !__atomic_compare_exchange_n(target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// adds delta to the bytes held by the channel, which lags above the limit until back under half of it
+static void channel_hold(struct replication_channel_t* channel, int64_t delta) {
+    uint64_t bytes = __atomic_add_fetch(&channel->lag.bytes_in_flight, (uint64_t)delta, __ATOMIC_SEQ_CST);
+    if (channel->lag_limit == 0)
+        return;
+
+    bool lagging = __atomic_load_n(&channel->lag.lagging, __ATOMIC_RELAXED);
+    if (!lagging && bytes > channel->lag_limit) {
+        if (!__atomic_exchange_n(&channel->lag.lagging, true, __ATOMIC_RELAXED))
+            LOG_WARN(REPLICATION_LAGGING, channel->address, channel->port, (unsigned long)bytes,
+                channel->lag_policy == REPLICATION_LAG_ASYNC ? "acknowledging ahead" : "throttling writers");
+    } else if (lagging && bytes <= channel->lag_limit / 2) {
+        if (__atomic_exchange_n(&channel->lag.lagging, false, __ATOMIC_RELAXED))
+            LOG_INFO(REPLICATION_CAUGHT_UP, channel->address, channel->port, (unsigned long)bytes);
+    }
+
+    // throttled writers check the bytes held again
+    if (delta < 0 && __atomic_load_n(&channel->lag_waiters, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&channel->lag_mutex);
+        pthread_cond_broadcast(&channel->lag_cond);
+        pthread_mutex_unlock(&channel->lag_mutex);
+    }
+}
+
+// fills msg (and entry) with the mutation, as sent alone
+static void entry_to_message(struct replication_entry_t* mutation, MessageT* msg, EntryT* entry) {
+    msg->opcode = mutation->opcode;
+    msg->seq = mutation->seq;
+    msg->n_chain_seqs = 1;
+    msg->chain_seqs = &mutation->chain_seq;
+    if (mutation->opcode == MESSAGE_T__OPCODE__OP_PUT) {
+        entry->key = mutation->key;
+        entry->value.data = mutation->value;
+        entry->value.len = mutation->value_size;
+        msg->c_type = MESSAGE_T__C_TYPE__CT_ENTRY;
+        msg->entry = entry;
+    } else {
+        msg->c_type = MESSAGE_T__C_TYPE__CT_KEY;
+        msg->key = mutation->key;
+    }
+}
+
+// tells whether one of the n mutations of batch is of the key of mutation
+static bool batch_has_key(struct replication_entry_t** batch, int n, struct replication_entry_t* mutation) {
+    if (mutation->opcode == MESSAGE_T__OPCODE__OP_BAD)
+        return false;
+    for (int i = 0; i < n; i++) {
+        if (batch[i]->key_hash == mutation->key_hash && strcmp(batch[i]->key, mutation->key) == 0)
+            return true;
+    }
+    return false;
+}
+
+// packs the n (consecutive) mutations into lane->tx_buffer. Returns the frame size or -1 on error
+static ssize_t lane_pack_batch(struct replication_lane_t* lane, struct replication_entry_t** batch, int n) {
+    struct replication_channel_t* channel = lane->channel;
+    MessageT msg = MESSAGE_T__INIT;
+    EntryT single = ENTRY_T__INIT;
+    if (n == 1 && batch[0]->opcode != MESSAGE_T__OPCODE__OP_BAD) {
+        entry_to_message(batch[0], &msg, &single);
+        return pack_message_frame(&msg, lane->tx_buffer, MESSAGE_MAX_FRAME_SIZE);
+    }
+
+    EntryT entries[REPLICATION_MAX_BATCH];
+    EntryT* entry_ptrs[REPLICATION_MAX_BATCH];
+    char* keys[REPLICATION_MAX_BATCH];
+    uint64_t entry_seqs[REPLICATION_MAX_BATCH], key_seqs[REPLICATION_MAX_BATCH], skipped_seqs[REPLICATION_MAX_BATCH];
+    size_t n_entries = 0, n_keys = 0, n_skipped = 0, alone_size = 0;
+    uint64_t coalesced = 0;
+    for (int i = 0; i < n; i++) {
+        struct replication_entry_t* mutation = batch[i];
+        alone_size += mutation->frame_size;
+        if (mutation->opcode == MESSAGE_T__OPCODE__OP_BAD) {
+            skipped_seqs[n_skipped++] = mutation->chain_seq;
+            continue;
+        }
+
+        // a later mutation of the same key leaves this one unobservable: only its seq is sent
+        bool superseded = false;
+        for (int j = i + 1; channel->coalesce && j < n && !superseded; j++)
+            superseded = batch[j]->opcode != MESSAGE_T__OPCODE__OP_BAD && batch[j]->key_hash == mutation->key_hash
+                && strcmp(batch[j]->key, mutation->key) == 0;
+        if (superseded) {
+            skipped_seqs[n_skipped++] = mutation->chain_seq;
+            coalesced++;
+            continue;
+        }
+
+        if (mutation->opcode == MESSAGE_T__OPCODE__OP_PUT) {
+            entry_t__init(&entries[n_entries]);
+            entries[n_entries].key = mutation->key;
+            entries[n_entries].value.data = mutation->value;
+            entries[n_entries].value.len = mutation->value_size;
+            entry_ptrs[n_entries] = &entries[n_entries];
+            entry_seqs[n_entries++] = mutation->chain_seq;
+        } else {
+            key_seqs[n_keys] = mutation->chain_seq;
+            keys[n_keys++] = mutation->key;
+        }
+    }
+
+    // chain seqs of the entries, then of the keys, then of the superseded mutations
+    uint64_t chain_seqs[REPLICATION_MAX_BATCH];
+    size_t n_seqs = 0;
+    for (size_t i = 0; i < n_entries; i++)
+        chain_seqs[n_seqs++] = entry_seqs[i];
+    for (size_t i = 0; i < n_keys; i++)
+        chain_seqs[n_seqs++] = key_seqs[i];
+    for (size_t i = 0; i < n_skipped; i++)
+        chain_seqs[n_seqs++] = skipped_seqs[i];
+
+    msg.opcode = MESSAGE_T__OPCODE__OP_BATCH;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    msg.seq = batch[0]->seq;
+    msg.result = n;
+    msg.n_entries = n_entries;
+    msg.entries = entry_ptrs;
+    msg.n_keys = n_keys;
+    msg.keys = keys;
+    msg.n_chain_seqs = n_seqs;
+    msg.chain_seqs = chain_seqs;
+    ssize_t frame_size = pack_message_frame(&msg, lane->tx_buffer, MESSAGE_MAX_FRAME_SIZE);
+    if (frame_size > 0 && channel->stats != NULL) {
+        __atomic_fetch_add(&channel->stats->coalesced, coalesced, __ATOMIC_RELAXED);
+        if (alone_size > (size_t)frame_size)
+            __atomic_fetch_add(&channel->stats->bytes_saved, alone_size - frame_size, __ATOMIC_RELAXED);
+    }
+    return frame_size;
+}
+
+static void lane_count_batch(struct replication_lane_t* lane, int n) {
+    struct replication_stats_t* stats = lane->channel->stats;
+    if (stats == NULL)
+        return;
+
+    int bucket = 0;
+    while ((n >> (bucket + 1)) > 0 && bucket < STATS_BATCH_BUCKETS - 1)
+        bucket++;
+    __atomic_fetch_add(&stats->batches[bucket], 1, __ATOMIC_RELAXED);
+}
+
+// opens a stream to the successor. Returns the socket or -1 on error
+static int channel_connect(struct replication_channel_t* channel) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(channel->port);
+    if (inet_pton(AF_INET, channel->address, &addr.sin_addr) <= 0)
+        return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        return close_and_return_failure(fd);
+    set_no_delay(fd);
+
+    MessageT request = MESSAGE_T__INIT;
+    request.opcode = MESSAGE_T__OPCODE__OP_REPLICATE;
+    request.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    if (send_message(fd, &request) == -1)
+        return close_and_return_failure(fd);
+
+    MessageT* response = read_message(fd);
+    bool accepted = response != NULL && response->opcode == MESSAGE_T__OPCODE__OP_REPLICATE + 1;
+    if (response != NULL)
+        message_t__free_unpacked(response, NULL);
+    return accepted ? fd : close_and_return_failure(fd);
+}
+
+static void lane_wait_ms(struct replication_lane_t* lane, int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&lane->cond, &lane->mutex, &deadline);
+}
+
+// detaches the acknowledged mutations at the head of the queue. Called with the mutex held
+static struct replication_entry_t* lane_pop_acked(struct replication_lane_t* lane) {
+    struct replication_entry_t* first = NULL;
+    struct replication_entry_t** last = &first;
+    while (lane->head != NULL && lane->head->acked) {
+        struct replication_entry_t* entry = lane->head;
+        lane->head = entry->next;
+        entry->next = NULL;
+        *last = entry;
+        last = &entry->next;
+        lane->acked_seq = entry->seq + 1;
+    }
+    if (lane->head == NULL)
+        lane->tail = NULL;
+    return first;
+}
+
+// runs the callbacks of detached mutations, in order, and frees them. The acknowledgements of
+// the successor (not override_status) count in its lag
+static void lane_complete(struct replication_channel_t* channel, struct replication_entry_t* entry, bool override_status, int status) {
+    int64_t released = 0;
+    uint64_t now = override_status ? 0 : monotonic_us();
+    while (entry != NULL) {
+        struct replication_entry_t* next = entry->next;
+        if (!override_status) {
+            uint64_t elapsed = now > entry->submitted_us ? now - entry->submitted_us : 0;
+            int bucket = 0;
+            while (elapsed >> bucket > 0 && bucket < STATS_LATENCY_BUCKETS - 1)
+                bucket++;
+            __atomic_fetch_add(&channel->lag.ack_latency[bucket], 1, __ATOMIC_RELAXED);
+            atomic_max(&channel->acked_chain_seq, entry->chain_seq);
+        }
+        if (entry->callback != NULL)
+            entry->callback(entry->arg, entry->tag, override_status ? status : entry->status);
+        released += entry->frame_size;
+        destroy_dynamic_memory(entry);
+        entry = next;
+    }
+    if (released > 0)
+        channel_hold(channel, -released);
+}
+
+static void* lane_receiver(void* _lane) {
+    struct replication_lane_t* lane = _lane;
+    int fd = lane->fd; // stable until this thread is joined
+
+    while (true) {
+        MessageT* ack = read_message(fd);
+        if (ack == NULL)
+            break;
+
+        // a batch is acknowledged with the seq of its first mutation and their number
+        uint64_t first = ack->seq;
+        uint64_t end = first + (ack->result > 1 ? (uint64_t)ack->result : 1);
+        int status = ack->opcode == MESSAGE_T__OPCODE__OP_REPLICATE + 1 ? 0 : -1;
+        message_t__free_unpacked(ack, NULL);
+
+        // acknowledgements mostly arrive in order, so the entries are usually at the head. The
+        // ack may beat the sender to updating sent_seq, but never outlives its connection
+        pthread_mutex_lock(&lane->mutex);
+        for (struct replication_entry_t* entry = lane->head; entry != NULL && entry->seq < end; entry = entry->next) {
+            if (entry->seq >= first) {
+                entry->acked = true;
+                entry->status = status;
+            }
+        }
+        struct replication_entry_t* completed = lane_pop_acked(lane);
+        if (completed != NULL)
+            pthread_cond_broadcast(&lane->cond);
+        pthread_mutex_unlock(&lane->mutex);
+        lane_complete(lane->channel, completed, false, 0);
+    }
+
+    pthread_mutex_lock(&lane->mutex);
+    lane->broken = true;
+    pthread_cond_broadcast(&lane->cond);
+    pthread_mutex_unlock(&lane->mutex);
+    return NULL;
+}
+
+// tears down the current connection. Called with the mutex held
+static void lane_disconnect(struct replication_lane_t* lane) {
+    shutdown(lane->fd, SHUT_RDWR);
+    if (lane->receiver_running) {
+        pthread_mutex_unlock(&lane->mutex);
+        pthread_join(lane->receiver, NULL);
+        pthread_mutex_lock(&lane->mutex);
+        lane->receiver_running = false;
+    }
+    close(lane->fd);
+    lane->fd = -1;
+}
+
+static void* lane_sender(void* _lane) {
+    struct replication_lane_t* lane = _lane;
+    struct replication_channel_t* channel = lane->channel;
+    int index = (int)(lane - channel->lanes);
+    struct replication_entry_t* batch[REPLICATION_MAX_BATCH];
+
+    pthread_mutex_lock(&lane->mutex);
+    while (!lane->closed) {
+        if (lane->fd < 0) {
+            pthread_mutex_unlock(&lane->mutex);
+            int fd = channel_connect(channel);
+            pthread_mutex_lock(&lane->mutex);
+            if (fd < 0) {
+                lane_wait_ms(lane, REPLICATION_RETRY_MS);
+                continue;
+            }
+
+            // everything not acknowledged is sent again: mutations are idempotent in order
+            lane->fd = fd;
+            lane->broken = false;
+            lane->sent_seq = lane->acked_seq;
+            lane->receiver_running = pthread_create(&lane->receiver, NULL, lane_receiver, lane) == 0;
+            if (!lane->receiver_running)
+                lane->broken = true;
+            else
+                LOG_INFO(REPLICATION_CONNECTED, channel->address, channel->port, index, channel->window);
+            continue;
+        }
+
+        if (lane->broken) {
+            LOG_WARN(REPLICATION_DISCONNECTED, channel->address, channel->port, index, (unsigned long)(lane->next_seq - lane->acked_seq));
+            lane_disconnect(lane);
+            continue;
+        }
+
+        if (lane->sent_seq == lane->next_seq) {
+            pthread_cond_wait(&lane->cond, &lane->mutex);
+            continue;
+        }
+
+        // everything queued since the last write goes out as one batch that fits a frame.
+        // Unsent mutations stay allocated while the lock is released: they cannot be acknowledged yet
+        int n = 0;
+        size_t size = REPLICATION_BATCH_OVERHEAD;
+        for (struct replication_entry_t* entry = lane->head; entry != NULL && n < REPLICATION_MAX_BATCH; entry = entry->next) {
+            if (entry->seq < lane->sent_seq)
+                continue;
+            if (n > 0 && size + entry->frame_size > MESSAGE_MAX_FRAME_SIZE)
+                break;
+            // the receiver applies puts before deletes: uncoalesced, a key may appear only once
+            if (!channel->coalesce && batch_has_key(batch, n, entry))
+                break;
+            batch[n++] = entry;
+            size += entry->frame_size;
+        }
+        int fd = lane->fd;
+        pthread_mutex_unlock(&lane->mutex);
+        ssize_t frame_size = lane_pack_batch(lane, batch, n);
+        struct iovec iov = { .iov_base = lane->tx_buffer, .iov_len = frame_size };
+        ssize_t sent = frame_size < 0 ? -1 : zerocopy_send_iov(fd, &iov, 1, NULL);
+        if (sent >= 0)
+            lane_count_batch(lane, n);
+        pthread_mutex_lock(&lane->mutex);
+
+        if (sent < 0)
+            lane->broken = true;
+        else
+            lane->sent_seq += n;
+    }
+
+    if (lane->fd >= 0)
+        lane_disconnect(lane);
+    pthread_mutex_unlock(&lane->mutex);
+    return NULL;
+}
+
+static void channel_free(struct replication_channel_t* channel) {
+    for (int i = 0; i < channel->n_lanes; i++) {
+        pthread_mutex_destroy(&channel->lanes[i].order_mutex);
+        pthread_mutex_destroy(&channel->lanes[i].mutex);
+        pthread_cond_destroy(&channel->lanes[i].cond);
+        destroy_dynamic_memory(channel->lanes[i].tx_buffer);
+    }
+    destroy_dynamic_memory(channel->lanes);
+    destroy_dynamic_memory(channel->address);
+    pthread_mutex_destroy(&channel->lag_mutex);
+    pthread_cond_destroy(&channel->lag_cond);
+    pthread_mutex_destroy(&channel->refs_mutex);
+    destroy_dynamic_memory(channel);
+}
+
+// stops the senders (and receivers) and detaches the pending mutations of each lane
+static void channel_stop(struct replication_channel_t* channel, struct replication_entry_t** pending) {
+    pthread_mutex_lock(&channel->lag_mutex);
+    __atomic_store_n(&channel->stopped, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&channel->lag_cond);
+    pthread_mutex_unlock(&channel->lag_mutex);
+    for (int i = 0; i < channel->n_lanes; i++) {
+        struct replication_lane_t* lane = &channel->lanes[i];
+        pthread_mutex_lock(&lane->mutex);
+        lane->closed = true;
+        if (lane->fd >= 0)
+            shutdown(lane->fd, SHUT_RDWR);
+        pthread_cond_broadcast(&lane->cond);
+        pthread_mutex_unlock(&lane->mutex);
+    }
+
+    for (int i = 0; i < channel->n_lanes; i++) {
+        struct replication_lane_t* lane = &channel->lanes[i];
+        if (lane->sender_running)
+            pthread_join(lane->sender, NULL);
+        lane->sender_running = false;
+
+        pthread_mutex_lock(&lane->mutex);
+        pending[i] = lane->head;
+        lane->head = lane->tail = NULL;
+        pthread_mutex_unlock(&lane->mutex);
+    }
+}
+
+struct replication_channel_t* replication_channel_create(const char* address_port, struct replication_stats_t* stats) {
+    if (assert_error(
+        address_port == NULL,
+        "replication_channel_create",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    const char* separator = strrchr(address_port, ':');
+    if (assert_error(
+        separator == NULL,
+        "replication_channel_create",
+        "Invalid connection string format. It should be address:port.\n"
+    )) return NULL;
+
+    struct replication_channel_t* channel = create_dynamic_memory(sizeof(struct replication_channel_t));
+    if (assert_error(
+        channel == NULL,
+        "replication_channel_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    channel->window = get_env_int("NODEDB_REPLICATION_WINDOW", REPLICATION_DEFAULT_WINDOW);
+    if (channel->window <= 0)
+        channel->window = 1;
+    channel->n_lanes = get_env_int("NODEDB_REPLICATION_LANES", REPLICATION_DEFAULT_LANES);
+    if (channel->n_lanes <= 0 || channel->n_lanes > REPLICATION_MAX_LANES)
+        channel->n_lanes = REPLICATION_DEFAULT_LANES;
+    channel->coalesce = get_env_int("NODEDB_REPLICATION_COALESCE", 1) != 0;
+    channel->stats = stats;
+    int lag_limit_kb = get_env_int("NODEDB_LAG_LIMIT_KB", 0);
+    channel->lag_limit = lag_limit_kb > 0 ? (uint64_t)lag_limit_kb * 1024 : 0;
+    channel->lag_policy = strcmp(get_env_string("NODEDB_LAG_POLICY", "throttle"), "async") == 0 ? REPLICATION_LAG_ASYNC : REPLICATION_LAG_THROTTLE;
+    pthread_mutex_init(&channel->lag_mutex, NULL);
+    pthread_cond_init(&channel->lag_cond, NULL);
+
+    channel->address = strndup(address_port, separator - address_port);
+    channel->port = atoi(separator + 1);
+    channel->refs = 1;
+    pthread_mutex_init(&channel->refs_mutex, NULL);
+    channel->lanes = create_dynamic_memory(channel->n_lanes * sizeof(struct replication_lane_t));
+    if (assert_error(
+        channel->address == NULL || channel->lanes == NULL,
+        "replication_channel_create",
+        ERROR_MALLOC
+    )) {
+        channel->n_lanes = 0;
+        channel_free(channel);
+        return NULL;
+    }
+
+    bool failed = false;
+    for (int i = 0; i < channel->n_lanes; i++) {
+        struct replication_lane_t* lane = &channel->lanes[i];
+        lane->channel = channel;
+        lane->fd = -1;
+        pthread_mutex_init(&lane->order_mutex, NULL);
+        pthread_mutex_init(&lane->mutex, NULL);
+        pthread_cond_init(&lane->cond, NULL);
+        lane->tx_buffer = create_dynamic_memory(MESSAGE_MAX_FRAME_SIZE);
+        failed = failed || lane->tx_buffer == NULL;
+        lane->sender_running = !failed && pthread_create(&lane->sender, NULL, lane_sender, lane) == 0;
+        failed = failed || !lane->sender_running;
+    }
+
+    if (assert_error(
+        failed,
+        "replication_channel_create",
+        "Failed to launch the replication channel.\n"
+    )) {
+        struct replication_entry_t* pending[REPLICATION_MAX_LANES];
+        channel_stop(channel, pending);
+        channel_free(channel);
+        return NULL;
+    }
+    return channel;
+}
+
+void replication_channel_acquire(struct replication_channel_t* channel) {
+    pthread_mutex_lock(&channel->refs_mutex);
+    channel->refs++;
+    pthread_mutex_unlock(&channel->refs_mutex);
+}
+
+void replication_channel_release(struct replication_channel_t* channel) {
+    if (channel == NULL)
+        return;
+
+    pthread_mutex_lock(&channel->refs_mutex);
+    bool last = --channel->refs == 0;
+    pthread_mutex_unlock(&channel->refs_mutex);
+
+    // stopped by whoever dropped the reference of the creator
+    if (last)
+        channel_free(channel);
+}
+
+int replication_channel_lock_lane(struct replication_channel_t* channel, const char* key) {
+    int lane = lane_of(channel, key);
+    pthread_mutex_lock(&channel->lanes[lane].order_mutex);
+    return lane;
+}
+
+void replication_channel_unlock_lane(struct replication_channel_t* channel, int lane) {
+    pthread_mutex_unlock(&channel->lanes[lane].order_mutex);
+}
+
+int replication_channel_submit(struct replication_channel_t* channel, int lane_index, MessageT__Opcode opcode, char* key,
+    struct data_t* value, uint64_t chain_seq, replication_callback_t callback, void* arg, uint64_t tag) {
+    if (assert_error(
+        channel == NULL || key == NULL || callback == NULL || (opcode == MESSAGE_T__OPCODE__OP_PUT && value == NULL)
+            || lane_index < 0 || lane_index >= channel->n_lanes,
+        "replication_channel_submit",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the mutation is copied: batches are packed by the sender, once it is its turn
+    size_t key_size = strlen(key) + 1;
+    size_t value_size = opcode == MESSAGE_T__OPCODE__OP_PUT ? (size_t)value->datasize : 0;
+    struct replication_entry_t* node = create_dynamic_memory(sizeof(struct replication_entry_t) + key_size + value_size);
+    if (assert_error(
+        node == NULL,
+        "replication_channel_submit",
+        ERROR_MALLOC
+    )) return -1;
+
+    node->opcode = opcode;
+    node->chain_seq = chain_seq;
+    node->key = (char*)(node + 1);
+    memcpy(node->key, key, key_size);
+    node->key_hash = key_hash(key);
+    node->value = (uint8_t*)node->key + key_size;
+    node->value_size = value_size;
+    if (value_size > 0)
+        memcpy(node->value, value->data, value_size);
+    node->callback = callback;
+    node->arg = arg;
+    node->tag = tag;
+    node->submitted_us = monotonic_us();
+    // a lagging channel in async mode leaves the acknowledgement to the caller
+    bool ahead = channel->lag_policy == REPLICATION_LAG_ASYNC && __atomic_load_n(&channel->lag.lagging, __ATOMIC_RELAXED);
+    if (ahead)
+        node->callback = NULL;
+
+    struct replication_lane_t* lane = &channel->lanes[lane_index];
+    pthread_mutex_lock(&lane->mutex);
+    MessageT msg = MESSAGE_T__INIT;
+    EntryT entry = ENTRY_T__INIT;
+    node->seq = lane->next_seq;
+    entry_to_message(node, &msg, &entry);
+    node->frame_size = message_frame_size(&msg);
+    if (assert_error(
+        lane->closed || node->frame_size == 0 || node->frame_size > MESSAGE_MAX_FRAME_SIZE,
+        "replication_channel_submit",
+        "Failed to enqueue mutation.\n"
+    )) {
+        pthread_mutex_unlock(&lane->mutex);
+        destroy_dynamic_memory(node);
+        return -1;
+    }
+
+    // held before the receiver can release it
+    channel_hold(channel, node->frame_size);
+    lane->next_seq++;
+    if (lane->tail != NULL)
+        lane->tail->next = node;
+    else
+        lane->head = node;
+    lane->tail = node;
+    pthread_cond_broadcast(&lane->cond);
+    pthread_mutex_unlock(&lane->mutex);
+
+    atomic_max(&channel->submitted_chain_seq, chain_seq);
+    if (!ahead)
+        return 0;
+    __atomic_fetch_add(&channel->lag.async_acks, 1, __ATOMIC_RELAXED);
+    return REPLICATION_SUBMITTED_ASYNC;
+}
+
+void replication_channel_wait_window(struct replication_channel_t* channel, int lane_index) {
+    if (channel == NULL || lane_index < 0 || lane_index >= channel->n_lanes)
+        return;
+
+    // a lagging channel in async mode holds up to REPLICATION_ASYNC_FACTOR limits, regardless of the window
+    bool lagging = channel->lag_limit > 0 && __atomic_load_n(&channel->lag.lagging, __ATOMIC_RELAXED);
+    bool ahead = lagging && channel->lag_policy == REPLICATION_LAG_ASYNC;
+    struct replication_lane_t* lane = &channel->lanes[lane_index];
+    pthread_mutex_lock(&lane->mutex);
+    while (!ahead && !lane->closed && lane->next_seq - lane->acked_seq > (uint64_t)channel->window)
+        pthread_cond_wait(&lane->cond, &lane->mutex);
+    pthread_mutex_unlock(&lane->mutex);
+    if (!lagging)
+        return;
+
+    uint64_t limit = ahead ? channel->lag_limit * REPLICATION_ASYNC_FACTOR : channel->lag_limit;
+    if (__atomic_load_n(&channel->lag.bytes_in_flight, __ATOMIC_RELAXED) <= limit)
+        return;
+    __atomic_fetch_add(&channel->lag.throttled, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&channel->lag_mutex);
+    __atomic_add_fetch(&channel->lag_waiters, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&channel->stopped, __ATOMIC_ACQUIRE) && __atomic_load_n(&channel->lag.bytes_in_flight, __ATOMIC_SEQ_CST) > limit)
+        pthread_cond_wait(&channel->lag_cond, &channel->lag_mutex);
+    __atomic_sub_fetch(&channel->lag_waiters, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&channel->lag_mutex);
+}
+
+void replication_channel_lag(struct replication_channel_t* channel, struct replication_lag_t* lag) {
+    if (channel == NULL || lag == NULL)
+        return;
+
+    memset(lag, 0, sizeof(struct replication_lag_t));
+    for (int i = 0; i < channel->n_lanes; i++) {
+        struct replication_lane_t* lane = &channel->lanes[i];
+        pthread_mutex_lock(&lane->mutex);
+        lag->queued += lane->next_seq - lane->sent_seq;
+        lag->in_flight += lane->sent_seq - lane->acked_seq;
+        pthread_mutex_unlock(&lane->mutex);
+    }
+    lag->bytes_in_flight = __atomic_load_n(&channel->lag.bytes_in_flight, __ATOMIC_RELAXED);
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+        lag->ack_latency[i] = __atomic_load_n(&channel->lag.ack_latency[i], __ATOMIC_RELAXED);
+    lag->throttled = __atomic_load_n(&channel->lag.throttled, __ATOMIC_RELAXED);
+    lag->async_acks = __atomic_load_n(&channel->lag.async_acks, __ATOMIC_RELAXED);
+    lag->lagging = __atomic_load_n(&channel->lag.lagging, __ATOMIC_RELAXED);
+    uint64_t submitted = __atomic_load_n(&channel->submitted_chain_seq, __ATOMIC_RELAXED);
+    uint64_t acked = __atomic_load_n(&channel->acked_chain_seq, __ATOMIC_RELAXED);
+    lag->seq_lag = submitted > acked ? submitted - acked : 0;
+}
+
+void replication_channel_replace(struct replication_channel_t* from, struct replication_channel_t* successor) {
+    if (from == NULL)
+        return;
+
+    struct replication_entry_t* pending[REPLICATION_MAX_LANES];
+    channel_stop(from, pending);
+    for (int i = 0; i < from->n_lanes; i++) {
+        if (successor == NULL) {
+            // applied here, which is now the end of the chain
+            lane_complete(from, pending[i], true, 0);
+            continue;
+        }
+        if (pending[i] == NULL)
+            continue;
+
+        // both channels have as many lanes (same configuration), so keys keep their lane:
+        // the new successor continues the numbering, starting with what is pending
+        struct replication_lane_t* lane = &successor->lanes[i % successor->n_lanes];
+        struct replication_entry_t* last = pending[i];
+        int64_t held = last->frame_size;
+        while (last->next != NULL) {
+            last = last->next;
+            held += last->frame_size;
+        }
+
+        pthread_mutex_lock(&lane->mutex);
+        if (lane->head == NULL) {
+            channel_hold(successor, held);
+            lane->head = pending[i];
+            lane->tail = last;
+            lane->sent_seq = lane->acked_seq = pending[i]->seq;
+            lane->next_seq = last->seq + 1;
+            pthread_cond_broadcast(&lane->cond);
+            pthread_mutex_unlock(&lane->mutex);
+        } else {
+            pthread_mutex_unlock(&lane->mutex);
+            lane_complete(from, pending[i], true, -1);
+        }
+    }
+    replication_channel_release(from);
+}
+
+void replication_channel_destroy(struct replication_channel_t* channel) {
+    if (channel == NULL)
+        return;
+
+    struct replication_entry_t* pending[REPLICATION_MAX_LANES];
+    channel_stop(channel, pending);
+    for (int i = 0; i < channel->n_lanes; i++)
+        lane_complete(channel, pending[i], true, -1);
+    replication_channel_release(channel);
+}
+
+#endif
+
+#ifndef STREAM
+// ====================================================================================================
+//                                              Stream
+// ====================================================================================================
+
+// Replication stream received from the predecessor
+struct replication_stream_t {
+    int fd;
+    pthread_mutex_t mutex;          // serializes acknowledgements
+    int refs;                       // the serving thread plus mutations forwarded downstream
+    uint8_t* buffered;              // bytes received before the stream was handed over
+    size_t buffered_length;
+    size_t buffered_offset;
+    struct TableServerDistributedDatabase* ddb;
+};
+
+// Request of the predecessor (one mutation or a batch), acknowledged once all its mutations are
+struct stream_request_t {
+    struct replication_stream_t* stream;
+    uint64_t seq;
+    int count;                      // mutations covered
+    int pending;                    // mutations not acknowledged yet, plus one while dispatching
+    int status;
+};
+
+static void stream_release(struct replication_stream_t* stream) {
+    pthread_mutex_lock(&stream->mutex);
+    bool last = --stream->refs == 0;
+    pthread_mutex_unlock(&stream->mutex);
+    if (!last)
+        return;
+
+    close(stream->fd);
+    destroy_dynamic_memory(stream->buffered);
+    pthread_mutex_destroy(&stream->mutex);
+    destroy_dynamic_memory(stream);
+}
+
+static int stream_send_ack(struct replication_stream_t* stream, uint64_t seq, int count, int status) {
+    MessageT ack = MESSAGE_T__INIT;
+    ack.opcode = status == 0 ? MESSAGE_T__OPCODE__OP_REPLICATE + 1 : MESSAGE_T__OPCODE__OP_ERROR;
+    ack.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    ack.seq = seq;
+    ack.result = count > 1 ? count : 0;
+
+    pthread_mutex_lock(&stream->mutex);
+    int result = send_message(stream->fd, &ack);
+    pthread_mutex_unlock(&stream->mutex);
+    return result;
+}
+
+static void stream_request_done(struct stream_request_t* request, int status) {
+    if (status != 0)
+        __atomic_store_n(&request->status, -1, __ATOMIC_RELAXED);
+    if (__atomic_sub_fetch(&request->pending, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+
+    struct replication_stream_t* stream = request->stream;
+    // out of the chain, nothing is acknowledged: the predecessor sends it to the next server again
+    if (__atomic_load_n(&stream->ddb->detached, __ATOMIC_ACQUIRE))
+        shutdown(stream->fd, SHUT_RDWR);
+    else
+        stream_send_ack(stream, request->seq, request->count, __atomic_load_n(&request->status, __ATOMIC_RELAXED));
+    destroy_dynamic_memory(request);
+    stream_release(stream);
+}
+
+// acknowledges upstream a mutation acknowledged downstream
+static void stream_on_forwarded(void* arg, uint64_t tag, int status) {
+    (void)tag;
+    stream_request_done(arg, status);
+}
+
+// reads n bytes, starting with those handed over with the stream
+static int stream_read(struct replication_stream_t* stream, void* buffer, size_t n) {
+    size_t available = stream->buffered_length - stream->buffered_offset;
+    size_t from_buffer = available < n ? available : n;
+    memcpy(buffer, stream->buffered + stream->buffered_offset, from_buffer);
+    stream->buffered_offset += from_buffer;
+    if (from_buffer == n)
+        return 0;
+    return read_all(stream->fd, (uint8_t*)buffer + from_buffer, n - from_buffer) == (ssize_t)(n - from_buffer) ? 0 : -1;
+}
+
+static MessageT* stream_read_message(struct replication_stream_t* stream, struct arena_t* arena) {
+    unsigned short msg_size_be;
+    if (stream_read(stream, &msg_size_be, MESSAGE_FRAME_HEADER_SIZE) == -1)
+        return NULL;
+
+    size_t msg_size = ntohs(msg_size_be);
+    uint8_t* buffer = arena_alloc(arena, msg_size);
+    if (buffer == NULL || stream_read(stream, buffer, msg_size) == -1)
+        return NULL;
+    return message_t__unpack(&arena->allocator, msg_size, buffer);
+}
+
+// applies and forwards one mutation of request
+static void stream_apply(struct stream_request_t* request, MessageT__Opcode opcode, char* key, struct data_t* value, uint64_t chain_seq) {
+    struct TableServerDistributedDatabase* ddb = request->stream->ddb;
+    __atomic_add_fetch(&request->pending, 1, __ATOMIC_RELAXED);
+
+    // waits for room in the window downstream, which holds the predecessor back in turn
+    int result = ddb_mutate(ddb, opcode, key, value, chain_seq, stream_on_forwarded, request, 0);
+    if (result != -1)
+        db_increment_op_counter(ddb->db);
+    if (result != DDB_MUTATION_FORWARDED)
+        stream_request_done(request, result == DDB_MUTATION_APPLIED ? 0 : -1);
+}
+
+// applies and forwards the mutations of a request. Returns -1 if the stream must be closed
+static int stream_process(struct replication_stream_t* stream, MessageT* msg) {
+    if (__atomic_load_n(&stream->ddb->detached, __ATOMIC_ACQUIRE))
+        return -1;
+
+    struct stream_request_t* request = create_dynamic_memory(sizeof(struct stream_request_t));
+    if (assert_error(
+        request == NULL,
+        "stream_process",
+        ERROR_MALLOC
+    )) return -1;
+
+    pthread_mutex_lock(&stream->mutex);
+    stream->refs++;
+    pthread_mutex_unlock(&stream->mutex);
+    request->stream = stream;
+    request->seq = msg->seq;
+    request->count = msg->opcode == MESSAGE_T__OPCODE__OP_BATCH && msg->result > 1 ? msg->result : 1;
+    request->pending = 1;
+
+    size_t n_seqs = msg->n_chain_seqs;
+    if (msg->opcode == MESSAGE_T__OPCODE__OP_BATCH) {
+        // every key appears once, so the order between keys does not matter
+        for (size_t i = 0; i < msg->n_entries; i++) {
+            struct data_t value = { .datasize = msg->entries[i]->value.len, .data = msg->entries[i]->value.data };
+            stream_apply(request, MESSAGE_T__OPCODE__OP_PUT, msg->entries[i]->key, &value, i < n_seqs ? msg->chain_seqs[i] : 0);
+        }
+        for (size_t i = 0; i < msg->n_keys; i++) {
+            size_t seq_index = msg->n_entries + i;
+            stream_apply(request, MESSAGE_T__OPCODE__OP_DEL, msg->keys[i], NULL, seq_index < n_seqs ? msg->chain_seqs[seq_index] : 0);
+        }
+        // superseded mutations keep their seqs going down the chain
+        for (size_t i = msg->n_entries + msg->n_keys; i < n_seqs; i++)
+            stream_apply(request, MESSAGE_T__OPCODE__OP_BAD, "", NULL, msg->chain_seqs[i]);
+    } else if (msg->opcode == MESSAGE_T__OPCODE__OP_PUT && msg->c_type == MESSAGE_T__C_TYPE__CT_ENTRY && msg->entry != NULL) {
+        struct data_t value = { .datasize = msg->entry->value.len, .data = msg->entry->value.data };
+        stream_apply(request, MESSAGE_T__OPCODE__OP_PUT, msg->entry->key, &value, n_seqs > 0 ? msg->chain_seqs[0] : 0);
+    } else if (msg->opcode == MESSAGE_T__OPCODE__OP_DEL && msg->c_type == MESSAGE_T__C_TYPE__CT_KEY) {
+        stream_apply(request, MESSAGE_T__OPCODE__OP_DEL, msg->key, NULL, n_seqs > 0 ? msg->chain_seqs[0] : 0);
+    } else {
+        request->status = -1;
+    }
+
+    // the keys and values were copied: the message may be released before the acknowledgement
+    stream_request_done(request, 0);
+    return 0;
+}
+
+static void* stream_serve(void* _stream) {
+    struct replication_stream_t* stream = _stream;
+    LOG_INFO(REPLICATION_STREAM_OPENED);
+
+    struct arena_t* arena = arena_create(ARENA_DEFAULT_CAPACITY);
+    bool detached = __atomic_load_n(&stream->ddb->detached, __ATOMIC_ACQUIRE);
+    if (arena != NULL && !detached && stream_send_ack(stream, 0, 1, 0) == 0) {
+        while (true) {
+            MessageT* msg = stream_read_message(stream, arena);
+            if (msg == NULL)
+                break;
+
+            int result = stream_process(stream, msg);
+            release_message(msg, arena);
+            if (result == -1)
+                break;
+        }
+    }
+
+    LOG_INFO(REPLICATION_STREAM_CLOSED);
+    arena_destroy(arena);
+    shutdown(stream->fd, SHUT_RD);
+    stream_release(stream);
+    return NULL;
+}
+
+int replication_stream_start(int fd, const uint8_t* buffered, size_t length, struct TableServerDistributedDatabase* ddb) {
+    struct replication_stream_t* stream = create_dynamic_memory(sizeof(struct replication_stream_t));
+    if (assert_error(
+        stream == NULL,
+        "replication_stream_start",
+        ERROR_MALLOC
+    )) return close_and_return_failure(fd);
+
+    if (length > 0) {
+        stream->buffered = duplicate_memory((void*)buffered, length, "replication_stream_start");
+        if (stream->buffered == NULL) {
+            destroy_dynamic_memory(stream);
+            return close_and_return_failure(fd);
+        }
+    }
+
+    stream->fd = fd;
+    stream->buffered_length = length;
+    stream->refs = 1;
+    stream->ddb = ddb;
+    pthread_mutex_init(&stream->mutex, NULL);
+
+    pthread_t thread;
+    if (assert_error(
+        pthread_create(&thread, &ddb->db->thread_attr, stream_serve, stream) != 0,
+        "replication_stream_start",
+        "Failed to launch the replication stream.\n"
+    )) {
+        stream_release(stream);
+        return -1;
+    }
+    return 0;
+}
+
+#endif
@@ -7,6 +7,141 @@
 #endif
 
 #include "sdmessage.pb-c.h"
+void   successor_stats_t__init
+                     (SuccessorStatsT         *message)
+{
+  static const SuccessorStatsT init_value = SUCCESSOR_STATS_T__INIT;
+  *message = init_value;
+}
+size_t successor_stats_t__get_packed_size
+                     (const SuccessorStatsT *message)
+{
+  assert(message->base.descriptor == &successor_stats_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t successor_stats_t__pack
+                     (const SuccessorStatsT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &successor_stats_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t successor_stats_t__pack_to_buffer
+                     (const SuccessorStatsT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &successor_stats_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+SuccessorStatsT *
+       successor_stats_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (SuccessorStatsT *)
+     protobuf_c_message_unpack (&successor_stats_t__descriptor,
+                                allocator, len, data);
+}
+void   successor_stats_t__free_unpacked
+                     (SuccessorStatsT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &successor_stats_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   latency_histogram_t__init
+                     (LatencyHistogramT         *message)
+{
+  static const LatencyHistogramT init_value = LATENCY_HISTOGRAM_T__INIT;
+  *message = init_value;
+}
+size_t latency_histogram_t__get_packed_size
+                     (const LatencyHistogramT *message)
+{
+  assert(message->base.descriptor == &latency_histogram_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t latency_histogram_t__pack
+                     (const LatencyHistogramT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &latency_histogram_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t latency_histogram_t__pack_to_buffer
+                     (const LatencyHistogramT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &latency_histogram_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+LatencyHistogramT *
+       latency_histogram_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (LatencyHistogramT *)
+     protobuf_c_message_unpack (&latency_histogram_t__descriptor,
+                                allocator, len, data);
+}
+void   latency_histogram_t__free_unpacked
+                     (LatencyHistogramT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &latency_histogram_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   memory_tag_t__init
+                     (MemoryTagT         *message)
+{
+  static const MemoryTagT init_value = MEMORY_TAG_T__INIT;
+  *message = init_value;
+}
+size_t memory_tag_t__get_packed_size
+                     (const MemoryTagT *message)
+{
+  assert(message->base.descriptor == &memory_tag_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t memory_tag_t__pack
+                     (const MemoryTagT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &memory_tag_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t memory_tag_t__pack_to_buffer
+                     (const MemoryTagT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &memory_tag_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+MemoryTagT *
+       memory_tag_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (MemoryTagT *)
+     protobuf_c_message_unpack (&memory_tag_t__descriptor,
+                                allocator, len, data);
+}
+void   memory_tag_t__free_unpacked
+                     (MemoryTagT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &memory_tag_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 void   server_stats_t__init
                      (ServerStatsT         *message)
 {
@@ -52,6 +187,96 @@ void   server_stats_t__free_unpacked
   assert(message->base.descriptor == &server_stats_t__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   slow_op_t__init
+                     (SlowOpT         *message)
+{
+  static const SlowOpT init_value = SLOW_OP_T__INIT;
+  *message = init_value;
+}
+size_t slow_op_t__get_packed_size
+                     (const SlowOpT *message)
+{
+  assert(message->base.descriptor == &slow_op_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t slow_op_t__pack
+                     (const SlowOpT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &slow_op_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t slow_op_t__pack_to_buffer
+                     (const SlowOpT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &slow_op_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+SlowOpT *
+       slow_op_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (SlowOpT *)
+     protobuf_c_message_unpack (&slow_op_t__descriptor,
+                                allocator, len, data);
+}
+void   slow_op_t__free_unpacked
+                     (SlowOpT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &slow_op_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   hot_key_t__init
+                     (HotKeyT         *message)
+{
+  static const HotKeyT init_value = HOT_KEY_T__INIT;
+  *message = init_value;
+}
+size_t hot_key_t__get_packed_size
+                     (const HotKeyT *message)
+{
+  assert(message->base.descriptor == &hot_key_t__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t hot_key_t__pack
+                     (const HotKeyT *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &hot_key_t__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t hot_key_t__pack_to_buffer
+                     (const HotKeyT *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &hot_key_t__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+HotKeyT *
+       hot_key_t__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (HotKeyT *)
+     protobuf_c_message_unpack (&hot_key_t__descriptor,
+                                allocator, len, data);
+}
+void   hot_key_t__free_unpacked
+                     (HotKeyT *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &hot_key_t__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 void   entry_t__init
                      (EntryT         *message)
 {
@@ -142,39 +367,457 @@ void   message_t__free_unpacked
   assert(message->base.descriptor == &message_t__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
-static const ProtobufCFieldDescriptor server_stats_t__field_descriptors[3] =
+static const ProtobufCFieldDescriptor successor_stats_t__field_descriptors[9] =
+{
+  {
+    "address",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, address),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "queued",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, queued),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "in_flight",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, in_flight),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "bytes_in_flight",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, bytes_in_flight),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "seq_lag",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, seq_lag),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "ack_latency",
+    6,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_INT64,
+    offsetof(SuccessorStatsT, n_ack_latency),
+    offsetof(SuccessorStatsT, ack_latency),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "throttled",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, throttled),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "async_acks",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, async_acks),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "lagging",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(SuccessorStatsT, lagging),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned successor_stats_t__field_indices_by_name[] = {
+  5,   /* field[5] = ack_latency */
+  0,   /* field[0] = address */
+  7,   /* field[7] = async_acks */
+  3,   /* field[3] = bytes_in_flight */
+  2,   /* field[2] = in_flight */
+  8,   /* field[8] = lagging */
+  1,   /* field[1] = queued */
+  4,   /* field[4] = seq_lag */
+  6,   /* field[6] = throttled */
+};
+static const ProtobufCIntRange successor_stats_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 9 }
+};
+const ProtobufCMessageDescriptor successor_stats_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "successor_stats_t",
+  "SuccessorStatsT",
+  "SuccessorStatsT",
+  "",
+  sizeof(SuccessorStatsT),
+  9,
+  successor_stats_t__field_descriptors,
+  successor_stats_t__field_indices_by_name,
+  1,  successor_stats_t__number_ranges,
+  (ProtobufCMessageInit) successor_stats_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor latency_histogram_t__field_descriptors[5] =
+{
+  {
+    "op",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT32,
+    0,   /* quantifier_offset */
+    offsetof(LatencyHistogramT, op),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "phase",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT32,
+    0,   /* quantifier_offset */
+    offsetof(LatencyHistogramT, phase),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "buckets",
+    3,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_INT64,
+    offsetof(LatencyHistogramT, n_buckets),
+    offsetof(LatencyHistogramT, buckets),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sum_ns",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(LatencyHistogramT, sum_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "max_ns",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(LatencyHistogramT, max_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned latency_histogram_t__field_indices_by_name[] = {
+  2,   /* field[2] = buckets */
+  4,   /* field[4] = max_ns */
+  0,   /* field[0] = op */
+  1,   /* field[1] = phase */
+  3,   /* field[3] = sum_ns */
+};
+static const ProtobufCIntRange latency_histogram_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 5 }
+};
+const ProtobufCMessageDescriptor latency_histogram_t__descriptor =
 {
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "latency_histogram_t",
+  "LatencyHistogramT",
+  "LatencyHistogramT",
+  "",
+  sizeof(LatencyHistogramT),
+  5,
+  latency_histogram_t__field_descriptors,
+  latency_histogram_t__field_indices_by_name,
+  1,  latency_histogram_t__number_ranges,
+  (ProtobufCMessageInit) latency_histogram_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor memory_tag_t__field_descriptors[5] =
+{
+  {
+    "tag",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(MemoryTagT, tag),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "bytes",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(MemoryTagT, bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "objects",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(MemoryTagT, objects),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "allocations",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(MemoryTagT, allocations),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "allocated_bytes",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(MemoryTagT, allocated_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned memory_tag_t__field_indices_by_name[] = {
+  4,   /* field[4] = allocated_bytes */
+  3,   /* field[3] = allocations */
+  1,   /* field[1] = bytes */
+  2,   /* field[2] = objects */
+  0,   /* field[0] = tag */
+};
+static const ProtobufCIntRange memory_tag_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 5 }
+};
+const ProtobufCMessageDescriptor memory_tag_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "memory_tag_t",
+  "MemoryTagT",
+  "MemoryTagT",
+  "",
+  sizeof(MemoryTagT),
+  5,
+  memory_tag_t__field_descriptors,
+  memory_tag_t__field_indices_by_name,
+  1,  memory_tag_t__number_ranges,
+  (ProtobufCMessageInit) memory_tag_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor server_stats_t__field_descriptors[11] =
+{
+  {
+    "op_counter",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(ServerStatsT, op_counter),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "active_clients",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT32,
+    0,   /* quantifier_offset */
+    offsetof(ServerStatsT, active_clients),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "computed_time",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(ServerStatsT, computed_time),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
   {
-    "op_counter",
-    1,
+    "replication_batches",
+    4,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_INT64,
+    offsetof(ServerStatsT, n_replication_batches),
+    offsetof(ServerStatsT, replication_batches),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "replication_bytes_saved",
+    5,
     PROTOBUF_C_LABEL_NONE,
-    PROTOBUF_C_TYPE_INT32,
+    PROTOBUF_C_TYPE_INT64,
     0,   /* quantifier_offset */
-    offsetof(ServerStatsT, op_counter),
+    offsetof(ServerStatsT, replication_bytes_saved),
     NULL,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "active_clients",
-    2,
+    "replication_coalesced",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(ServerStatsT, replication_coalesced),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "successors",
+    7,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(ServerStatsT, n_successors),
+    offsetof(ServerStatsT, successors),
+    &successor_stats_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "latencies",
+    8,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(ServerStatsT, n_latencies),
+    offsetof(ServerStatsT, latencies),
+    &latency_histogram_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "timing_sample",
+    9,
     PROTOBUF_C_LABEL_NONE,
     PROTOBUF_C_TYPE_INT32,
     0,   /* quantifier_offset */
-    offsetof(ServerStatsT, active_clients),
+    offsetof(ServerStatsT, timing_sample),
     NULL,
     NULL,
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
   {
-    "computed_time",
-    3,
+    "memory",
+    10,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(ServerStatsT, n_memory),
+    offsetof(ServerStatsT, memory),
+    &memory_tag_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "uptime_ms",
+    11,
     PROTOBUF_C_LABEL_NONE,
     PROTOBUF_C_TYPE_INT64,
     0,   /* quantifier_offset */
-    offsetof(ServerStatsT, computed_time),
+    offsetof(ServerStatsT, uptime_ms),
     NULL,
     NULL,
     0,             /* flags */
@@ -184,12 +827,20 @@ static const ProtobufCFieldDescriptor server_stats_t__field_descriptors[3] =
 static const unsigned server_stats_t__field_indices_by_name[] = {
   1,   /* field[1] = active_clients */
   2,   /* field[2] = computed_time */
+  7,   /* field[7] = latencies */
+  9,   /* field[9] = memory */
   0,   /* field[0] = op_counter */
+  3,   /* field[3] = replication_batches */
+  4,   /* field[4] = replication_bytes_saved */
+  5,   /* field[5] = replication_coalesced */
+  6,   /* field[6] = successors */
+  8,   /* field[8] = timing_sample */
+  10,   /* field[10] = uptime_ms */
 };
 static const ProtobufCIntRange server_stats_t__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 3 }
+  { 0, 11 }
 };
 const ProtobufCMessageDescriptor server_stats_t__descriptor =
 {
@@ -199,13 +850,219 @@ const ProtobufCMessageDescriptor server_stats_t__descriptor =
   "ServerStatsT",
   "",
   sizeof(ServerStatsT),
-  3,
+  11,
   server_stats_t__field_descriptors,
   server_stats_t__field_indices_by_name,
   1,  server_stats_t__number_ranges,
   (ProtobufCMessageInit) server_stats_t__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
+static const ProtobufCFieldDescriptor slow_op_t__field_descriptors[9] =
+{
+  {
+    "time_ms",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, time_ms),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "opcode",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT32,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, opcode),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "key",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, key),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "value_size",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT32,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, value_size),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "lock_wait_ns",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, lock_wait_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "table_ns",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, table_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "replication_ns",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, replication_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "serialization_ns",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, serialization_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "total_ns",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(SlowOpT, total_ns),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned slow_op_t__field_indices_by_name[] = {
+  2,   /* field[2] = key */
+  4,   /* field[4] = lock_wait_ns */
+  1,   /* field[1] = opcode */
+  6,   /* field[6] = replication_ns */
+  7,   /* field[7] = serialization_ns */
+  5,   /* field[5] = table_ns */
+  0,   /* field[0] = time_ms */
+  8,   /* field[8] = total_ns */
+  3,   /* field[3] = value_size */
+};
+static const ProtobufCIntRange slow_op_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 9 }
+};
+const ProtobufCMessageDescriptor slow_op_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "slow_op_t",
+  "SlowOpT",
+  "SlowOpT",
+  "",
+  sizeof(SlowOpT),
+  9,
+  slow_op_t__field_descriptors,
+  slow_op_t__field_indices_by_name,
+  1,  slow_op_t__number_ranges,
+  (ProtobufCMessageInit) slow_op_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor hot_key_t__field_descriptors[3] =
+{
+  {
+    "key",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(HotKeyT, key),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "ops",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(HotKeyT, ops),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "bytes",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_INT64,
+    0,   /* quantifier_offset */
+    offsetof(HotKeyT, bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned hot_key_t__field_indices_by_name[] = {
+  2,   /* field[2] = bytes */
+  0,   /* field[0] = key */
+  1,   /* field[1] = ops */
+};
+static const ProtobufCIntRange hot_key_t__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 3 }
+};
+const ProtobufCMessageDescriptor hot_key_t__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "hot_key_t",
+  "HotKeyT",
+  "HotKeyT",
+  "",
+  sizeof(HotKeyT),
+  3,
+  hot_key_t__field_descriptors,
+  hot_key_t__field_indices_by_name,
+  1,  hot_key_t__number_ranges,
+  (ProtobufCMessageInit) hot_key_t__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
 static const ProtobufCFieldDescriptor entry_t__field_descriptors[2] =
 {
   {
@@ -257,7 +1114,7 @@ const ProtobufCMessageDescriptor entry_t__descriptor =
   (ProtobufCMessageInit) entry_t__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[9] =
+static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[17] =
 {
   { "OP_BAD", "MESSAGE_T__OPCODE__OP_BAD", 0 },
   { "OP_PUT", "MESSAGE_T__OPCODE__OP_PUT", 10 },
@@ -267,21 +1124,37 @@ static const ProtobufCEnumValue message_t__opcode__enum_values_by_number[9] =
   { "OP_GETKEYS", "MESSAGE_T__OPCODE__OP_GETKEYS", 50 },
   { "OP_GETTABLE", "MESSAGE_T__OPCODE__OP_GETTABLE", 60 },
   { "OP_STATS", "MESSAGE_T__OPCODE__OP_STATS", 70 },
+  { "OP_HELLO", "MESSAGE_T__OPCODE__OP_HELLO", 80 },
+  { "OP_REPLICATE", "MESSAGE_T__OPCODE__OP_REPLICATE", 90 },
+  { "OP_BATCH", "MESSAGE_T__OPCODE__OP_BATCH", 95 },
   { "OP_ERROR", "MESSAGE_T__OPCODE__OP_ERROR", 99 },
+  { "OP_SNAPSHOT", "MESSAGE_T__OPCODE__OP_SNAPSHOT", 100 },
+  { "OP_MIGRATE", "MESSAGE_T__OPCODE__OP_MIGRATE", 110 },
+  { "OP_DIGEST", "MESSAGE_T__OPCODE__OP_DIGEST", 120 },
+  { "OP_SLOWLOG", "MESSAGE_T__OPCODE__OP_SLOWLOG", 130 },
+  { "OP_HOTKEYS", "MESSAGE_T__OPCODE__OP_HOTKEYS", 140 },
 };
 static const ProtobufCIntRange message_t__opcode__value_ranges[] = {
-{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{99, 8},{0, 9}
+{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{90, 9},{95, 10},{99, 11},{110, 13},{120, 14},{130, 15},{140, 16},{0, 17}
 };
-static const ProtobufCEnumValueIndex message_t__opcode__enum_values_by_name[9] =
+static const ProtobufCEnumValueIndex message_t__opcode__enum_values_by_name[17] =
 {
   { "OP_BAD", 0 },
+  { "OP_BATCH", 10 },
   { "OP_DEL", 3 },
-  { "OP_ERROR", 8 },
+  { "OP_DIGEST", 14 },
+  { "OP_ERROR", 11 },
   { "OP_GET", 2 },
   { "OP_GETKEYS", 5 },
   { "OP_GETTABLE", 6 },
+  { "OP_HELLO", 8 },
+  { "OP_HOTKEYS", 16 },
+  { "OP_MIGRATE", 13 },
   { "OP_PUT", 1 },
+  { "OP_REPLICATE", 9 },
   { "OP_SIZE", 4 },
+  { "OP_SLOWLOG", 15 },
+  { "OP_SNAPSHOT", 12 },
   { "OP_STATS", 7 },
 };
 const ProtobufCEnumDescriptor message_t__opcode__descriptor =
@@ -291,15 +1164,15 @@ const ProtobufCEnumDescriptor message_t__opcode__descriptor =
   "Opcode",
   "MessageT__Opcode",
   "",
-  9,
+  17,
   message_t__opcode__enum_values_by_number,
-  9,
+  17,
   message_t__opcode__enum_values_by_name,
-  9,
+  16,
   message_t__opcode__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
-static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[9] =
+static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[11] =
 {
   { "CT_BAD", "MESSAGE_T__C_TYPE__CT_BAD", 0 },
   { "CT_ENTRY", "MESSAGE_T__C_TYPE__CT_ENTRY", 10 },
@@ -310,18 +1183,22 @@ static const ProtobufCEnumValue message_t__c_type__enum_values_by_number[9] =
   { "CT_TABLE", "MESSAGE_T__C_TYPE__CT_TABLE", 60 },
   { "CT_NONE", "MESSAGE_T__C_TYPE__CT_NONE", 70 },
   { "CT_STATS", "MESSAGE_T__C_TYPE__CT_STATS", 80 },
+  { "CT_SLOW_OPS", "MESSAGE_T__C_TYPE__CT_SLOW_OPS", 90 },
+  { "CT_HOT_KEYS", "MESSAGE_T__C_TYPE__CT_HOT_KEYS", 100 },
 };
 static const ProtobufCIntRange message_t__c_type__value_ranges[] = {
-{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{0, 9}
+{0, 0},{10, 1},{20, 2},{30, 3},{40, 4},{50, 5},{60, 6},{70, 7},{80, 8},{90, 9},{100, 10},{0, 11}
 };
-static const ProtobufCEnumValueIndex message_t__c_type__enum_values_by_name[9] =
+static const ProtobufCEnumValueIndex message_t__c_type__enum_values_by_name[11] =
 {
   { "CT_BAD", 0 },
   { "CT_ENTRY", 1 },
+  { "CT_HOT_KEYS", 10 },
   { "CT_KEY", 2 },
   { "CT_KEYS", 5 },
   { "CT_NONE", 7 },
   { "CT_RESULT", 4 },
+  { "CT_SLOW_OPS", 9 },
   { "CT_STATS", 8 },
   { "CT_TABLE", 6 },
   { "CT_VALUE", 3 },
@@ -333,15 +1210,15 @@ const ProtobufCEnumDescriptor message_t__c_type__descriptor =
   "C_type",
   "MessageT__CType",
   "",
-  9,
+  11,
   message_t__c_type__enum_values_by_number,
-  9,
+  11,
   message_t__c_type__enum_values_by_name,
-  9,
+  11,
   message_t__c_type__value_ranges,
   NULL,NULL,NULL,NULL   /* reserved[1234] */
 };
-static const ProtobufCFieldDescriptor message_t__field_descriptors[9] =
+static const ProtobufCFieldDescriptor message_t__field_descriptors[14] =
 {
   {
     "opcode",
@@ -451,22 +1328,87 @@ static const ProtobufCFieldDescriptor message_t__field_descriptors[9] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "seq",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(MessageT, seq),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "chain_seqs",
+    11,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_UINT64,
+    offsetof(MessageT, n_chain_seqs),
+    offsetof(MessageT, chain_seqs),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "digests",
+    12,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_UINT32,
+    offsetof(MessageT, n_digests),
+    offsetof(MessageT, digests),
+    NULL,
+    NULL,
+    0 | PROTOBUF_C_FIELD_FLAG_PACKED,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "slow_ops",
+    13,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(MessageT, n_slow_ops),
+    offsetof(MessageT, slow_ops),
+    &slow_op_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "hot_keys",
+    14,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(MessageT, n_hot_keys),
+    offsetof(MessageT, hot_keys),
+    &hot_key_t__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned message_t__field_indices_by_name[] = {
   1,   /* field[1] = c_type */
+  10,   /* field[10] = chain_seqs */
+  11,   /* field[11] = digests */
   7,   /* field[7] = entries */
   2,   /* field[2] = entry */
+  13,   /* field[13] = hot_keys */
   3,   /* field[3] = key */
   6,   /* field[6] = keys */
   0,   /* field[0] = opcode */
   5,   /* field[5] = result */
+  9,   /* field[9] = seq */
+  12,   /* field[12] = slow_ops */
   8,   /* field[8] = stats */
   4,   /* field[4] = value */
 };
 static const ProtobufCIntRange message_t__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 9 }
+  { 0, 14 }
 };
 const ProtobufCMessageDescriptor message_t__descriptor =
 {
@@ -476,7 +1418,7 @@ const ProtobufCMessageDescriptor message_t__descriptor =
   "MessageT",
   "",
   sizeof(MessageT),
-  9,
+  14,
   message_t__field_descriptors,
   message_t__field_indices_by_name,
   1,  message_t__number_ranges,
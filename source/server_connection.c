@@ -0,0 +1,383 @@
+#include "server_connection.h"
+
+#include "network_server-private.h"
+#include "table_skel.h"
+#include "compact_protocol.h"
+#include "message.h"
+#include "utils.h"
+#include "sdmessage.pb-c.h"
+#include "replication.h"
+#include "snapshot.h"
+#include "logger.h"
+#include "slowlog.h"
+#include "probes.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+
+// grow buffer (keeping the first length bytes) so that it holds at least needed bytes
+static int ensure_capacity(uint8_t** buffer, size_t* capacity, size_t length, size_t needed) {
+    if (*capacity >= needed)
+        return 0;
+
+    size_t new_capacity = *capacity > 0 ? *capacity : SERVER_CONNECTION_MIN_READ;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    uint8_t* new_buffer = create_tagged_memory(MEMORY_CONNECTIONS, new_capacity);
+    if (assert_error(
+        new_buffer == NULL,
+        "server_connection",
+        ERROR_MALLOC
+    )) return -1;
+
+    if (length > 0)
+        memcpy(new_buffer, *buffer, length);
+    destroy_tagged_memory(MEMORY_CONNECTIONS, *buffer);
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 0;
+}
+
+// called once the chain acknowledged the pending write of a connection, from any thread
+static void server_connection_on_replicated(void* arg, uint64_t tag, int status) {
+    (void)tag;
+    struct ServerConnection* conn = arg;
+    struct server_completions_t* completions = conn->completions;
+    conn->status = status;
+    conn->next_completed = NULL;
+    pthread_mutex_lock(&completions->mutex);
+    if (completions->last != NULL)
+        completions->last->next_completed = conn;
+    else
+        completions->first = conn;
+    completions->last = conn;
+    pthread_mutex_unlock(&completions->mutex);
+    eventfd_write(completions->event_fd, 1);
+}
+
+struct ServerConnection* server_connection_create(int fd, uint8_t* tx_buffer, size_t tx_capacity, struct server_completions_t* completions) {
+    struct ServerConnection* conn = create_tagged_memory(MEMORY_CONNECTIONS, sizeof(struct ServerConnection));
+    if (assert_error(
+        conn == NULL,
+        "server_connection_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    conn->arena = arena_create(ARENA_DEFAULT_CAPACITY);
+    if (conn->arena == NULL) {
+        destroy_tagged_memory(MEMORY_CONNECTIONS, conn);
+        return NULL;
+    }
+
+    conn->fd = fd;
+    conn->fixed_tx = tx_buffer != NULL;
+    conn->tx_buffer = tx_buffer;
+    conn->tx_capacity = tx_buffer != NULL ? tx_capacity : 0;
+    conn->completions = completions;
+    conn->pending.callback = server_connection_on_replicated;
+    conn->pending.arg = conn;
+    return conn;
+}
+
+void server_connection_destroy(struct ServerConnection* conn) {
+    if (assert_error(
+        conn == NULL,
+        "server_connection_destroy",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    close(conn->fd);
+    destroy_dynamic_memory(conn->successor);
+    destroy_dynamic_memory(conn->pending.key);
+    destroy_tagged_memory(MEMORY_CONNECTIONS, conn->rx_buffer);
+    arena_destroy(conn->arena);
+    if (!conn->fixed_tx)
+        destroy_tagged_memory(MEMORY_CONNECTIONS, conn->tx_buffer);
+    destroy_tagged_memory(MEMORY_CONNECTIONS, conn);
+}
+
+uint8_t* server_connection_rx_space(struct ServerConnection* conn, size_t* available) {
+    if (assert_error(
+        conn == NULL || available == NULL,
+        "server_connection_rx_space",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    if (ensure_capacity(&conn->rx_buffer, &conn->rx_capacity, conn->rx_length, conn->rx_length + SERVER_CONNECTION_MIN_READ) == -1)
+        return NULL;
+
+    *available = conn->rx_capacity - conn->rx_length;
+    return conn->rx_buffer + conn->rx_length;
+}
+
+void server_connection_rx_commit(struct ServerConnection* conn, size_t n) {
+    conn->rx_length += n;
+}
+
+int server_connection_receive(struct ServerConnection* conn, const uint8_t* data, size_t n) {
+    if (assert_error(
+        conn == NULL || data == NULL,
+        "server_connection_receive",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (ensure_capacity(&conn->rx_buffer, &conn->rx_capacity, conn->rx_length, conn->rx_length + n) == -1)
+        return -1;
+
+    memcpy(conn->rx_buffer + conn->rx_length, data, n);
+    conn->rx_length += n;
+    return 0;
+}
+
+// serialize the response to the end of the transmit buffer
+static int append_response(struct ServerConnection* conn, MessageT* response) {
+    size_t frame_size = message_frame_size(response);
+    if (frame_size == 0)
+        return -1;
+
+    if (!conn->fixed_tx && ensure_capacity(&conn->tx_buffer, &conn->tx_capacity, conn->tx_length, conn->tx_length + frame_size) == -1)
+        return -1;
+
+    ssize_t written = pack_message_frame(response, conn->tx_buffer + conn->tx_length, conn->tx_capacity - conn->tx_length);
+    if (written < 0)
+        return -1;
+
+    conn->tx_length += written;
+    return 0;
+}
+
+// process the protobuf frame at offset. Returns the frame size, 0 if incomplete, or -1 on error
+static ssize_t process_message_frame(struct ServerConnection* conn, size_t offset, struct TableServerDistributedDatabase* ddb) {
+    if (conn->rx_length - offset < MESSAGE_FRAME_HEADER_SIZE)
+        return 0;
+
+    unsigned short msg_size_be;
+    memcpy(&msg_size_be, conn->rx_buffer + offset, MESSAGE_FRAME_HEADER_SIZE);
+    size_t msg_size = ntohs(msg_size_be);
+    if (conn->rx_length - offset - MESSAGE_FRAME_HEADER_SIZE < msg_size)
+        return 0; // wait for the rest of the frame
+
+    MessageT* request = message_t__unpack(&conn->arena->allocator, msg_size, conn->rx_buffer + offset + MESSAGE_FRAME_HEADER_SIZE);
+    if (assert_error(
+        request == NULL,
+        "server_connection_process",
+        "Failed to unpack client request.\n"
+    )) {
+        arena_reset(conn->arena);
+        return -1;
+    }
+
+    // the predecessor opens its replication stream, or a joining server (or chain) its snapshot
+    // stream: the backend hands the connection over
+    if ((request->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT || request->opcode == MESSAGE_T__OPCODE__OP_MIGRATE) && request->key != NULL) {
+        conn->successor = strdup(request->key);
+        conn->since = request->seq;
+        conn->chain = request->opcode == MESSAGE_T__OPCODE__OP_MIGRATE ? request->result : -1;
+        if (conn->successor == NULL) {
+            release_message(request, conn->arena);
+            return -1;
+        }
+    }
+    if (request->opcode == MESSAGE_T__OPCODE__OP_REPLICATE || conn->successor != NULL) {
+        conn->replication = true;
+        release_message(request, conn->arena);
+        return MESSAGE_FRAME_HEADER_SIZE + msg_size;
+    }
+
+    PROBE1(request__receive, conn->fd);
+    LOG_DEBUG(SERVER_RECEIVED_REQUEST);
+    // a write forwarded down the chain is answered by server_connection_complete()
+    struct invoke_pending_t* pending = conn->completions != NULL ? &conn->pending : NULL;
+    bool failed = invoke_async(request, ddb, pending) == -1 || (!conn->pending.pending && append_response(conn, request) == -1);
+    slowlog_end();
+    if (failed) {
+        release_message(request, conn->arena);
+        return -1;
+    }
+    if (!conn->pending.pending) {
+        PROBE2(request__send, conn->fd, request->opcode);
+        LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    }
+
+    // following frames use the compact protocol
+    if (request->opcode == MESSAGE_T__OPCODE__OP_HELLO + 1)
+        conn->compact = true;
+    release_message(request, conn->arena);
+    return MESSAGE_FRAME_HEADER_SIZE + msg_size;
+}
+
+// process the compact frame at offset. Returns the frame size, 0 if incomplete, or -1 on error
+static ssize_t process_compact_frame(struct ServerConnection* conn, size_t offset, struct TableServerDistributedDatabase* ddb) {
+    if (conn->rx_length - offset < COMPACT_HEADER_SIZE)
+        return 0;
+
+    struct compact_header_t header;
+    if (compact_header_decode(conn->rx_buffer + offset, &header) == -1)
+        return -1;
+
+    size_t payload_size = compact_payload_size(&header);
+    if (conn->rx_length - offset - COMPACT_HEADER_SIZE < payload_size)
+        return 0; // wait for the rest of the frame
+
+    if (!conn->fixed_tx && ensure_capacity(&conn->tx_buffer, &conn->tx_capacity, conn->tx_length, conn->tx_length + COMPACT_MAX_FRAME_SIZE) == -1)
+        return -1;
+
+    // the response is written in place at the end of the transmit buffer
+    PROBE1(request__receive, conn->fd);
+    LOG_DEBUG(SERVER_RECEIVED_REQUEST);
+    ssize_t written = compact_invoke_async(
+        &header, conn->rx_buffer + offset + COMPACT_HEADER_SIZE, ddb,
+        conn->tx_buffer + conn->tx_length, conn->tx_capacity - conn->tx_length,
+        conn->completions != NULL ? &conn->pending : NULL
+    );
+    if (written < 0)
+        return -1;
+    if (written > 0) {
+        PROBE2(request__send, conn->fd, header.opcode);
+        LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    }
+
+    conn->tx_length += written;
+    return COMPACT_HEADER_SIZE + payload_size;
+}
+
+int server_connection_process(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        conn == NULL || ddb == NULL,
+        "server_connection_process",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    size_t offset = 0;
+    int processed = 0;
+    while (offset < conn->rx_length && !conn->replication && !conn->pending.pending) {
+        // a fixed transmit buffer must be able to take any response before a request is executed
+        if (conn->fixed_tx && conn->tx_capacity - conn->tx_length < COMPACT_MAX_FRAME_SIZE)
+            break;
+
+        ssize_t frame_size = conn->compact
+            ? process_compact_frame(conn, offset, ddb)
+            : process_message_frame(conn, offset, ddb);
+        if (frame_size == -1)
+            return -1;
+        if (frame_size == 0)
+            break;
+
+        offset += frame_size;
+        processed++;
+    }
+
+    // keep only the bytes of incomplete frames
+    if (offset > 0) {
+        memmove(conn->rx_buffer, conn->rx_buffer + offset, conn->rx_length - offset);
+        conn->rx_length -= offset;
+    }
+    return processed;
+}
+
+int server_connection_complete(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        conn == NULL || ddb == NULL || !conn->pending.pending,
+        "server_connection_complete",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the room taken before the request was executed is still there, nothing having been appended since
+    if (!conn->fixed_tx && ensure_capacity(&conn->tx_buffer, &conn->tx_capacity, conn->tx_length, conn->tx_length + COMPACT_MAX_FRAME_SIZE) == -1)
+        return -1;
+
+    ssize_t written = invoke_complete(&conn->pending, conn->status, ddb, conn->tx_buffer + conn->tx_length, conn->tx_capacity - conn->tx_length);
+    if (written < 0)
+        return -1;
+    PROBE2(request__send, conn->fd, conn->pending.frame != 0 ? conn->pending.frame : conn->pending.opcode + 1);
+    LOG_DEBUG(SERVER_SENT_MSG_TO_CLIENT);
+    conn->tx_length += written;
+    return 0;
+}
+
+int server_completions_init(struct server_completions_t* completions) {
+    if (assert_error(
+        completions == NULL,
+        "server_completions_init",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    completions->first = NULL;
+    completions->last = NULL;
+    completions->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (assert_error(
+        completions->event_fd < 0,
+        "server_completions_init",
+        "Failed to create the completion eventfd.\n"
+    )) return -1;
+    pthread_mutex_init(&completions->mutex, NULL);
+    return 0;
+}
+
+void server_completions_destroy(struct server_completions_t* completions) {
+    if (completions == NULL || completions->event_fd < 0)
+        return;
+    close(completions->event_fd);
+    completions->event_fd = -1;
+    pthread_mutex_destroy(&completions->mutex);
+}
+
+struct ServerConnection* server_completions_take(struct server_completions_t* completions) {
+    if (assert_error(
+        completions == NULL,
+        "server_completions_take",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    // read before the list is taken, so that a connection queued meanwhile wakes the backend again
+    eventfd_t count;
+    eventfd_read(completions->event_fd, &count);
+    pthread_mutex_lock(&completions->mutex);
+    struct ServerConnection* first = completions->first;
+    completions->first = NULL;
+    completions->last = NULL;
+    pthread_mutex_unlock(&completions->mutex);
+    return first;
+}
+
+int server_connection_start_replication(struct ServerConnection* conn, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        conn == NULL || ddb == NULL,
+        "server_connection_start_replication",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    int fd = conn->fd;
+    int flags = fcntl(fd, F_GETFL, 0);
+    bool failed = flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0
+        || (conn->tx_length > 0 && write_all(fd, conn->tx_buffer, conn->tx_length) != (ssize_t)conn->tx_length);
+
+    int result = -1;
+    if (failed)
+        close_and_return_failure(fd);
+    else if (conn->successor != NULL)
+        result = snapshot_stream_start(fd, conn->successor, conn->since, conn->chain, ddb);
+    else
+        result = replication_stream_start(fd, conn->rx_buffer, conn->rx_length, ddb);
+    destroy_dynamic_memory(conn->successor);
+    destroy_tagged_memory(MEMORY_CONNECTIONS, conn->rx_buffer);
+    arena_destroy(conn->arena);
+    if (!conn->fixed_tx)
+        destroy_tagged_memory(MEMORY_CONNECTIONS, conn->tx_buffer);
+    destroy_tagged_memory(MEMORY_CONNECTIONS, conn);
+    return result;
+}
+
+void server_connection_tx_consume(struct ServerConnection* conn, size_t n) {
+    if (n >= conn->tx_length) {
+        conn->tx_length = 0;
+        return;
+    }
+    memmove(conn->tx_buffer, conn->tx_buffer + n, conn->tx_length - n);
+    conn->tx_length -= n;
+}
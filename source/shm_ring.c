@@ -0,0 +1,318 @@
+#define _GNU_SOURCE
+
+#include "shm_ring.h"
+
+#include "message.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define SHM_RING_MASK (SHM_RING_SIZE - 1)
+
+#ifndef SHM_SYNCHRONIZATION
+// ====================================================================================================
+//                                         Synchronization
+// ====================================================================================================
+
+// futexes on the shared mapping must not be process-private
+static void shm_futex_wait(uint32_t* word, uint32_t expected) {
+    struct timespec timeout = { .tv_sec = 0, .tv_nsec = SHM_WAIT_TIMEOUT_MS * 1000000L };
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void shm_futex_wake(uint32_t* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void shm_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// the peer is gone once it closed the channel or its end of the Unix socket
+static bool shm_peer_alive(struct shm_endpoint_t* endpoint) {
+    if (__atomic_load_n(&endpoint->channel->closed, __ATOMIC_ACQUIRE))
+        return false;
+
+    struct pollfd pfd = { .fd = endpoint->peer_fd, .events = POLLRDHUP };
+    return !(poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR)));
+}
+
+// waits until *word changes from seen: spins briefly, then sleeps on the futex.
+// Returns 0 (OK) or -1 if the peer went away.
+static int shm_wait(struct shm_endpoint_t* endpoint, uint32_t* word, uint32_t* waiting, uint32_t seen) {
+    for (int i = 0; i < SHM_SPIN_ITERATIONS; i++) {
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen)
+            return 0;
+        shm_cpu_relax();
+    }
+
+    int result = 0;
+    while (true) {
+        // sequentially consistent with shm_notify: either the waker sees the flag or we see the new value
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(word, __ATOMIC_SEQ_CST) != seen)
+            break;
+        shm_futex_wait(word, seen);
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen)
+            break;
+        if (!shm_peer_alive(endpoint)) {
+            result = -1;
+            break;
+        }
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+    return result;
+}
+
+static void shm_notify(uint32_t* word, uint32_t* waiting) {
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST))
+        shm_futex_wake(word);
+}
+
+#endif
+
+#ifndef SHM_RING_OPERATIONS
+// ====================================================================================================
+//                                          Ring Operations
+// ====================================================================================================
+
+// producer: waits until n bytes can be written at the tail
+static int shm_ring_wait_space(struct shm_endpoint_t* endpoint, uint32_t n) {
+    struct shm_ring_t* ring = endpoint->tx;
+    while (true) {
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (SHM_RING_SIZE - (ring->tail - head) >= n)
+            return 0;
+        if (shm_wait(endpoint, &ring->head, &ring->producer_waiting, head) == -1)
+            return -1;
+    }
+}
+
+static void shm_ring_publish(struct shm_ring_t* ring, uint32_t n) {
+    __atomic_store_n(&ring->tail, ring->tail + n, __ATOMIC_SEQ_CST);
+    shm_notify(&ring->tail, &ring->consumer_waiting);
+}
+
+// consumer: waits until n bytes can be read at the head
+static int shm_ring_wait_data(struct shm_endpoint_t* endpoint, uint32_t n) {
+    struct shm_ring_t* ring = endpoint->rx;
+    while (true) {
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (tail - ring->head >= n)
+            return 0;
+        if (shm_wait(endpoint, &ring->tail, &ring->consumer_waiting, tail) == -1)
+            return -1;
+    }
+}
+
+static void shm_ring_consume(struct shm_ring_t* ring, uint32_t n) {
+    __atomic_store_n(&ring->head, ring->head + n, __ATOMIC_SEQ_CST);
+    shm_notify(&ring->head, &ring->producer_waiting);
+}
+
+static void shm_ring_copy_in(struct shm_ring_t* ring, uint32_t position, const uint8_t* data, size_t n) {
+    size_t offset = position & SHM_RING_MASK;
+    size_t first = n < SHM_RING_SIZE - offset ? n : SHM_RING_SIZE - offset;
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, n - first);
+}
+
+static void shm_ring_copy_out(struct shm_ring_t* ring, uint32_t position, uint8_t* out, size_t n) {
+    size_t offset = position & SHM_RING_MASK;
+    size_t first = n < SHM_RING_SIZE - offset ? n : SHM_RING_SIZE - offset;
+    memcpy(out, ring->data + offset, first);
+    memcpy(out + first, ring->data, n - first);
+}
+
+#endif
+
+struct shm_channel_t* shm_channel_create(int* memfd) {
+    int fd = memfd_create("node-db-shm", MFD_CLOEXEC);
+    if (assert_error(
+        fd < 0,
+        "shm_channel_create",
+        "Failed to create shared memory file.\n"
+    )) return NULL;
+
+    if (assert_error(
+        ftruncate(fd, sizeof(struct shm_channel_t)) < 0,
+        "shm_channel_create",
+        "Failed to size shared memory file.\n"
+    )) {
+        close(fd);
+        return NULL;
+    }
+
+    // a new memory file is zero-filled: both rings start empty
+    struct shm_channel_t* channel = mmap(NULL, sizeof(struct shm_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (assert_error(
+        channel == MAP_FAILED,
+        "shm_channel_create",
+        "Failed to map shared memory file.\n"
+    )) {
+        close(fd);
+        return NULL;
+    }
+
+    channel->magic = SHM_CHANNEL_MAGIC;
+    *memfd = fd;
+    return channel;
+}
+
+struct shm_channel_t* shm_channel_map(int memfd) {
+    struct stat st;
+    if (assert_error(
+        fstat(memfd, &st) < 0 || st.st_size < (off_t)sizeof(struct shm_channel_t),
+        "shm_channel_map",
+        "Invalid shared memory file.\n"
+    )) return NULL;
+
+    struct shm_channel_t* channel = mmap(NULL, sizeof(struct shm_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (assert_error(
+        channel == MAP_FAILED,
+        "shm_channel_map",
+        "Failed to map shared memory file.\n"
+    )) return NULL;
+
+    if (assert_error(
+        channel->magic != SHM_CHANNEL_MAGIC,
+        "shm_channel_map",
+        "Invalid shared memory channel.\n"
+    )) {
+        munmap(channel, sizeof(struct shm_channel_t));
+        return NULL;
+    }
+    return channel;
+}
+
+void shm_channel_destroy(struct shm_channel_t* channel) {
+    if (channel != NULL)
+        munmap(channel, sizeof(struct shm_channel_t));
+}
+
+struct shm_endpoint_t* shm_endpoint_create(struct shm_channel_t* channel, int peer_fd, int is_server) {
+    if (assert_error(
+        channel == NULL,
+        "shm_endpoint_create",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    struct shm_endpoint_t* endpoint = create_dynamic_memory(sizeof(struct shm_endpoint_t));
+    if (assert_error(
+        endpoint == NULL,
+        "shm_endpoint_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    endpoint->channel = channel;
+    endpoint->peer_fd = peer_fd;
+    endpoint->tx = is_server ? &channel->responses : &channel->requests;
+    endpoint->rx = is_server ? &channel->requests : &channel->responses;
+    return endpoint;
+}
+
+void shm_endpoint_destroy(struct shm_endpoint_t* endpoint) {
+    if (assert_error(
+        endpoint == NULL,
+        "shm_endpoint_destroy",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    struct shm_channel_t* channel = endpoint->channel;
+    __atomic_store_n(&channel->closed, 1, __ATOMIC_SEQ_CST);
+    shm_futex_wake(&channel->requests.head);
+    shm_futex_wake(&channel->requests.tail);
+    shm_futex_wake(&channel->responses.head);
+    shm_futex_wake(&channel->responses.tail);
+
+    shm_channel_destroy(channel);
+    close(endpoint->peer_fd);
+    destroy_dynamic_memory(endpoint);
+}
+
+int shm_send_message(struct shm_endpoint_t* endpoint, MessageT* msg) {
+    if (assert_error(
+        endpoint == NULL || msg == NULL,
+        "shm_send_message",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    size_t frame_size = message_frame_size(msg);
+    if (frame_size == 0 || shm_ring_wait_space(endpoint, frame_size) == -1)
+        return -1;
+
+    // pack straight into the ring unless the frame wraps around its end
+    struct shm_ring_t* ring = endpoint->tx;
+    size_t offset = ring->tail & SHM_RING_MASK;
+    if (offset + frame_size <= SHM_RING_SIZE) {
+        if (pack_message_frame(msg, ring->data + offset, frame_size) < 0)
+            return -1;
+    } else {
+        uint8_t* frame = create_dynamic_memory(frame_size);
+        if (frame == NULL || pack_message_frame(msg, frame, frame_size) < 0) {
+            destroy_dynamic_memory(frame);
+            return -1;
+        }
+        shm_ring_copy_in(ring, ring->tail, frame, frame_size);
+        destroy_dynamic_memory(frame);
+    }
+
+    shm_ring_publish(ring, frame_size);
+    return 0;
+}
+
+MessageT* shm_read_message(struct shm_endpoint_t* endpoint, struct arena_t* arena) {
+    if (assert_error(
+        endpoint == NULL,
+        "shm_read_message",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    struct shm_ring_t* ring = endpoint->rx;
+    unsigned short msg_size_be;
+    if (shm_ring_wait_data(endpoint, MESSAGE_FRAME_HEADER_SIZE) == -1)
+        return NULL;
+    shm_ring_copy_out(ring, ring->head, (uint8_t*)&msg_size_be, MESSAGE_FRAME_HEADER_SIZE);
+
+    size_t msg_size = ntohs(msg_size_be);
+    if (shm_ring_wait_data(endpoint, MESSAGE_FRAME_HEADER_SIZE + msg_size) == -1)
+        return NULL;
+
+    // unpack straight from the ring unless the message wraps around its end
+    MessageT* msg;
+    ProtobufCAllocator* allocator = arena != NULL ? &arena->allocator : NULL;
+    uint32_t position = ring->head + MESSAGE_FRAME_HEADER_SIZE;
+    size_t offset = position & SHM_RING_MASK;
+    if (offset + msg_size <= SHM_RING_SIZE) {
+        msg = message_t__unpack(allocator, msg_size, ring->data + offset);
+    } else {
+        uint8_t* buffer = arena != NULL ? arena_alloc(arena, msg_size) : create_dynamic_memory(msg_size);
+        if (buffer == NULL)
+            return NULL;
+        shm_ring_copy_out(ring, position, buffer, msg_size);
+        msg = message_t__unpack(allocator, msg_size, buffer);
+        if (arena == NULL)
+            destroy_dynamic_memory(buffer);
+    }
+
+    shm_ring_consume(ring, MESSAGE_FRAME_HEADER_SIZE + msg_size);
+    assert_error(
+        msg == NULL,
+        "shm_read_message",
+        "Failed to unpack message.\n"
+    );
+    return msg;
+}
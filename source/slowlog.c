@@ -0,0 +1,145 @@
+#include "slowlog.h"
+#include "latency.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct slow_op_t* ring = NULL;               // capacity operations, count from first
+static int capacity = 0;
+static int first = 0;
+static int count = 0;
+static uint64_t threshold_ns = 0;                   // 0 if disabled
+static pthread_once_t slowlog_once = PTHREAD_ONCE_INIT;
+static __thread struct slowlog_request_t local_request;
+
+static void slowlog_init(void) {
+    int ms = get_env_int("NODEDB_SLOW_LOG_MS", SLOWLOG_DEFAULT_MS);
+    int size = get_env_int("NODEDB_SLOW_LOG_SIZE", SLOWLOG_DEFAULT_SIZE);
+    if (ms <= 0 || size <= 0)
+        return;
+
+    ring = create_dynamic_memory(size * sizeof(struct slow_op_t));
+    if (ring == NULL)
+        return;
+    capacity = size;
+    threshold_ns = (uint64_t)ms * 1000000ULL;
+}
+
+// appends the request to the ring, over the oldest operation if full
+static void slowlog_append(struct slowlog_request_t* request, uint64_t total_ns) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t time_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000 - (int64_t)(total_ns / 1000000);
+    char* key = request->key[0] != '\0' ? strdup(request->key) : NULL;
+    pthread_mutex_lock(&ring_mutex);
+    struct slow_op_t* op;
+    if (count < capacity) {
+        op = &ring[(first + count++) % capacity];
+    } else {
+        op = &ring[first];
+        first = (first + 1) % capacity;
+        destroy_dynamic_memory(op->key);
+    }
+    op->time_ms = time_ms;
+    op->opcode = request->opcode;
+    op->key = key;
+    op->value_size = request->value_size;
+    op->lock_wait_ns = request->phases[SLOWLOG_LOCK_WAIT];
+    op->table_ns = request->phases[SLOWLOG_TABLE];
+    op->replication_ns = request->phases[SLOWLOG_REPLICATION];
+    op->serialization_ns = request->phases[SLOWLOG_SERIALIZATION];
+    op->total_ns = total_ns;
+    pthread_mutex_unlock(&ring_mutex);
+}
+
+void slowlog_begin(int opcode, const char* key, int value_size) {
+    pthread_once(&slowlog_once, slowlog_init);
+    struct slowlog_request_t* request = &local_request;
+    request->active = threshold_ns > 0;
+    if (!request->active)
+        return;
+
+    request->start_ns = latency_now_ns();
+    request->invoked_ns = 0;
+    request->opcode = opcode;
+    request->value_size = value_size;
+    memset(request->phases, 0, sizeof(request->phases));
+    request->key[0] = '\0';
+    if (key != NULL) {
+        strncpy(request->key, key, SLOWLOG_KEY_SIZE - 1);
+        request->key[SLOWLOG_KEY_SIZE - 1] = '\0';
+    }
+}
+
+bool slowlog_active() {
+    return local_request.active;
+}
+
+void slowlog_add(enum SlowlogPhase phase, uint64_t ns) {
+    if (local_request.active && phase >= 0 && phase < SLOWLOG_PHASES)
+        local_request.phases[phase] += ns;
+}
+
+void slowlog_invoked() {
+    if (local_request.active)
+        local_request.invoked_ns = latency_now_ns();
+}
+
+void slowlog_end() {
+    struct slowlog_request_t* request = &local_request;
+    if (!request->active)
+        return;
+
+    request->active = false;
+    uint64_t end_ns = latency_now_ns();
+    if (request->invoked_ns != 0)
+        request->phases[SLOWLOG_SERIALIZATION] += end_ns - request->invoked_ns;
+    if (end_ns - request->start_ns >= threshold_ns)
+        slowlog_append(request, end_ns - request->start_ns);
+}
+
+void slowlog_suspend(struct slowlog_request_t* request) {
+    *request = local_request;
+    local_request.active = false;
+}
+
+void slowlog_resume(struct slowlog_request_t* request) {
+    local_request = *request;
+}
+
+int slowlog_fetch(struct slow_op_t** ops, bool reset) {
+    if (assert_error(
+        ops == NULL,
+        "slowlog_fetch",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pthread_once(&slowlog_once, slowlog_init);
+    *ops = NULL;
+    pthread_mutex_lock(&ring_mutex);
+    int n = count;
+    if (n > 0)
+        *ops = create_dynamic_memory(n * sizeof(struct slow_op_t));
+    if (n > 0 && *ops == NULL) {
+        pthread_mutex_unlock(&ring_mutex);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        struct slow_op_t* op = &ring[(first + i) % capacity];
+        (*ops)[i] = *op;
+        if (reset)
+            op->key = NULL;     // moved into the copy
+        else if (op->key != NULL)
+            (*ops)[i].key = strdup(op->key);
+    }
+    if (reset) {
+        first = 0;
+        count = 0;
+    }
+    pthread_mutex_unlock(&ring_mutex);
+    return n;
+}
@@ -0,0 +1,610 @@
+#include "snapshot.h"
+
+#include "distributed_database.h"
+#include "database.h"
+#include "entry.h"
+#include "message.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#ifndef SNAPSHOT_LOG
+// ====================================================================================================
+//                                                Log
+// ====================================================================================================
+
+static struct snapshot_log_t* snapshot_log_create(const char* successor, int chain) {
+    struct snapshot_log_t* log = create_dynamic_memory(sizeof(struct snapshot_log_t));
+    if (assert_error(
+        log == NULL,
+        "snapshot_log_create",
+        ERROR_MALLOC
+    )) return NULL;
+
+    log->successor = strdup(successor);
+    if (assert_error(
+        log->successor == NULL,
+        "snapshot_log_create",
+        ERROR_MALLOC
+    )) {
+        destroy_dynamic_memory(log);
+        return NULL;
+    }
+    log->max_size = (size_t)get_env_int("NODEDB_SNAPSHOT_LOG_MB", SNAPSHOT_DEFAULT_LOG_MB) << 20;
+    log->chain = chain;
+    pthread_mutex_init(&log->mutex, NULL);
+    pthread_cond_init(&log->cond, NULL);
+    return log;
+}
+
+static void snapshot_mutations_free(struct snapshot_mutation_t* mutation) {
+    while (mutation != NULL) {
+        struct snapshot_mutation_t* next = mutation->next;
+        destroy_dynamic_memory(mutation);
+        mutation = next;
+    }
+}
+
+static void snapshot_log_destroy(struct snapshot_log_t* log) {
+    snapshot_mutations_free(log->head);
+    pthread_mutex_destroy(&log->mutex);
+    pthread_cond_destroy(&log->cond);
+    destroy_dynamic_memory(log->successor);
+    hash_ring_destroy(log->ring);
+    destroy_dynamic_memory(log);
+}
+
+void snapshot_log_append(struct snapshot_log_t* log, uint64_t chain_seq, MessageT__Opcode opcode, char* key, struct data_t* value) {
+    size_t key_size = strlen(key) + 1;
+    size_t value_size = opcode == MESSAGE_T__OPCODE__OP_PUT && value != NULL ? (size_t)value->datasize : 0;
+    size_t size = sizeof(struct snapshot_mutation_t) + key_size + value_size;
+
+    pthread_mutex_lock(&log->mutex);
+    if (log->overflowed || log->spliced) {
+        pthread_mutex_unlock(&log->mutex);
+        return;
+    }
+
+    struct snapshot_mutation_t* mutation = log->size + size <= log->max_size ? create_dynamic_memory(size) : NULL;
+    if (mutation == NULL) {
+        // the copy cannot be completed anymore: the stream aborts and the log stops growing
+        log->overflowed = true;
+        snapshot_mutations_free(log->head);
+        log->head = log->tail = NULL;
+        log->size = 0;
+        pthread_cond_signal(&log->cond);
+        pthread_mutex_unlock(&log->mutex);
+        return;
+    }
+
+    mutation->seq = log->next_seq++;
+    mutation->chain_seq = chain_seq;
+    mutation->opcode = opcode;
+    mutation->key = (char*)(mutation + 1);
+    memcpy(mutation->key, key, key_size);
+    mutation->value = (uint8_t*)mutation->key + key_size;
+    mutation->value_size = value_size;
+    if (value_size > 0)
+        memcpy(mutation->value, value->data, value_size);
+
+    if (log->tail != NULL)
+        log->tail->next = mutation;
+    else
+        log->head = mutation;
+    log->tail = mutation;
+    log->size += size;
+    pthread_cond_signal(&log->cond);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void snapshot_log_splice(struct snapshot_log_t* log, uint64_t applied) {
+    pthread_mutex_lock(&log->mutex);
+    log->spliced = true;
+    log->spliced_base = applied;
+    pthread_cond_signal(&log->cond);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+// detaches the logged mutations. Called with the mutex held
+static struct snapshot_mutation_t* snapshot_log_take(struct snapshot_log_t* log) {
+    struct snapshot_mutation_t* mutations = log->head;
+    log->head = log->tail = NULL;
+    log->size = 0;
+    return mutations;
+}
+
+static void snapshot_log_wait_ms(struct snapshot_log_t* log, int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&log->cond, &log->mutex, &deadline);
+}
+
+#endif
+
+#ifndef STREAM
+// ====================================================================================================
+//                                         Stream (source side)
+// ====================================================================================================
+
+struct snapshot_stream_t {
+    int fd;
+    struct TableServerDistributedDatabase* ddb;
+    struct snapshot_log_t* log;
+    uint8_t* tx_buffer;                 // MESSAGE_MAX_FRAME_SIZE bytes
+    uint64_t entries;
+    uint64_t mutations;
+};
+
+static int stream_send_frame(struct snapshot_stream_t* stream, MessageT* msg) {
+    ssize_t frame_size = pack_message_frame(msg, stream->tx_buffer, MESSAGE_MAX_FRAME_SIZE);
+    if (frame_size <= 0)
+        return -1;
+    return write_all(stream->fd, stream->tx_buffer, frame_size) == frame_size ? 0 : -1;
+}
+
+static int stream_send_marker(struct snapshot_stream_t* stream, int marker, uint64_t seq) {
+    MessageT msg = MESSAGE_T__INIT;
+    msg.opcode = MESSAGE_T__OPCODE__OP_SNAPSHOT + 1;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+    msg.result = marker;
+    msg.seq = seq;
+    return stream_send_frame(stream, &msg);
+}
+
+// sends the next chunk of the table. Returns the number of entries read, 0 at the end, or -1 on error
+static int stream_send_chunk(struct snapshot_stream_t* stream, int* index, char** after) {
+    struct snapshot_log_t* log = stream->log;
+    struct entry_t* copies[SNAPSHOT_MAX_ENTRIES];
+    // mutations logged from now on may be missing from the chunk
+    pthread_mutex_lock(&log->mutex);
+    uint64_t seq = log->next_seq;
+    pthread_mutex_unlock(&log->mutex);
+
+    int scanned = db_table_scan(stream->ddb->db, index, *after, copies, SNAPSHOT_MAX_ENTRIES, SNAPSHOT_CHUNK_BUDGET);
+    if (scanned <= 0)
+        return scanned;
+    destroy_dynamic_memory(*after);
+    *after = strdup(copies[scanned - 1]->key);
+
+    // a chain taking over keys gets its own only
+    int n = 0;
+    for (int i = 0; i < scanned; i++) {
+        if (log->chain < 0 || hash_ring_lookup(log->ring, copies[i]->key) == log->chain)
+            copies[n++] = copies[i];
+        else
+            entry_destroy(copies[i]);
+    }
+
+    EntryT entries[SNAPSHOT_MAX_ENTRIES];
+    EntryT* entry_ptrs[SNAPSHOT_MAX_ENTRIES];
+    for (int i = 0; i < n; i++) {
+        entry_t__init(&entries[i]);
+        entries[i].key = copies[i]->key;
+        entries[i].value.data = copies[i]->value->data;
+        entries[i].value.len = copies[i]->value->datasize;
+        entry_ptrs[i] = &entries[i];
+    }
+
+    MessageT msg = MESSAGE_T__INIT;
+    msg.opcode = MESSAGE_T__OPCODE__OP_SNAPSHOT + 1;
+    msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    msg.result = SNAPSHOT_CHUNK;
+    msg.seq = seq;
+    msg.n_entries = n;
+    msg.entries = entry_ptrs;
+    int result = n > 0 ? stream_send_frame(stream, &msg) : 0;
+
+    for (int i = 0; i < n; i++)
+        entry_destroy(copies[i]);
+    if (result == -1 || *after == NULL)
+        return -1;
+    stream->entries += n;
+    return scanned;
+}
+
+// sends the detached mutations as batches, a key appearing once per batch. Frees them
+static int stream_send_mutations(struct snapshot_stream_t* stream, struct snapshot_mutation_t* mutations) {
+    int result = 0;
+    while (mutations != NULL && result == 0) {
+        EntryT entries[SNAPSHOT_MAX_BATCH];
+        EntryT* entry_ptrs[SNAPSHOT_MAX_BATCH];
+        char* keys[SNAPSHOT_MAX_BATCH];
+        uint64_t entry_seqs[SNAPSHOT_MAX_BATCH], key_seqs[SNAPSHOT_MAX_BATCH], chain_seqs[SNAPSHOT_MAX_BATCH];
+        size_t n_entries = 0, n_keys = 0, n_skips = 0, size = 64;
+        int n = 0;
+
+        struct snapshot_mutation_t* mutation = mutations;
+        for (; mutation != NULL && n < SNAPSHOT_MAX_BATCH; mutation = mutation->next) {
+            size_t mutation_size = strlen(mutation->key) + mutation->value_size + SNAPSHOT_ENTRY_OVERHEAD;
+            if (n > 0 && size + mutation_size > MESSAGE_MAX_FRAME_SIZE)
+                break;
+            if (mutation->opcode == MESSAGE_T__OPCODE__OP_BAD) {
+                // superseded mutation: only its chain seq, after the others
+                chain_seqs[SNAPSHOT_MAX_BATCH - 1 - n_skips++] = mutation->chain_seq;
+                size += SNAPSHOT_ENTRY_OVERHEAD;
+                n++;
+                continue;
+            }
+            // puts are applied before deletes: a key may appear only once
+            bool repeated = false;
+            for (size_t i = 0; i < n_entries && !repeated; i++)
+                repeated = strcmp(entries[i].key, mutation->key) == 0;
+            for (size_t i = 0; i < n_keys && !repeated; i++)
+                repeated = strcmp(keys[i], mutation->key) == 0;
+            if (repeated)
+                break;
+
+            if (mutation->opcode == MESSAGE_T__OPCODE__OP_PUT) {
+                entry_t__init(&entries[n_entries]);
+                entries[n_entries].key = mutation->key;
+                entries[n_entries].value.data = mutation->value;
+                entries[n_entries].value.len = mutation->value_size;
+                entry_ptrs[n_entries] = &entries[n_entries];
+                entry_seqs[n_entries++] = mutation->chain_seq;
+            } else {
+                key_seqs[n_keys] = mutation->chain_seq;
+                keys[n_keys++] = mutation->key;
+            }
+            size += mutation_size;
+            n++;
+        }
+
+        // chain seqs of the entries, then of the keys, then of the superseded mutations
+        size_t n_seqs = 0;
+        for (size_t i = 0; i < n_entries; i++)
+            chain_seqs[n_seqs++] = entry_seqs[i];
+        for (size_t i = 0; i < n_keys; i++)
+            chain_seqs[n_seqs++] = key_seqs[i];
+        for (size_t i = 0; i < n_skips; i++)
+            chain_seqs[n_seqs++] = chain_seqs[SNAPSHOT_MAX_BATCH - 1 - i];
+
+        MessageT msg = MESSAGE_T__INIT;
+        msg.opcode = MESSAGE_T__OPCODE__OP_BATCH;
+        msg.c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+        msg.seq = mutations->seq;
+        msg.result = n;
+        msg.n_entries = n_entries;
+        msg.entries = entry_ptrs;
+        msg.n_keys = n_keys;
+        msg.keys = keys;
+        msg.n_chain_seqs = n_seqs;
+        msg.chain_seqs = chain_seqs;
+        result = stream_send_frame(stream, &msg);
+        stream->mutations += n;
+
+        // free what was sent
+        while (mutations != mutation) {
+            struct snapshot_mutation_t* next = mutations->next;
+            destroy_dynamic_memory(mutations);
+            mutations = next;
+        }
+    }
+    snapshot_mutations_free(mutations);
+    return result;
+}
+
+// sends what was logged so far. Returns 0 (OK) or -1 on error (or overflow)
+static int stream_drain_log(struct snapshot_stream_t* stream) {
+    pthread_mutex_lock(&stream->log->mutex);
+    bool overflowed = stream->log->overflowed;
+    struct snapshot_mutation_t* mutations = snapshot_log_take(stream->log);
+    pthread_mutex_unlock(&stream->log->mutex);
+    if (overflowed)
+        return -1;
+    return stream_send_mutations(stream, mutations);
+}
+
+// tells whether the joining server went away
+static bool stream_peer_closed(struct snapshot_stream_t* stream) {
+    struct pollfd pfd = { .fd = stream->fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR));
+}
+
+static int stream_serve_log(struct snapshot_stream_t* stream) {
+    // the table is copied: the log keeps being drained until the joining server follows this one
+    struct snapshot_log_t* log = stream->log;
+    pthread_mutex_lock(&log->mutex);
+    uint64_t logged = log->next_seq;
+    pthread_mutex_unlock(&log->mutex);
+    if (stream_drain_log(stream) == -1 || stream_send_marker(stream, SNAPSHOT_CAUGHT_UP, logged) == -1)
+        return -1;
+
+    while (true) {
+        pthread_mutex_lock(&log->mutex);
+        if (log->head == NULL && !log->spliced && !log->overflowed)
+            snapshot_log_wait_ms(log, SNAPSHOT_WAIT_MS);
+        bool spliced = log->spliced;
+        uint64_t spliced_base = log->spliced_base;
+        pthread_mutex_unlock(&log->mutex);
+
+        if (stream_drain_log(stream) == -1)
+            return -1;
+        if (spliced)
+            return stream_send_marker(stream, SNAPSHOT_END, spliced_base);
+        if (stream_peer_closed(stream))
+            return -1;
+    }
+}
+
+static void* stream_serve(void* _stream) {
+    struct snapshot_stream_t* stream = _stream;
+    struct snapshot_log_t* log = stream->log;
+    LOG_INFO(SNAPSHOT_SERVING, log->delta ? "missed mutations" : log->chain >= 0 ? "keys moving to the chain" : "table", log->successor);
+
+    int index = 0;
+    char* after = NULL;
+    int result = log->delta ? stream_send_marker(stream, SNAPSHOT_DELTA, 0) : stream_send_marker(stream, SNAPSHOT_FULL, log->base);
+    while (result >= 0 && !log->delta && (result = stream_send_chunk(stream, &index, &after)) > 0) {
+        // mutations are sent between chunks, so that the log never holds more than one chunk's worth
+        if (stream_drain_log(stream) == -1) {
+            result = -1;
+            break;
+        }
+    }
+    destroy_dynamic_memory(after);
+    if (result == 0)
+        result = stream_serve_log(stream);
+
+    ddb_capture_stop(stream->ddb, log);
+    if (result == 0) {
+        LOG_INFO(SNAPSHOT_SERVED, log->successor, (unsigned long)stream->entries, (unsigned long)stream->mutations);
+    } else {
+        LOG_WARN(SNAPSHOT_ABORTED, log->successor, log->overflowed ? " (log overflowed, see NODEDB_SNAPSHOT_LOG_MB)" : "");
+        MessageT error = MESSAGE_T__INIT;
+        error.opcode = MESSAGE_T__OPCODE__OP_ERROR;
+        error.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+        stream_send_frame(stream, &error);
+    }
+
+    close(stream->fd);
+    snapshot_log_destroy(log);
+    destroy_dynamic_memory(stream->tx_buffer);
+    destroy_dynamic_memory(stream);
+    return NULL;
+}
+
+int snapshot_stream_start(int fd, const char* successor, uint64_t since, int chain, struct TableServerDistributedDatabase* ddb) {
+    struct snapshot_stream_t* stream = create_dynamic_memory(sizeof(struct snapshot_stream_t));
+    struct snapshot_log_t* log = successor != NULL ? snapshot_log_create(successor, chain) : NULL;
+    uint8_t* tx_buffer = create_dynamic_memory(MESSAGE_MAX_FRAME_SIZE);
+    if (assert_error(
+        stream == NULL || log == NULL || tx_buffer == NULL,
+        "snapshot_stream_start",
+        ERROR_MALLOC
+    )) {
+        destroy_dynamic_memory(stream);
+        if (log != NULL)
+            snapshot_log_destroy(log);
+        destroy_dynamic_memory(tx_buffer);
+        return close_and_return_failure(fd);
+    }
+
+    stream->fd = fd;
+    stream->ddb = ddb;
+    stream->log = log;
+    stream->tx_buffer = tx_buffer;
+
+    // mutations are logged from before the first chunk is read
+    ddb_capture_start(ddb, log, since);
+
+    pthread_t thread;
+    if (assert_error(
+        pthread_create(&thread, &ddb->db->thread_attr, stream_serve, stream) != 0,
+        "snapshot_stream_start",
+        "Failed to launch the snapshot stream.\n"
+    )) {
+        ddb_capture_stop(ddb, log);
+        snapshot_log_destroy(log);
+        destroy_dynamic_memory(tx_buffer);
+        destroy_dynamic_memory(stream);
+        return close_and_return_failure(fd);
+    }
+    return 0;
+}
+
+#endif
+
+#ifndef SYNC
+// ====================================================================================================
+//                                         Sync (joining side)
+// ====================================================================================================
+
+static int sync_connect(const char* source) {
+    const char* separator = strrchr(source, ':');
+    if (assert_error(
+        separator == NULL,
+        "sync_connect",
+        "Invalid connection string format. It should be address:port.\n"
+    )) return -1;
+
+    char address[INET_ADDRSTRLEN];
+    size_t address_length = separator - source;
+    if (address_length >= sizeof(address))
+        return -1;
+    memcpy(address, source, address_length);
+    address[address_length] = '\0';
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(atoi(separator + 1));
+    if (inet_pton(AF_INET, address, &addr.sin_addr) <= 0)
+        return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        return close_and_return_failure(fd);
+    return fd;
+}
+
+// replays the frames of the source until marker. Returns 0 (OK) or -1 on error
+static int sync_replay_until(struct snapshot_sync_t* sync, struct TableServerDistributedDatabase* ddb, int marker) {
+    while (true) {
+        MessageT* msg = read_message_with_arena(sync->fd, sync->arena);
+        if (msg == NULL)
+            return -1;
+
+        int result = 0;
+        bool done = false;
+        if (msg->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT + 1 && msg->c_type == MESSAGE_T__C_TYPE__CT_TABLE) {
+            for (size_t i = 0; i < msg->n_entries && result == 0; i++) {
+                struct data_t value = { .datasize = msg->entries[i]->value.len, .data = msg->entries[i]->value.data };
+                result = ddb_sync_apply(ddb, MESSAGE_T__OPCODE__OP_PUT, msg->entries[i]->key, &value, 0);
+            }
+            sync->entries += msg->n_entries;
+        } else if (msg->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT + 1) {
+            // a stream ending before this server followed the source missed mutations
+            done = true;
+            result = msg->result == marker ? 0 : -1;
+            // the copy holds every mutation the source held when the log was closed
+            if (result == 0 && marker == SNAPSHOT_END && !sync->migration)
+                backlog_advance(&ddb->backlog, msg->seq);
+        } else if (msg->opcode == MESSAGE_T__OPCODE__OP_BATCH) {
+            size_t n_seqs = msg->n_chain_seqs;
+            for (size_t i = 0; i < msg->n_entries && result == 0; i++) {
+                struct data_t value = { .datasize = msg->entries[i]->value.len, .data = msg->entries[i]->value.data };
+                uint64_t chain_seq = i < n_seqs ? msg->chain_seqs[i] : 0;
+                result = ddb_sync_apply(ddb, MESSAGE_T__OPCODE__OP_PUT, msg->entries[i]->key, &value, chain_seq);
+            }
+            for (size_t i = 0; i < msg->n_keys && result == 0; i++) {
+                uint64_t chain_seq = msg->n_entries + i < n_seqs ? msg->chain_seqs[msg->n_entries + i] : 0;
+                result = ddb_sync_apply(ddb, MESSAGE_T__OPCODE__OP_DEL, msg->keys[i], NULL, chain_seq);
+            }
+            for (size_t i = msg->n_entries + msg->n_keys; i < n_seqs && result == 0; i++)
+                result = ddb_sync_apply(ddb, MESSAGE_T__OPCODE__OP_BAD, "", NULL, msg->chain_seqs[i]);
+            sync->mutations += msg->result;
+        } else {
+            result = -1;
+        }
+        release_message(msg, sync->arena);
+
+        if (result == -1 || done)
+            return result;
+    }
+}
+
+static void sync_close(struct snapshot_sync_t* sync) {
+    close(sync->fd);
+    arena_destroy(sync->arena);
+    destroy_dynamic_memory(sync);
+}
+
+// reads the first frame of the source, telling whether the table is copied. Returns 0 (OK) or -1 on error
+static int sync_start(struct snapshot_sync_t* sync, struct TableServerDistributedDatabase* ddb, uint64_t since) {
+    MessageT* msg = read_message_with_arena(sync->fd, sync->arena);
+    if (msg == NULL)
+        return -1;
+
+    int result = -1;
+    if (msg->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT + 1 && msg->result == SNAPSHOT_DELTA) {
+        result = 0;
+    } else if (msg->opcode == MESSAGE_T__OPCODE__OP_SNAPSHOT + 1 && msg->result == SNAPSHOT_FULL) {
+        // the table of a rejoining server is replaced by the copy; moving keys come on top of the table
+        result = since > 0 ? ddb_sync_reset(ddb) : 0;
+        if (!sync->migration)
+            backlog_reset(&ddb->backlog, msg->seq);
+    }
+    release_message(msg, sync->arena);
+    return result;
+}
+
+// sends request to the source and replays its stream until SNAPSHOT_CAUGHT_UP
+static struct snapshot_sync_t* sync_open(const char* source, MessageT* request, struct TableServerDistributedDatabase* ddb) {
+    struct snapshot_sync_t* sync = create_dynamic_memory(sizeof(struct snapshot_sync_t));
+    if (assert_error(
+        sync == NULL,
+        "sync_open",
+        ERROR_MALLOC
+    )) return NULL;
+
+    sync->fd = sync_connect(source);
+    sync->arena = arena_create(ARENA_DEFAULT_CAPACITY);
+    if (sync->fd < 0 || sync->arena == NULL) {
+        if (sync->fd >= 0)
+            close(sync->fd);
+        arena_destroy(sync->arena);
+        destroy_dynamic_memory(sync);
+        return NULL;
+    }
+
+    sync->migration = request->opcode == MESSAGE_T__OPCODE__OP_MIGRATE;
+    if (send_message(sync->fd, request) == -1 || sync_start(sync, ddb, request->seq) == -1 ||
+        sync_replay_until(sync, ddb, SNAPSHOT_CAUGHT_UP) == -1) {
+        sync_close(sync);
+        return NULL;
+    }
+
+    LOG_INFO(SNAPSHOT_CAUGHT_UP_MSG, source, (unsigned long)sync->entries, (unsigned long)sync->mutations);
+    return sync;
+}
+
+struct snapshot_sync_t* snapshot_sync_open(const char* source, const char* self, uint64_t since, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        source == NULL || self == NULL || ddb == NULL,
+        "snapshot_sync_open",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    MessageT request = MESSAGE_T__INIT;
+    request.opcode = MESSAGE_T__OPCODE__OP_SNAPSHOT;
+    request.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    request.key = (char*)self;
+    request.seq = since;
+    return sync_open(source, &request, ddb);
+}
+
+struct snapshot_sync_t* snapshot_migration_open(const char* source, const char* self, int chain, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        source == NULL || self == NULL || ddb == NULL,
+        "snapshot_migration_open",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    MessageT request = MESSAGE_T__INIT;
+    request.opcode = MESSAGE_T__OPCODE__OP_MIGRATE;
+    request.c_type = MESSAGE_T__C_TYPE__CT_KEY;
+    request.key = (char*)self;
+    request.result = chain;
+    return sync_open(source, &request, ddb);
+}
+
+int snapshot_sync_finish(struct snapshot_sync_t* sync, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        sync == NULL || ddb == NULL,
+        "snapshot_sync_finish",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    int result = sync_replay_until(sync, ddb, SNAPSHOT_END);
+    if (result == 0)
+        LOG_INFO(sync->migration ? SNAPSHOT_MIGRATED : SNAPSHOT_COMPLETED, (unsigned long)sync->entries, (unsigned long)sync->mutations);
+    sync_close(sync);
+    return result;
+}
+
+void snapshot_sync_abort(struct snapshot_sync_t* sync) {
+    if (sync == NULL)
+        return;
+
+    // the source sees the stream closed and stops logging
+    sync_close(sync);
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "stats.h"
 #include "utils.h"
+#include "sdmessage.pb-c.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
-struct statistics_t* stats_create(int op_counter, long long computed_time_micros, int active_clients) {
+struct statistics_t* stats_create(long long op_counter, long long computed_time_micros, int active_clients) {
     struct statistics_t* stats = create_dynamic_memory(sizeof(struct statistics_t));
     if (assert_error(
         stats == NULL,
@@ -24,10 +27,199 @@ int stats_destroy(struct statistics_t* stats) {
         ERROR_NULL_POINTER_REFERENCE
     )) return M_ERROR;
 
+    for (int i = 0; i < stats->n_successors; i++)
+        destroy_dynamic_memory(stats->successors[i].address);
+    destroy_dynamic_memory(stats->successors);
+    destroy_dynamic_memory(stats->latencies);
+    for (int i = 0; i < stats->n_memory; i++)
+        destroy_dynamic_memory(stats->memory[i].tag);
+    destroy_dynamic_memory(stats->memory);
     destroy_dynamic_memory(stats);
     return M_OK;
 }
 
+// upper bound (microseconds) of the bucket holding the given fraction of the acknowledgements
+static long long stats_latency_bound(long long* latency, double fraction) {
+    long long total = 0;
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+        total += latency[i];
+
+    long long seen = 0;
+    for (int i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+        seen += latency[i];
+        if (total > 0 && seen >= fraction * total)
+            return 1LL << i;
+    }
+    return 0;
+}
+
 void stats_show(struct statistics_t* stats) {
     printf(STATS_STR, stats->op_counter, stats->active_clients, stats->computed_time_micros);
-}
\ No newline at end of file
+    for (int i = 0; i < stats->n_successors; i++) {
+        struct successor_stats_t* s = &stats->successors[i];
+        printf(STATS_SUCCESSOR_STR, s->address, s->lagging ? " (lagging)" : "", s->queued, s->in_flight, s->bytes_in_flight,
+            s->seq_lag, stats_latency_bound(s->ack_latency, 0.5), stats_latency_bound(s->ack_latency, 0.99), s->throttled, s->async_acks);
+    }
+
+    long long batches = 0;
+    for (int i = 0; i < STATS_BATCH_BUCKETS; i++)
+        batches += stats->replication_batches[i];
+    if (batches == 0)
+        return;
+
+    long long* b = stats->replication_batches;
+    printf(STATS_REPLICATION_STR, b[0], b[1], b[2], b[3], b[4], b[5], b[6], stats->replication_bytes_saved, stats->replication_coalesced);
+}
+
+int stats_histogram_index(long long latency_ns) {
+    if (latency_ns < STATS_HISTOGRAM_SUB_BUCKETS)
+        return latency_ns < 0 ? 0 : latency_ns;
+    int exponent = 63 - __builtin_clzll(latency_ns);
+    if (exponent > STATS_HISTOGRAM_MAX_EXPONENT)
+        return STATS_HISTOGRAM_BUCKETS - 1;
+    int sub = (latency_ns >> (exponent - STATS_HISTOGRAM_SUB_BITS)) & (STATS_HISTOGRAM_SUB_BUCKETS - 1);
+    int index = (exponent - STATS_HISTOGRAM_SUB_BITS + 1) * STATS_HISTOGRAM_SUB_BUCKETS + sub;
+    return index < STATS_HISTOGRAM_BUCKETS ? index : STATS_HISTOGRAM_BUCKETS - 1;
+}
+
+long long stats_histogram_bound(int index) {
+    if (index < STATS_HISTOGRAM_SUB_BUCKETS)
+        return index;
+    int exponent = index / STATS_HISTOGRAM_SUB_BUCKETS + STATS_HISTOGRAM_SUB_BITS - 1;
+    long long sub = index % STATS_HISTOGRAM_SUB_BUCKETS;
+    return ((STATS_HISTOGRAM_SUB_BUCKETS + sub + 1) << (exponent - STATS_HISTOGRAM_SUB_BITS)) - 1;
+}
+
+long long stats_histogram_count(struct stats_histogram_t* histogram) {
+    long long count = 0;
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+        count += histogram->buckets[i];
+    return count;
+}
+
+long long stats_histogram_percentile(struct stats_histogram_t* histogram, double fraction) {
+    long long count = stats_histogram_count(histogram), seen = 0;
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS && count > 0; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= fraction * count) {
+            long long bound = stats_histogram_bound(i);
+            return bound < histogram->max_ns ? bound : histogram->max_ns;
+        }
+    }
+    return 0;
+}
+
+void stats_show_latencies(struct statistics_t* stats) {
+    static const char* ops[STATS_OPS] = { "put", "get", "del", "size", "getkeys", "gettable", "other" };
+    static const char* phases[STATS_PHASES] = { "lock hold", "replication", "total", "lock wait" };
+    static const enum StatsPhase order[STATS_PHASES] = { STATS_PHASE_LOCK_WAIT, STATS_PHASE_TABLE, STATS_PHASE_REPLICATION, STATS_PHASE_TOTAL };
+    if (stats->latencies == NULL)
+        return;
+
+    if (stats->timing_sample > 1)
+        printf(STATS_LATENCY_SAMPLED_STR, stats->timing_sample);
+    printf(STATS_LATENCY_HEADER);
+    for (int op = 0; op < STATS_OPS; op++) {
+        for (int i = 0; i < STATS_PHASES; i++) {
+            enum StatsPhase phase = order[i];
+            struct stats_histogram_t* histogram = &stats->latencies[op * STATS_PHASES + phase];
+            long long count = stats_histogram_count(histogram);
+            if (count == 0)
+                continue;
+            printf(STATS_LATENCY_STR, ops[op], phases[phase], count, histogram->sum_ns / 1e3 / count,
+                stats_histogram_percentile(histogram, 0.5) / 1e3, stats_histogram_percentile(histogram, 0.9) / 1e3,
+                stats_histogram_percentile(histogram, 0.99) / 1e3, stats_histogram_percentile(histogram, 0.999) / 1e3,
+                histogram->max_ns / 1e3);
+        }
+    }
+}
+
+void stats_show_memory(struct statistics_t* stats) {
+    if (stats->memory == NULL)
+        return;
+
+    double seconds = stats->uptime_ms > 0 ? stats->uptime_ms / 1e3 : 1;
+    printf(STATS_MEMORY_HEADER);
+    for (int i = 0; i < stats->n_memory; i++) {
+        struct memory_stats_t* m = &stats->memory[i];
+        printf(STATS_MEMORY_STR, m->tag, m->bytes, m->objects, m->allocations, m->allocations / seconds, m->allocated_bytes / seconds);
+    }
+}
+
+// name of an opcode of sdmessage.proto
+static const char* stats_opcode_name(int opcode) {
+    switch (opcode) {
+        case MESSAGE_T__OPCODE__OP_PUT: return "put";
+        case MESSAGE_T__OPCODE__OP_GET: return "get";
+        case MESSAGE_T__OPCODE__OP_DEL: return "del";
+        case MESSAGE_T__OPCODE__OP_SIZE: return "size";
+        case MESSAGE_T__OPCODE__OP_GETKEYS: return "getkeys";
+        case MESSAGE_T__OPCODE__OP_GETTABLE: return "gettable";
+        case MESSAGE_T__OPCODE__OP_STATS: return "stats";
+        case MESSAGE_T__OPCODE__OP_HELLO: return "hello";
+        case MESSAGE_T__OPCODE__OP_DIGEST: return "digest";
+        case MESSAGE_T__OPCODE__OP_SLOWLOG: return "slowlog";
+        case MESSAGE_T__OPCODE__OP_HOTKEYS: return "hotkeys";
+        default: return "other";
+    }
+}
+
+void stats_show_slow_ops(struct slow_op_t* ops, int n) {
+    if (n <= 0) {
+        printf("No operation slower than the threshold.\n");
+        return;
+    }
+
+    printf(STATS_SLOW_OPS_HEADER);
+    for (int i = 0; i < n; i++) {
+        struct slow_op_t* op = &ops[i];
+        time_t seconds = op->time_ms / 1000;
+        struct tm tm;
+        char time[32];
+        localtime_r(&seconds, &tm);
+        size_t length = strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &tm);
+        snprintf(time + length, sizeof(time) - length, ".%03lld", op->time_ms % 1000);
+        printf(STATS_SLOW_OP_STR, time, stats_opcode_name(op->opcode), op->key != NULL ? op->key : "",
+            op->value_size, op->lock_wait_ns / 1e3, op->table_ns / 1e3, op->replication_ns / 1e3,
+            op->serialization_ns / 1e3, op->total_ns / 1e3);
+    }
+}
+
+void stats_destroy_slow_ops(struct slow_op_t* ops, int n) {
+    for (int i = 0; ops != NULL && i < n; i++)
+        destroy_dynamic_memory(ops[i].key);
+    destroy_dynamic_memory(ops);
+}
+
+static int compare_hot_key_ops(const void* a, const void* b) {
+    long long x = ((const struct hot_key_t*)a)->ops, y = ((const struct hot_key_t*)b)->ops;
+    return (x < y) - (x > y);
+}
+
+static int compare_hot_key_bytes(const void* a, const void* b) {
+    long long x = ((const struct hot_key_t*)a)->bytes, y = ((const struct hot_key_t*)b)->bytes;
+    return (x < y) - (x > y);
+}
+
+void stats_show_hot_keys(struct hot_key_t* keys, int n) {
+    if (n <= 0) {
+        printf("No key counted yet.\n");
+        return;
+    }
+
+    int (*orders[2])(const void*, const void*) = { compare_hot_key_ops, compare_hot_key_bytes };
+    const char* titles[2] = { "By operations:", "By bytes:" };
+    for (int o = 0; o < 2; o++) {
+        qsort(keys, n, sizeof(struct hot_key_t), orders[o]);
+        printf("%s\n", titles[o]);
+        printf(STATS_HOT_KEYS_HEADER);
+        for (int i = 0; i < n && i < STATS_MAX_HOT_KEYS; i++)
+            printf(STATS_HOT_KEY_STR, keys[i].key != NULL ? keys[i].key : "", keys[i].ops, keys[i].bytes);
+    }
+}
+
+void stats_destroy_hot_keys(struct hot_key_t* keys, int n) {
+    for (int i = 0; keys != NULL && i < n; i++)
+        destroy_dynamic_memory(keys[i].key);
+    destroy_dynamic_memory(keys);
+}
@@ -137,6 +137,37 @@ struct data_t *table_get(struct table_t *table, char *key) {
     return (entry == NULL) ? NULL : data_dup(entry->value);
 }
 
+int table_read(struct table_t *table, char *key, void *buffer, int capacity) {
+    if (assert_error(
+        table == NULL || table->lists == NULL 
+        || key == NULL || buffer == NULL,
+        "table_read",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct list_t* hash_table_entry = table->lists[hash_code(key, table->size)];
+    struct entry_t* entry = list_get(hash_table_entry, key);
+    if (entry == NULL)
+        return -1;
+    if (entry->value->datasize > capacity)
+        return -2;
+
+    memcpy(buffer, entry->value->data, entry->value->datasize);
+    return entry->value->datasize;
+}
+
+struct data_t *table_peek(struct table_t *table, char *key) {
+    if (assert_error(
+        table == NULL || table->lists == NULL 
+        || key == NULL,
+        "table_peek",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return NULL;
+
+    struct entry_t* entry = list_get(table->lists[hash_code(key, table->size)], key);
+    return entry == NULL ? NULL : entry->value;
+}
+
 int table_remove(struct table_t *table, char *key) {
     if (assert_error(
         table == NULL || table->lists == NULL 
@@ -230,6 +261,108 @@ char **table_get_keys(struct table_t *table) {
     return array;
 }
 
+int table_clear(struct table_t *table) {
+    if (assert_error(
+        table == NULL || table->lists == NULL,
+        "table_clear",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    for (int i = 0; i < table->size; i++) {
+        struct list_t* empty = list_create();
+        if (assert_error(
+            empty == NULL,
+            "table_clear",
+            ERROR_MALLOC
+        )) return -1;
+
+        list_destroy(table->lists[i]);
+        table->lists[i] = empty;
+    }
+    return 0;
+}
+
+int table_scan(struct table_t *table, int *index, char *after, struct entry_t **entries, int max, size_t budget) {
+    if (assert_error(
+        table == NULL || table->lists == NULL || index == NULL || entries == NULL,
+        "table_scan",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    int n = 0;
+    size_t size = 0;
+    int start = *index;
+    for (int i = start; i < table->size; i++) {
+        struct node_t* node = table->lists[i]->head;
+        // lists are ordered by key: skip what was copied by the previous call
+        if (i == start && after != NULL) {
+            while (node != NULL && strcmp(node->entry->key, after) <= 0)
+                node = node->next;
+        }
+
+        for (; node != NULL; node = node->next) {
+            size_t entry_size = strlen(node->entry->key) + node->entry->value->datasize;
+            if (n == max || (n > 0 && size + entry_size > budget))
+                return n;
+
+            entries[n] = entry_dup(node->entry);
+            if (assert_error(
+                entries[n] == NULL,
+                "table_scan",
+                ERROR_MALLOC
+            )) {
+                for (int j = 0; j < n; j++)
+                    entry_destroy(entries[j]);
+                return -1;
+            }
+            size += entry_size;
+            *index = i;
+            n++;
+        }
+    }
+    return n;
+}
+
+int table_scan_keys(struct table_t *table, int *index, char *after, bool (*wanted)(const char *key, void *arg), void *arg, char **keys, int max) {
+    if (assert_error(
+        table == NULL || table->lists == NULL || index == NULL || wanted == NULL || keys == NULL,
+        "table_scan_keys",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    int n = 0;
+    int start = *index;
+    for (int i = start; i < table->size; i++) {
+        struct node_t* node = table->lists[i]->head;
+        // lists are ordered by key: skip what was copied by the previous call
+        if (i == start && after != NULL) {
+            while (node != NULL && strcmp(node->entry->key, after) <= 0)
+                node = node->next;
+        }
+
+        for (; node != NULL; node = node->next) {
+            if (!wanted(node->entry->key, arg))
+                continue;
+            if (n == max)
+                return n;
+
+            keys[n] = strdup(node->entry->key);
+            if (assert_error(
+                keys[n] == NULL,
+                "table_scan_keys",
+                ERROR_MALLOC
+            )) {
+                for (int j = 0; j < n; j++)
+                    destroy_dynamic_memory(keys[j]);
+                return -1;
+            }
+            *index = i;
+            n++;
+        }
+    }
+    return n;
+}
+
 int table_free_keys(char **keys) {
     return list_free_keys(keys);
 }
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include "table_bench.h"
+#include "client_stub-private.h"
+#include "network_client.h"
+#include "zk_client.h"
+#include "utils.h"
+#include "workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+
+
+#ifndef BENCH_GLOBAL_VARIABLES
+// ====================================================================================================
+//                                        Global Variables
+// ====================================================================================================
+struct TableBenchOptions options;
+struct bench_target_t targets[BENCH_MAX_TARGETS];
+int n_targets;
+struct TableClientData client;              // chains found in ZooKeeper, and their ring
+struct hash_ring_t* ring;                   // the ring at the time the targets were found
+struct TableClientReplicationData replicator;
+#endif
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record_key(uint64_t record, char* key) {
+    snprintf(key, BENCH_KEY_SIZE, "user%012llu", (unsigned long long)record);
+}
+
+#ifndef BENCH_DATA_STRUCT
+// ====================================================================================================
+//                                    Bench Data Struct (targets)
+// ====================================================================================================
+
+static char* table_address(struct rtable_t* rtable) {
+    char address[strlen(rtable->server_address) + 16];
+    snprintf(address, sizeof(address), "%s:%d", rtable->server_address, rtable->server_port);
+    return strdup(address);
+}
+
+// snapshots the servers of every chain found in ZooKeeper, along with the ring routing the keys
+static int discover_targets() {
+    zk_client_init(&replicator, &client, &(struct TableClientOptions){ .zk_connection_str = options.address, .valid = true });
+    if (replicator.zh == NULL)
+        return -1;
+
+    printf(BENCH_WAITING_FOR_SERVERS);
+    for (int attempt = 0; attempt < 100; attempt++) {
+        pthread_mutex_lock(&client.mutex);
+        int n_chains = client.n_chains, ready = 0;
+        for (int c = 0; c < n_chains; c++)
+            ready += client.chains[c].head_table != NULL && client.chains[c].tail_table != NULL;
+        if (n_chains > 0 && ready == n_chains && client.ring != NULL) {
+            ring = hash_ring_create(client.ring->chains, client.ring->n_chains);
+            for (int c = 0; c < n_chains && c < BENCH_MAX_TARGETS; c++) {
+                struct TableClientChain* chain = &client.chains[c];
+                struct bench_target_t* target = &targets[n_targets++];
+                target->id = chain->id;
+                target->write_address = table_address(chain->head_table);
+                for (int i = 0; i < chain->n_read_tables && target->n_reads < BENCH_MAX_READERS; i++)
+                    target->read_addresses[target->n_reads++] = table_address(chain->read_tables[i]);
+                if (target->n_reads == 0)
+                    target->read_addresses[target->n_reads++] = table_address(chain->tail_table);
+                printf(BENCH_TARGET, target->id, target->write_address, target->n_reads);
+            }
+            pthread_mutex_unlock(&client.mutex);
+            return 0;
+        }
+        pthread_mutex_unlock(&client.mutex);
+        usleep(100000);
+    }
+    return -1;
+}
+
+void BENCH_INIT() {
+    options.valid = false;
+    pthread_mutex_init(&client.mutex, NULL);
+    if (options.direct) {
+        targets[0].id = -1;
+        targets[0].write_address = strdup(options.address);
+        targets[0].read_addresses[0] = strdup(options.address);
+        targets[0].n_reads = 1;
+        n_targets = 1;
+    } else if (assert_error(
+        discover_targets() == -1,
+        "BENCH_INIT",
+        "Failed to find the servers.\n"
+    )) return;
+    options.valid = true;
+}
+
+void BENCH_EXIT(int status) {
+    BENCH_FREE();
+    exit(status);
+}
+
+void BENCH_FREE() {
+    for (int t = 0; t < n_targets; t++) {
+        destroy_dynamic_memory(targets[t].write_address);
+        for (int i = 0; i < targets[t].n_reads; i++)
+            destroy_dynamic_memory(targets[t].read_addresses[i]);
+    }
+    n_targets = 0;
+    hash_ring_destroy(ring);
+    ring = NULL;
+    if (replicator.zh != NULL)
+        zookeeper_close(replicator.zh);
+    replicator.zh = NULL;
+}
+
+#endif
+
+
+#ifndef BENCH_EXECUTION_OPTIONS
+// ====================================================================================================
+//                                      Program Execution Options
+// ====================================================================================================
+void tb_parse_args(int argc, char* argv[]) {
+    options = (struct TableBenchOptions){
+        .threads = 1,
+        .connections = 1,
+        .depth = 1,
+        .read_proportion = BENCH_DEFAULT_READ_PROPORTION,
+        .records = BENCH_DEFAULT_RECORDS,
+        .value_size = BENCH_DEFAULT_VALUE_SIZE,
+        .theta = BENCH_DEFAULT_THETA,
+        .operations = BENCH_DEFAULT_OPERATIONS
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hsw:r:k:v:uz:t:c:p:n:d:l")) != -1) {
+        switch (opt) {
+            case 'h':
+                printf(TB_USAGE_STR);
+                exit(EXIT_SUCCESS);
+            case 's': options.direct = true; break;
+            case 'w':
+                options.read_proportion = optarg[0] == 'a' ? 0.5 : optarg[0] == 'b' ? 0.95 : optarg[0] == 'c' ? 1.0 : -1;
+                break;
+            case 'r': options.read_proportion = atof(optarg); break;
+            case 'k': options.records = strtoull(optarg, NULL, 10); break;
+            case 'v': options.value_size = atoi(optarg); break;
+            case 'u': options.uniform = true; break;
+            case 'z': options.theta = atof(optarg); break;
+            case 't': options.threads = atoi(optarg); break;
+            case 'c': options.connections = atoi(optarg); break;
+            case 'p': options.depth = atoi(optarg); break;
+            case 'n': options.operations = strtoull(optarg, NULL, 10); break;
+            case 'd': options.duration = atoi(optarg); break;
+            case 'l': options.skip_load = true; break;
+            default: return;
+        }
+    }
+    if (optind != argc - 1)
+        return;
+
+    options.address = argv[optind];
+    options.valid = options.read_proportion >= 0 && options.read_proportion <= 1 && options.records > 0 &&
+        options.value_size >= 0 && options.value_size <= COMPACT_MAX_PAYLOAD - BENCH_KEY_SIZE &&
+        options.theta > 0 && options.theta < 1 && options.threads > 0 && options.connections > 0 &&
+        options.depth > 0 && options.depth <= BENCH_MAX_DEPTH && options.duration >= 0;
+}
+
+void tb_show_options(struct TableBenchOptions* options) {
+    printf("+-----------------------------------+\n");
+    printf("|           Bench Options           |\n");
+    printf("+-----------------------------------+\n");
+    printf("| %-12s %20s |\n", options->direct ? "Server:" : "Zookeeper:", options->address);
+    printf("| Reads:                    %6.1f%% |\n", options->read_proportion * 100);
+    printf("| Records:             %12llu |\n", (unsigned long long)options->records);
+    printf("| Value size:                %6d |\n", options->value_size);
+    printf("| Keys:               %13s |\n", options->uniform ? "uniform" : "zipfian");
+    printf("| Threads x conns x depth: %3dx%2dx%-3d|\n", options->threads, options->connections, options->depth);
+    if (options->duration > 0)
+        printf("| Duration (s):              %6d |\n", options->duration);
+    else
+        printf("| Operations:          %12llu |\n", (unsigned long long)options->operations);
+    printf("+-----------------------------------+\n");
+}
+
+void tb_interrupt_handler() {
+    BENCH_EXIT(0);
+}
+
+#endif
+
+
+#ifndef BENCH_STATISTICS
+// ====================================================================================================
+//                                            Histograms
+// ====================================================================================================
+void bench_histogram_record(struct bench_histogram_t* histogram, uint64_t latency_ns, bool failed) {
+    histogram->buckets[stats_histogram_index((long long)latency_ns)]++;
+    histogram->count++;
+    histogram->errors += failed;
+    if (latency_ns > histogram->max_ns)
+        histogram->max_ns = latency_ns;
+}
+
+void bench_histogram_merge(struct bench_histogram_t* into, struct bench_histogram_t* from) {
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+        into->buckets[i] += from->buckets[i];
+    into->count += from->count;
+    into->errors += from->errors;
+    if (from->max_ns > into->max_ns)
+        into->max_ns = from->max_ns;
+}
+
+uint64_t bench_histogram_percentile(struct bench_histogram_t* histogram, double fraction) {
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS && histogram->count > 0; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= fraction * histogram->count) {
+            uint64_t bound = stats_histogram_bound(i);
+            return bound < histogram->max_ns ? bound : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+#endif
+
+
+#ifndef BENCH_WORKLOAD
+// ====================================================================================================
+//                                             Workload
+// ====================================================================================================
+static int endpoint_open(struct bench_endpoint_t* endpoint, char* address) {
+    char copy[strlen(address) + 1];
+    strcpy(copy, address);
+    endpoint->rtable = rtable_connect(copy);
+    endpoint->sent_ns = create_dynamic_memory(options.depth * sizeof(uint64_t));
+    endpoint->ops = create_dynamic_memory(options.depth);
+    if (endpoint->rtable == NULL || endpoint->sent_ns == NULL || endpoint->ops == NULL)
+        return -1;
+    static bool warned = false;
+    if (!endpoint->rtable->compact && options.depth > 1 && !__atomic_exchange_n(&warned, true, __ATOMIC_RELAXED))
+        printf(BENCH_NO_PIPELINE, endpoint->rtable->server_address, endpoint->rtable->server_port);
+    return 0;
+}
+
+static void endpoint_close(struct bench_endpoint_t* endpoint) {
+    if (endpoint->rtable != NULL)
+        rtable_disconnect(endpoint->rtable);
+    destroy_dynamic_memory(endpoint->sent_ns);
+    destroy_dynamic_memory(endpoint->ops);
+    memset(endpoint, 0, sizeof(struct bench_endpoint_t));
+}
+
+// waits for the oldest request in flight
+static int endpoint_complete(struct bench_thread_t* thread, struct bench_endpoint_t* endpoint) {
+    struct compact_header_t response;
+    int result = network_compact_receive(endpoint->rtable, &response);
+    uint64_t latency = now_ns() - endpoint->sent_ns[endpoint->first];
+    int op = endpoint->ops[endpoint->first];
+    endpoint->first = (endpoint->first + 1) % options.depth;
+    endpoint->pending--;
+    bench_histogram_record(&thread->histograms[op], latency, result == -1 || (response.flags & COMPACT_FLAG_ERROR));
+    return result;
+}
+
+// completes the pipelined requests whose responses arrived, timing them as they do, waiting
+// up to timeout_ms for one (-1: no limit). Returns the number of endpoints with requests in
+// flight, or -1
+static int thread_poll(struct bench_thread_t* thread, int timeout_ms) {
+    int n = 0;
+    for (int c = 0; c < options.connections; c++) {
+        struct bench_connection_t* connection = &thread->connections[c];
+        for (int t = 0; t < n_targets; t++) {
+            for (int r = -1; r < targets[t].n_reads; r++) {
+                struct bench_endpoint_t* endpoint = r == -1 ? &connection->writes[t] : &connection->reads[t][r];
+                if (endpoint->pending == 0)
+                    continue;
+                thread->pipelined[n] = endpoint;
+                thread->pollfds[n] = (struct pollfd){ .fd = endpoint->rtable->sockfd, .events = POLLIN };
+                n++;
+            }
+        }
+    }
+    if (n == 0)
+        return 0;
+
+    int ready = poll(thread->pollfds, n, timeout_ms);
+    if (ready == -1)
+        return errno == EINTR ? n : -1;
+    for (int i = 0; i < n && ready > 0; i++) {
+        if (thread->pollfds[i].revents == 0)
+            continue;
+        ready--;
+        if (endpoint_complete(thread, thread->pipelined[i]) == -1)
+            return -1;
+    }
+    return n;
+}
+
+// sends op over endpoint, once it has room for another request
+static int endpoint_issue(struct bench_thread_t* thread, struct bench_endpoint_t* endpoint, int op, char* key) {
+    struct rtable_t* rtable = endpoint->rtable;
+    struct data_t value = { .datasize = options.value_size, .data = thread->value };
+    if (!rtable->compact) {
+        // one request at a time
+        uint64_t start = now_ns();
+        bool failed;
+        if (op == BENCH_READ) {
+            struct data_t* data = rtable_get(rtable, key);
+            failed = data == NULL;
+            data_destroy(data);
+        } else {
+            failed = rtable_put_with_data(rtable, key, &value) == -1;
+        }
+        bench_histogram_record(&thread->histograms[op], now_ns() - start, failed);
+        return 0;
+    }
+
+    // responses are taken as they arrive on any endpoint, not when their slot is needed, so that
+    // their latency does not include the requests issued meanwhile
+    if (options.depth > 1 && thread_poll(thread, 0) == -1)
+        return -1;
+    while (endpoint->pending == options.depth) {
+        if (thread_poll(thread, -1) == -1)
+            return -1;
+    }
+    int slot = (endpoint->first + endpoint->pending) % options.depth;
+    endpoint->sent_ns[slot] = now_ns();
+    endpoint->ops[slot] = op;
+    endpoint->pending++;
+    int result = op == BENCH_READ
+        ? network_compact_send(rtable, COMPACT_OP_GET, key, NULL, 0, NULL)
+        : network_compact_send(rtable, COMPACT_OP_PUT, key, value.data, value.datasize, NULL);
+    if (result == -1 || options.depth > 1)
+        return result;
+    return endpoint_complete(thread, endpoint);
+}
+
+static int target_of(char* key) {
+    if (n_targets == 1)
+        return 0;
+    int id = hash_ring_lookup(ring, key);
+    for (int t = 0; t < n_targets; t++) {
+        if (targets[t].id == id)
+            return t;
+    }
+    return 0;
+}
+
+static void* bench_thread(void* _thread) {
+    struct bench_thread_t* thread = _thread;
+    struct bench_phase_t* phase = thread->phase;
+    char key[BENCH_KEY_SIZE];
+    int failed = 0;
+
+    // the operations are shared out between the threads
+    uint64_t operations = phase->operations / options.threads + ((uint64_t)thread->index < phase->operations % options.threads);
+    for (uint64_t i = 0; i < operations && !failed; i++) {
+        if (phase->deadline_ns > 0 && (i & 63) == 0 && now_ns() >= phase->deadline_ns)
+            break;
+
+        int op;
+        uint64_t record;
+        if (phase->load) {
+            // the threads take turns over the records
+            op = BENCH_UPDATE;
+            record = i * options.threads + thread->index;
+            if (record >= options.records)
+                break;
+        } else {
+            op = random_uniform(&thread->rng) < options.read_proportion ? BENCH_READ : BENCH_UPDATE;
+            record = options.uniform
+                ? random_next(&thread->rng) % options.records
+                : workload_scramble(zipfian_next(&phase->zipfian, random_uniform(&thread->rng))) % options.records;
+        }
+        record_key(record, key);
+
+        struct bench_connection_t* connection = &thread->connections[i % options.connections];
+        struct bench_target_t* target = &targets[target_of(key)];
+        int t = target - targets;
+        struct bench_endpoint_t* endpoint = op == BENCH_READ
+            ? &connection->reads[t][connection->next_read++ % target->n_reads]
+            : &connection->writes[t];
+        failed = endpoint_issue(thread, endpoint, op, key) == -1;
+    }
+
+    // the requests still in flight
+    while (thread_poll(thread, -1) > 0);
+    return NULL;
+}
+
+static int thread_open(struct bench_thread_t* thread) {
+    thread->rng = workload_scramble(thread->index + 1) | 1;
+    thread->value = create_dynamic_memory(options.value_size + 1);
+    thread->connections = create_dynamic_memory(options.connections * sizeof(struct bench_connection_t));
+    int n_endpoints = 0;
+    for (int t = 0; t < n_targets; t++)
+        n_endpoints += options.connections * (1 + targets[t].n_reads);
+    thread->pipelined = create_dynamic_memory(n_endpoints * sizeof(struct bench_endpoint_t*));
+    thread->pollfds = create_dynamic_memory(n_endpoints * sizeof(struct pollfd));
+    if (thread->value == NULL || thread->connections == NULL || thread->pipelined == NULL || thread->pollfds == NULL)
+        return -1;
+    for (int i = 0; i < options.value_size; i++)
+        thread->value[i] = 'a' + random_next(&thread->rng) % 26;
+
+    for (int c = 0; c < options.connections; c++) {
+        for (int t = 0; t < n_targets; t++) {
+            if (endpoint_open(&thread->connections[c].writes[t], targets[t].write_address) == -1)
+                return -1;
+            for (int r = 0; r < targets[t].n_reads; r++) {
+                if (endpoint_open(&thread->connections[c].reads[t][r], targets[t].read_addresses[r]) == -1)
+                    return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void thread_close(struct bench_thread_t* thread) {
+    for (int c = 0; thread->connections != NULL && c < options.connections; c++) {
+        for (int t = 0; t < n_targets; t++) {
+            endpoint_close(&thread->connections[c].writes[t]);
+            for (int r = 0; r < targets[t].n_reads; r++)
+                endpoint_close(&thread->connections[c].reads[t][r]);
+        }
+    }
+    destroy_dynamic_memory(thread->connections);
+    destroy_dynamic_memory(thread->pipelined);
+    destroy_dynamic_memory(thread->pollfds);
+    destroy_dynamic_memory(thread->value);
+}
+
+int bench_run(struct bench_phase_t* phase, struct bench_result_t* result) {
+    if (assert_error(
+        phase == NULL || result == NULL,
+        "bench_run",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct bench_thread_t* threads = create_dynamic_memory(options.threads * sizeof(struct bench_thread_t));
+    if (assert_error(
+        threads == NULL,
+        "bench_run",
+        ERROR_MALLOC
+    )) return -1;
+
+    int status = 0;
+    for (int i = 0; i < options.threads && status == 0; i++) {
+        threads[i].index = i;
+        threads[i].phase = phase;
+        status = assert_error(
+            thread_open(&threads[i]) == -1,
+            "bench_run",
+            "Failed to connect to the servers.\n"
+        ) ? -1 : 0;
+    }
+
+    int started = 0;
+    uint64_t start = now_ns();
+    if (status == 0 && phase->deadline_ns > 0)
+        phase->deadline_ns += start;
+    for (; status == 0 && started < options.threads; started++) {
+        if (pthread_create(&threads[started].thread, NULL, bench_thread, &threads[started]) != 0)
+            status = -1;
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i].thread, NULL);
+    result->seconds = (now_ns() - start) / 1e9;
+
+    memset(result->histograms, 0, sizeof(result->histograms));
+    for (int i = 0; i < options.threads; i++) {
+        for (int op = 0; op < BENCH_OPS; op++)
+            bench_histogram_merge(&result->histograms[op], &threads[i].histograms[op]);
+        thread_close(&threads[i]);
+    }
+    destroy_dynamic_memory(threads);
+    return status;
+}
+
+void bench_report(struct bench_result_t* result) {
+    static const char* names[BENCH_OPS] = { "READ", "UPDATE" };
+    struct bench_histogram_t total = { 0 };
+    for (int op = 0; op < BENCH_OPS; op++)
+        bench_histogram_merge(&total, &result->histograms[op]);
+
+    printf(BENCH_PHASE, result->phase, (unsigned long long)total.count, result->seconds,
+        result->seconds > 0 ? total.count / result->seconds : 0);
+    for (int op = 0; op <= BENCH_OPS; op++) {
+        struct bench_histogram_t* histogram = op < BENCH_OPS ? &result->histograms[op] : &total;
+        // the total only adds up a mix
+        if (histogram->count == 0 || (op == BENCH_OPS && (result->histograms[BENCH_READ].count == 0 || result->histograms[BENCH_UPDATE].count == 0)))
+            continue;
+        printf(BENCH_LATENCY, op < BENCH_OPS ? names[op] : "ALL", (unsigned long long)histogram->count,
+            (unsigned long long)histogram->errors, bench_histogram_percentile(histogram, 0.5) / 1e3,
+            bench_histogram_percentile(histogram, 0.99) / 1e3, bench_histogram_percentile(histogram, 0.999) / 1e3,
+            histogram->max_ns / 1e3);
+    }
+}
+
+#endif
+
+
+#ifndef TABLE_BENCH_MAIN
+// ====================================================================================================
+//                                              Main
+// ====================================================================================================
+int main(int argc, char *argv[]) {
+    signal(SIGINT, tb_interrupt_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    tb_parse_args(argc, argv);
+    if (assert_error(
+        !options.valid,
+        "main",
+        TB_ERROR_ARGS
+    )) exit(EXIT_FAILURE);
+    tb_show_options(&options);
+
+    BENCH_INIT();
+    if (!options.valid)
+        BENCH_EXIT(EXIT_FAILURE);
+
+    if (!options.skip_load) {
+        struct bench_phase_t load = { .load = true, .operations = UINT64_MAX };
+        struct bench_result_t result = { .phase = "Load" };
+        if (bench_run(&load, &result) == -1)
+            BENCH_EXIT(EXIT_FAILURE);
+        bench_report(&result);
+    }
+
+    struct bench_phase_t run = {
+        .operations = options.duration > 0 ? UINT64_MAX : options.operations,
+        .deadline_ns = options.duration * 1000000000ULL
+    };
+    if (!options.uniform)
+        zipfian_init(&run.zipfian, options.records, options.theta);
+    struct bench_result_t result = { .phase = "Run" };
+    if (bench_run(&run, &result) == -1)
+        BENCH_EXIT(EXIT_FAILURE);
+    bench_report(&result);
+    BENCH_EXIT(EXIT_SUCCESS);
+}
+#endif
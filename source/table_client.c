@@ -29,6 +29,7 @@ struct TableClientReplicationData replicator;
 void CLIENT_INIT() {
     client.valid = false;
     client.terminate = false;
+    pthread_mutex_init(&client.mutex, NULL);
     zk_client_init(&replicator, &client, &options);
     client.valid = true;
 }
@@ -37,20 +38,28 @@ void CLIENT_EXIT(int status) {
     exit(status);
 }
 void CLIENT_FREE() {
-    if (client.head_table != NULL) {
-        assert_error(
-            rtable_disconnect(client.head_table) == M_ERROR,
-            "CLIENT_FREE",
-            "Failed to disconnect from remote head table."
-        );
-    }
-    if (client.tail_table != NULL) {
-        assert_error(
-            rtable_disconnect(client.tail_table) == M_ERROR,
-            "CLIENT_FREE",
-            "Failed to disconnect from remote head table."
-        );
+    for (int c = 0; c < client.n_chains; c++) {
+        struct TableClientChain* chain = &client.chains[c];
+        if (chain->head_table != NULL) {
+            assert_error(
+                rtable_disconnect(chain->head_table) == M_ERROR,
+                "CLIENT_FREE",
+                "Failed to disconnect from remote head table."
+            );
+        }
+        if (chain->tail_table != NULL) {
+            assert_error(
+                rtable_disconnect(chain->tail_table) == M_ERROR,
+                "CLIENT_FREE",
+                "Failed to disconnect from remote head table."
+            );
+        }
+        for (int i = 0; i < chain->n_read_tables; i++)
+            rtable_disconnect(chain->read_tables[i]);
+        for (int i = 0; i < chain->n_retired_tables; i++)
+            rtable_disconnect(chain->retired_tables[i]);
     }
+    hash_ring_destroy(client.ring);
 }
 
 #endif
@@ -99,64 +108,230 @@ void tc_interrupt_handler() {
 // ====================================================================================================
 //                                      Client Stub Wrappers
 // ====================================================================================================
-int stats() {
-    struct statistics_t* stats = rtable_stats(client.tail_table);
-    if (stats == NULL)
-        return -1;
+// chain holding key: the one the ring maps it to, or the first one found before any joined the ring
+static struct TableClientChain* key_chain(char* key) {
+    pthread_mutex_lock(&client.mutex);
+    int id = hash_ring_lookup(client.ring, key);
+    pthread_mutex_unlock(&client.mutex);
+
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        if (id == -1 || client.chains[c].id == id)
+            return &client.chains[c];
+    }
+    return NULL;
+}
 
-    stats_show(stats);
-    stats_destroy(stats);
+// disconnects the tables of servers that left the chain, which the previous read was done with. Called with mutex held
+static void retired_tables_drop(struct TableClientChain* chain) {
+    for (int i = 0; i < chain->n_retired_tables; i++)
+        rtable_disconnect(chain->retired_tables[i]);
+    destroy_dynamic_memory(chain->retired_tables);
+    chain->retired_tables = NULL;
+    chain->n_retired_tables = 0;
+}
+
+// table answering the next read of key: the servers of its chain take turns, clean keys being read locally
+static struct rtable_t* read_table(char* key) {
+    struct TableClientChain* chain = key_chain(key);
+    if (chain == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&client.mutex);
+    retired_tables_drop(chain);
+    struct rtable_t* table = chain->n_read_tables == 0 ? chain->tail_table
+        : chain->read_tables[chain->next_read++ % chain->n_read_tables];
+    pthread_mutex_unlock(&client.mutex);
+    return table;
+}
+
+// table answering the writes of key
+static struct rtable_t* write_table(char* key) {
+    struct TableClientChain* chain = key_chain(key);
+    return chain != NULL ? chain->head_table : NULL;
+}
+
+int stats(bool detail) {
+    // every chain serves its own clients
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        struct statistics_t* stats = rtable_stats(client.chains[c].tail_table);
+        if (stats == NULL)
+            return -1;
+
+        // the lag down the chain is seen by the head
+        struct rtable_t* head = client.chains[c].head_table;
+        struct statistics_t* head_stats = head != client.chains[c].tail_table ? rtable_stats(head) : NULL;
+        if (head_stats != NULL && stats->n_successors == 0) {
+            stats->successors = head_stats->successors;
+            stats->n_successors = head_stats->n_successors;
+            head_stats->successors = NULL;
+            head_stats->n_successors = 0;
+        }
+        printf("Chain %d:\n", client.chains[c].id);
+        stats_show(stats);
+        if (detail) {
+            // writes are served by the head, reads by the tail
+            printf("Tail latencies:\n");
+            stats_show_latencies(stats);
+            printf("Tail memory:\n");
+            stats_show_memory(stats);
+            if (head_stats != NULL) {
+                printf("Head latencies:\n");
+                stats_show_latencies(head_stats);
+                printf("Head memory:\n");
+                stats_show_memory(head_stats);
+            }
+        }
+        if (head_stats != NULL)
+            stats_destroy(head_stats);
+        stats_destroy(stats);
+    }
     return 0;
 }
 
-int gettable() {
-    struct entry_t** entries = rtable_get_table(client.tail_table);
-    if (assert_error(
-        entries == NULL,
-        "gettable",
-        "Failed to retrieve remote table.\n"
-    )) return -1;
+int slowlog(bool reset) {
+    // writes are slow at the head, reads at the tail
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        struct rtable_t* servers[2] = { client.chains[c].head_table, client.chains[c].tail_table };
+        int n_servers = servers[0] != servers[1] ? 2 : 1;
+        for (int s = 0; s < n_servers; s++) {
+            int n_ops;
+            struct slow_op_t* ops = rtable_slowlog(servers[s], reset, &n_ops);
+            if (assert_error(
+                n_ops == -1,
+                "slowlog",
+                "Failed to retrieve the slow log.\n"
+            )) return -1;
+
+            printf("Chain %d %s:\n", client.chains[c].id, n_servers == 1 ? "server" : s == 0 ? "head" : "tail");
+            stats_show_slow_ops(ops, n_ops);
+            stats_destroy_slow_ops(ops, n_ops);
+        }
+    }
+    return 0;
+}
 
-    // starting with index 0, iterate over entries, printing
-    int index = 0;
-    struct entry_t* entry;
-    while ((entry = entries[index])) {
-        printf("%s : ", entry->key);
-        print_data(entry->value->data, entry->value->datasize);
-        index++;
+int hotkeys(bool reset) {
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        // every server counts the requests of its own clients: writes at the head, reads
+        // wherever they were sent
+        struct TableClientChain* chain = &client.chains[c];
+        pthread_mutex_lock(&client.mutex);
+        retired_tables_drop(chain);
+        struct rtable_t* servers[chain->n_read_tables + 1];
+        int n_servers = 0;
+        servers[n_servers++] = chain->head_table;
+        for (int i = 0; i < chain->n_read_tables; i++) {
+            // the head may also be read from, over a connection of its own
+            struct rtable_t* table = chain->read_tables[i];
+            if (table->server_port != chain->head_table->server_port
+                || strcmp(table->server_address, chain->head_table->server_address) != 0)
+                servers[n_servers++] = table;
+        }
+        pthread_mutex_unlock(&client.mutex);
+
+        struct hot_key_t* merged = NULL;
+        int n_merged = 0;
+        for (int s = 0; s < n_servers; s++) {
+            int n_keys;
+            struct hot_key_t* keys = rtable_hotkeys(servers[s], reset, &n_keys);
+            if (assert_error(
+                n_keys == -1,
+                "hotkeys",
+                "Failed to retrieve the hot keys.\n"
+            )) {
+                stats_destroy_hot_keys(merged, n_merged);
+                return -1;
+            }
+
+            // the estimates of a key add up over the servers
+            struct hot_key_t* grown = n_keys > 0 ? realloc(merged, (n_merged + n_keys) * sizeof(struct hot_key_t)) : merged;
+            for (int i = 0; grown != NULL && i < n_keys; i++) {
+                int j = 0;
+                while (j < n_merged && strcmp(grown[j].key, keys[i].key) != 0)
+                    j++;
+                if (j == n_merged) {
+                    grown[n_merged++] = keys[i];
+                    keys[i].key = NULL;
+                } else {
+                    grown[j].ops += keys[i].ops;
+                    grown[j].bytes += keys[i].bytes;
+                }
+            }
+            if (grown != NULL)
+                merged = grown;
+            stats_destroy_hot_keys(keys, n_keys);
+        }
+        printf("Chain %d:\n", chain->id);
+        stats_show_hot_keys(merged, n_merged);
+        stats_destroy_hot_keys(merged, n_merged);
     }
+    return 0;
+}
 
-    rtable_free_entries(entries);
+int gettable() {
+    // the keys of every chain, one after the other
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        struct entry_t** entries = rtable_get_table(client.chains[c].tail_table);
+        if (assert_error(
+            entries == NULL,
+            "gettable",
+            "Failed to retrieve remote table.\n"
+        )) return -1;
+
+        // starting with index 0, iterate over entries, printing
+        int index = 0;
+        struct entry_t* entry;
+        while ((entry = entries[index])) {
+            printf("%s : ", entry->key);
+            print_data(entry->value->data, entry->value->datasize);
+            index++;
+        }
+
+        rtable_free_entries(entries);
+    }
     return 0;
 }
 
 int getkeys() {
-    char** keys = rtable_get_keys(client.tail_table);
-    if (assert_error(
-        keys == NULL,
-        "getkeys",
-        "Failed to retrieve keys of remote table.\n"
-    )) return -1;
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        char** keys = rtable_get_keys(client.chains[c].tail_table);
+        if (assert_error(
+            keys == NULL,
+            "getkeys",
+            "Failed to retrieve keys of remote table.\n"
+        )) return -1;
+
+        // starting with index 0, iterate over keys, printing
+        int index = 0;
+        char* key;
+        while ((key = keys[index])) {
+            printf("<key> %s\n", key);
+            index++;
+        }
 
-    // starting with index 0, iterate over keys, printing
-    int index = 0;
-    char* key;
-    while ((key = keys[index])) {
-        printf("<key> %s\n", key);
-        index++;
+        rtable_free_keys(keys);
     }
-
-    rtable_free_keys(keys);
     return 0;
 }
 
 int size() {
-    int size = rtable_size(client.tail_table);
-    if (assert_error(
-        size < 0,
-        "size",
-        "Failed to retrieve size of remote table.\n"
-    )) return -1;
+    int size = 0;
+    int n_chains = __atomic_load_n(&client.n_chains, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < n_chains; c++) {
+        int chain_size = rtable_size(client.chains[c].tail_table);
+        if (assert_error(
+            chain_size < 0,
+            "size",
+            "Failed to retrieve size of remote table.\n"
+        )) return -1;
+        size += chain_size;
+    }
 
     printf("Table size: %d\n", size);
     return 0;
@@ -171,7 +346,7 @@ int del(char *key) {
 
     printf("Deleting key %s...\n", key);
     if (assert_error(
-        rtable_del(client.head_table, key) < 0,
+        rtable_del(write_table(key), key) < 0,
         "del",
         "Failed to delete key from remote table.\n"
     )) return -1;
@@ -188,7 +363,7 @@ int get(char *key) {
 
     printf("Getting key %s...\n", key);
     // retrieve data from remote table
-    struct data_t* data = rtable_get(client.tail_table, key);
+    struct data_t* data = rtable_get(read_table(key), key);
     if (data == NULL) {
         printf("Not found.\n");
         return -1;
@@ -232,7 +407,7 @@ int put(char* key, char* value) {
 
     // send request to server
     if (assert_error(
-        rtable_put(client.head_table, entry) == -1,
+        rtable_put(write_table(key), entry) == -1,
         "put",
         "Failed to put entry in remote table.\n"
     )) {
@@ -266,6 +441,10 @@ enum CommandType parse_command(char* token) {
         return GETTABLE;
     else if (!strcmp(token, "stats"))
         return STATS;
+    else if (!strcmp(token, "hotkeys"))
+        return HOTKEYS;
+    else if (!strcmp(token, "slowlog"))
+        return SLOWLOG;
     else if (!strcmp(token, "quit"))
         return QUIT;
     return INVALID;
@@ -277,11 +456,11 @@ void user_interaction() {
     printf(CLIENT_LOADING_CLI);
     char input[MAX_INPUT_LENGTH]; // user input buffer
     while (!client.terminate) {
-        while(client.head_table == NULL) {
+        while(client.n_chains == 0 || client.chains[0].head_table == NULL) {
             printf(CLIENT_WAITING_FOR_SERVERS);
             sleep(5);
         }
-        printf(CLIENT_SHELL, options.zk_connection_str, replicator.head_node_path);
+        printf(CLIENT_SHELL, options.zk_connection_str, replicator.chains[0].head_node_path);
         if (fgets(input, sizeof(input), stdin) == NULL)
             break;
 
@@ -315,7 +494,27 @@ void user_interaction() {
                 printf("Successful operation.\n");
             break;
         case STATS:
-            if (stats() == 0)
+            if (key != NULL && strcmp(key, "--detail") != 0) {
+                printf("Usage: stats [--detail]\n");
+                break;
+            }
+            if (stats(key != NULL) == 0)
+                printf("Successful operation.\n");
+            break;
+        case HOTKEYS:
+            if (key != NULL && strcmp(key, "--reset") != 0) {
+                printf("Usage: hotkeys [--reset]\n");
+                break;
+            }
+            if (hotkeys(key != NULL) == 0)
+                printf("Successful operation.\n");
+            break;
+        case SLOWLOG:
+            if (key != NULL && strcmp(key, "--reset") != 0) {
+                printf("Usage: slowlog [--reset]\n");
+                break;
+            }
+            if (slowlog(key != NULL) == 0)
                 printf("Successful operation.\n");
             break;
         case QUIT:
@@ -6,6 +6,9 @@
 #include "utils.h"
 #include "network_server.h"
 #include "table_skel.h"
+#include "event_loop.h"
+#include "local_transport.h"
+#include "logger.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -17,7 +20,7 @@
 // ====================================================================================================
 //                                        Global Variables
 // ====================================================================================================
-struct TableServerConfig config;
+struct TableServerConfig config = { .listening_fd = -1, .local_fd = -1 };
 struct TableServerOptions options;
 struct TableServerDistributedDatabase ddatabase;
 struct TableServerReplicationData replicator;
@@ -30,7 +33,10 @@ struct TableServerReplicationData replicator;
 
 void SERVER_INIT() {
     config.valid = false;
+    logger_start();
     config.listening_fd = network_server_init(options.listening_port);
+    // the socket of the port belongs to the server listening on it
+    config.local_fd = options.local_transport && config.listening_fd >= 0 ? local_transport_init(options.listening_port) : -1;
     ddatabase_init(&ddatabase, options.n_lists);
     zk_server_init(&replicator, &ddatabase, &options);
 
@@ -47,12 +53,15 @@ void SERVER_EXIT(int status) {
 }
 void SERVER_FREE() {
     assert_error(
-        network_server_close(config.listening_fd) == M_ERROR,
+        config.listening_fd >= 0 && network_server_close(config.listening_fd) == M_ERROR,
         "SERVER_FREE",
         "Failed to free listening file descriptor."
     );
+    if (config.local_fd >= 0)
+        local_transport_close(config.local_fd, options.listening_port);
     ddatabase_destroy(&ddatabase);
     zk_server_destroy(&replicator);
+    logger_stop();
 }
 
 #endif
@@ -87,6 +96,8 @@ void ts_parse_args(char* argv[]) {
     options.listening_port = port;
     options.n_lists = n;
     options.zk_connection_str = zk_connection_str;
+    options.io_backend = io_backend_parse(get_env_string("NODEDB_IO_BACKEND", "threads"));
+    options.local_transport = get_env_int("NODEDB_LOCAL_TRANSPORT", 1) != 0;
     return;
 }
 
@@ -97,6 +108,8 @@ void ts_show_options(struct TableServerOptions* options) {
     printf("| Listening Port:           %7d |\n", options->listening_port);
     printf("| Number of Lists:          %7d |\n", options->n_lists);
     printf("| Zookeeper Conn.:  %-15s |\n", options->zk_connection_str);
+    printf("| I/O Backend:              %7s |\n", io_backend_name(options->io_backend));
+    printf("| Local Transport:          %7s |\n", options->local_transport ? "Yes" : "No");
     printf("| Valid:                     %-6s |\n", options->valid ? "Yes" : "No");
     printf("+-----------------------------------+\n");
 }
@@ -130,8 +143,12 @@ int main(int argc, char *argv[]) {
     if (!config.valid)
         SERVER_EXIT(EXIT_FAILURE);
 
+    // serve co-located clients in the background
+    if (config.local_fd >= 0)
+        local_transport_start(config.local_fd, &ddatabase);
+
     // Main Loop
-    network_main_loop(config.listening_fd, &ddatabase);
+    event_loop_run(config.listening_fd, &ddatabase, options.io_backend);
     SERVER_EXIT(EXIT_FAILURE);
 }
 #endif
\ No newline at end of file
@@ -6,9 +6,16 @@
 #include "sdmessage.pb-c.h"
 #include "database.h"
 #include "distributed_database.h"
+#include "anti_entropy.h"
+#include "latency.h"
+#include "logger.h"
+#include "slowlog.h"
+#include "hotkeys.h"
+#include "probes.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 
 struct table_t *table_skel_init(int n_lists) {
     return table_create(n_lists);
@@ -18,42 +25,145 @@ int table_skel_destroy(struct table_t* table) {
     return table_destroy(table);
 }
 
-int invoke(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
-    if (assert_error(
-        msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->table == NULL,
-        "invoke",
-        ERROR_NULL_POINTER_REFERENCE
-    )) return -1;
-
+// runs the request in msg, answering in msg (unless a write is left pending)
+static int invoke_request(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending) {
     switch (msg->opcode) {
         case MESSAGE_T__OPCODE__OP_PUT:
-            printf(SERVER_PARSED_REQUEST, "put");
-            return put(msg, ddb);        
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "put");
+            return put(msg, ddb, pending);        
         case MESSAGE_T__OPCODE__OP_GET:
-            printf(SERVER_PARSED_REQUEST, "get");
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "get");
             return get(msg, ddb);
         case MESSAGE_T__OPCODE__OP_DEL:
-            printf(SERVER_PARSED_REQUEST, "del");
-            return del(msg, ddb);
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "del");
+            return del(msg, ddb, pending);
         case MESSAGE_T__OPCODE__OP_SIZE:
-            printf(SERVER_PARSED_REQUEST, "size");
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "size");
             return size(msg, ddb);
         case MESSAGE_T__OPCODE__OP_GETKEYS:
-            printf(SERVER_PARSED_REQUEST, "getkeys");
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "getkeys");
             return getkeys(msg, ddb);
         case MESSAGE_T__OPCODE__OP_GETTABLE:
-            printf(SERVER_PARSED_REQUEST, "gettable");
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "gettable");
             return gettable(msg, ddb);
         case MESSAGE_T__OPCODE__OP_STATS:
-            printf(SERVER_PARSED_REQUEST, "stats");
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "stats");
             return stats(msg, ddb);
+        case MESSAGE_T__OPCODE__OP_HOTKEYS:
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "hotkeys");
+            return hotkeys(msg);
+        case MESSAGE_T__OPCODE__OP_SLOWLOG:
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "slowlog");
+            return slowlog(msg);
+        case MESSAGE_T__OPCODE__OP_HELLO:
+            LOG_DEBUG(SERVER_PARSED_REQUEST, "hello");
+            return hello(msg);
+        case MESSAGE_T__OPCODE__OP_DIGEST:
+            return digest(msg, ddb);
         default:
-            printf(SERVER_UNKNOWN_REQUEST);
+            LOG_WARN(SERVER_UNKNOWN_REQUEST);
             return error(msg);
     }
     return 0;
 }
 
+int invoke(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
+    return invoke_async(msg, ddb, NULL);
+}
+
+int invoke_async(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending) {
+    if (assert_error(
+        msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->table == NULL,
+        "invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    // the transport ends the request once the response is packed
+    EntryT* entry = msg->entry;
+    PROBE2(request__parse, msg->opcode, entry != NULL ? entry->key : msg->key);
+    slowlog_begin(msg->opcode, entry != NULL ? entry->key : msg->key, entry != NULL ? (int)entry->value.len : 0);
+    enum StatsOp op = latency_op(msg->opcode);
+    uint64_t start_ns = latency_sample(STATS_PHASE_TOTAL) ? latency_now_ns() : 0;
+    int result = invoke_request(msg, ddb, pending);
+    if (pending != NULL && pending->pending) {
+        pending->start_ns = start_ns;
+        return result;
+    }
+    if (start_ns != 0)
+        latency_record(op, STATS_PHASE_TOTAL, latency_now_ns() - start_ns);
+    slowlog_invoked();
+    return result;
+}
+
+// runs a PUT or DEL of a client. With pending, a mutation forwarded down the chain is left
+// pending instead of waited for
+static int invoke_mutation(MessageT__Opcode opcode, char* key, struct data_t* value, struct TableServerDistributedDatabase* ddb,
+    struct invoke_pending_t* pending) {
+    if (pending == NULL)
+        return opcode == MESSAGE_T__OPCODE__OP_PUT ? ddb_table_put(ddb, key, value) : ddb_table_remove(ddb, key);
+
+    // set before the mutation is forwarded, the callback not waiting for ddb_table_mutate() to return
+    pending->opcode = opcode;
+    pending->frame = 0;
+    pending->request_id = 0;
+    pending->sampled = latency_sample(STATS_PHASE_REPLICATION);
+    pending->forwarded_ns = pending->sampled || slowlog_active() ? latency_now_ns() : 0;
+    int result = ddb_table_mutate(ddb, opcode, key, value, pending->callback, pending->arg);
+    if (result != DDB_MUTATION_FORWARDED)
+        return result == -1 ? -1 : 0;
+
+    pending->pending = true;
+    pending->key = strdup(key);
+    slowlog_suspend(&pending->slowlog);
+    return 0;
+}
+
+ssize_t invoke_complete(struct invoke_pending_t* pending, int status, struct TableServerDistributedDatabase* ddb, uint8_t* response, size_t capacity) {
+    if (assert_error(
+        pending == NULL || !pending->pending || ddb == NULL || ddb->db == NULL || response == NULL,
+        "invoke_complete",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    pending->pending = false;
+    slowlog_resume(&pending->slowlog);
+    uint64_t now_ns = pending->forwarded_ns != 0 || pending->start_ns != 0 ? latency_now_ns() : 0;
+    if (pending->forwarded_ns != 0) {
+        slowlog_add(SLOWLOG_REPLICATION, now_ns - pending->forwarded_ns);
+        if (pending->sampled)
+            latency_record(latency_op(pending->opcode), STATS_PHASE_REPLICATION, now_ns - pending->forwarded_ns);
+    }
+    PROBE3(replicate__done, pending->opcode, pending->key, status);
+    if (pending->start_ns != 0)
+        latency_record(latency_op(pending->opcode), STATS_PHASE_TOTAL, now_ns - pending->start_ns);
+    if (status != -1)
+        db_increment_op_counter(ddb->db);
+    slowlog_invoked();
+
+    ssize_t frame_size;
+    if (pending->frame == COMPACT_OP_PUT || pending->frame == COMPACT_OP_DEL) {
+        struct compact_header_t header = {
+            .opcode = pending->frame,
+            .flags = status == -1 ? COMPACT_FLAG_ERROR : 0,
+            .request_id = pending->request_id
+        };
+        compact_header_encode(&header, response);
+        frame_size = COMPACT_HEADER_SIZE;
+    } else {
+        MessageT msg;
+        message_t__init(&msg);
+        msg.opcode = status == -1 ? MESSAGE_T__OPCODE__OP_ERROR : pending->opcode + 1;
+        msg.c_type = MESSAGE_T__C_TYPE__CT_NONE;
+        frame_size = pending->frame == COMPACT_OP_PROTOBUF
+            ? compact_pack_message(&msg, pending->request_id, response, capacity)
+            : pack_message_frame(&msg, response, capacity);
+    }
+    slowlog_end();
+    destroy_dynamic_memory(pending->key);
+    pending->key = NULL;
+    return frame_size;
+}
+
 int error(MessageT* msg) {
     if (assert_error(
         msg == NULL,
@@ -66,7 +176,7 @@ int error(MessageT* msg) {
     return 0;
 }
 
-int put(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
+int put(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending) {
     if (assert_error(
         msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->table == NULL ||
         msg->entry == NULL || msg->entry->key == NULL || msg->entry->value.data == NULL,
@@ -86,6 +196,7 @@ int put(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
         "Invalid c_type.\n"
     )) return -1;
 
+    hotkeys_count(msg->entry->key, msg->entry->value.len);
     // unwrap data
     struct data_t* data = unwrap_data_from_entry(msg->entry);
     if (assert_error(
@@ -96,7 +207,7 @@ int put(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
 
     // put
     if (assert_error(
-        ddb_table_put(ddb, msg->entry->key, data) == -1,
+        invoke_mutation(MESSAGE_T__OPCODE__OP_PUT, msg->entry->key, data, ddb, pending) == -1,
         "invoke",
         "Failed to put entry.\n"
     )) {
@@ -107,6 +218,8 @@ int put(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
 
     // destroy data (since it's copied during put...)
     data_destroy(data);
+    if (pending != NULL && pending->pending)
+        return 0;
 
     db_increment_op_counter(ddb->db);
     msg->opcode = MESSAGE_T__OPCODE__OP_PUT + 1;
@@ -128,13 +241,15 @@ int get(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
     )) return -1;
 
     struct data_t* data = ddb_table_get(ddb, msg->key);
+    hotkeys_count(msg->key, data != NULL ? data->datasize : 0);
     if (data == NULL)
         return error(msg);
 
     
     msg->value.len = data->datasize;
     msg->value.data = data->data;
-    // destroy only the pointer
+    // destroy only the pointer, the value being freed with the response
+    memory_account(MEMORY_VALUES, data->data, false);
     destroy_dynamic_memory(data);
     db_increment_op_counter(ddb->db);
     msg->opcode = MESSAGE_T__OPCODE__OP_GET + 1;
@@ -142,7 +257,7 @@ int get(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
     return 0;
 }
 
-int del(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
+int del(MessageT* msg, struct TableServerDistributedDatabase* ddb, struct invoke_pending_t* pending) {
     if (assert_error(
         msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->table == NULL || msg->key == NULL,
         "invoke",
@@ -156,10 +271,12 @@ int del(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
     )) return -1;
 
     if (assert_error(
-        ddb_table_remove(ddb, msg->key) == -1,
+        invoke_mutation(MESSAGE_T__OPCODE__OP_DEL, msg->key, NULL, ddb, pending) == -1,
         "invoke_get",
         "Failed to remove entry from table.\n"
     )) return error(msg);
+    if (pending != NULL && pending->pending)
+        return 0;
 
     db_increment_op_counter(ddb->db);
     msg->opcode = MESSAGE_T__OPCODE__OP_DEL + 1;
@@ -289,7 +406,8 @@ int gettable(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
             return error(msg);     
         }
 
-        // destroy only pointer to data struct...
+        // destroy only pointer to data struct, the value being freed with the response
+        memory_account(MEMORY_VALUES, data->data, false);
         destroy_dynamic_memory(data);
     }
     table_free_keys(keys);
@@ -302,6 +420,103 @@ int gettable(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
     return 0;
 }
 
+// lag of the servers this one replicates to
+static void stats_successors(ServerStatsT* stats, struct TableServerDistributedDatabase* ddb) {
+    struct replication_lag_t lags[STATS_MAX_SUCCESSORS];
+    char* addresses[STATS_MAX_SUCCESSORS];
+    int n = ddb_replication_lag(ddb, lags, addresses, STATS_MAX_SUCCESSORS);
+    if (n <= 0)
+        return;
+
+    stats->successors = create_dynamic_memory(n * sizeof(SuccessorStatsT*));
+    for (int i = 0; i < n; i++) {
+        SuccessorStatsT* successor = stats->successors != NULL ? create_dynamic_memory(sizeof(SuccessorStatsT)) : NULL;
+        int64_t* latency = successor != NULL ? create_dynamic_memory(STATS_LATENCY_BUCKETS * sizeof(int64_t)) : NULL;
+        if (successor == NULL || latency == NULL) {
+            destroy_dynamic_memory(successor);
+            destroy_dynamic_memory(addresses[i]);
+            continue;
+        }
+        successor_stats_t__init(successor);
+        successor->address = addresses[i];
+        successor->queued = lags[i].queued;
+        successor->in_flight = lags[i].in_flight;
+        successor->bytes_in_flight = lags[i].bytes_in_flight;
+        successor->seq_lag = lags[i].seq_lag;
+        for (int j = 0; j < STATS_LATENCY_BUCKETS; j++)
+            latency[j] = lags[i].ack_latency[j];
+        successor->ack_latency = latency;
+        successor->n_ack_latency = STATS_LATENCY_BUCKETS;
+        successor->throttled = lags[i].throttled;
+        successor->async_acks = lags[i].async_acks;
+        successor->lagging = lags[i].lagging;
+        stats->successors[stats->n_successors++] = successor;
+    }
+}
+
+// latencies recorded by every thread, merged
+static void stats_latencies(ServerStatsT* stats) {
+    struct stats_histogram_t* histograms = create_dynamic_memory(STATS_OPS * STATS_PHASES * sizeof(struct stats_histogram_t));
+    stats->latencies = histograms != NULL ? create_dynamic_memory(STATS_OPS * STATS_PHASES * sizeof(LatencyHistogramT*)) : NULL;
+    if (stats->latencies == NULL) {
+        destroy_dynamic_memory(histograms);
+        return;
+    }
+
+    latency_merge(histograms);
+    for (int h = 0; h < STATS_OPS * STATS_PHASES; h++) {
+        int used = STATS_HISTOGRAM_BUCKETS;
+        while (used > 0 && histograms[h].buckets[used - 1] == 0)
+            used--;
+        if (used == 0)
+            continue;
+
+        LatencyHistogramT* latency = create_dynamic_memory(sizeof(LatencyHistogramT));
+        int64_t* buckets = latency != NULL ? create_dynamic_memory(used * sizeof(int64_t)) : NULL;
+        if (buckets == NULL) {
+            destroy_dynamic_memory(latency);
+            continue;
+        }
+        latency_histogram_t__init(latency);
+        latency->op = h / STATS_PHASES;
+        latency->phase = h % STATS_PHASES;
+        for (int i = 0; i < used; i++)
+            buckets[i] = histograms[h].buckets[i];
+        latency->buckets = buckets;
+        latency->n_buckets = used;
+        latency->sum_ns = histograms[h].sum_ns;
+        latency->max_ns = histograms[h].max_ns;
+        stats->latencies[stats->n_latencies++] = latency;
+    }
+    destroy_dynamic_memory(histograms);
+}
+
+// memory counted by every thread, by tag
+static void stats_memory(ServerStatsT* stats) {
+    struct memory_counters_t counters[MEMORY_TAGS];
+    memory_read(counters);
+    stats->memory = create_dynamic_memory(MEMORY_TAGS * sizeof(MemoryTagT*));
+    for (int tag = 0; stats->memory != NULL && tag < MEMORY_TAGS; tag++) {
+        MemoryTagT* memory = create_dynamic_memory(sizeof(MemoryTagT));
+        char* name = memory != NULL ? strdup(memory_tag_name(tag)) : NULL;
+        if (name == NULL) {
+            destroy_dynamic_memory(memory);
+            continue;
+        }
+        memory_tag_t__init(memory);
+        memory->tag = name;
+        // shards are read one after the other while threads count, so a free can be seen
+        // without its allocation
+        long long bytes = counters[tag].allocated_bytes - counters[tag].freed_bytes;
+        long long objects = counters[tag].allocations - counters[tag].frees;
+        memory->bytes = bytes > 0 ? bytes : 0;
+        memory->objects = objects > 0 ? objects : 0;
+        memory->allocations = counters[tag].allocations;
+        memory->allocated_bytes = counters[tag].allocated_bytes;
+        stats->memory[stats->n_memory++] = memory;
+    }
+}
+
 int stats(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
     if (assert_error(
         msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->table == NULL,
@@ -315,8 +530,330 @@ int stats(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
         "Invalid c_type.\n"
     )) return -1;
 
-    msg->stats = wrap_stats_with_data(ddb->db->stats->active_clients, ddb->db->stats->op_counter, ddb->db->stats->computed_time_micros);
+    long long op_counter = 0, computed_time_micros = 0;
+    db_read_counters(ddb->db, &op_counter, &computed_time_micros);
+    msg->stats = wrap_stats_with_data(ddb->db->stats->active_clients, op_counter, computed_time_micros);
+    if (msg->stats == NULL)
+        return error(msg);
+
+    // batches sent to the next server
+    struct replication_stats_t* replication = &ddb->replication_stats;
+    msg->stats->replication_batches = create_dynamic_memory(STATS_BATCH_BUCKETS * sizeof(int64_t));
+    if (msg->stats->replication_batches != NULL) {
+        msg->stats->n_replication_batches = STATS_BATCH_BUCKETS;
+        for (int i = 0; i < STATS_BATCH_BUCKETS; i++)
+            msg->stats->replication_batches[i] = __atomic_load_n(&replication->batches[i], __ATOMIC_RELAXED);
+    }
+    msg->stats->replication_bytes_saved = __atomic_load_n(&replication->bytes_saved, __ATOMIC_RELAXED);
+    msg->stats->replication_coalesced = __atomic_load_n(&replication->coalesced, __ATOMIC_RELAXED);
+    stats_successors(msg->stats, ddb);
+    stats_latencies(msg->stats);
+    msg->stats->timing_sample = latency_sample_rate();
+    stats_memory(msg->stats);
+    msg->stats->uptime_ms = (latency_now_ns() - ddb->db->started_ns) / 1000000;
     msg->opcode = MESSAGE_T__OPCODE__OP_STATS + 1;
     msg->c_type = MESSAGE_T__C_TYPE__CT_STATS;
     return 0;
-}
\ No newline at end of file
+}
+
+int hotkeys(MessageT* msg) {
+    if (assert_error(
+        msg == NULL,
+        "invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct hot_key_t* keys = NULL;
+    int n = hotkeys_fetch(&keys, msg->result == 1);
+    HotKeyT** wrapped = n > 0 ? create_dynamic_memory(n * sizeof(HotKeyT*)) : NULL;
+    if (n == -1 || (n > 0 && wrapped == NULL)) {
+        stats_destroy_hot_keys(keys, n);
+        return error(msg);
+    }
+
+    // the keys move into the response
+    for (int i = 0; i < n; i++) {
+        HotKeyT* wrapper = create_dynamic_memory(sizeof(HotKeyT));
+        if (wrapper == NULL)
+            break;
+        hot_key_t__init(wrapper);
+        wrapper->key = keys[i].key;
+        keys[i].key = NULL;
+        wrapper->ops = keys[i].ops;
+        wrapper->bytes = keys[i].bytes;
+        wrapped[msg->n_hot_keys++] = wrapper;
+    }
+    stats_destroy_hot_keys(keys, n);
+    msg->hot_keys = wrapped;
+    msg->opcode = MESSAGE_T__OPCODE__OP_HOTKEYS + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_HOT_KEYS;
+    msg->result = 0;
+    return 0;
+}
+
+int slowlog(MessageT* msg) {
+    if (assert_error(
+        msg == NULL,
+        "invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    struct slow_op_t* ops = NULL;
+    int n = slowlog_fetch(&ops, msg->result == 1);
+    SlowOpT** wrapped = n > 0 ? create_dynamic_memory(n * sizeof(SlowOpT*)) : NULL;
+    if (n == -1 || (n > 0 && wrapped == NULL)) {
+        stats_destroy_slow_ops(ops, n);
+        return error(msg);
+    }
+
+    // the keys move into the response
+    for (int i = 0; i < n; i++) {
+        SlowOpT* wrapper = create_dynamic_memory(sizeof(SlowOpT));
+        if (wrapper == NULL)
+            break;
+        slow_op_t__init(wrapper);
+        wrapper->time_ms = ops[i].time_ms;
+        wrapper->opcode = ops[i].opcode;
+        wrapper->key = ops[i].key != NULL ? ops[i].key : strdup("");
+        ops[i].key = NULL;
+        wrapper->value_size = ops[i].value_size;
+        wrapper->lock_wait_ns = ops[i].lock_wait_ns;
+        wrapper->table_ns = ops[i].table_ns;
+        wrapper->replication_ns = ops[i].replication_ns;
+        wrapper->serialization_ns = ops[i].serialization_ns;
+        wrapper->total_ns = ops[i].total_ns;
+        wrapped[msg->n_slow_ops++] = wrapper;
+    }
+    stats_destroy_slow_ops(ops, n);
+    msg->slow_ops = wrapped;
+    msg->opcode = MESSAGE_T__OPCODE__OP_SLOWLOG + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_SLOW_OPS;
+    msg->result = 0;
+    return 0;
+}
+
+int hello(MessageT* msg) {
+    if (assert_error(
+        msg == NULL,
+        "invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (assert_error(
+        msg->c_type != MESSAGE_T__C_TYPE__CT_RESULT || msg->result != COMPACT_PROTOCOL_VERSION,
+        "invoke_hello",
+        "Unsupported protocol version.\n"
+    )) return error(msg);
+
+    // the caller switches the connection to the compact protocol once this response is sent
+    msg->opcode = MESSAGE_T__OPCODE__OP_HELLO + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_RESULT;
+    msg->result = COMPACT_PROTOCOL_VERSION;
+    return 0;
+}
+
+// copies into msg the entries of the buckets asked for, as many as fit in a frame
+static int digest_entries(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
+    bool asked[DIGEST_BUCKETS] = { false };
+    for (size_t i = 0; i < msg->n_digests; i++) {
+        if (msg->digests[i] < DIGEST_BUCKETS)
+            asked[msg->digests[i]] = true;
+    }
+
+    int capacity = ANTI_ENTROPY_MAX_ENTRIES;
+    EntryT** entries = create_dynamic_memory(sizeof(EntryT*) * (capacity + 1));
+    if (entries == NULL)
+        return error(msg);
+
+    int n_entries = 0, index = 0;
+    size_t size = 0;
+    char* after = NULL;
+    bool truncated = false;
+    struct entry_t* copies[SNAPSHOT_MAX_ENTRIES];
+    int scanned;
+    // the table is read a chunk at a time, so that writers are not held back for long
+    while (!truncated && (scanned = db_table_scan(ddb->db, &index, after, copies, SNAPSHOT_MAX_ENTRIES, SNAPSHOT_CHUNK_BUDGET)) > 0) {
+        destroy_dynamic_memory(after);
+        after = strdup(copies[scanned - 1]->key);
+        for (int i = 0; i < scanned; i++) {
+            struct entry_t* copy = copies[i];
+            bool wanted = !truncated && asked[digest_bucket(copy->key)];
+            if (wanted && (n_entries == capacity || size + strlen(copy->key) + copy->value->datasize > ANTI_ENTROPY_BUDGET))
+                truncated = true;
+            if (!wanted || truncated) {
+                entry_destroy(copy);
+                continue;
+            }
+            // the key and the value go with the response
+            size += strlen(copy->key) + copy->value->datasize;
+            entries[n_entries++] = wrap_entry(copy);
+            destroy_dynamic_memory(copy->value);
+            destroy_dynamic_memory(copy);
+        }
+    }
+    destroy_dynamic_memory(after);
+
+    msg->n_entries = n_entries;
+    msg->entries = entries;
+    msg->result = truncated;
+    msg->opcode = MESSAGE_T__OPCODE__OP_DIGEST + 1;
+    msg->c_type = MESSAGE_T__C_TYPE__CT_TABLE;
+    return 0;
+}
+
+int digest(MessageT* msg, struct TableServerDistributedDatabase* ddb) {
+    if (assert_error(
+        msg == NULL || ddb == NULL || ddb->db == NULL || ddb->db->digest == NULL,
+        "invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (msg->c_type == MESSAGE_T__C_TYPE__CT_TABLE)
+        return digest_entries(msg, ddb);
+
+    // the groups, or the buckets of a group
+    bool group = msg->c_type == MESSAGE_T__C_TYPE__CT_RESULT;
+    if (assert_error(
+        (msg->c_type != MESSAGE_T__C_TYPE__CT_NONE && !group) || msg->n_digests > 0 ||
+        (group && (msg->result < 0 || msg->result >= DIGEST_GROUPS)),
+        "invoke_digest",
+        "Invalid digest request.\n"
+    )) return error(msg);
+
+    struct digest_t* copy = create_dynamic_memory(sizeof(struct digest_t));
+    if (copy == NULL || db_table_digest(ddb->db, copy->buckets) == -1) {
+        destroy_dynamic_memory(copy);
+        return error(msg);
+    }
+    // the response reuses the copy, freed with the message
+    uint32_t* digests = copy->buckets;
+    if (group) {
+        memmove(digests, digests + msg->result * DIGEST_GROUP_SIZE, sizeof(uint32_t) * DIGEST_GROUP_SIZE);
+        msg->n_digests = DIGEST_GROUP_SIZE;
+    } else {
+        uint32_t groups[DIGEST_GROUPS];
+        digest_groups(copy, groups);
+        memcpy(digests, groups, sizeof(groups));
+        msg->n_digests = DIGEST_GROUPS;
+    }
+    msg->digests = digests;
+    msg->opcode = MESSAGE_T__OPCODE__OP_DIGEST + 1;
+    return 0;
+}
+
+// runs a protobuf request carried by a compact frame, packing the response into response
+static ssize_t compact_invoke_protobuf(struct compact_header_t* request, uint8_t* payload, struct TableServerDistributedDatabase* ddb, uint8_t* response, size_t capacity,
+    struct invoke_pending_t* pending) {
+    MessageT* msg = message_t__unpack(NULL, request->value_length, payload + request->key_length);
+    if (assert_error(
+        msg == NULL,
+        "compact_invoke",
+        "Failed to unpack message.\n"
+    )) return -1;
+
+    // a connection cannot be upgraded twice
+    if (msg->opcode == MESSAGE_T__OPCODE__OP_HELLO)
+        error(msg);
+
+    ssize_t frame_size = -1;
+    if (invoke_async(msg, ddb, pending) == 0) {
+        if (pending != NULL && pending->pending) {
+            pending->frame = COMPACT_OP_PROTOBUF;
+            pending->request_id = request->request_id;
+            frame_size = 0;
+        } else {
+            frame_size = compact_pack_message(msg, request->request_id, response, capacity);
+        }
+    }
+    slowlog_end();
+    message_t__free_unpacked(msg, NULL);
+    return frame_size;
+}
+
+ssize_t compact_invoke(struct compact_header_t* request, uint8_t* payload, struct TableServerDistributedDatabase* ddb, uint8_t* response, size_t capacity) {
+    return compact_invoke_async(request, payload, ddb, response, capacity, NULL);
+}
+
+ssize_t compact_invoke_async(struct compact_header_t* request, uint8_t* payload, struct TableServerDistributedDatabase* ddb,
+    uint8_t* response, size_t capacity, struct invoke_pending_t* pending) {
+    if (assert_error(
+        request == NULL || payload == NULL || ddb == NULL || ddb->db == NULL || response == NULL,
+        "compact_invoke",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return -1;
+
+    if (assert_error(
+        capacity < COMPACT_MAX_FRAME_SIZE,
+        "compact_invoke",
+        ERROR_SIZE
+    )) return -1;
+
+    if (request->opcode == COMPACT_OP_PROTOBUF)
+        return compact_invoke_protobuf(request, payload, ddb, response, capacity, pending);
+
+    uint64_t start_ns = latency_sample(STATS_PHASE_TOTAL) ? latency_now_ns() : 0;
+    struct compact_header_t header = {
+        .opcode = request->opcode,
+        .request_id = request->request_id
+    };
+
+    // keys travel without terminator
+    char key[request->key_length + 1];
+    memcpy(key, payload, request->key_length);
+    key[request->key_length] = '\0';
+    MessageT__Opcode opcode = request->opcode == COMPACT_OP_PUT ? MESSAGE_T__OPCODE__OP_PUT
+        : request->opcode == COMPACT_OP_GET ? MESSAGE_T__OPCODE__OP_GET
+        : request->opcode == COMPACT_OP_DEL ? MESSAGE_T__OPCODE__OP_DEL : MESSAGE_T__OPCODE__OP_BAD;
+    PROBE2(request__parse, opcode, key);
+    slowlog_begin(opcode, key, request->opcode == COMPACT_OP_PUT ? request->value_length : 0);
+
+    bool failed = request->key_length == 0;
+    if (!failed) {
+        switch (request->opcode) {
+            case COMPACT_OP_PUT: {
+                LOG_DEBUG(SERVER_PARSED_REQUEST, "put");
+                // the value is copied by the table, so it can point into the payload
+                struct data_t value = {
+                    .datasize = request->value_length,
+                    .data = payload + request->key_length
+                };
+                hotkeys_count(key, value.datasize);
+                failed = value.datasize == 0 || invoke_mutation(MESSAGE_T__OPCODE__OP_PUT, key, &value, ddb, pending) == -1;
+                break;
+            }
+            case COMPACT_OP_GET: {
+                LOG_DEBUG(SERVER_PARSED_REQUEST, "get");
+                int datasize = ddb_table_read(ddb, key, response + COMPACT_HEADER_SIZE, COMPACT_MAX_PAYLOAD);
+                hotkeys_count(key, datasize > 0 ? datasize : 0);
+                failed = datasize < 0;
+                if (!failed)
+                    header.value_length = datasize;
+                break;
+            }
+            case COMPACT_OP_DEL:
+                LOG_DEBUG(SERVER_PARSED_REQUEST, "del");
+                failed = invoke_mutation(MESSAGE_T__OPCODE__OP_DEL, key, NULL, ddb, pending) == -1;
+                break;
+            default:
+                LOG_WARN(SERVER_UNKNOWN_REQUEST);
+                failed = true;
+        }
+    }
+
+    if (pending != NULL && pending->pending) {
+        pending->frame = request->opcode;
+        pending->request_id = request->request_id;
+        pending->start_ns = start_ns;
+        return 0;
+    }
+    if (failed)
+        header.flags = COMPACT_FLAG_ERROR;
+    else
+        db_increment_op_counter(ddb->db);
+    if (start_ns != 0)
+        latency_record(latency_op(opcode), STATS_PHASE_TOTAL, latency_now_ns() - start_ns);
+    slowlog_invoked();
+    compact_header_encode(&header, response);
+    slowlog_end();
+    return COMPACT_HEADER_SIZE + header.value_length;
+}
@@ -0,0 +1,611 @@
+#include "uring.h"
+#include "uring-private.h"
+
+#include "server_connection.h"
+#include "network_server-private.h"
+#include "client_executor.h"
+#include "event_loop.h"
+#include "database.h"
+#include "message.h"
+#include "utils.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+// liburing is not a dependency of the project: the three system calls are used directly
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+#ifndef URING_QUEUES
+// ====================================================================================================
+//                                         Ring Management
+// ====================================================================================================
+
+int uring_init(struct uring_t* ring, unsigned entries) {
+    memset(ring, 0, sizeof(struct uring_t));
+    ring->ring_fd = -1;
+
+    // the loop is the only submitter, which lets the kernel skip cross-thread task work
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    int fd = sys_io_uring_setup(entries, &params);
+    if (fd < 0 && errno == EINVAL) {
+        memset(&params, 0, sizeof(params));
+        fd = sys_io_uring_setup(entries, &params);
+    }
+    if (assert_error(
+        fd < 0,
+        "uring_init",
+        "Failed to create io_uring instance.\n"
+    )) return -1;
+
+    if (assert_error(
+        !(params.features & IORING_FEAT_SINGLE_MMAP),
+        "uring_init",
+        "io_uring instance does not support a single mapping.\n"
+    )) return close_and_return_failure(fd);
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->ring_ptr = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (assert_error(
+        ring->ring_ptr == MAP_FAILED,
+        "uring_init",
+        "Failed to map io_uring queues.\n"
+    )) return close_and_return_failure(fd);
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (assert_error(
+        ring->sqes == MAP_FAILED,
+        "uring_init",
+        "Failed to map io_uring submission entries.\n"
+    )) {
+        munmap(ring->ring_ptr, ring->ring_size);
+        return close_and_return_failure(fd);
+    }
+
+    uint8_t* ptr = ring->ring_ptr;
+    ring->ring_fd = fd;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_head = (unsigned*)(ptr + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(ptr + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(ptr + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(ptr + params.sq_off.array);
+    ring->sqe_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned*)(ptr + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(ptr + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(ptr + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(ptr + params.cq_off.cqes);
+    return 0;
+}
+
+void uring_destroy(struct uring_t* ring) {
+    if (ring->ring_fd < 0)
+        return;
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->ring_ptr, ring->ring_size);
+    close(ring->ring_fd);
+    ring->ring_fd = -1;
+}
+
+struct io_uring_sqe* uring_get_sqe(struct uring_t* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        // queue full: hand the pending entries to the kernel to make room
+        if (uring_submit(ring, 0) < 0)
+            return NULL;
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sqe_tail - head >= ring->sq_entries)
+            return NULL;
+    }
+
+    unsigned index = ring->sqe_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+    return sqe;
+}
+
+int uring_submit(struct uring_t* ring, unsigned wait_nr) {
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+        int submitted = sys_io_uring_enter(ring->ring_fd, to_submit, wait_nr, flags);
+        if (submitted >= 0)
+            return submitted;
+        if (errno == EINTR)
+            continue;
+        // completion queue overflowing: the caller reaps completions and submits again
+        if (errno == EBUSY || errno == EAGAIN)
+            return 0;
+        return -1;
+    }
+}
+
+#endif
+
+#ifndef URING_BUFFERS
+// ====================================================================================================
+//                                             Buffers
+// ====================================================================================================
+
+static void uring_provide_rx_buffer(struct UringServer* server, unsigned short bid) {
+    struct uring_buffer_ring* rx = &server->rx;
+    // only addr, len and bid are written: the ring tail overlays the reserved field of entry 0
+    struct io_uring_buf* buf = &rx->ring->bufs[rx->tail & (URING_RX_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(rx->buffers + (size_t)bid * URING_RX_BUFFER_SIZE);
+    buf->len = URING_RX_BUFFER_SIZE;
+    buf->bid = bid;
+    rx->tail++;
+    __atomic_store_n(&rx->ring->tail, rx->tail, __ATOMIC_RELEASE);
+}
+
+static int uring_setup_rx_buffers(struct UringServer* server) {
+    struct uring_buffer_ring* rx = &server->rx;
+    rx->ring_size = URING_RX_BUFFERS * sizeof(struct io_uring_buf);
+    rx->ring = mmap(NULL, rx->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (assert_error(
+        rx->ring == MAP_FAILED,
+        "uring_setup_rx_buffers",
+        "Failed to map the receive buffer ring.\n"
+    )) {
+        rx->ring = NULL;
+        return -1;
+    }
+
+    rx->buffers = create_dynamic_memory(URING_RX_BUFFERS * URING_RX_BUFFER_SIZE);
+    if (assert_error(
+        rx->buffers == NULL,
+        "uring_setup_rx_buffers",
+        ERROR_MALLOC
+    )) return -1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)rx->ring;
+    reg.ring_entries = URING_RX_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (assert_error(
+        sys_io_uring_register(server->ring.ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0,
+        "uring_setup_rx_buffers",
+        "Failed to register the receive buffer ring.\n"
+    )) return -1;
+
+    rx->tail = 0;
+    for (unsigned short bid = 0; bid < URING_RX_BUFFERS; bid++)
+        uring_provide_rx_buffer(server, bid);
+    return 0;
+}
+
+static int uring_setup_tx_slots(struct UringServer* server) {
+    server->tx_slots_size = (size_t)server->max_connections * URING_TX_SLOT_SIZE;
+    server->tx_slots = create_dynamic_memory(server->tx_slots_size);
+    if (assert_error(
+        server->tx_slots == NULL,
+        "uring_setup_tx_slots",
+        ERROR_MALLOC
+    )) return -1;
+
+    // registered once, so writes skip pinning and mapping the pages on every request;
+    // pinned memory counts against RLIMIT_MEMLOCK, so plain sends are used if this fails
+    struct iovec iov = { .iov_base = server->tx_slots, .iov_len = server->tx_slots_size };
+    server->tx_registered = sys_io_uring_register(server->ring.ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+    return 0;
+}
+
+static void uring_server_destroy(struct UringServer* server) {
+    uring_destroy(&server->ring);
+    if (server->rx.ring != NULL)
+        munmap(server->rx.ring, server->rx.ring_size);
+    destroy_dynamic_memory(server->rx.buffers);
+    destroy_dynamic_memory(server->tx_slots);
+    destroy_dynamic_memory(server->connections);
+    server_completions_destroy(&server->completions);
+}
+
+#endif
+
+#ifndef URING_OPERATIONS
+// ====================================================================================================
+//                                           Operations
+// ====================================================================================================
+
+static uint64_t uring_user_data(int slot, enum UringOp op) {
+    return ((uint64_t)slot << URING_OP_BITS) | op;
+}
+
+static int uring_arm_accept(struct UringServer* server) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&server->ring);
+    if (assert_error(
+        sqe == NULL,
+        "uring_arm_accept",
+        "Failed to get a submission entry.\n"
+    )) return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->listening_socket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = uring_user_data(0, URING_OP_ACCEPT);
+    return 0;
+}
+
+static int uring_arm_recv(struct UringServer* server, int fd, uint64_t user_data) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&server->ring);
+    if (assert_error(
+        sqe == NULL,
+        "uring_arm_recv",
+        "Failed to get a submission entry.\n"
+    )) return -1;
+
+    // one submission keeps receiving into buffers picked from the ring until it is terminated
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+static int uring_arm_completions(struct UringServer* server) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&server->ring);
+    if (assert_error(
+        sqe == NULL,
+        "uring_arm_completions",
+        "Failed to get a submission entry.\n"
+    )) return -1;
+
+    // one submission reports every time the eventfd turns readable until it is terminated
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = server->completions.event_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = uring_user_data(0, URING_OP_COMPLETIONS);
+    return 0;
+}
+
+static int uring_flush(struct UringServer* server, int slot) {
+    struct UringConnection* uc = &server->connections[slot];
+    struct ServerConnection* conn = uc->conn;
+    if (uc->write_inflight || conn->tx_length == 0)
+        return 0;
+
+    struct io_uring_sqe* sqe = uring_get_sqe(&server->ring);
+    if (assert_error(
+        sqe == NULL,
+        "uring_flush",
+        "Failed to get a submission entry.\n"
+    )) return -1;
+
+    if (server->tx_registered) {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = 0;
+    } else {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    }
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)conn->tx_buffer;
+    sqe->len = conn->tx_length;
+    sqe->user_data = uring_user_data(slot, URING_OP_WRITE);
+    uc->write_inflight = true;
+    return 0;
+}
+
+// terminates the pending multishot receive without closing the socket
+static int uring_cancel_recv(struct UringServer* server, int slot) {
+    struct UringConnection* uc = &server->connections[slot];
+    if (uc->cancel_requested || !uc->recv_armed)
+        return 0;
+
+    struct io_uring_sqe* sqe = uring_get_sqe(&server->ring);
+    if (assert_error(
+        sqe == NULL,
+        "uring_cancel_recv",
+        "Failed to get a submission entry.\n"
+    )) return -1;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = uring_user_data(slot, URING_OP_RECV);
+    sqe->user_data = uring_user_data(slot, URING_OP_CANCEL);
+    uc->cancel_requested = true;
+    return 0;
+}
+
+// frees the slot once no operation of the connection is pending
+static void uring_try_release(struct UringServer* server, int slot) {
+    struct UringConnection* uc = &server->connections[slot];
+    // a pending write is answered before the slot is freed (see uring_on_completions())
+    if (uc->recv_armed || uc->write_inflight || uc->conn->pending.pending)
+        return;
+
+    struct ServerConnection* conn = uc->conn;
+    uc->conn = NULL;
+    if (conn->replication && !conn->closing) {
+        // the replication stream of the predecessor is served by a thread of its own
+        server_connection_start_replication(conn, server->ddb);
+    } else {
+        server_connection_destroy(conn);
+        LOG_INFO(CLIENT_CONNECTION_CLOSED);
+    }
+    db_decrement_active_clients(server->ddb->db);
+}
+
+static void uring_close_connection(struct UringServer* server, int slot) {
+    struct ServerConnection* conn = server->connections[slot].conn;
+    if (!conn->closing) {
+        conn->closing = true;
+        // terminates the pending multishot receive
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+    uring_try_release(server, slot);
+}
+
+// executes the complete requests received and starts writing their responses
+static int uring_process(struct UringServer* server, int slot) {
+    struct ServerConnection* conn = server->connections[slot].conn;
+    if (server_connection_process(conn, server->ddb) == -1)
+        return -1;
+    // pending responses are written by the hand-over, once the receive is terminated
+    if (conn->replication)
+        return uring_cancel_recv(server, slot);
+    return uring_flush(server, slot);
+}
+
+static void uring_on_accept(struct UringServer* server, struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        uring_arm_accept(server);
+    if (cqe->res < 0) {
+        LOG_ERROR(SERVER_FAILED_CONNECTION);
+        return;
+    }
+
+    int client_socket = cqe->res;
+    set_no_delay(client_socket);
+    int slot = 0;
+    while (slot < server->max_connections && server->connections[slot].conn != NULL)
+        slot++;
+    if (slot == server->max_connections) {
+        LOG_WARN(URING_TOO_MANY_CONNECTIONS);
+        close(client_socket);
+        return;
+    }
+
+    uint8_t* tx_buffer = server->tx_slots + (size_t)slot * URING_TX_SLOT_SIZE;
+    struct ServerConnection* conn = server_connection_create(client_socket, tx_buffer, URING_TX_SLOT_SIZE, &server->completions);
+    if (conn == NULL) {
+        close(client_socket);
+        return;
+    }
+
+    struct UringConnection* uc = &server->connections[slot];
+    uc->conn = conn;
+    uc->recv_armed = false;
+    uc->write_inflight = false;
+    uc->cancel_requested = false;
+    db_increment_active_clients(server->ddb->db);
+    LOG_INFO(CLIENT_CONNECTION_OK);
+
+    if (uring_arm_recv(server, client_socket, uring_user_data(slot, URING_OP_RECV)) == -1)
+        uring_close_connection(server, slot);
+    else
+        uc->recv_armed = true;
+}
+
+static void uring_on_recv(struct UringServer* server, int slot, struct io_uring_cqe* cqe) {
+    struct UringConnection* uc = &server->connections[slot];
+    struct ServerConnection* conn = uc->conn;
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        uc->recv_armed = false;
+
+    bool failed = false;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (cqe->res > 0 && !conn->closing)
+            failed = server_connection_receive(conn, server->rx.buffers + (size_t)bid * URING_RX_BUFFER_SIZE, cqe->res) == -1;
+        uring_provide_rx_buffer(server, bid);
+    }
+
+    if (conn->closing || (conn->replication && !failed)) {
+        uring_try_release(server, slot);
+        return;
+    }
+    // out of receive buffers (-ENOBUFS) is transient: they are returned as data is consumed
+    if (failed || cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS) || uring_process(server, slot) == -1) {
+        uring_close_connection(server, slot);
+        return;
+    }
+    if (conn->replication) {
+        uring_try_release(server, slot);
+        return;
+    }
+
+    if (!uc->recv_armed) {
+        if (uring_arm_recv(server, conn->fd, uring_user_data(slot, URING_OP_RECV)) == -1)
+            uring_close_connection(server, slot);
+        else
+            uc->recv_armed = true;
+    }
+}
+
+static void uring_on_write(struct UringServer* server, int slot, struct io_uring_cqe* cqe) {
+    struct UringConnection* uc = &server->connections[slot];
+    struct ServerConnection* conn = uc->conn;
+    uc->write_inflight = false;
+
+    if (conn->closing) {
+        uring_try_release(server, slot);
+        return;
+    }
+    if (cqe->res <= 0) {
+        uring_close_connection(server, slot);
+        return;
+    }
+
+    // requests held back while the transmit buffer was full can now be executed
+    server_connection_tx_consume(conn, cqe->res);
+    if (conn->replication) {
+        uring_try_release(server, slot);
+        return;
+    }
+    if (uring_process(server, slot) == -1)
+        uring_close_connection(server, slot);
+}
+
+// answers the writes the chain acknowledged, then the requests received in the meantime
+static void uring_on_completions(struct UringServer* server, struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        uring_arm_completions(server);
+
+    struct ServerConnection* conn = server_completions_take(&server->completions);
+    while (conn != NULL) {
+        struct ServerConnection* next = conn->next_completed;
+        // the slot owns the transmit buffer of the connection
+        int slot = (int)((conn->tx_buffer - server->tx_slots) / URING_TX_SLOT_SIZE);
+        bool failed = server_connection_complete(conn, server->ddb) == -1;
+        if (conn->closing)
+            uring_try_release(server, slot);
+        else if (failed || uring_process(server, slot) == -1)
+            uring_close_connection(server, slot);
+        conn = next;
+    }
+}
+
+static void uring_handle_completion(struct UringServer* server, struct io_uring_cqe* cqe) {
+    int slot = (int)(cqe->user_data >> URING_OP_BITS);
+    switch (cqe->user_data & ((1 << URING_OP_BITS) - 1)) {
+        case URING_OP_ACCEPT:
+            uring_on_accept(server, cqe);
+            break;
+        case URING_OP_RECV:
+            uring_on_recv(server, slot, cqe);
+            break;
+        case URING_OP_WRITE:
+            uring_on_write(server, slot, cqe);
+            break;
+        case URING_OP_COMPLETIONS:
+            uring_on_completions(server, cqe);
+            break;
+        default:
+            break;
+    }
+}
+
+// waits for the next completion, copying it to cqe. Returns 0 (OK) or -1 on error.
+static int uring_wait_completion(struct uring_t* ring, struct io_uring_cqe* cqe) {
+    while (true) {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            *cqe = ring->cqes[head & *ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if (uring_submit(ring, 1) < 0)
+            return -1;
+    }
+}
+
+// multishot receives (Linux 6.0) imply every other feature used, so a receive on a
+// socket pair tells whether this kernel can run the backend
+static bool uring_probe(struct UringServer* server) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+        return false;
+
+    bool supported = false;
+    struct io_uring_cqe cqe;
+    if (uring_arm_recv(server, sv[0], uring_user_data(0, URING_OP_PROBE)) == 0
+        && write(sv[1], "", 1) == 1
+        && uring_wait_completion(&server->ring, &cqe) == 0
+    ) {
+        supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+        if (cqe.flags & IORING_CQE_F_BUFFER)
+            uring_provide_rx_buffer(server, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        // wait for the receive to terminate before its socket is closed
+        shutdown(sv[0], SHUT_RDWR);
+        while ((cqe.flags & IORING_CQE_F_MORE) && uring_wait_completion(&server->ring, &cqe) == 0) {
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+                uring_provide_rx_buffer(server, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+    }
+    close(sv[0]);
+    close(sv[1]);
+    return supported;
+}
+
+#endif
+
+int uring_main_loop(int listening_socket, struct TableServerDistributedDatabase* ddb) {
+    struct UringServer server;
+    memset(&server, 0, sizeof(server));
+    server.completions.event_fd = -1;
+    server.listening_socket = listening_socket;
+    server.ddb = ddb;
+    server.max_connections = get_env_int("NODEDB_URING_CONNECTIONS", URING_DEFAULT_MAX_CONNECTIONS);
+    if (server.max_connections <= 0 || server.max_connections > INT_MAX / URING_TX_SLOT_SIZE)
+        server.max_connections = URING_DEFAULT_MAX_CONNECTIONS;
+
+    if (uring_init(&server.ring, URING_QUEUE_DEPTH) == -1)
+        return URING_UNSUPPORTED;
+    if (uring_setup_rx_buffers(&server) == -1 || !uring_probe(&server)) {
+        uring_server_destroy(&server);
+        return URING_UNSUPPORTED;
+    }
+
+    server.connections = create_dynamic_memory(server.max_connections * sizeof(struct UringConnection));
+    if (assert_error(
+        server.connections == NULL || uring_setup_tx_slots(&server) == -1 || uring_arm_accept(&server) == -1 ||
+        server_completions_init(&server.completions) == -1 || uring_arm_completions(&server) == -1,
+        "uring_main_loop",
+        "Failed to set up the io_uring backend.\n"
+    )) {
+        uring_server_destroy(&server);
+        return -1;
+    }
+
+    LOG_INFO(EVENT_LOOP_STARTED, io_backend_name(IO_BACKEND_URING));
+    LOG_INFO(SERVER_WAITING_FOR_CONNECTIONS);
+    struct uring_t* ring = &server.ring;
+    while (true) {
+        // a single system call submits every pending operation and waits for completions
+        if (uring_submit(ring, 1) < 0)
+            break;
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+            // released before handling, so that submissions made by the handler find room
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            uring_handle_completion(&server, &cqe);
+        }
+    }
+
+    uring_server_destroy(&server);
+    return -1;
+}
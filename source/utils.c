@@ -3,8 +3,12 @@
 #include "entry.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <malloc.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <string.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
 
 enum ComparisonStatus string_compare(char* str1, char* str2) {
     if (str1 == NULL || str2 == NULL)
@@ -34,10 +38,134 @@ void print_data(void* ptr, int size) {
 // ====================================================================================================
 //                                        Memory Handling
 // ====================================================================================================
+// Memory counters of a thread
+struct memory_shard_t {
+    struct memory_counters_t counters[MEMORY_TAGS];
+    struct memory_shard_t* next;
+} __attribute__((aligned(64)));
+
+static const char* memory_tag_names[MEMORY_TAGS] = { "other", "keys", "values", "nodes", "messages", "connections" };
+static pthread_mutex_t memory_shards_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct memory_shard_t* memory_shards = NULL;            // of the running threads
+static struct memory_counters_t memory_retired[MEMORY_TAGS];   // of the threads that exited
+static pthread_key_t memory_shard_key;
+static pthread_once_t memory_shard_once = PTHREAD_ONCE_INIT;
+static __thread struct memory_shard_t* local_memory_shard = NULL;
+
+// adds the counters of the shard up; the owner may still be counting
+static void memory_shard_add(struct memory_counters_t* into, struct memory_shard_t* shard) {
+    for (int tag = 0; tag < MEMORY_TAGS; tag++) {
+        struct memory_counters_t* from = &shard->counters[tag];
+        into[tag].allocations += __atomic_load_n(&from->allocations, __ATOMIC_RELAXED);
+        into[tag].frees += __atomic_load_n(&from->frees, __ATOMIC_RELAXED);
+        into[tag].allocated_bytes += __atomic_load_n(&from->allocated_bytes, __ATOMIC_RELAXED);
+        into[tag].freed_bytes += __atomic_load_n(&from->freed_bytes, __ATOMIC_RELAXED);
+    }
+}
+
+static void memory_shard_retire(void* _shard) {
+    struct memory_shard_t* shard = _shard;
+    pthread_mutex_lock(&memory_shards_mutex);
+    struct memory_shard_t** link = &memory_shards;
+    while (*link != NULL && *link != shard)
+        link = &(*link)->next;
+    if (*link != NULL)
+        *link = shard->next;
+    memory_shard_add(memory_retired, shard);
+    pthread_mutex_unlock(&memory_shards_mutex);
+    free(shard);
+    // memory freed by later destructors goes to a new shard
+    local_memory_shard = NULL;
+}
+
+static void memory_shard_key_create(void) {
+    pthread_key_create(&memory_shard_key, memory_shard_retire);
+}
+
+// the shard is allocated with malloc itself, not to be counted
+static struct memory_shard_t* memory_shard_of_thread() {
+    if (local_memory_shard != NULL)
+        return local_memory_shard;
+
+    pthread_once(&memory_shard_once, memory_shard_key_create);
+    struct memory_shard_t* shard = NULL;
+    if (posix_memalign((void**)&shard, 64, sizeof(struct memory_shard_t)) != 0)
+        return NULL;
+
+    memset(shard, 0, sizeof(struct memory_shard_t));
+    pthread_mutex_lock(&memory_shards_mutex);
+    shard->next = memory_shards;
+    memory_shards = shard;
+    pthread_mutex_unlock(&memory_shards_mutex);
+    pthread_setspecific(memory_shard_key, shard);
+    local_memory_shard = shard;
+    return shard;
+}
+
+void memory_account(enum MemoryTag tag, void* ptr, bool allocated) {
+    if (ptr == NULL || tag < 0 || tag >= MEMORY_TAGS)
+        return;
+    struct memory_shard_t* shard = memory_shard_of_thread();
+    if (shard == NULL)
+        return;
+
+    // the only writer: plain increments, stored atomically for memory_read()
+    struct memory_counters_t* counters = &shard->counters[tag];
+    long long size = malloc_usable_size(ptr);
+    if (allocated) {
+        __atomic_store_n(&counters->allocations, counters->allocations + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&counters->allocated_bytes, counters->allocated_bytes + size, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&counters->frees, counters->frees + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&counters->freed_bytes, counters->freed_bytes + size, __ATOMIC_RELAXED);
+    }
+}
+
+void memory_read(struct memory_counters_t* counters) {
+    if (assert_error(
+        counters == NULL,
+        "memory_read",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    memset(counters, 0, MEMORY_TAGS * sizeof(struct memory_counters_t));
+    pthread_mutex_lock(&memory_shards_mutex);
+    for (int tag = 0; tag < MEMORY_TAGS; tag++) {
+        counters[tag].allocations += memory_retired[tag].allocations;
+        counters[tag].frees += memory_retired[tag].frees;
+        counters[tag].allocated_bytes += memory_retired[tag].allocated_bytes;
+        counters[tag].freed_bytes += memory_retired[tag].freed_bytes;
+    }
+    for (struct memory_shard_t* shard = memory_shards; shard != NULL; shard = shard->next)
+        memory_shard_add(counters, shard);
+    pthread_mutex_unlock(&memory_shards_mutex);
+}
+
+const char* memory_tag_name(enum MemoryTag tag) {
+    return tag >= 0 && tag < MEMORY_TAGS ? memory_tag_names[tag] : "unknown";
+}
+
 void safe_free(void* ptr) {
     if (ptr) free(ptr);
 }
 
+void* create_tagged_memory(enum MemoryTag tag, int size) {
+    if (assert_error(
+        size <= 0,
+        "create_dynamic_memory",
+        ERROR_SIZE
+    )) return NULL;
+
+    void* ptr = calloc(1, size);
+    memory_account(tag, ptr, true);
+    return ptr;
+}
+
+void destroy_tagged_memory(enum MemoryTag tag, void* ptr) {
+    memory_account(tag, ptr, false);
+    safe_free(ptr);
+}
+
 void* create_dynamic_memory(int size) {
     if (assert_error(
         size <= 0,
@@ -85,6 +213,59 @@ void* duplicate_memory(void* from, int size, char* snippet_id) {
     return copy;
 }
 
+void* duplicate_tagged_memory(enum MemoryTag tag, void* from, int size, char* snippet_id) {
+    void* copy = duplicate_memory(from, size, snippet_id);
+    memory_account(tag, copy, true);
+    return copy;
+}
+
+// ====================================================================================================
+//                                          CONFIGURATION
+// ====================================================================================================
+
+int get_env_int(char* name, int default_value) {
+    char* value = getenv(name);
+    if (value == NULL || *value == '\0')
+        return default_value;
+
+    char* endptr;
+    long parsed = strtol(value, &endptr, 10);
+    if (assert_error(
+        *endptr != '\0',
+        "get_env_int",
+        "Invalid integer setting, using default value.\n"
+    )) return default_value;
+    return (int)parsed;
+}
+
+char* get_env_string(char* name, char* default_value) {
+    char* value = getenv(name);
+    return (value == NULL || *value == '\0') ? default_value : value;
+}
+
+// ====================================================================================================
+//                                          HASHING
+// ====================================================================================================
+
+uint64_t hash_mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t hash_string(const char* key, size_t* length) {
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char* c = (const unsigned char*)key;
+    for (; *c != '\0'; c++)
+        hash = (hash ^ *c) * 1099511628211ULL;
+    if (length != NULL)
+        *length = c - (const unsigned char*)key;
+    return hash_mix64(hash);
+}
+
 // ====================================================================================================
 //                                          NETWORK
 // ====================================================================================================
@@ -94,6 +275,25 @@ int close_and_return_failure(int fd) {
     return -1;
 }
 
+int set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (assert_error(
+        flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0,
+        "set_non_blocking",
+        "Failed to set O_NONBLOCK.\n"
+    )) return -1;
+    return 0;
+}
+
+int set_no_delay(int fd) {
+    if (assert_error(
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &(int){1}, sizeof(int)) < 0,
+        "set_no_delay",
+        "Failed to set TCP_NODELAY.\n"
+    )) return -1;
+    return 0;
+}
+
 int get_client(int listening_fd) {
     struct sockaddr_in client;
     socklen_t size_client = sizeof((struct sockaddr *)&client);
@@ -0,0 +1,49 @@
+#include "workload.h"
+
+#include <math.h>
+
+uint64_t random_next(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+double random_uniform(uint64_t* state) {
+    // the 53 bits of a double's mantissa
+    return (random_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+uint64_t workload_scramble(uint64_t rank) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        hash ^= (rank >> (8 * i)) & 0xFF;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++)
+        sum += 1 / pow((double)i, theta);
+    return sum;
+}
+
+void zipfian_init(struct zipfian_t* zipfian, uint64_t n, double theta) {
+    zipfian->n = n;
+    zipfian->theta = theta;
+    zipfian->alpha = 1 / (1 - theta);
+    zipfian->zetan = zeta(n, theta);
+    zipfian->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta(2, theta) / zipfian->zetan);
+}
+
+uint64_t zipfian_next(struct zipfian_t* zipfian, double u) {
+    double uz = u * zipfian->zetan;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + pow(0.5, zipfian->theta))
+        return zipfian->n > 1 ? 1 : 0;
+    uint64_t rank = (uint64_t)(zipfian->n * pow(zipfian->eta * u - zipfian->eta + 1, zipfian->alpha));
+    return rank < zipfian->n ? rank : zipfian->n - 1;
+}
@@ -0,0 +1,216 @@
+#include "zerocopy.h"
+
+#include "utils.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+void zerocopy_init(struct zerocopy_t* zc, int fd) {
+    memset(zc, 0, sizeof(struct zerocopy_t));
+    zc->fd = fd;
+    zc->reserved = -1;
+
+    int threshold = get_env_int("NODEDB_ZEROCOPY_THRESHOLD", ZEROCOPY_DEFAULT_THRESHOLD);
+    if (threshold <= 0)
+        return;
+    zc->threshold = threshold;
+
+    // only TCP sockets take SO_ZEROCOPY
+    zc->enabled = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &(int){1}, sizeof(int)) == 0;
+}
+
+// counts the sends first..last as reported, releasing the buffers they were made from
+static void zerocopy_complete(struct zerocopy_t* zc, uint32_t first, uint32_t last) {
+    for (int i = 0; i < ZEROCOPY_BUFFERS; i++) {
+        struct zerocopy_slot_t* slot = &zc->slots[i];
+        if (slot->pending == 0)
+            continue;
+
+        // overlap with the ids of the slot, relative to its first one (ids wrap around)
+        int32_t from = (int32_t)(first - slot->first), to = (int32_t)(last + 1 - slot->first);
+        int32_t n = (int32_t)(slot->end - slot->first);
+        int32_t overlap = (to < n ? to : n) - (from > 0 ? from : 0);
+        if (overlap <= 0)
+            continue;
+
+        slot->pending -= (uint32_t)overlap < slot->pending ? (uint32_t)overlap : slot->pending;
+        if (slot->pending == 0) {
+            free(slot->block);
+            slot->block = NULL;
+            zc->in_flight--;
+        }
+    }
+}
+
+// reads the completion reports queued so far, without blocking. Returns 0 (OK) or -1 on error
+static int zerocopy_read_completions(struct zerocopy_t* zc) {
+    while (true) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(zc->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+
+            struct sock_extended_err error;
+            memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0)
+                continue;
+
+            // ids ee_info..ee_data completed
+            zerocopy_complete(zc, error.ee_info, error.ee_data);
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                zc->enabled = false; // the kernel copied anyway: pinning only adds overhead
+        }
+    }
+}
+
+// sends of every buffer not reported yet
+static uint32_t zerocopy_pending(struct zerocopy_t* zc) {
+    uint32_t pending = 0;
+    for (int i = 0; i < ZEROCOPY_BUFFERS; i++)
+        pending += zc->slots[i].pending;
+    return pending;
+}
+
+void zerocopy_destroy(struct zerocopy_t* zc) {
+    if (zc == NULL)
+        return;
+
+    // a send still unreported by then is one the peer is no longer reading: the kernel keeps
+    // its own references to the pinned pages, so the buffers may go anyway
+    while (zc->in_flight > 0) {
+        struct pollfd pfd = { .fd = zc->fd, .events = 0 };
+        int ready = poll(&pfd, 1, ZEROCOPY_WAIT_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        uint32_t pending = zerocopy_pending(zc);
+        if (ready <= 0 || zerocopy_read_completions(zc) == -1 || zerocopy_pending(zc) == pending)
+            break;
+    }
+
+    for (int i = 0; i < ZEROCOPY_BUFFERS; i++) {
+        destroy_tagged_memory(MEMORY_MESSAGES, zc->slots[i].buffer);
+        free(zc->slots[i].block);
+    }
+    memset(zc->slots, 0, sizeof(zc->slots));
+    zc->in_flight = 0;
+    zc->reserved = -1;
+}
+
+uint8_t* zerocopy_buffer(struct zerocopy_t* zc, size_t size) {
+    if (zc == NULL || !zc->enabled)
+        return NULL;
+    if (zc->in_flight > 0)
+        zerocopy_read_completions(zc);
+    if (!zc->enabled)
+        return NULL;
+
+    for (int i = 0; i < ZEROCOPY_BUFFERS; i++) {
+        struct zerocopy_slot_t* slot = &zc->slots[i];
+        if (slot->pending > 0)
+            continue;
+
+        if (slot->capacity < size) {
+            destroy_tagged_memory(MEMORY_MESSAGES, slot->buffer);
+            slot->buffer = create_tagged_memory(MEMORY_MESSAGES, size);
+            slot->capacity = slot->buffer != NULL ? size : 0;
+            if (slot->buffer == NULL)
+                return NULL;
+        }
+        zc->reserved = i;
+        return slot->buffer;
+    }
+    return NULL; // every buffer in flight: copy this one
+}
+
+int zerocopy_attach(struct zerocopy_t* zc, void* block) {
+    if (assert_error(
+        zc == NULL || zc->reserved == -1,
+        "zerocopy_attach",
+        "No zero-copy buffer was handed out.\n"
+    )) return -1;
+
+    zc->slots[zc->reserved].block = block;
+    return 0;
+}
+
+// the buffer handed out, if any, waits for the reports of the sends made from it
+static void zerocopy_release(struct zerocopy_t* zc, uint32_t first) {
+    if (zc == NULL || zc->reserved == -1)
+        return;
+
+    struct zerocopy_slot_t* slot = &zc->slots[zc->reserved];
+    zc->reserved = -1;
+    slot->first = first;
+    slot->end = zc->next_id;
+    slot->pending = slot->end - slot->first;
+    if (slot->pending > 0) {
+        zc->in_flight++;
+    } else {
+        free(slot->block);
+        slot->block = NULL;
+    }
+}
+
+ssize_t zerocopy_send_iov(int fd, struct iovec* iov, int iovcnt, struct zerocopy_t* zc) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+
+    bool zerocopy = zc != NULL && zc->enabled && zc->reserved != -1 && total >= zc->threshold;
+    uint32_t first = zc != NULL ? zc->next_id : 0;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    size_t sent = 0;
+    while (msg.msg_iovlen > 0) {
+        ssize_t written = sendmsg(fd, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (zerocopy && errno == ENOBUFS) {
+                zerocopy = false; // out of pinnable memory: copy this one
+                continue;
+            }
+            assert_error(
+                1,
+                "zerocopy_send_iov",
+                "Failed to write to the socket.\n"
+            );
+            zerocopy_release(zc, first);
+            return -1;
+        }
+        if (zerocopy)
+            zc->next_id++;
+        sent += written;
+
+        // skip what was written, resuming a partially written buffer
+        while (msg.msg_iovlen > 0 && (size_t)written >= msg.msg_iov->iov_len) {
+            written -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (uint8_t*)msg.msg_iov->iov_base + written;
+            msg.msg_iov->iov_len -= written;
+        }
+    }
+
+    zerocopy_release(zc, first);
+    return sent;
+}
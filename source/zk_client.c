@@ -2,80 +2,246 @@
 
 #include "zk_utils.h"
 #include "utils.h"
+#include "logger.h"
 
 #include <zookeeper/zookeeper.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
 
-void handle_head_change(struct TableClientReplicationData* replicator, char* head) {
+void handle_head_change(struct TableClientReplicationData* replicator, int chain, char* head) {
     if (assert_error(
-        replicator == NULL || replicator->client == NULL,
+        replicator == NULL || replicator->client == NULL || chain < 0 || chain >= TC_MAX_CHAINS,
         "handle_head_change",
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
-    char* current_head = replicator->head_node_path;
+    struct TableClientChain* client_chain = &replicator->client->chains[chain];
+    char* current_head = replicator->chains[chain].head_node_path;
     if (string_compare(current_head, head) != EQUAL) {
         // head changed!
-        if (replicator->client->head_table != NULL)
-            rtable_disconnect(replicator->client->head_table);
-        replicator->client->head_table = head ? zk_table_connect(replicator->zh, head) : NULL;
-        replicator->head_node_path = head;
-        printf(ZK_CLIENT_HEAD_UPDATE, current_head, head);
+        if (client_chain->head_table != NULL)
+            rtable_disconnect(client_chain->head_table);
+        client_chain->head_table = head ? zk_table_connect(replicator->zh, head) : NULL;
+        replicator->chains[chain].head_node_path = head;
+        LOG_INFO(ZK_CLIENT_HEAD_UPDATE, current_head, head);
     }
 }
 
-void handle_tail_change(struct TableClientReplicationData* replicator, char* tail) {
+void handle_tail_change(struct TableClientReplicationData* replicator, int chain, char* tail) {
     if (assert_error(
-        replicator == NULL || replicator->client == NULL,
+        replicator == NULL || replicator->client == NULL || chain < 0 || chain >= TC_MAX_CHAINS,
         "handle_tail_change",
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
-    char* current_tail = replicator->tail_node_path;
+    struct TableClientChain* client_chain = &replicator->client->chains[chain];
+    char* current_tail = replicator->chains[chain].tail_node_path;
     if (string_compare(current_tail, tail) != EQUAL) {
         // tail changed!
-        if (replicator->client->tail_table != NULL)
-            rtable_disconnect(replicator->client->tail_table);
-        replicator->client->tail_table = tail ? zk_table_connect(replicator->zh, tail) : NULL;
-        replicator->tail_node_path = tail;
-        printf(ZK_CLIENT_TAIL_UPDATE, current_tail, tail);
+        if (client_chain->tail_table != NULL)
+            rtable_disconnect(client_chain->tail_table);
+        client_chain->tail_table = tail ? zk_table_connect(replicator->zh, tail) : NULL;
+        replicator->chains[chain].tail_node_path = tail;
+        LOG_INFO(ZK_CLIENT_TAIL_UPDATE, current_tail, tail);
     }
 }
 
-void client_child_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx) {
-    struct TableClientReplicationData* replicator = (struct TableClientReplicationData*)watcher_ctx;
+void handle_chain_change(struct TableClientReplicationData* replicator, int chain, zoo_string* children_list) {
+    if (assert_error(
+        replicator == NULL || replicator->client == NULL || children_list == NULL || chain < 0 || chain >= TC_MAX_CHAINS,
+        "handle_chain_change",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    if (!replicator->apportioned_reads)
+        return;
+
+    struct TableClientChain* client = &replicator->client->chains[chain];
+    const char* chain_path = replicator->chains[chain].path;
+    int n_servers = children_list->count;
+    int n_old_tables = client->n_read_tables;
+    struct rtable_t** tables = create_dynamic_memory((n_servers + 1) * sizeof(struct rtable_t*));
+    char** paths = create_dynamic_memory((n_servers + 1) * sizeof(char*));
+    bool* kept = create_dynamic_memory((n_old_tables + 1) * sizeof(bool));
+    if (assert_error(
+        tables == NULL || paths == NULL || kept == NULL,
+        "handle_chain_change",
+        ERROR_MALLOC
+    )) {
+        destroy_dynamic_memory(tables);
+        destroy_dynamic_memory(paths);
+        destroy_dynamic_memory(kept);
+        return;
+    }
+
+    // reads go on over the published tables meanwhile: this watcher is the only one changing them
+    int n_tables = 0;
+    for (int i = 0; i < n_servers; i++) {
+        char path[strlen(chain_path) + 1 + strlen(children_list->data[i]) + 1];
+        snprintf(path, sizeof(path), "%s/%s", chain_path, children_list->data[i]);
+
+        // keep the connections to the servers still in the chain
+        struct rtable_t* table = NULL;
+        for (int j = 0; j < n_old_tables && table == NULL; j++) {
+            if (!kept[j] && replicator->chains[chain].chain_node_paths[j] != NULL && string_compare(replicator->chains[chain].chain_node_paths[j], path) == EQUAL) {
+                table = client->read_tables[j];
+                kept[j] = true;
+            }
+        }
+        if (table == NULL)
+            table = zk_table_connect(replicator->zh, path);
+        if (table == NULL)
+            continue;
 
-    // alloc mem for children buffer
+        tables[n_tables] = table;
+        paths[n_tables] = strdup(path);
+        n_tables++;
+    }
+
+    // publish the tables; those of the servers that left are disconnected by the next read, done with them
+    struct TableClientData* data = replicator->client;
+    pthread_mutex_lock(&data->mutex);
+    struct rtable_t** old_tables = client->read_tables;
+    int n_retired = 0;
+    for (int j = 0; j < n_old_tables; j++)
+        n_retired += !kept[j];
+    struct rtable_t** retired = n_retired > 0 ? realloc(client->retired_tables, (client->n_retired_tables + n_retired) * sizeof(struct rtable_t*)) : client->retired_tables;
+    for (int j = 0; j < n_old_tables; j++) {
+        if (kept[j])
+            continue;
+        if (retired != NULL)
+            retired[client->n_retired_tables++] = old_tables[j];
+        else
+            rtable_disconnect(old_tables[j]);
+    }
+    if (retired != NULL)
+        client->retired_tables = retired;
+    client->read_tables = tables;
+    client->n_read_tables = n_tables;
+    pthread_mutex_unlock(&data->mutex);
+
+    char** old_paths = replicator->chains[chain].chain_node_paths;
+    replicator->chains[chain].chain_node_paths = paths;
+    for (int j = 0; j < n_old_tables; j++)
+        destroy_dynamic_memory(old_paths[j]);
+    destroy_dynamic_memory(old_tables);
+    destroy_dynamic_memory(old_paths);
+    destroy_dynamic_memory(kept);
+    LOG_INFO(ZK_CLIENT_CHAIN_UPDATE, n_tables);
+}
+
+// watches the servers of the chain at index chain, updating its head, tail and read servers
+static void client_chain_watch(struct TableClientReplicationData* replicator, int chain) {
     zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
     if (assert_error(
         children_list == NULL,
-        "child_watcher",
+        "client_chain_watch",
         ERROR_MALLOC
     )) return;
 
-    if (state == ZOO_CONNECTED_STATE) {
-        if (type == ZOO_CHILD_EVENT) {
-            /* Get the updated children and reset the watch */ 
-            if (assert_error(
-                zoo_wget_children(
-                    wzh, 
-                    CHAIN_PATH, 
-                    client_child_watcher, 
-                    watcher_ctx, 
-                    children_list) != ZOK,
-                "child_watcher",
-                "Error setting watch\n"
-            )) return;
-
-            // get head and tail server
-            char* new_head = zk_get_first_child(children_list, CHAIN_PATH);
-            char* new_tail = zk_get_last_child(children_list, CHAIN_PATH);
-            handle_head_change(replicator, new_head);
-            handle_tail_change(replicator, new_tail);
-        }
+    const char* chain_path = replicator->chains[chain].path;
+    if (zoo_wget_children(replicator->zh, chain_path, client_child_watcher, replicator, children_list) != ZOK) {
+        LOG_ERROR("Error setting watch at %s!\n", chain_path);
+        destroy_dynamic_memory(children_list);
+        return;
     }
+
+    // get head and tail server
+    char* new_head = zk_get_first_child(children_list, chain_path);
+    char* new_tail = zk_get_last_child(children_list, chain_path);
+    handle_head_change(replicator, chain, new_head);
+    handle_tail_change(replicator, chain, new_tail);
+    handle_chain_change(replicator, chain, children_list);
     zk_free_list(children_list);
 }
 
+void handle_chains_change(struct TableClientReplicationData* replicator, zoo_string* children_list) {
+    if (assert_error(
+        replicator == NULL || replicator->client == NULL || children_list == NULL,
+        "handle_chains_change",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    // chains are only added (removing one is not supported)
+    struct TableClientData* client = replicator->client;
+    for (int i = 0; i < children_list->count && client->n_chains < TC_MAX_CHAINS; i++) {
+        int id = atoi(children_list->data[i]);
+        bool known = false;
+        for (int j = 0; j < client->n_chains && !known; j++)
+            known = client->chains[j].id == id;
+        if (known)
+            continue;
+
+        int chain = client->n_chains;
+        client->chains[chain].id = id;
+        zk_chain_path(id, replicator->chains[chain].path, sizeof(replicator->chains[chain].path));
+        // the chain is routed to once complete
+        __atomic_store_n(&client->n_chains, chain + 1, __ATOMIC_RELEASE);
+        LOG_INFO(ZK_CLIENT_NEW_CHAIN, id);
+        client_chain_watch(replicator, chain);
+    }
+}
+
+void client_child_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx) {
+    struct TableClientReplicationData* replicator = (struct TableClientReplicationData*)watcher_ctx;
+    if (state != ZOO_CONNECTED_STATE || type != ZOO_CHILD_EVENT)
+        return;
+
+    if (strcmp(zpath, CHAINS_PATH) == 0) {
+        /* Get the updated chains and reset the watch */
+        zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
+        if (assert_error(
+            children_list == NULL,
+            "child_watcher",
+            ERROR_MALLOC
+        )) return;
+
+        if (assert_error(
+            zoo_wget_children(wzh, CHAINS_PATH, client_child_watcher, watcher_ctx, children_list) != ZOK,
+            "child_watcher",
+            "Error setting watch\n"
+        )) {
+            destroy_dynamic_memory(children_list);
+            return;
+        }
+        handle_chains_change(replicator, children_list);
+        zk_free_list(children_list);
+        return;
+    }
+
+    // the servers of a chain changed
+    for (int chain = 0; chain < replicator->client->n_chains; chain++) {
+        if (strcmp(zpath, replicator->chains[chain].path) == 0)
+            client_chain_watch(replicator, chain);
+    }
+}
+
+// replaces the ring routing the keys
+static void client_ring_update(struct TableClientReplicationData* replicator) {
+    struct hash_ring_t* ring = zk_ring_get(replicator->zh, client_ring_watcher, replicator);
+    if (assert_error(
+        ring == NULL,
+        "client_ring_update",
+        "Error setting watch\n"
+    )) return;
+
+    struct TableClientData* client = replicator->client;
+    pthread_mutex_lock(&client->mutex);
+    struct hash_ring_t* previous = client->ring;
+    client->ring = ring;
+    pthread_mutex_unlock(&client->mutex);
+    hash_ring_destroy(previous);
+    LOG_INFO(ZK_CLIENT_RING_UPDATE, ring->n_chains);
+}
+
+void client_ring_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx) {
+    (void)wzh;
+    (void)zpath;
+    if (state == ZOO_CONNECTED_STATE && type == ZOO_CHILD_EVENT)
+        client_ring_update((struct TableClientReplicationData*)watcher_ctx);
+}
+
 void zk_client_init(struct TableClientReplicationData* replicator, struct TableClientData* client, struct TableClientOptions* options) {
     zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
     if (assert_error(
@@ -85,6 +251,7 @@ void zk_client_init(struct TableClientReplicationData* replicator, struct TableC
     )) return;
 
     replicator->client = client;
+    replicator->apportioned_reads = strcmp(get_env_string("NODEDB_READS", "chain"), "tail") != 0;
 
     // 1. retrieve the token
     replicator->zh = zk_connect(options->zk_connection_str);
@@ -94,7 +261,10 @@ void zk_client_init(struct TableClientReplicationData* replicator, struct TableC
         "Failed to retrieve token from Zookeeper.\n"
     )) return;
 
-    // 2. watch /chain children
+    // 2. watch the ring, and the chains and their servers
+    if (ensure_chain_exists(replicator->zh, CHAINS_PATH) && ensure_chain_exists(replicator->zh, RING_PATH))
+        client_ring_update(replicator);
+
     zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
     if (assert_error(
         children_list == NULL,
@@ -102,16 +272,9 @@ void zk_client_init(struct TableClientReplicationData* replicator, struct TableC
         ERROR_MALLOC
     )) return;
 
-    if (zoo_wget_children(replicator->zh, CHAIN_PATH, client_child_watcher, replicator, children_list) != ZOK) {
-        fprintf(stderr, "Error setting watch at %s!\n", CHAIN_PATH);
+    if (zoo_wget_children(replicator->zh, CHAINS_PATH, client_child_watcher, replicator, children_list) != ZOK) {
+        LOG_ERROR("Error setting watch at %s!\n", CHAINS_PATH);
     }
-
-    // get head and tail server
-    char* new_head = zk_get_first_child(children_list, CHAIN_PATH);
-    if (new_head)
-        handle_head_change(replicator, new_head);
-    
-    char* new_tail = zk_get_last_child(children_list, CHAIN_PATH);
-    if (new_tail)
-        handle_tail_change(replicator, new_tail);
-}
\ No newline at end of file
+    handle_chains_change(replicator, children_list);
+    zk_free_list(children_list);
+}
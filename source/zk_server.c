@@ -2,12 +2,77 @@
 
 #include "zk_utils.h"
 #include "utils.h"
+#include "logger.h"
 #include "database.h"
 #include "distributed_database.h"
 #include "address.h"
+#include "snapshot.h"
 
 #include <zookeeper/zookeeper.h>
 #include <stdbool.h>
+#include <string.h>
+
+// opens the replication channel to the server registered under path
+static struct replication_channel_t* zk_replication_connect(zhandle_t* zh, const char* path, struct TableServerDistributedDatabase* ddb) {
+    char* address = zk_node_address(zh, path);
+    if (address == NULL)
+        return NULL;
+
+    LOG_INFO(ZK_ESTABLISHING_REMOTE_SESSION, path, address);
+    struct replication_channel_t* channel = replication_channel_create(address, &ddb->replication_stats);
+    destroy_dynamic_memory(address);
+    return channel;
+}
+
+// the current tail of the chain (the head in fan-out mode), whose table a joining server copies
+static char* zk_snapshot_source(zhandle_t* zh, const char* chain_path, bool fanout) {
+    LOG_INFO(ZK_SERVER_CHECKING_SYNC);
+    zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
+    if (assert_error(
+        children_list == NULL,
+        "zk_snapshot_source",
+        ERROR_MALLOC
+    )) return NULL;
+
+    char* source_path = NULL;
+    if (zoo_get_children(zh, chain_path, 0, children_list) == ZOK)
+        source_path = fanout ? zk_get_first_child(children_list, chain_path) : zk_get_last_child(children_list, chain_path);
+    zk_free_list(children_list);
+    return source_path;
+}
+
+// the head of the chain at chain_path, which the keys of the chain move from
+static char* zk_snapshot_head(zhandle_t* zh, const char* chain_path) {
+    zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
+    if (assert_error(
+        children_list == NULL,
+        "zk_snapshot_head",
+        ERROR_MALLOC
+    )) return NULL;
+
+    char* head_path = NULL;
+    if (zoo_get_children(zh, chain_path, 0, children_list) == ZOK)
+        head_path = zk_get_first_child(children_list, chain_path);
+    zk_free_list(children_list);
+    return head_path;
+}
+
+static struct snapshot_sync_t* zk_snapshot_open(zhandle_t* zh, char* source_path, const char* self, uint64_t since,
+    struct TableServerDistributedDatabase* ddb) {
+    LOG_INFO(ZK_SERVER_SET_SYNC, source_path);
+    char* source = zk_node_address(zh, source_path);
+    if (source == NULL)
+        return NULL;
+
+    struct snapshot_sync_t* sync = snapshot_sync_open(source, self, since, ddb);
+    assert_error(
+        sync == NULL,
+        "zk_snapshot_open",
+        "Failed to copy the table of the previous server.\n"
+    );
+    destroy_dynamic_memory(source);
+    return sync;
+}
 
 void handle_next_server_change(struct TableServerReplicationData* replicator, char* next_node) {
     if (assert_error(
@@ -22,31 +87,94 @@ void handle_next_server_change(struct TableServerReplicationData* replicator, ch
     if (current_next_node != NULL) {
         // handle changes when the current next server is defined
         if (next_node == NULL) {
-            // this server is now the tail! disconnect the current table
-            rtable_disconnect(replicator->ddb->replica);
-            replicator->ddb->replica = NULL;
+            // this server is now the tail! pending mutations are acknowledged here
+            ddb_set_replica(replicator->ddb, NULL);
             changed = true;
         } else if (string_compare(current_next_node, next_node) != EQUAL) {
-            // if not equal, change the next server
-            rtable_disconnect(replicator->ddb->replica); // disconnect the current next server
-            replicator->ddb->replica = zk_table_connect(replicator->zh, next_node);
+            // if not equal, change the next server, which resumes the pending mutations
+            ddb_set_replica(replicator->ddb, zk_replication_connect(replicator->zh, next_node, replicator->ddb));
             changed = true;
         }
     } else {
         // handle changes when the current next server is not defined
         if (next_node != NULL) {
-            replicator->ddb->replica = zk_table_connect(replicator->zh, next_node);
+            ddb_set_replica(replicator->ddb, zk_replication_connect(replicator->zh, next_node, replicator->ddb));
             changed = true;
         }
     }
 
     if (changed)
-        printf(ZK_SERVER_REPLICA_UPDATE, current_next_node ? current_next_node : "None", next_node ? next_node : "None");
+        LOG_INFO(ZK_SERVER_REPLICA_UPDATE, current_next_node ? current_next_node : "None", next_node ? next_node : "None");
     // clean up memory
     destroy_dynamic_memory(replicator->next_server_node_path);
     replicator->next_server_node_path = next_node;
 }
 
+void handle_backups_change(struct TableServerReplicationData* replicator, zoo_string* children_list) {
+    if (assert_error(
+        replicator == NULL || replicator->ddb == NULL || children_list == NULL,
+        "handle_backups_change",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    char* head = zk_get_first_child(children_list, replicator->chain_path);
+    bool is_head = head != NULL && string_compare(head, replicator->server_node_path) == EQUAL;
+    destroy_dynamic_memory(head);
+    if (!is_head) {
+        // the head sends the mutations straight to this server, which forwards them to none
+        ddb_set_backups(replicator->ddb, NULL, 0);
+        return;
+    }
+
+    char* addresses[children_list->count + 1];
+    int n_addresses = 0;
+    for (int i = 0; i < children_list->count; i++) {
+        char path[strlen(replicator->chain_path) + 1 + strlen(children_list->data[i]) + 1];
+        snprintf(path, sizeof(path), "%s/%s", replicator->chain_path, children_list->data[i]);
+        if (string_compare(path, replicator->server_node_path) == EQUAL)
+            continue;
+        char* address = zk_node_address(replicator->zh, path);
+        if (address != NULL)
+            addresses[n_addresses++] = address;
+    }
+    ddb_set_backups(replicator->ddb, addresses, n_addresses);
+    LOG_INFO(ZK_SERVER_BACKUPS_UPDATE, n_addresses);
+    for (int i = 0; i < n_addresses; i++)
+        destroy_dynamic_memory(addresses[i]);
+}
+
+// compares the table with the one of the server sending the mutations to this one from now on
+static void zk_server_update_source(struct TableServerReplicationData* replicator, zoo_string* children_list) {
+    char* previous_path = zk_find_previous_node(children_list, replicator->chain_path, replicator->server_node_path);
+    if (replicator->fanout && previous_path != NULL) {
+        destroy_dynamic_memory(previous_path);
+        previous_path = zk_get_first_child(children_list, replicator->chain_path);
+    }
+    char* source = previous_path != NULL ? zk_node_address(replicator->zh, previous_path) : NULL;
+    anti_entropy_set_source(&replicator->anti_entropy, source);
+    destroy_dynamic_memory(source);
+    destroy_dynamic_memory(previous_path);
+}
+
+void handle_tail_server_change(struct TableServerReplicationData* replicator, char* tail_node) {
+    if (assert_error(
+        replicator == NULL || replicator->ddb == NULL,
+        "handle_tail_server_change",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    char* current_tail = replicator->tail_node_path;
+    if (string_compare(current_tail, tail_node) != EQUAL) {
+        // reads of dirty keys go to the new tail; the tail itself has none
+        bool is_tail = tail_node == NULL || string_compare(tail_node, replicator->server_node_path) == EQUAL;
+        ddb_set_tail(replicator->ddb, is_tail ? NULL : zk_table_connect(replicator->zh, tail_node));
+        LOG_INFO(ZK_SERVER_TAIL_UPDATE, current_tail ? current_tail : "None", tail_node ? tail_node : "None");
+    }
+    destroy_dynamic_memory(replicator->tail_node_path);
+    replicator->tail_node_path = tail_node;
+}
+
+static void* zk_server_rejoin(void* _replicator);
 
 void zk_server_child_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx) {
     // parse context to update next server pointer!
@@ -60,13 +188,20 @@ void zk_server_child_watcher(zhandle_t* wzh, int type, int state, const char* zp
         ERROR_MALLOC
     )) return;
 
-    if (state == ZOO_CONNECTED_STATE) {
+    if (type == ZOO_SESSION_EVENT && state == ZOO_EXPIRED_SESSION_STATE) {
+        // the node of this server is gone: rejoin from a thread of its own, the session being closed
+        pthread_t thread;
+        if (!__atomic_exchange_n(&replicator->rejoining, true, __ATOMIC_ACQ_REL)) {
+            if (pthread_create(&thread, &replicator->ddb->db->thread_attr, zk_server_rejoin, replicator) != 0)
+                __atomic_store_n(&replicator->rejoining, false, __ATOMIC_RELEASE);
+        }
+    } else if (state == ZOO_CONNECTED_STATE) {
         if (type == ZOO_CHILD_EVENT) {
             /* Get the updated children and reset the watch */ 
             if (assert_error(
                 zoo_wget_children(
                     wzh, 
-                    CHAIN_PATH, 
+                    replicator->chain_path, 
                     zk_server_child_watcher, 
                     watcher_ctx, 
                     children_list) != ZOK,
@@ -74,78 +209,291 @@ void zk_server_child_watcher(zhandle_t* wzh, int type, int state, const char* zp
                 "Error setting watch\n"
             )) return;
 
-            // get next server
-            char* next_node = zk_find_successor_node(children_list, CHAIN_PATH, replicator->server_node_path);
-            handle_next_server_change(replicator, next_node);
+            // get next server, or the backups of the head in fan-out mode
+            if (replicator->fanout) {
+                handle_backups_change(replicator, children_list);
+            } else {
+                char* next_node = zk_find_successor_node(children_list, replicator->chain_path, replicator->server_node_path);
+                handle_next_server_change(replicator, next_node);
+            }
+            handle_tail_server_change(replicator, zk_get_last_child(children_list, replicator->chain_path));
+            zk_server_update_source(replicator, children_list);
         }
     }
     zk_free_list(children_list);
 }
 
-void zk_server_init(struct TableServerReplicationData* replicator, struct TableServerDistributedDatabase* ddb, struct TableServerOptions* options) {
-    zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
+// tells whether this server is the head of its chain
+static bool zk_server_is_head(struct TableServerReplicationData* replicator) {
+    zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
     if (assert_error(
-        replicator == NULL || ddb == NULL || ddb->db == NULL || options == NULL || options->zk_connection_str == NULL,
-        "replicator_init",
-        ERROR_NULL_POINTER_REFERENCE
-    )) return;
+        children_list == NULL,
+        "zk_server_is_head",
+        ERROR_MALLOC
+    )) return false;
 
-    replicator->ddb = ddb;
+    bool head = false;
+    if (zoo_get_children(replicator->zh, replicator->chain_path, 0, children_list) == ZOK) {
+        char* head_path = zk_get_first_child(children_list, replicator->chain_path);
+        head = head_path != NULL && string_compare(head_path, replicator->server_node_path) == EQUAL;
+        destroy_dynamic_memory(head_path);
+    }
+    zk_free_list(children_list);
+    return head;
+}
 
-    // 1. retrieve the token
-    replicator->zh = zk_connect(options->zk_connection_str);
-    if (replicator->zh == NULL)
+// deletes the keys moved to other chains down the chain, from a thread of its own
+static void* zk_server_purge(void* _replicator) {
+    struct TableServerReplicationData* replicator = _replicator;
+    int purged = ddb_purge(replicator->ddb);
+    if (purged > 0)
+        LOG_INFO(ZK_SERVER_PURGED, purged);
+    __atomic_store_n(&replicator->purging, false, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+void zk_server_ring_watcher(zhandle_t* wzh, int type, int state, const char* zpath, void* watcher_ctx) {
+    (void)wzh;
+    (void)zpath;
+    struct TableServerReplicationData* replicator = (struct TableServerReplicationData*)watcher_ctx;
+    if (state != ZOO_CONNECTED_STATE || type != ZOO_CHILD_EVENT)
         return;
 
+    // get the updated ring and reset the watch
+    struct hash_ring_t* ring = zk_ring_get(replicator->zh, zk_server_ring_watcher, replicator);
+    if (assert_error(
+        ring == NULL,
+        "zk_server_ring_watcher",
+        "Error setting watch\n"
+    )) return;
+    LOG_INFO(ZK_SERVER_RING_UPDATE, ring->n_chains);
+    ddb_set_ring(replicator->ddb, ring);
+
+    // the head deletes the keys another chain took over, its successors following
+    pthread_t thread;
+    if (zk_server_is_head(replicator) && !__atomic_exchange_n(&replicator->purging, true, __ATOMIC_ACQ_REL)) {
+        if (pthread_create(&thread, &replicator->ddb->db->thread_attr, zk_server_purge, replicator) != 0)
+            __atomic_store_n(&replicator->purging, false, __ATOMIC_RELEASE);
+    }
+}
 
-    // 2. make sure that root path is created
-    if (!ensure_chain_exists(replicator->zh, CHAIN_PATH))
+// takes over the keys moving to the chain of this server from the heads of the chains in the ring,
+// until the chain joins the ring
+static void zk_server_take_over(struct TableServerReplicationData* replicator, const char* self) {
+    struct TableServerDistributedDatabase* ddb = replicator->ddb;
+    struct hash_ring_t* ring = zk_ring_get(replicator->zh, NULL, NULL);
+    if (ring == NULL || hash_ring_contains(ring, replicator->chain)) {
+        hash_ring_destroy(ring);
         return;
+    }
+
+    struct snapshot_sync_t* syncs[ring->n_chains + 1];
+    // mutations of clients, arriving once the chain joins the ring, supersede the logged ones
+    ddb_set_syncing(ddb, true);
+    for (int i = 0; i < ring->n_chains; i++) {
+        char chain_path[64];
+        zk_chain_path(ring->chains[i], chain_path, sizeof(chain_path));
+        syncs[i] = NULL;
+        char* head_path = zk_snapshot_head(replicator->zh, chain_path);
+        char* source = head_path != NULL ? zk_node_address(replicator->zh, head_path) : NULL;
+        if (source == NULL) {
+            LOG_WARN(ZK_SERVER_NO_HEAD, ring->chains[i], replicator->chain);
+        } else {
+            LOG_INFO(ZK_SERVER_TAKING_OVER, ring->chains[i], source);
+            syncs[i] = snapshot_migration_open(source, self, replicator->chain, ddb);
+            assert_error(
+                syncs[i] == NULL,
+                "zk_server_take_over",
+                "Failed to copy the keys of another chain.\n"
+            );
+        }
+        destroy_dynamic_memory(source);
+        destroy_dynamic_memory(head_path);
+    }
+
+    // the heads stop taking mutations of the keys moved once they see the chain in the ring
+    bool joined = zk_ring_join(replicator->zh, replicator->chain) == 0;
+    if (joined) {
+        struct hash_ring_t* joined_ring = zk_ring_get(replicator->zh, NULL, NULL);
+        if (joined_ring != NULL) {
+            LOG_INFO(ZK_SERVER_JOINED_RING, replicator->chain, joined_ring->n_chains);
+            ddb_set_ring(ddb, joined_ring);
+        }
+    }
+    for (int i = 0; i < ring->n_chains; i++) {
+        if (!joined) {
+            snapshot_sync_abort(syncs[i]);
+            continue;
+        }
+        if (syncs[i] != NULL) {
+            assert_error(
+                snapshot_sync_finish(syncs[i], ddb) == -1,
+                "zk_server_take_over",
+                "Failed to replay the mutations of another chain.\n"
+            );
+        }
+    }
+    ddb_set_syncing(ddb, false);
+    hash_ring_destroy(ring);
+}
 
-    // 3. create and get node id for this server!
+// copies the table of the current tail (or only the mutations after since, if still held) and joins the chain after it
+static void zk_server_join(struct TableServerReplicationData* replicator, uint64_t since) {
+    struct TableServerDistributedDatabase* ddb = replicator->ddb;
+
+    // 2b. watch the ring, telling which keys the chain holds
+    struct hash_ring_t* ring = zk_ring_get(replicator->zh, zk_server_ring_watcher, replicator);
+    if (ring == NULL)
+        LOG_ERROR("Error setting watch at %s!\n", RING_PATH);
+    else
+        ddb_set_ring(ddb, ring);
+
+    // 3. copy the table of the current tail, which keeps streaming its mutations until this server follows it
     char* server_address_str = get_ip_address();
-    replicator->server_node_path = zk_register_server(replicator->zh, server_address_str ? server_address_str : "127.0.0.1", options->listening_port);
+    char* host = server_address_str ? server_address_str : "127.0.0.1";
+    char self[64];
+    snprintf(self, sizeof(self), "%s:%d", host, replicator->listening_port);
+    // replicated mutations, arriving once this server joins, supersede the copied ones
+    ddb_set_syncing(ddb, true);
+    char* source_path = zk_snapshot_source(replicator->zh, replicator->chain_path, replicator->fanout);
+    struct snapshot_sync_t* sync = source_path ? zk_snapshot_open(replicator->zh, source_path, self, since, ddb) : NULL;
+
+    // 4. create and get node id for this server!
+    ddb_attach(ddb);
+    destroy_dynamic_memory(replicator->server_node_path);
+    replicator->server_node_path = zk_register_server(replicator->zh, replicator->chain_path, host, replicator->listening_port);
     destroy_dynamic_memory(server_address_str);
-    if (replicator->server_node_path == NULL)
+    if (replicator->server_node_path == NULL) {
+        snapshot_sync_abort(sync);
+        destroy_dynamic_memory(source_path);
         return;
+    }
     
-    // 4. watch /chain children
+    // 5. watch the children of the chain
     zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
     if (assert_error(
         children_list == NULL,
-        "zk_server_init",
+        "zk_server_join",
         ERROR_MALLOC
     )) return;
 
-    if (ZOK != zoo_wget_children(replicator->zh, CHAIN_PATH, zk_server_child_watcher, replicator, children_list)) {
-        fprintf(stderr, "Error setting watch at %s!\n", CHAIN_PATH);
+    if (ZOK != zoo_wget_children(replicator->zh, replicator->chain_path, zk_server_child_watcher, replicator, children_list)) {
+        LOG_ERROR("Error setting watch at %s!\n", replicator->chain_path);
     }
     
-    // 5. retrieve next server from zk and setup remote table
-    replicator->next_server_node_path = zk_find_successor_node(children_list, CHAIN_PATH, replicator->server_node_path);
+    // 6. retrieve next server (or the backups) from zk and setup remote table
+    destroy_dynamic_memory(replicator->next_server_node_path);
+    replicator->next_server_node_path = replicator->fanout ? NULL : zk_find_successor_node(children_list, replicator->chain_path, replicator->server_node_path);
+    if (replicator->fanout)
+        handle_backups_change(replicator, children_list);
     if (replicator->next_server_node_path != NULL) {
-        printf(ZK_SERVER_SET_REPLICA, replicator->next_server_node_path, replicator->server_node_path);
-    }
-
-    // 6. retrieve prev server from zk and start migration
-    printf(ZK_SERVER_CHECKING_SYNC);
-    char* prev_server_node_path = zk_find_previous_node(children_list, CHAIN_PATH, replicator->server_node_path);
-    if (prev_server_node_path != NULL) {
-        printf(ZK_SERVER_SET_SYNC, prev_server_node_path);
-        struct rtable_t* migration_table = zk_table_connect(replicator->zh, prev_server_node_path);
-        if (migration_table != NULL) {
-            printf(ZK_SERVER_SESSION_OK_FOR_SYNC, prev_server_node_path);
-            db_migrate_table(ddb->db, migration_table);
-            rtable_disconnect(migration_table);
-            destroy_dynamic_memory(prev_server_node_path);
-        }
+        LOG_INFO(ZK_SERVER_SET_REPLICA, replicator->next_server_node_path, replicator->server_node_path);
+        ddb_set_replica(ddb, zk_replication_connect(replicator->zh, replicator->next_server_node_path, ddb));
+    }
+    handle_tail_server_change(replicator, zk_get_last_child(children_list, replicator->chain_path));
+
+    // another server joined while the table was copied (or the head changed, in fan-out mode): copy the
+    // table of the server actually sending the mutations to this one
+    char* previous_path = zk_find_previous_node(children_list, replicator->chain_path, replicator->server_node_path);
+    bool head = previous_path == NULL;
+    if (replicator->fanout && !head) {
+        destroy_dynamic_memory(previous_path);
+        previous_path = zk_get_first_child(children_list, replicator->chain_path);
+    }
+    if (previous_path != NULL && (source_path == NULL || string_compare(previous_path, source_path) != EQUAL)) {
+        LOG_INFO(ZK_SERVER_RESYNC, source_path ? source_path : "None", previous_path);
+        snapshot_sync_abort(sync);
+        ddb_sync_reset(ddb);
+        sync = zk_snapshot_open(replicator->zh, previous_path, self, 0, ddb);
+    }
+    destroy_dynamic_memory(previous_path);
+    destroy_dynamic_memory(source_path);
+
+    // 7. replay what the previous tail applied until it saw this server join
+    if (sync != NULL) {
+        assert_error(
+            snapshot_sync_finish(sync, ddb) == -1,
+            "zk_server_join",
+            "Failed to replay the mutations of the previous server.\n"
+        );
     }
-    printf(ZK_SERVER_COMPLETED_SYNC);
+    ddb_set_syncing(ddb, false);
+
+    // 8. the first server of a new chain takes its keys over before clients are sent to it
+    if (head)
+        zk_server_take_over(replicator, self);
+    // 9. compare the table with the one of the predecessor from now on
+    zk_server_update_source(replicator, children_list);
+    LOG_INFO(ZK_SERVER_COMPLETED_SYNC);
     // free list
     zk_free_list(children_list);
     replicator->valid = 1;
 }
 
+// makes sure that the chains, the chain of this server and the ring exist
+static bool zk_server_ensure_paths(struct TableServerReplicationData* replicator) {
+    return ensure_chain_exists(replicator->zh, CHAINS_PATH) && ensure_chain_exists(replicator->zh, replicator->chain_path)
+        && ensure_chain_exists(replicator->zh, RING_PATH);
+}
+
+// joins the chain again under a new session, presenting what this server already holds
+static void* zk_server_rejoin(void* _replicator) {
+    struct TableServerReplicationData* replicator = _replicator;
+    struct TableServerDistributedDatabase* ddb = replicator->ddb;
+
+    // no table is compared with the one being copied
+    anti_entropy_pause(&replicator->anti_entropy);
+    anti_entropy_set_source(&replicator->anti_entropy, NULL);
+    // the previous server of this one forwards to the next one now
+    ddb_detach(ddb);
+    // a copy cut short holds no mutation reliably
+    uint64_t since = replicator->valid ? backlog_applied(&ddb->backlog) : 0;
+    replicator->valid = 0;
+    LOG_INFO(ZK_SERVER_REJOINING, (unsigned long)since);
+
+    zookeeper_close(replicator->zh);
+    replicator->zh = zk_connect(replicator->zk_connection_str);
+    if (replicator->zh != NULL && zk_server_ensure_paths(replicator))
+        zk_server_join(replicator, since);
+    anti_entropy_resume(&replicator->anti_entropy);
+    __atomic_store_n(&replicator->rejoining, false, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+void zk_server_init(struct TableServerReplicationData* replicator, struct TableServerDistributedDatabase* ddb, struct TableServerOptions* options) {
+    zoo_set_debug_level(ZOO_LOG_LEVEL_ERROR);
+    if (assert_error(
+        replicator == NULL || ddb == NULL || ddb->db == NULL || options == NULL || options->zk_connection_str == NULL,
+        "replicator_init",
+        ERROR_NULL_POINTER_REFERENCE
+    )) return;
+
+    replicator->ddb = ddb;
+    replicator->zk_connection_str = options->zk_connection_str;
+    replicator->listening_port = options->listening_port;
+    replicator->chain = get_env_int("NODEDB_CHAIN", 0);
+    replicator->fanout = strcmp(get_env_string("NODEDB_REPLICATION_MODE", "chain"), "fanout") == 0;
+    zk_chain_path(replicator->chain, replicator->chain_path, sizeof(replicator->chain_path));
+    ddb->chain = replicator->chain;
+
+    anti_entropy_start(&replicator->anti_entropy, ddb);
+
+    // 1. retrieve the token
+    replicator->zh = zk_connect(options->zk_connection_str);
+    if (replicator->zh == NULL)
+        return;
+
+
+    // 2. make sure that the paths of the chain and the ring are created
+    if (!zk_server_ensure_paths(replicator))
+        return;
+
+    // 3-9. copy the table of the current tail and join the chain
+    anti_entropy_pause(&replicator->anti_entropy);
+    zk_server_join(replicator, 0);
+    anti_entropy_resume(&replicator->anti_entropy);
+}
+
 
 void zk_server_destroy(struct TableServerReplicationData* replicator) {
     if (assert_error(
@@ -154,7 +502,9 @@ void zk_server_destroy(struct TableServerReplicationData* replicator) {
         ERROR_NULL_POINTER_REFERENCE
     )) return;
 
+    anti_entropy_stop(&replicator->anti_entropy);
     destroy_dynamic_memory(replicator->server_node_path);
     destroy_dynamic_memory(replicator->next_server_node_path);
+    destroy_dynamic_memory(replicator->tail_node_path);
     zookeeper_close(replicator->zh);
 }
\ No newline at end of file
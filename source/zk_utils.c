@@ -1,9 +1,11 @@
 #include "zk_utils.h"
 
 #include "utils.h"
+#include "logger.h"
 
 #include "client_stub.h"
 #include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <zookeeper/zookeeper.h>
@@ -56,6 +58,9 @@ char* zk_get_last_child(zoo_string* children_list, const char* path) {
 void connection_watcher(zhandle_t *zzh, int type, int state, const char *path, void* context) {
     // parse context to update variables!
     struct ConnectionContext* connection_ctx = (struct ConnectionContext*)context;
+    // the context lives only until the connection is established (see zk_connect)
+    if (connection_ctx == NULL)
+        return;
 
     pthread_mutex_lock(connection_ctx->mutex);
     if (type == ZOO_SESSION_EVENT) {
@@ -98,10 +103,14 @@ zhandle_t* zk_connect(char* zk_connection_str) {
     }
 
     // just leave when connection is established!
+    pthread_mutex_lock(&connection_established_mutex);
     while (!connection_established) {
         if (pthread_cond_wait(&connection_established_cond, &connection_established_mutex) != 0)
             break;
     }
+    // later session events (e.g. expiry) must not reach the context on this stack
+    zoo_set_context(zh, NULL);
+    pthread_mutex_unlock(&connection_established_mutex);
 
     pthread_mutex_destroy(&connection_established_mutex);
     pthread_cond_destroy(&connection_established_cond);
@@ -120,8 +129,47 @@ int ensure_chain_exists(zhandle_t* zh, const char* path) {
     return 1;
 }
 
-char* zk_register_server(zhandle_t* zh, char* host_str, int host_port) {
-    printf(ZK_REGISTER_SERVER);
+void zk_chain_path(int chain, char* path, size_t size) {
+    snprintf(path, size, "%s/%d", CHAINS_PATH, chain);
+}
+
+struct hash_ring_t* zk_ring_get(zhandle_t* zh, watcher_fn watcher, void* watcher_ctx) {
+    zoo_string* children_list = (zoo_string *)create_dynamic_memory(sizeof(zoo_string));
+    if (assert_error(
+        children_list == NULL,
+        "zk_ring_get",
+        ERROR_MALLOC
+    )) return NULL;
+
+    int result = watcher != NULL ? zoo_wget_children(zh, RING_PATH, watcher, watcher_ctx, children_list)
+        : zoo_get_children(zh, RING_PATH, 0, children_list);
+    if (result != ZOK) {
+        destroy_dynamic_memory(children_list);
+        return NULL;
+    }
+
+    // children are named after their chain
+    int* chains = create_dynamic_memory((children_list->count + 1) * sizeof(int));
+    struct hash_ring_t* ring = NULL;
+    if (chains != NULL) {
+        for (int i = 0; i < children_list->count; i++)
+            chains[i] = atoi(children_list->data[i]);
+        ring = hash_ring_create(chains, children_list->count);
+    }
+    destroy_dynamic_memory(chains);
+    zk_free_list(children_list);
+    return ring;
+}
+
+int zk_ring_join(zhandle_t* zh, int chain) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%d", RING_PATH, chain);
+    int result = zoo_create(zh, path, NULL, -1, &ZOO_OPEN_ACL_UNSAFE, 0, NULL, 0);
+    return result == ZOK || result == ZNODEEXISTS ? 0 : -1;
+}
+
+char* zk_register_server(zhandle_t* zh, const char* chain_path, char* host_str, int host_port) {
+    LOG_INFO(ZK_REGISTER_SERVER);
     // alloc mem for the new_path buffer
     char* generated_path = create_dynamic_memory(1024);
     if (assert_error(
@@ -134,12 +182,15 @@ char* zk_register_server(zhandle_t* zh, char* host_str, int host_port) {
     // fill node data with host and port!
     snprintf(node_data, sizeof(node_data), "%s:%d", host_str, host_port);
 
+    char node_path[strlen(chain_path) + 1 + strlen(NODE_NAME) + 1];
+    snprintf(node_path, sizeof(node_path), "%s/%s", chain_path, NODE_NAME);
+
     // create the ephemeral sequential ZNode
-    if (zoo_create(zh, NODE_PATH, node_data, strlen(node_data), &ZOO_OPEN_ACL_UNSAFE, ZOO_EPHEMERAL | ZOO_SEQUENCE, generated_path, 1024) != ZOK) {
+    if (zoo_create(zh, node_path, node_data, strlen(node_data), &ZOO_OPEN_ACL_UNSAFE, ZOO_EPHEMERAL | ZOO_SEQUENCE, generated_path, 1024) != ZOK) {
         destroy_dynamic_memory(generated_path);
         return NULL;
     }
-    printf(ZK_REGISTERED_SERVER, generated_path, node_data);
+    LOG_INFO(ZK_REGISTERED_SERVER, generated_path, node_data);
 
     // return the node path
     return generated_path;
@@ -206,15 +257,23 @@ char* zk_find_successor_node(zoo_string* children_list, const char* path, char*
     return successor;
 }
 
-struct rtable_t* zk_table_connect(zhandle_t* zh, const char* path) {    
+char* zk_node_address(zhandle_t* zh, const char* path) {
     int size = 32;
-    char* node_data = create_dynamic_memory(size * sizeof(char));
-    if (zoo_get(zh, path, 0, node_data, &size, NULL) != ZOK) {
+    char* node_data = create_dynamic_memory((size + 1) * sizeof(char));
+    if (node_data == NULL || zoo_get(zh, path, 0, node_data, &size, NULL) != ZOK || size < 0) {
         destroy_dynamic_memory(node_data);
         return NULL;
     }
+    node_data[size] = '\0';
+    return node_data;
+}
+
+struct rtable_t* zk_table_connect(zhandle_t* zh, const char* path) {    
+    char* node_data = zk_node_address(zh, path);
+    if (node_data == NULL)
+        return NULL;
 
-    printf(ZK_ESTABLISHING_REMOTE_SESSION, path, node_data);
+    LOG_INFO(ZK_ESTABLISHING_REMOTE_SESSION, path, node_data);
     struct rtable_t* table = rtable_connect(node_data);
     destroy_dynamic_memory(node_data);
     return table;    